@@ -62,15 +62,23 @@
  *       When setting an attribute, the corresponding crc is calculated and stored in this buffer then written into the file.
  *       When uninitilizing the component this bufffer is written in the file.
  *
- * So the non volatile memory layout will be as below. The size of non-volatile memory is set in GPNVM_MEMORY_SIZE.
+ * So the non volatile memory layout will be as below, after a header identifying the image (see 16). The size of non-volatile
+ * memory is set in GPNVM_MEMORY_SIZE.
  * The size of user attributes data area = GPNVM_MEMORY_SIZE - 2*GPNVM_MEMORY_INDEX_TABLE_SIZE - GPNVM_ATTRIBUTES_CRCS_SIZE
  *                                       = GPNVM_MEMORY_SIZE - 768 bytes
- *               ____________________________________________________________________________________
- *               |Attribute index table area|Attribute CRC table area|   User attributes data area   |
- *               |        (512 bytes)       |      (256 bytes)       |(GPNVM_MEMORY_SIZE - 768 bytes)|
- *               |__________________________|________________________|_______________________________|
+ *        ___________________________________________________________________________________________
+ *        |Header|Attribute index table area|Attribute CRC table area|   User attributes data area   |
+ *        |      |        (512 bytes)       |      (256 bytes)       |(GPNVM_MEMORY_SIZE - 768 bytes)|
+ *        |______|__________________________|________________________|_______________________________|
  *                                          Non-volatile memory layout
  *
+ * Each area starts on a GPNVM_REGION_ALIGNMENT boundary in the file, and the space left between two areas is filled with 0xFF.
+ * The default alignment of 1 gives the packed layout above. Setting it to the file system block size (e.g. 4096) aligns every area
+ * on a block, so writing an area never updates part of a block that belongs to another area. The file size is GPNVM_IMAGE_SIZE,
+ * the end of the user attributes data area rounded up to the alignment.
+ * The alignment is a build setting rather than the st_blksize of the file: it is part of the geometry stored in the header, so an
+ * image keeps its layout when it is copied to another file system. gpNvm_Init only warns when st_blksize does not divide it.
+ *
  *
  * 2) Init
  *
@@ -79,6 +87,9 @@
  * gpNvm_MemoryCache, gpNvm_MemoryIndexTable and gpNvm_AttributesCrcTable buffers.
  * If not, we initialize the cache by setting gpNvm_MemoryIndexTable buffer to 0xFFFF, gpNvm_AttributesCrcTable buffer to 0xFF and
  * gpNvm_MemoryCache buffer to zeros. Then this file is created and the cache is written there.
+ * A file smaller than GPNVM_IMAGE_SIZE (e.g. a new one) is first preallocated with fallocate, so later writes never extend the file
+ * and the latency of setting an attribute does not depend on block allocation. The header of an existing file is checked before
+ * (see 16).
  *
  *
  * 3) Uninit
@@ -114,15 +125,235 @@
  *   - copy attribute value to gpNvm_MemoryCache[offset + 1] => gpNvm_MemoryCache[offset + length]
  *   - the cache gpNvm_MemoryIndexTable, gpNvm_AttributesCrcTable and gpNvm_MemoryCache is written in the file defined by GPNVM_FILE_NAME
  * Here both old and new attributes must have the same length.
+ *
+ * 6) Durability
+ *
+ * Each time the cache is written into the file, the stdio buffer is flushed so the data reaches the operating system.
+ * Forcing it to the storage device (fdatasync) is a durability point whose cost depends on the device, so it is
+ * controlled by a sync policy set with gpNvm_SetSyncPolicy:
+ *   - GPNVM_SYNC_ALWAYS: every write is synced before gpNvm_SetAttribute returns.
+ *   - GPNVM_SYNC_PERIODIC: a write is synced only if the last sync is older than the configured interval. Writes done
+ *     in between are batched in the next sync. As all writes go through the same file, a sync covers every write done
+ *     before it and the order of the writes is preserved. A deferred write is synced by the next commit, or when the
+ *     interval expires by the thread gpNvm_SyncDeadline, started by the first deferred write and stopped by gpNvm_Uninit,
+ *     so the last write before an idle period is durable after one interval at most.
+ *   - GPNVM_SYNC_NONE: the file is synced only by gpNvm_Sync and gpNvm_Uninit.
+ * gpNvm_Init (when it creates the file), gpNvm_Sync and gpNvm_Uninit are always durability points.
+ *
+ * 7) Storage access
+ *
+ * The file is accessed by sectors of GPNVM_SECTOR_SIZE bytes (512 or 4096). When the cache is updated, the sectors of the file holding
+ * the updated bytes are marked dirty in gpNvm_DirtySectors, and writing the cache only writes these sectors instead of the whole file.
+ * Consecutive dirty sectors are gathered in the sector aligned buffer gpNvm_IoBuffer and written with one pwrite at a sector aligned
+ * offset. The file is also loaded by whole sectors through this buffer.
+ * Since all the I/O are aligned, the file can be opened with O_DIRECT (option GPNVM_STORAGE_DIRECT of gpNvm_SetStorageOptions) so that
+ * data already held in the cache is not cached a second time by the operating system, and the latency of setting an attribute does not
+ * depend on page cache writeback of other processes. GPNVM_SECTOR_SIZE must then match the logical block size of the device.
+ *
+ * 8) Bounded cache
+ *
+ * By default the whole user attributes data area is loaded into gpNvm_MemoryCache. For large memories, GPNVM_CACHE_RAM_BUDGET sets the
+ * RAM in bytes used to cache this area instead. Only the index and CRC tables are then loaded at init, and the user area is cached by
+ * pages of one sector in gpNvm_CachePages. A page is read from the file the first time it is accessed (a miss), and when all the pages
+ * are used one is evicted with the CLOCK algorithm, an approximation of LRU: each page has a referenced flag set on access, the clock
+ * hand clears the flag of referenced pages and evicts the first page found without it. A dirty page is written into the file when it is
+ * evicted and when the cache is written. Hits, misses, evictions and writebacks are counted and reported by gpNvm_GetCacheStats.
+ * Pages are written as whole sectors, so this mode needs the user area to start on a sector (GPNVM_REGION_ALIGNMENT multiple of
+ * GPNVM_SECTOR_SIZE).
+ * In both modes, the end of the last stored attribute is kept in gpNvm_UserMemoryEnd, so adding an attribute does not read the length
+ * of every stored attribute.
+ *
+ * 9) RAM minimal mode
+ *
+ * For the smallest targets GPNVM_RAM_MINIMAL removes the caches:
+ *   - 1: only gpNvm_MemoryIndexTable is in RAM. The CRC, length and value of an attribute are read from the file by gpNvm_GetAttribute.
+ *   - 2: no table is in RAM, only the 32 bytes bitmap gpNvm_AttributesPresent telling which attributes are stored, built at init.
+ *        The offset of a stored attribute is also read from the file.
+ * Updates are written through to the file: each updated sector is read into gpNvm_IoBuffer, reduced to one sector, modified and
+ * written back. The value and CRC are written before the index entry, so a new attribute becomes visible once its data is written.
+ * gpNvm_GetRamFootprint reports the static RAM used by the configuration the component is built with.
+ *
+ * 10) Bulk load
+ *
+ * gpNvm_BulkLoad and gpNvm_BulkLoadStream provision many attributes at once. Attributes are given in increasing id order and each
+ * one is laid out in cache by gpNvm_StoreAttribute, the same path as gpNvm_SetAttribute. The dirty sectors of the index, CRC and user
+ * areas are written into the file once at the end, then the file is synced once, instead of one write and one sync per attribute.
+ *
+ * 11) Concurrency and compare-and-set
+ *
+ * The attribute API calls of a process are serialized by gpNvm_Mutex (gpNvm_Init and gpNvm_Uninit must not run concurrently with
+ * other calls). gpNvm_CompareAndSetAttribute reads and compares the stored value then stores the new one under this mutex, so
+ * updaters can do an optimistic read-modify-write without their own lock. With GPNVM_VERSION_TOKENS, gpNvm_AttributeVersions holds
+ * a version per attribute incremented by gpNvm_StoreAttribute when the value changes, and gpNvm_CompareVersionAndSetAttribute
+ * compares this token instead of the value. Tokens are kept in RAM only and restart from 0 at gpNvm_Init. The cache of a process is
+ * not shared, so these guarantees hold between the threads of one process.
+ * The same tokens serve change detection: gpNvm_GetAttributeVersion returns the token of one attribute and gpNvm_GetStoreVersion
+ * a version of the whole store (kept in all modes), both only incremented when a stored value really changes. A reload loop polls
+ * the store version and reads the attributes whose token moved, instead of reading and comparing every value.
+ * Instead of polling, a client can register with gpNvm_Subscribe to a range of attributes. gpNvm_AttributeChanged marks the changed
+ * attributes and the API call that changed them notifies the subscribers after releasing gpNvm_Mutex: a callback per changed
+ * attribute and/or one eventfd wakeup for a poll/epoll loop. Identical writes change nothing so they notify nobody.
+ *
+ * 12) Snapshots
+ *
+ * gpNvm_SnapshotOpen gives a reader a point-in-time view of all the attributes without holding gpNvm_Mutex between its reads.
+ * Snapshots are copy-on-write at attribute granularity: before an attribute is changed in cache (update, new attribute or counter
+ * increment), gpNvm_SnapshotPreserve saves its current value, or its absence, in each open snapshot that has not saved it yet.
+ * gpNvm_SnapshotGet returns the saved value if there is one and the attribute in cache otherwise. A gpNvm_BulkLoad runs under the
+ * mutex, so a snapshot sees all of it or none of it. Writers pay the copy only while snapshots are open, and each snapshot arena
+ * (GPNVM_SNAPSHOT_ARENA_SIZE) holds every attribute once as stored. Values are saved decoded and once per attribute though, and
+ * with GPNVM_COMPRESSION or GPNVM_DEDUP the arena can fill up: each save is bounds-checked, and a snapshot missing a value is
+ * lost, gpNvm_SnapshotGet then returns GPNVM_ERROR_MEMORY_FULL until it is closed. Writers are never refused for a snapshot.
+ *
+ * 13) Multi-process
+ *
+ * With GPNVM_MULTI_PROCESS, several processes can use the same file, each one keeping its own cache of the whole file. They share a
+ * small state in shared memory: a robust process-shared mutex, a generation and one generation per file sector. It is named after
+ * the file (GPNVM_SHM_NAME, then the device and inode of the file), so processes using other files never share it, and it records
+ * its layout and GPNVM_IMAGE_SECTORS, so a state left by another build is rejected. Each process attached by gpNvm_Init counts in
+ * its users, and the last gpNvm_Uninit removes it. A process dying without gpNvm_Uninit leaves it in /dev/shm: it is reused by the
+ * next processes using the file, and can be removed by hand when none does.
+ * A writing API call holds the shared mutex from gpNvm_Lock to gpNvm_Unlock. It first refreshes its cache, then gpNvm_WriteCache
+ * writes only its dirty sectors (never the whole image) and increments their generations. A reading call only compares the shared
+ * generation with the one of its cache and, if another process wrote since, takes the shared mutex and gpNvm_Refresh reloads the
+ * sectors whose generation changed. The attributes found different are saved for the open snapshots before the reload, then get new
+ * versions and are notified to the subscribers of this process. If a process dies holding the shared mutex, the next owner marks all
+ * the sectors as changed so every process reloads the file. Versions and subscriptions stay local to each process.
+ * If the refresh cannot read the file, the API call returns the error before touching the cache, so a writer never writes its
+ * stale sectors over the ones of another process, and the next call refreshes again.
+ *
+ * 14) Read-only mapping
+ *
+ * Loading the image costs a read of the whole file, which dominates for a process fetching a few attributes and exiting. With the
+ * GPNVM_STORAGE_READ_ONLY option, gpNvm_Init opens the existing file read-only and maps it MAP_SHARED instead: gpNvm_GetIndexEntry,
+ * gpNvm_GetCrc, gpNvm_IsCounter and gpNvm_ReadUserMemory read the mapping (gpNvm_Mapping) and the cache stays unused. Only the pages
+ * touched are faulted in, from the page cache shared by all the readers. A reader takes no lock shared with the writers, and sees
+ * their writes as soon as they are in the file. A writer rewriting an attribute can be seen half way, which fails the CRC check, so
+ * the read is retried GPNVM_READ_ONLY_RETRIES times before the attribute is reported corrupted. Writes and snapshots are rejected.
+ *
+ * 15) Counters
+ *
+ * A counter attribute is created and incremented by gpNvm_CounterIncrement. It is marked by a cleared bit in the attributes flags area,
+ * a 32 bytes bitmap stored after the user area (0xFF, the erased state, for plain attributes). Its value is a UInt32 base followed by a
+ * unary bitmap of GPNVM_COUNTER_BITMAP_SIZE bytes:
+ *          ______________________________________________
+ *          |length| base | 0x00 | 0x00 | 0xF8 | 0xFF ... |     counter = base + 19
+ *          |______|______|______|______|______|__________|
+ *                   Layout of a counter attribute
+ * An increment clears the next bit of the bitmap, only programming one byte, and its CRC, computed on the base only, does not change.
+ * When the bitmap is full, the counter is erased: the base is increased by the number of bits, the bitmap is set back to 0xFF and the
+ * CRC is updated, i.e. one rewrite every 8*GPNVM_COUNTER_BITMAP_SIZE increments. gpNvm_GetAttribute and gpNvm_CounterRead return the
+ * counter as a UInt32, gpNvm_SetAttribute rejects it. An image written before the flags area existed is extended with an empty one.
+ *
+ * 16) Header and format versions
+ *
+ * The file starts with gpNvm_Header: a magic, the format version of the layout, a byte order marker, the image size and the
+ * geometry the image was written with (GPNVM_MEMORY_SIZE, GPNVM_REGION_ALIGNMENT, GPNVM_SECTOR_SIZE, GPNVM_COUNTER_BITMAP_SIZE),
+ * protected by a CRC8. It fills whole sectors (GPNVM_HEADER_AREA_SIZE), so the areas after it keep their alignment. gpNvm_Init
+ * reads the first sector only and rejects, before writing anything, a foreign file, a corrupted header, a newer format, another
+ * byte order or geometry, and an image shorter than its size. An image of an older format version is upgraded in place: the
+ * hooks of gpNvm_Upgrades convert it one version at a time, then the new header is written. A new layout only needs a new
+ * GPNVM_FORMAT_VERSION and the hook converting the previous one. Version 0 is the layout without header, recognized by its
+ * size and its first index entries, and upgraded by moving every area after the header. Read-only readers
+ * (GPNVM_STORAGE_READ_ONLY) check the header in the mapping and never upgrade.
+ * The migration streams the image through gpNvm_IoBuffer and is crash-safe: a hook is a sequence of gpNvm_MigrateArea steps
+ * moving areas by chunks, each chunk being synced then recorded in gpNvm_Journal, written in the sector after the image.
+ * Chunks are never longer than the move distance, so moving a chunk again after a crash reads bytes not overwritten yet.
+ * gpNvm_Init finds the journal in the last sector of a file longer than an image and resumes from the recorded step and
+ * chunk before checking the header. Once the header is written the file is truncated to GPNVM_IMAGE_SIZE, dropping it.
+ *
+ * 17) Deltas
+ *
+ * A mirror follows another store without copying its file. It computes a gpNvm_Signature: a 32 bits FNV-1a digest of the
+ * type, length and value of each stored attribute (the CRC8 of the attributes lets 1 change in 256 through, too many to
+ * decide that a value is unchanged). gpNvm_DiffCreate on the other store skips the attributes with the same digest and
+ * records the other ones, and the attributes it does not store as deletes, in a delta protected by its own digest.
+ * gpNvm_DeltaApply on the mirror checks the whole delta and the space it needs before changing anything, then applies it
+ * under gpNvm_Mutex with one write and one sync of the file, as a bulk load. Records hold whole values, so a delta
+ * interrupted by a crash is completed by applying it again, or by the next delta. Attributes removed or replaced leave
+ * holes in the user attributes data area, reclaimed by gpNvm_Compact.
+ *
+ * 18) Change feed
+ *
+ * gpNvm_AttributeChanged also marks the attribute in gpNvm_FeedPending, and gpNvm_Unlock, at the end of the API call, adds a
+ * change per marked attribute to gpNvm_Feed with its value at that point. gpNvm_Feed is a ring of GPNVM_CHANGE_FEED_SIZE bytes
+ * holding [sequence][type][attrId][length][value] entries. When it is full the oldest changes are dropped, so writers never wait
+ * for consumers. A consumer keeps a gpNvm_FeedCursor holding the sequence number of its next change, its offset in the ring
+ * and the number of times the ring wrapped before it, so gpNvm_ChangeFeedRead finds and checks it in constant time. A cursor on
+ * a dropped change, or of a previous gpNvm_Init (another epoch, from the real time clock and a random value so that it differs
+ * across reboots), gets GPNVM_ERROR_FEED_GAP, and the consumer scans the store again, e.g. with a delta (see 17). In
+ * multi-process mode the changes of the other processes enter the feed when gpNvm_Refresh finds them.
+ *
+ * 19) Redundant copies
+ *
+ * With GPNVM_MIRROR_COPIES, the file has copies named <file>.1, <file>.2... holding the same image: every sector written
+ * into the file (gpNvm_WriteFile) is written at the same offset of each copy, and gpNvm_SyncFile syncs them all. gpNvm_Init
+ * rebuilds a copy which is missing or has not the header of the file. When an attribute fails its CRC, gpNvm_ReadAttribute
+ * reads it from the first copy holding it sane, at the same offset with the same type, and only reports it corrupted when
+ * every copy is. The read does not repair the file: the attribute is marked in gpNvm_RepairPending and the next writer
+ * copies it back in place, written with its own update. Since a write copies whole sectors into the copies, gpNvm_Init
+ * also checks every attribute and marks the corrupted ones, so that they are repaired before the first write of a
+ * neighbour in their sector could spread them to the copies. A copy lags the file only between the writes of one sector, so a
+ * crash there can leave it one update behind, which is what a torn write of the file would have read back anyway.
+ * Read-only readers (GPNVM_STORAGE_READ_ONLY) do not use the copies.
+ *
+ * 20) Error correction
+ *
+ * With GPNVM_ECC_INTERLEAVE (I), an ECC table after the flags table holds an entry of 1 + 2*I bytes per attribute: a copy of
+ * its length byte, then two check bytes for each of the I codewords interleaving its value (byte i is in codeword i%I), set
+ * with the CRC by gpNvm_SetEcc. The check bytes of a codeword are the sum of its symbols and their sum weighted by
+ * alpha^position over GF(256), a Reed-Solomon code correcting one symbol: one corrupted byte per codeword, hence any burst of
+ * up to I consecutive bytes. When an attribute fails its CRC, gpNvm_CorrectAttribute corrects it, with the length of the
+ * entry if the length byte is the corrupted one, and the CRC of the corrected value must match, or the CRC is the corrupted
+ * byte when no codeword had an error. The correction comes before the copies (see 19), and a corrected attribute is repaired
+ * in place by the next writer the same way. Getting a sane attribute costs nothing more than the CRC check. The entry size
+ * is in the header, so an image is only opened with the ECC it was built with, and gpNvm_Init fills the entries after
+ * upgrading an older format.
+ *
+ * 21) Compression
+ *
+ * With GPNVM_COMPRESSION, gpNvm_SetAttribute run-length encodes the value (gpNvm_Compress, PackBits: a control byte n < 128
+ * for n+1 literal bytes, n >= 128 for a byte repeated n-125 times), after a byte holding its original length, and stores the
+ * encoded form only when it is shorter, e.g. for the sparse structures of zeros most attributes are. A second bitmap in the
+ * flags table marks the compressed attributes (a cleared bit), so a value without runs is stored as it is and read at no
+ * cost. The stored length byte is the encoded length: the CRC is the one of the decoded value, checked after gpNvm_Decompress,
+ * and the ECC entry covers the stored bytes. An update whose encoded form is not longer than the stored one is written in
+ * place, a longer one is appended like a new attribute and its old range becomes a hole reclaimed by gpNvm_Compact. The codec
+ * is in the header, so an image is only opened with the compression it was built with. gpNvm_GetSpaceStats reports the
+ * compressed attributes and the bytes saved.
+ *
+ * 22) Deduplication
+ *
+ * With GPNVM_DEDUP, several index entries can hold the same offset: an attribute set to a value already stored for another
+ * one points at it instead of storing it again, so provisioning identical defaults writes one copy of the value and then
+ * only the table entries of the other attributes. gpNvm_FindDuplicate uses the CRC table as the content hash, comparing
+ * the stored bytes of the attributes with the CRC and type of the new value, which costs a scan of the index per set.
+ * The reference count of a stored value is the number of index entries holding its offset (gpNvm_CountReferences), it is
+ * not stored apart so a crash cannot leave it wrong. A shared value is never written in place: an attribute changing it is
+ * added after the last one, and deleting an attribute only clears its entry, the value becomes a hole when no entry points
+ * at it anymore. gpNvm_Compact moves a shared value once and updates all its entries. Counters are never shared. The
+ * option is recorded in the header with the compression codec, since a build without it would update a shared value in
+ * place. An image written without it is opened as is, gpNvm_Init then rewrites the header with the option.
  */
 
 /* ==================================================================== */
 /* ========================== Include files =========================== */
 /* ==================================================================== */
 
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 #include "gpNvm.h"
 
 /* ==================================================================== */
@@ -131,24 +362,422 @@
 
 #define GPNVM_MEMORY_INDEX_TABLE_SIZE        256      /* non-volatile memory index table size */
 #define GPNVM_ATTRIBUTES_CRCS_SIZE           256      /* Attributes data crc */
+#define GPNVM_TYPE_FLAGS_SIZE                (256/8)  /* Attributes type bitmap, a cleared bit marks a counter */
+#if GPNVM_COMPRESSION > 0
+/* Followed by the compression bitmap, a cleared bit marks a compressed value */
+#define GPNVM_ATTRIBUTES_FLAGS_SIZE          (2*GPNVM_TYPE_FLAGS_SIZE)
+#define GPNVM_COMPRESSION_CODEC              GPNVM_COMPRESSION
+#else
+#define GPNVM_ATTRIBUTES_FLAGS_SIZE          GPNVM_TYPE_FLAGS_SIZE
+#define GPNVM_COMPRESSION_CODEC              0xFF     /* Recorded in the header of an image without compression */
+#endif
+#if GPNVM_DEDUP > 0
+/* Recorded in the header: the compression codec in the low nibble, shared values in the high one */
+#define GPNVM_VALUE_ENCODING                 (0x10 | GPNVM_COMPRESSION)
+#else
+#define GPNVM_VALUE_ENCODING                 GPNVM_COMPRESSION_CODEC
+#endif
+/* Type of a stored attribute, see gpNvm_GetType */
+#define GPNVM_TYPE_PLAIN                     0
+#define GPNVM_TYPE_COUNTER                   1
+#define GPNVM_TYPE_COMPRESSED                2
+/* Run-length encoding of a compressed value: a control byte below 0x80 is followed by 1 to 128 literal bytes, one above
+   repeats the next byte 3 to 130 times, see gpNvm_Compress */
+#define GPNVM_RLE_MAX_LITERALS               128
+#define GPNVM_RLE_MIN_RUN                    3
+#define GPNVM_RLE_MAX_RUN                    130
+/* Length of the value of a counter attribute: base then unary bitmap */
+#define GPNVM_COUNTER_LENGTH                 (sizeof(UInt32) + GPNVM_COUNTER_BITMAP_SIZE)
 /* User non-volatile memory data size */
 #define GPNVM_USER_MEMORY_SIZE               (GPNVM_MEMORY_SIZE - (sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE + GPNVM_ATTRIBUTES_CRCS_SIZE))
 
+/* Round x up to a multiple of a */
+#define GPNVM_ALIGN_UP(x, a)                 ((((x) + (a) - 1)/(a))*(a))
+/* Image header, see gpNvm_Header */
+#define GPNVM_HEADER_MAGIC                   0x4D564E67  /* "gNVM" in a little-endian file */
+#define GPNVM_HEADER_BYTE_ORDER              0x0102   /* Stored in the byte order of the host writing the image */
+#define GPNVM_FORMAT_VERSION                 1        /* Layout written by this build, 0 is the layout without header */
+#define GPNVM_JOURNAL_MAGIC                  0x47494D67  /* "gMIG" in a little-endian file, see gpNvm_Journal */
+#define GPNVM_DIGEST_BASIS                   2166136261u /* FNV-1a 32 bits offset basis, see gpNvm_Digest */
+#define GPNVM_DIGEST_PRIME                   16777619u   /* FNV-1a 32 bits prime */
+#define GPNVM_FEED_ENTRY_HEADER_SIZE         7        /* Sequence, type, attrId and length of a change in the feed */
+#if (GPNVM_CHANGE_FEED_SIZE > 0) && (GPNVM_CHANGE_FEED_SIZE < GPNVM_FEED_ENTRY_HEADER_SIZE + 255)
+#error "GPNVM_CHANGE_FEED_SIZE must hold a change of 255 bytes"
+#endif
+/* The header takes whole sectors at the start of the file, so the regions after it keep their sector and GPNVM_REGION_ALIGNMENT alignment */
+#define GPNVM_HEADER_AREA_SIZE               GPNVM_ALIGN_UP(GPNVM_ALIGN_UP(sizeof(gpNvm_Header), GPNVM_REGION_ALIGNMENT), GPNVM_SECTOR_SIZE)
+/* Offset of each region in the file, every region starts on a GPNVM_REGION_ALIGNMENT boundary */
+#define GPNVM_INDEX_TABLE_OFFSET             GPNVM_HEADER_AREA_SIZE
+#define GPNVM_CRC_TABLE_OFFSET               GPNVM_ALIGN_UP(GPNVM_INDEX_TABLE_OFFSET + sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE, GPNVM_REGION_ALIGNMENT)
+#define GPNVM_USER_MEMORY_OFFSET             GPNVM_ALIGN_UP(GPNVM_CRC_TABLE_OFFSET + GPNVM_ATTRIBUTES_CRCS_SIZE, GPNVM_REGION_ALIGNMENT)
+#define GPNVM_FLAGS_TABLE_OFFSET             GPNVM_ALIGN_UP(GPNVM_USER_MEMORY_OFFSET + GPNVM_USER_MEMORY_SIZE, GPNVM_REGION_ALIGNMENT)
+#if GPNVM_ECC_INTERLEAVE > 0
+/* ECC entry of an attribute: its length then the two check bytes of each interleaved codeword, see gpNvm_SetEcc */
+#define GPNVM_ECC_ENTRY_SIZE                 (1 + 2*GPNVM_ECC_INTERLEAVE)
+#define GPNVM_ECC_TABLE_SIZE                 (GPNVM_MEMORY_INDEX_TABLE_SIZE*GPNVM_ECC_ENTRY_SIZE)
+#define GPNVM_ECC_TABLE_OFFSET               GPNVM_ALIGN_UP(GPNVM_FLAGS_TABLE_OFFSET + GPNVM_ATTRIBUTES_FLAGS_SIZE, GPNVM_REGION_ALIGNMENT)
+#define GPNVM_IMAGE_END                      (GPNVM_ECC_TABLE_OFFSET + GPNVM_ECC_TABLE_SIZE)
+#else
+#define GPNVM_ECC_ENTRY_SIZE                 0xFF     /* Recorded in the header of an image without ECC */
+#define GPNVM_IMAGE_END                      (GPNVM_FLAGS_TABLE_OFFSET + GPNVM_ATTRIBUTES_FLAGS_SIZE)
+#endif
+/* Primitive polynomial x^8 + x^4 + x^3 + x^2 + 1 of the GF(256) arithmetic of the ECC */
+#define GPNVM_ECC_POLYNOMIAL                 0x1D
+/* Attributes failing their check can be served from their ECC or a copy of the file, then repaired by the next writer */
+#define GPNVM_REPAIR                         ((GPNVM_ECC_INTERLEAVE > 0) || (GPNVM_MIRROR_COPIES > 0))
+/* Size of the file emulating non-volatile memory, it is preallocated when the file is created */
+#define GPNVM_IMAGE_SIZE                     GPNVM_ALIGN_UP(GPNVM_ALIGN_UP(GPNVM_IMAGE_END, GPNVM_REGION_ALIGNMENT), GPNVM_SECTOR_SIZE)
+/* Number of sectors in the file, a sector is the unit of dirty tracking and file I/O */
+#define GPNVM_IMAGE_SECTORS                  (GPNVM_IMAGE_SIZE/GPNVM_SECTOR_SIZE)
+/* Size of the arena of a snapshot: each attribute is saved at most once as [attrId][length][value], one byte more than in the user area.
+ * A compressed value is saved decoded and a shared one once per attribute, so they can take more than in the user area and the arena
+ * can fill up */
+#define GPNVM_SNAPSHOT_ARENA_SIZE            (GPNVM_USER_MEMORY_SIZE + GPNVM_MEMORY_INDEX_TABLE_SIZE)
+#if (GPNVM_COMPRESSION < 0) || (GPNVM_COMPRESSION > 1)
+#error "GPNVM_COMPRESSION must be 0 (none) or 1 (run-length encoding)"
+#endif
+#if (GPNVM_DEDUP < 0) || (GPNVM_DEDUP > 1)
+#error "GPNVM_DEDUP must be 0 or 1"
+#endif
+#if (GPNVM_ECC_INTERLEAVE < 0) || (GPNVM_ECC_INTERLEAVE > 127)
+#error "GPNVM_ECC_INTERLEAVE must be between 0 and 127"
+#endif
+#if (GPNVM_RAM_MINIMAL > 0) && (GPNVM_CACHE_RAM_BUDGET > 0)
+#error "GPNVM_RAM_MINIMAL and GPNVM_CACHE_RAM_BUDGET cannot be used together"
+#endif
+#if GPNVM_MULTI_PROCESS && ((GPNVM_RAM_MINIMAL > 0) || (GPNVM_CACHE_RAM_BUDGET > 0))
+#error "GPNVM_MULTI_PROCESS needs the whole file cached in RAM"
+#endif
+/* Value of gpNvm_SharedState.magic once the shared state is initialized */
+#define GPNVM_SHARED_MAGIC                   0x4E564D53
+/* Layout of gpNvm_SharedState, a shared state of another layout is rejected */
+#define GPNVM_SHARED_VERSION                 2
+/* Attempts to attach the shared state when the last process removes it meanwhile */
+#define GPNVM_SHARED_ATTACH_RETRIES          3
+/* Maximum time waiting for another process to create the shared state, in ms */
+#define GPNVM_SHARED_WAIT_MS                 1000
+/* Reads of an attribute of the read-only mapping failing its CRC check before it is reported corrupted, a writer may be updating it */
+#define GPNVM_READ_ONLY_RETRIES              3
+
+#if GPNVM_RAM_MINIMAL == 1
+/* Only the index table is loaded into RAM */
+#define GPNVM_RESIDENT_SIZE                  GPNVM_CRC_TABLE_OFFSET
+#elif GPNVM_RAM_MINIMAL > 1
+/* Nothing is loaded into RAM */
+#define GPNVM_RESIDENT_SIZE                  0
+#elif GPNVM_CACHE_RAM_BUDGET > 0
+/* Number of pages of the user attributes data area kept in RAM, a page is one sector of the file */
+#define GPNVM_CACHE_PAGES                    (GPNVM_CACHE_RAM_BUDGET/GPNVM_SECTOR_SIZE)
+/* Number of pages in the user attributes data area */
+#define GPNVM_USER_PAGES                     (GPNVM_ALIGN_UP(GPNVM_USER_MEMORY_SIZE, GPNVM_SECTOR_SIZE)/GPNVM_SECTOR_SIZE)
+/* Page cache flags */
+#define GPNVM_CACHE_PAGE_REFERENCED          0x01     /* Page accessed since the clock hand last passed it */
+#define GPNVM_CACHE_PAGE_DIRTY               0x02     /* Page updated in RAM and not yet written into the file */
+#define GPNVM_CACHE_NO_PAGE                  0xFFFF   /* Free slot, or page not in RAM */
+/* Only the index and CRC tables are loaded into RAM */
+#define GPNVM_RESIDENT_SIZE                  GPNVM_USER_MEMORY_OFFSET
+
+#if GPNVM_CACHE_PAGES == 0
+#error "GPNVM_CACHE_RAM_BUDGET must hold at least one GPNVM_SECTOR_SIZE page"
+#endif
+#else
+/* The whole file is loaded into RAM */
+#define GPNVM_RESIDENT_SIZE                  GPNVM_IMAGE_SIZE
+#endif
+
+/* Attribute offsets are stored on 16 bits and 0xFFFF marks a free entry */
+#if (GPNVM_MEMORY_SIZE - 768) >= 0xFFFF
+#error "GPNVM_MEMORY_SIZE is too large for 16 bits attribute offsets"
+#endif
+
+/* ==================================================================== */
+/* ========================== Types Definition ======================== */
+/* ==================================================================== */
+
+/* Header at offset 0 of the file, identifying the image and the geometry it was written with. Fields are in host byte order */
+typedef struct
+{
+	UInt32 magic;                       /* GPNVM_HEADER_MAGIC */
+	UInt16 version;                     /* Format version of the layout, GPNVM_FORMAT_VERSION */
+	UInt16 byteOrder;                   /* GPNVM_HEADER_BYTE_ORDER */
+	UInt32 imageSize;                   /* GPNVM_IMAGE_SIZE, the file is at least this long */
+	UInt32 memorySize;                  /* GPNVM_MEMORY_SIZE */
+	UInt32 regionAlignment;             /* GPNVM_REGION_ALIGNMENT */
+	UInt32 sectorSize;                  /* GPNVM_SECTOR_SIZE, it sets the size of the header area */
+	UInt8 counterBitmapSize;            /* GPNVM_COUNTER_BITMAP_SIZE, it sets the length of the counters */
+	UInt8 eccEntrySize;                 /* GPNVM_ECC_ENTRY_SIZE, 0xFF (reserved before) without ECC */
+	UInt8 encoding;                     /* GPNVM_VALUE_ENCODING, 0xFF (reserved before) without compression nor deduplication */
+	UInt8 crc;                          /* CRC8 of the bytes before it */
+} gpNvm_Header;
+
+/* Journal of a format migration, in the sector following the image until the migration completes. Fields are in host byte order */
+typedef struct
+{
+	UInt32 magic;                       /* GPNVM_JOURNAL_MAGIC */
+	UInt16 version;                     /* Format version the image is being upgraded from */
+	UInt16 step;                        /* gpNvm_MigrateArea step of the upgrade hook in progress */
+	UInt32 done;                        /* Bytes of this step moved and synced */
+	UInt32 fileSize;                    /* Size of the file before the migration started */
+	UInt8 crc;                          /* CRC8 of the bytes before it */
+} gpNvm_Journal;
+
+/* Migration in progress, see gpNvm_UpgradeImage */
+typedef struct
+{
+	gpNvm_Journal journal;              /* Progress, as last written into the file */
+	UInt32 journalOffset;               /* Offset of the journal sector */
+	UInt16 step;                        /* Next gpNvm_MigrateArea step of the running upgrade hook */
+} gpNvm_Migration;
+
+/* Upgrade of an image from one format version to the next one, see gpNvm_Upgrades */
+typedef gpNvm_Result (*gpNvm_UpgradeHook)(gpNvm_Migration* pMigration);
+
+/* Context of gpNvm_ReadBulkArray */
+typedef struct
+{
+	const gpNvm_BulkEntry* pEntries;    /* Attributes to load */
+	UInt16 count;                       /* Number of attributes */
+	UInt16 next;                        /* Next attribute to read */
+} gpNvm_BulkArray;
+
+/* Subscriber to attribute changes, see gpNvm_Subscribe */
+typedef struct
+{
+	gpNvm_ChangeCallback callback;      /* Function called for each changed attribute, or NULL */
+	void* pContext;                     /* Context passed to the callback */
+	int eventFd;                        /* eventfd written once per notification, or -1 */
+	gpNvm_AttrId firstAttrId;           /* First attribute id of the subscribed range */
+	gpNvm_AttrId lastAttrId;            /* Last attribute id of the subscribed range, included */
+	UInt8 used;                         /* 1 if the entry is registered */
+} gpNvm_Subscriber;
+
+/* Point-in-time view of the attributes, see gpNvm_SnapshotOpen */
+typedef struct
+{
+	UInt8 saved[GPNVM_MEMORY_INDEX_TABLE_SIZE/8];   /* Attributes changed since the snapshot was opened */
+	UInt8 absent[GPNVM_MEMORY_INDEX_TABLE_SIZE/8];  /* Saved attributes that were not stored when it was opened */
+	UInt8 values[GPNVM_SNAPSHOT_ARENA_SIZE];        /* Values of the saved attributes, as [attrId][length][value] */
+	UInt16 end;                                     /* End of the last value in values */
+	UInt8 used;                                     /* 1 if the snapshot is open */
+	UInt8 full;                                     /* 1 if a value did not fit in values, the snapshot is lost */
+} gpNvm_Snapshot;
+
+#if GPNVM_MULTI_PROCESS
+/* State shared by the processes using the file, mapped from gpNvm_SharedName */
+typedef struct
+{
+	UInt32 magic;                                   /* GPNVM_SHARED_MAGIC once the mutex is initialized */
+	UInt32 version;                                 /* GPNVM_SHARED_VERSION */
+	UInt32 sectors;                                 /* GPNVM_IMAGE_SECTORS, the size of sectorGenerations */
+	UInt32 users;                                   /* Processes attached, the last one removes the object */
+	UInt8 removed;                                  /* 1 once removed, a process that opened it before maps a new one */
+	pthread_mutex_t mutex;                          /* Robust process-shared lock held by writers */
+	UInt32 generation;                              /* Incremented each time a process writes into the file */
+	UInt32 sectorGenerations[GPNVM_IMAGE_SECTORS];  /* Incremented each time a process writes the sector */
+} gpNvm_SharedState;
+#endif
+
 /* ==================================================================== */
 /* ========================= Global variables ========================= */
 /* ==================================================================== */
 
 /* File descriptor of the file emulating non-volaltile memory */
-static FILE* gpNvm_FileDescriptor = NULL;
+static int gpNvm_FileDescriptor = -1;
+
+/* Read-only shared mapping of the file (GPNVM_STORAGE_READ_ONLY), the cache is not used. NULL otherwise */
+static const UInt8* gpNvm_Mapping = NULL;
+
+/* Storage options (GPNVM_STORAGE_xxx) used when opening the file */
+static UInt8 gpNvm_StorageOptions = 0;
+
+/* File emulating non-volatile memory, GPNVM_FILE_NAME unless set by gpNvm_SetFileName */
+static const char* gpNvm_FileName = GPNVM_FILE_NAME;
+
+#if GPNVM_CACHE_RAM_BUDGET > 0
+/* Pages of user non-volatile memory (attributes) data cached in RAM, managed with the CLOCK algorithm */
+static UInt8 gpNvm_CachePages[GPNVM_CACHE_PAGES][GPNVM_SECTOR_SIZE] __attribute__((aligned(GPNVM_SECTOR_SIZE)));
+
+/* User page held by each slot of gpNvm_CachePages, GPNVM_CACHE_NO_PAGE if the slot is free */
+static UInt16 gpNvm_CachePageNumber[GPNVM_CACHE_PAGES];
+
+/* GPNVM_CACHE_PAGE_xxx flags of each slot of gpNvm_CachePages */
+static UInt8 gpNvm_CachePageFlags[GPNVM_CACHE_PAGES];
+
+/* Slot of gpNvm_CachePages holding each user page, GPNVM_CACHE_NO_PAGE if the page is not in RAM */
+static UInt16 gpNvm_CacheSlot[GPNVM_USER_PAGES];
 
+/* Next slot examined by the CLOCK algorithm to find a page to evict */
+static UInt16 gpNvm_CacheClockHand = 0;
+
+/* Pages are written by whole sectors, they cannot share a sector with the tables */
+_Static_assert((GPNVM_USER_MEMORY_OFFSET % GPNVM_SECTOR_SIZE) == 0, "GPNVM_CACHE_RAM_BUDGET needs GPNVM_REGION_ALIGNMENT to be a multiple of GPNVM_SECTOR_SIZE");
+#elif GPNVM_RAM_MINIMAL == 0
 /* User non-volatile memory (attributes) data cache */
 static UInt8 gpNvm_MemoryCache[GPNVM_USER_MEMORY_SIZE];
+#endif
+
+/* Hit and miss counters of the user non-volatile memory data cache */
+static gpNvm_CacheStats gpNvm_CacheStatistics;
 
+/* End of the last attribute stored in user non-volatile memory, where a new attribute is added */
+static UInt16 gpNvm_UserMemoryEnd = 0;
+
+#if GPNVM_RAM_MINIMAL < 2
 /* Table containing the offset of each attribute stored in user non-volatile memory cache gpNvm_MemoryCache */
 static UInt16 gpNvm_MemoryIndexTable[GPNVM_MEMORY_INDEX_TABLE_SIZE];
+#else
+/* Bitmap of the attributes stored in non-volatile memory, their offset is read from the file */
+static UInt8 gpNvm_AttributesPresent[GPNVM_MEMORY_INDEX_TABLE_SIZE/8];
+#endif
 
+#if GPNVM_RAM_MINIMAL == 0
 /* Table containing the CRC8 of each attribute data in non-volatile memory */
 static UInt8 gpNvm_AttributesCrcTable[GPNVM_ATTRIBUTES_CRCS_SIZE];
+#endif
+
+#if (GPNVM_ECC_INTERLEAVE > 0) && (GPNVM_RAM_MINIMAL == 0)
+/* Table containing the ECC entry of each attribute in non-volatile memory */
+static UInt8 gpNvm_AttributesEccTable[GPNVM_ECC_TABLE_SIZE];
+#endif
+
+/* Attributes flags cache, one bit per attribute cleared for a counter. Kept in RAM in every mode */
+static UInt8 gpNvm_AttributesFlags[GPNVM_ATTRIBUTES_FLAGS_SIZE];
+
+/* Policy deciding when written data is forced to the storage device (fdatasync) */
+static gpNvm_SyncPolicy gpNvm_CurrentSyncPolicy = GPNVM_SYNC_POLICY_DEFAULT;
+
+/* Minimum time between two fdatasync calls when the policy is GPNVM_SYNC_PERIODIC */
+static UInt32 gpNvm_SyncIntervalMs = GPNVM_SYNC_INTERVAL_MS;
+
+/* Monotonic time in ms of the last fdatasync */
+static UInt32 gpNvm_LastSyncTimeMs = 0;
+
+/* Set when data was written into the file but not yet synced */
+static UInt8 gpNvm_SyncPending = 0;
+
+/* Thread syncing a write deferred by GPNVM_SYNC_PERIODIC when the interval expires, woken up through gpNvm_SyncWakeup */
+static pthread_t gpNvm_SyncThread;
+static pthread_cond_t gpNvm_SyncWakeup;
+
+/* 0: the thread is not started, 1: it is running, 2: it is asked to stop, 0x80 is set once the fork handlers are installed */
+static UInt8 gpNvm_SyncThreadState = 0;
+
+/* Serializes the API calls, so a compare-and-set is atomic against other threads */
+static pthread_mutex_t gpNvm_Mutex = PTHREAD_MUTEX_INITIALIZER;
+
+#if GPNVM_VERSION_TOKENS
+/* Version of each attribute, incremented each time its value changes. Reset by gpNvm_Init */
+static UInt32 gpNvm_AttributeVersions[GPNVM_MEMORY_INDEX_TABLE_SIZE];
+#endif
+
+/* Version of the whole store, incremented each time any attribute value changes. Reset by gpNvm_Init */
+static UInt32 gpNvm_StoreVersion = 0;
+
+#if GPNVM_MAX_SUBSCRIBERS > 0
+/* Registered subscribers to attribute changes */
+static gpNvm_Subscriber gpNvm_Subscribers[GPNVM_MAX_SUBSCRIBERS];
+
+/* Bitmap of the attributes changed and not yet notified to the subscribers */
+static UInt8 gpNvm_ChangedAttributes[GPNVM_MEMORY_INDEX_TABLE_SIZE/8];
+
+/* 1 if gpNvm_ChangedAttributes has a bit set */
+static UInt8 gpNvm_ChangesPending = 0;
+#endif
+
+#if GPNVM_MAX_SNAPSHOTS > 0
+/* Open snapshots, holding the old values of the attributes changed since they were opened */
+static gpNvm_Snapshot gpNvm_Snapshots[GPNVM_MAX_SNAPSHOTS];
+
+/* Number of open snapshots, writers skip the copy-on-write when it is 0 */
+static UInt8 gpNvm_SnapshotsOpen = 0;
+#endif
+
+#if GPNVM_CHANGE_FEED_SIZE > 0
+/* Ring of the last changes, as [sequence][type][attrId][length][value] entries, see gpNvm_ChangeFeedRead */
+static UInt8 gpNvm_Feed[GPNVM_CHANGE_FEED_SIZE];
+
+/* Offset of the oldest change in the ring, and number of bytes used from it */
+static UInt32 gpNvm_FeedTail = 0;
+static UInt32 gpNvm_FeedUsed = 0;
+
+/* Number of times gpNvm_FeedTail wrapped around the end of the ring, locating the cursors with their own wrap count */
+static UInt32 gpNvm_FeedTailWraps = 0;
+
+/* Sequence number of the oldest change kept, and of the next change */
+static UInt32 gpNvm_FeedFirst = 0;
+static UInt32 gpNvm_FeedNext = 0;
+
+/* Epoch of the sequence numbers, a new one is taken by each gpNvm_Init */
+static UInt32 gpNvm_FeedEpoch = 0;
+
+/* Attributes changed by the running API call, added to the feed by gpNvm_Unlock */
+static UInt8 gpNvm_FeedPending[GPNVM_MEMORY_INDEX_TABLE_SIZE/8];
+static UInt8 gpNvm_FeedPendingAny = 0;
+#endif
+
+#if GPNVM_MULTI_PROCESS
+/* State shared with the other processes */
+static gpNvm_SharedState* gpNvm_Shared = NULL;
+
+/* Name of the shared memory object of the file: GPNVM_SHM_NAME, then the device and inode of the file */
+static char gpNvm_SharedName[64];
+
+/* Process that attached the shared state, a forked child inherits the mapping without being counted in its users */
+static pid_t gpNvm_SharedOwner = 0;
+
+/* Shared generation the cache was last refreshed at */
+static UInt32 gpNvm_Generation = 0;
+
+/* Shared generation of each sector when it was last loaded into or written from the cache */
+static UInt32 gpNvm_SectorGenerations[GPNVM_IMAGE_SECTORS];
+#endif
+
+#if GPNVM_MIRROR_COPIES > 0
+/* Redundant copies of the file, named <file>.1 to <file>.GPNVM_MIRROR_COPIES, and number of them open */
+static int gpNvm_MirrorDescriptors[GPNVM_MIRROR_COPIES];
+static UInt8 gpNvm_MirrorsOpen = 0;
+#endif
+
+#if GPNVM_REPAIR
+/* Attributes served corrected or from a copy because corrupted in the file, repaired by the next writer */
+static UInt8 gpNvm_RepairPending[GPNVM_MEMORY_INDEX_TABLE_SIZE/8];
+static UInt8 gpNvm_RepairPendingAny = 0;
+#endif
+
+/* Bitmap of the file sectors updated in cache and not yet written into the file */
+static UInt8 gpNvm_DirtySectors[(GPNVM_IMAGE_SECTORS + 7)/8];
+
+/* Sector aligned buffer used for all file I/O, as required by O_DIRECT */
+static UInt8 gpNvm_IoBuffer[GPNVM_IO_BUFFER_SECTORS*GPNVM_SECTOR_SIZE] __attribute__((aligned(GPNVM_SECTOR_SIZE)));
+
+/* Header of the image, written with the other areas when the file is created */
+static gpNvm_Header gpNvm_ImageHeader;
+
+/* Cache buffer of each area of the non-volatile memory and its location in the file */
+static const struct
+{
+	UInt32 offset;
+	UInt32 size;
+	UInt8* pCache;
+} gpNvm_Regions[] =
+{
+	{0, sizeof(gpNvm_Header), (UInt8*)&gpNvm_ImageHeader},
+#if GPNVM_RAM_MINIMAL < 2
+	{GPNVM_INDEX_TABLE_OFFSET, sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE, (UInt8*)gpNvm_MemoryIndexTable},
+#else
+	{0, 0, NULL},
+#endif
+#if GPNVM_RAM_MINIMAL == 0
+	{GPNVM_CRC_TABLE_OFFSET, GPNVM_ATTRIBUTES_CRCS_SIZE, gpNvm_AttributesCrcTable},
+#endif
+#if (GPNVM_CACHE_RAM_BUDGET == 0) && (GPNVM_RAM_MINIMAL == 0)
+	{GPNVM_USER_MEMORY_OFFSET, GPNVM_USER_MEMORY_SIZE, gpNvm_MemoryCache},
+#endif
+	{GPNVM_FLAGS_TABLE_OFFSET, GPNVM_ATTRIBUTES_FLAGS_SIZE, gpNvm_AttributesFlags},
+#if (GPNVM_ECC_INTERLEAVE > 0) && (GPNVM_RAM_MINIMAL == 0)
+	{GPNVM_ECC_TABLE_OFFSET, GPNVM_ECC_TABLE_SIZE, gpNvm_AttributesEccTable},
+#endif
+};
 
 /* ==================================================================== */
 /* ==================== Local functions Definition ==================== */
@@ -188,286 +817,6220 @@ static UInt8 gpNvm_CalculateChecksum(UInt8* ptr, UInt8 length)
     return crc;
 }
 
-/* ==================================================================== */
-/* ======================= Functions Definition ======================= */
-/* ==================================================================== */
-
 /*
- * Name: gpNvm_Init
- * 
- * Description: Initilize non-volatile menory component. First this function
- * will check if the component is already initilized. If not, it will open the
- * file emulating the non-volatil memory. If the file is empty, it will initilize
- * cache and write it into the file. If not, it will load file content into cache.
- * 
+ * Name: gpNvm_GetTimeMs
+ *
+ * Description: Get a monotonic timestamp in milliseconds. It is only used to compute
+ * the elapsed time between two syncs so wrapping around is harmless.
+ *
  * Parameters: None
- * 
- * Return value: gpNvm_Result: GPNVM_OK: the component is initilized successfully
- *                             GPNVM_ERROR_ALREADY_INITIALIZED: the component is already initilized
- *                             GPNVM_ERROR_OPENING_FILE: the is a problem when opening the file emulating the non-volatile memory
+ *
+ * Return value: UInt32: monotonic time in milliseconds
  */
-gpNvm_Result gpNvm_Init(void)
+static UInt32 gpNvm_GetTimeMs(void)
 {
-	//Check if the component is already initialized
-	if(gpNvm_FileDescriptor != NULL)
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (UInt32)(now.tv_sec*1000 + now.tv_nsec/1000000);
+}
+
+/*
+ * Name: gpNvm_CopyImage
+ *
+ * Description: Copy bytes between the cache and a buffer holding the same bytes as the file at a given offset.
+ * The file offset is translated into the cache buffer of the area it belongs to. When copying to the buffer,
+ * the space between areas is filled with 0xFF. When copying to the cache, this space is ignored.
+ *
+ * Parameters:
+ *            UInt32 offset: offset in the file of the first byte of the buffer
+ *            UInt8* pBuffer: buffer to copy from or to
+ *            UInt32 length: number of bytes to copy
+ *            UInt8 toCache: 1 to copy the buffer into the cache, 0 to copy the cache into the buffer
+ *
+ * Return value: None
+ */
+static void gpNvm_CopyImage(UInt32 offset, UInt8* pBuffer, UInt32 length, UInt8 toCache)
+{
+	UInt32 start, end;
+
+	if(toCache == 0)
 	{
-		printf("[gpNvm][%s] Component already initialized! Abort.\n",__FUNCTION__);
-		return GPNVM_ERROR_ALREADY_INITIALIZED;
+		memset(pBuffer, 0xFF, length);
 	}
-	//Open the non-volatile memory file
-	gpNvm_FileDescriptor = fopen(GPNVM_FILE_NAME,"r+b");
 
-	if(gpNvm_FileDescriptor == NULL)
+	for(UInt8 cpt=0;cpt<sizeof(gpNvm_Regions)/sizeof(gpNvm_Regions[0]);cpt++)
 	{
-		//File does not exist, create it
-		gpNvm_FileDescriptor = fopen(GPNVM_FILE_NAME, "wb");
+		//Overlap between [offset, offset + length[ and the area
+		start = (offset > gpNvm_Regions[cpt].offset) ? offset : gpNvm_Regions[cpt].offset;
+		end = offset + length;
 
-		if(gpNvm_FileDescriptor == NULL)
+		if(end > gpNvm_Regions[cpt].offset + gpNvm_Regions[cpt].size)
 		{
-			printf("[gpNvm][%s] Cannot oppen file %s! Abort.\n",__FUNCTION__,GPNVM_FILE_NAME);
-			return GPNVM_ERROR_OPENING_FILE;
+			end = gpNvm_Regions[cpt].offset + gpNvm_Regions[cpt].size;
 		}
-	}
-	//Check if the non-volatile memory file is empty
-	fseek(gpNvm_FileDescriptor, 0, SEEK_END);
 
-	if(ftell(gpNvm_FileDescriptor) == 0)
-	{
-		/* Initialize non-volatile memory file and the cache */
-		//Set Memory index table section to 0xFF in file and cache
-		memset(gpNvm_MemoryIndexTable,0xFF,sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE);
-		fseek(gpNvm_FileDescriptor, 0, SEEK_SET);
-		fwrite(gpNvm_MemoryIndexTable, sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE,1,gpNvm_FileDescriptor);
-		//Set attributes CRC table section to 0xFF in file and cache
-		memset(gpNvm_AttributesCrcTable,0xFF,GPNVM_ATTRIBUTES_CRCS_SIZE);
-		fseek(gpNvm_FileDescriptor, sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE, SEEK_SET);
-		fwrite(gpNvm_AttributesCrcTable, GPNVM_ATTRIBUTES_CRCS_SIZE,1,gpNvm_FileDescriptor);
-		//Set user attributes data section to zeros in file and cache
-		memset(gpNvm_MemoryCache,0xFF,GPNVM_USER_MEMORY_SIZE);
-		fseek(gpNvm_FileDescriptor, sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE + GPNVM_ATTRIBUTES_CRCS_SIZE, SEEK_SET);
-		fwrite(gpNvm_MemoryCache,GPNVM_USER_MEMORY_SIZE,1,gpNvm_FileDescriptor);
-	}
-	else
-	{
-		/* Load non-volatile memory file data into cache */
-		//Load Memory index table
-		fseek(gpNvm_FileDescriptor, 0, SEEK_SET);
-		fread(gpNvm_MemoryIndexTable,sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE, 1, gpNvm_FileDescriptor);
-		//Load attributes CRC table
-		fseek(gpNvm_FileDescriptor, sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE, SEEK_SET);
-		fread(gpNvm_AttributesCrcTable, GPNVM_ATTRIBUTES_CRCS_SIZE,1,gpNvm_FileDescriptor);
-		//Load user attributes data
-		fseek(gpNvm_FileDescriptor, sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE + GPNVM_ATTRIBUTES_CRCS_SIZE, SEEK_SET);
-		fread(gpNvm_MemoryCache,GPNVM_USER_MEMORY_SIZE,1,gpNvm_FileDescriptor);
+		if(start >= end)
+		{
+			continue;
+		}
+
+		if(toCache != 0)
+		{
+			memcpy(&gpNvm_Regions[cpt].pCache[start - gpNvm_Regions[cpt].offset], &pBuffer[start - offset], end - start);
+		}
+		else
+		{
+			memcpy(&pBuffer[start - offset], &gpNvm_Regions[cpt].pCache[start - gpNvm_Regions[cpt].offset], end - start);
+		}
 	}
-	fseek(gpNvm_FileDescriptor, 0, SEEK_SET);
-	return GPNVM_OK;
 }
 
 /*
- * Name: gpNvm_Uninit
- * 
- * Description: Uninitilize non-volatile menory component. First this function
- * will check if the component is already initilized. Then it will write cache into
- * the file emulating non-volatile memory.
- * 
- * Parameters: None
- * 
- * Return value: gpNvm_Result: GPNVM_OK: the component is uninitilized successfully
- *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initilized
+ * Name: gpNvm_MarkDirty
+ *
+ * Description: Mark the file sectors holding [offset, offset + length[ as updated in cache, so that
+ * they are written into the file by the next gpNvm_WriteCache.
+ *
+ * Parameters:
+ *            UInt32 offset: offset in the file of the first updated byte
+ *            UInt32 length: number of updated bytes
+ *
+ * Return value: None
  */
-gpNvm_Result gpNvm_Uninit(void)
+static void gpNvm_MarkDirty(UInt32 offset, UInt32 length)
 {
-	//Check if the component is initialized
-	if(gpNvm_FileDescriptor == NULL)
+	UInt32 sector;
+
+	if(length == 0)
 	{
-		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
-		return GPNVM_ERROR_NOT_INITIALIZED;
+		return;
+	}
+
+	for(sector = offset/GPNVM_SECTOR_SIZE; sector <= (offset + length - 1)/GPNVM_SECTOR_SIZE; sector++)
+	{
+		gpNvm_DirtySectors[sector/8] |= (UInt8)(1 << (sector%8));
 	}
-	/* Write cache into non-volatile memory file */
-	//Write Memory index table section to the file
-	fseek(gpNvm_FileDescriptor, 0, SEEK_SET);
-	fwrite(gpNvm_MemoryIndexTable, sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE,1,gpNvm_FileDescriptor);
-	//Write attributes CRC table into the file
-	fseek(gpNvm_FileDescriptor, sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE, SEEK_SET);
-	fwrite(gpNvm_AttributesCrcTable, GPNVM_ATTRIBUTES_CRCS_SIZE,1,gpNvm_FileDescriptor);
-	//Write user attributes data section into the file
-	fseek(gpNvm_FileDescriptor, sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE + GPNVM_ATTRIBUTES_CRCS_SIZE, SEEK_SET);
-	fwrite(gpNvm_MemoryCache,GPNVM_USER_MEMORY_SIZE,1,gpNvm_FileDescriptor);
-	//Close the non-volatile memory file
-	fclose(gpNvm_FileDescriptor);
-	return GPNVM_OK;
 }
 
 /*
- * Name: gpNvm_GetAttribute
- * 
- * Description: Get attribute data from non-volatile memory.
- * This function check if the component is already initialized, if the provided argument sare valid, if the attribute
- * id is already stored in the non-volatile memory then check if the attribute data is corrupted or not by comparing 
- * its stored crc by the calculated one. If data is sane, it will copy it into provided args.
- * 
- * Parameters: 
- *            gpNvm_AttrId attrId: attribute id
- *            UInt8* pLength: pointer to a variable that will store the length of attribute data
- *            UInt8* pValue: pointer to store attribute data
- * 
- * Return value: gpNvm_Result: GPNVM_OK: attribute data is read successfully
- *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initilized
- *                             GPNVM_ERROR_INVALID_PARAMETERS: pointers provided as arguments to the function are not valid
- *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the provided attribute is not in non-volatile memory
- *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: attribute data are corrupted
+ * Name: gpNvm_OpenFile
+ *
+ * Description: Open, or create, the file emulating non-volatile memory or one of its copies. With the GPNVM_STORAGE_DIRECT
+ * option the file is opened with O_DIRECT so its data is not cached a second time by the operating system. If the file
+ * system does not support O_DIRECT, the file is opened without it.
+ *
+ * Parameters:
+ *            const char* pFileName: path of the file
+ *
+ * Return value: int: file descriptor, -1 if the file cannot be opened
  */
-gpNvm_Result gpNvm_GetAttribute(gpNvm_AttrId attrId, UInt8* pLength, UInt8* pValue)
+static int gpNvm_OpenFile(const char* pFileName)
 {
-	UInt16 attributeOffset = 0;
-	UInt8 attributeLength = 0;
-	UInt8 attributeCrc = 0;
+	int fd = -1;
 
-	//Check if the component is initialized
-	if(gpNvm_FileDescriptor == NULL)
+	if(((gpNvm_StorageOptions & GPNVM_STORAGE_DIRECT) != 0) && ((GPNVM_SECTOR_SIZE % 512) != 0))
 	{
-		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
-		return GPNVM_ERROR_NOT_INITIALIZED;
+		printf("[gpNvm][%s] O_DIRECT needs GPNVM_SECTOR_SIZE to be a multiple of 512! Continue without it.\n",__FUNCTION__);
 	}
-	//Validate input pointers
-	if((pLength == NULL) || (pValue == NULL))
+	else if((gpNvm_StorageOptions & GPNVM_STORAGE_DIRECT) != 0)
 	{
-		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
-		return GPNVM_ERROR_INVALID_PARAMETERS;
+		fd = open(pFileName, O_RDWR | O_CREAT | O_DIRECT, 0644);
+
+		if(fd >= 0)
+		{
+			return fd;
+		}
+		printf("[gpNvm][%s] Cannot open file %s with O_DIRECT (%s)! Continue without it.\n",__FUNCTION__,pFileName,strerror(errno));
 	}
-	//Check if attribute is in non-volatile memory
-	attributeOffset = gpNvm_MemoryIndexTable[attrId];
+	return open(pFileName, O_RDWR | O_CREAT, 0644);
+}
 
-	if(attributeOffset == 0xFFFF)
+/*
+ * Name: gpNvm_WriteFile
+ *
+ * Description: Write sector aligned data at a sector aligned offset of the file emulating non-volatile memory, then at
+ * the same offset of each of its copies (GPNVM_MIRROR_COPIES), so that every copy holds the image of the file.
+ *
+ * Parameters:
+ *            const UInt8* pData: pointer to the sector aligned data
+ *            UInt32 length: number of bytes to write, a multiple of GPNVM_SECTOR_SIZE
+ *            off_t offset: offset in the file
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the data is written successfully
+ *                             GPNVM_ERROR_WRITING_FILE: the file or one of its copies could not be written
+ */
+static gpNvm_Result gpNvm_WriteFile(const UInt8* pData, UInt32 length, off_t offset)
+{
+	if(pwrite(gpNvm_FileDescriptor, pData, length, offset) != (ssize_t)length)
 	{
-		printf("[gpNvm][%s] Invalid attribute! Abort.\n",__FUNCTION__);
-		return GPNVM_ERROR_INVALID_ATTRIBUTE_ID;
+		printf("[gpNvm][%s] Cannot write file %s! Abort.\n",__FUNCTION__,gpNvm_FileName);
+		return GPNVM_ERROR_WRITING_FILE;
 	}
-	//Validate attribute data by comparing attribute crc stored in gpNvm_AttributesCrcTable and the calculated crc of the attribute data in gpNvm_MemoryCache
-	attributeCrc = gpNvm_AttributesCrcTable[attrId];
-	attributeLength = gpNvm_MemoryCache[attributeOffset];
-
-	if(gpNvm_CalculateChecksum(&gpNvm_MemoryCache[attributeOffset + 1],attributeLength) != attributeCrc)
+#if GPNVM_MIRROR_COPIES > 0
+	for(UInt8 copy = 0; copy < gpNvm_MirrorsOpen; copy++)
 	{
-		printf("[gpNvm][%s] Corrupted attribute data! Abort.\n",__FUNCTION__);
-		return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+		if(pwrite(gpNvm_MirrorDescriptors[copy], pData, length, offset) != (ssize_t)length)
+		{
+			printf("[gpNvm][%s] Cannot write copy %u of file %s! Abort.\n",__FUNCTION__,copy + 1,gpNvm_FileName);
+			return GPNVM_ERROR_WRITING_FILE;
+		}
 	}
-	*pLength = attributeLength;
-	memcpy(pValue,&gpNvm_MemoryCache[attributeOffset + 1],attributeLength);
+#endif
+	gpNvm_SyncPending = 1;
 	return GPNVM_OK;
 }
 
 /*
- * Name: gpNvm_SetAttribute
+ * Name: gpNvm_PreallocateFile
  *
- * Description: Set attribute data to non-volatile memory.
- * This function checks if the component is already initialized and if the provided arguments are valid. Then it
- * calculates its crc and offset in the user non-volatile memory, update cache then write the cache into the file in case
- * the attributes is already stored. If not, it checks if there is still place to store a new attribute there. Then it
- * calculates its crc and offset in the user non-volatile memory, update cache then write the cache into the file.
+ * Description: Reserve the blocks of the whole image with fallocate, so writing attributes never extends
+ * the file nor allocates blocks on the write path. If the file system does not support fallocate the file
+ * is left as is and blocks are allocated by the first write of the cache.
  *
- * Parameters:
- *            gpNvm_AttrId attrId: attribute id
- *            UInt8 pLength: length of attribute data
- *            UInt8* pValue: pointer to attribute data
+ * Parameters: None
  *
- * Return value: gpNvm_Result: GPNVM_OK: attribute data is written successfully
- *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initilized
- *                             GPNVM_ERROR_INVALID_PARAMETERS: pointers provided as arguments to the function are not valid
- *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the provided attribute is not in non-volatile memory
- *                             GPNVM_ERROR_MEMORY_FULL: Memory is full
+ * Return value: None
  */
-gpNvm_Result gpNvm_SetAttribute(gpNvm_AttrId attrId, UInt8 length, UInt8* pValue)
+static void gpNvm_PreallocateFile(void)
 {
-	UInt16 attributeOffset = 0;
-	UInt8 attributeLength = 0;
-	UInt8 attributeCrc = 0;
-
-	//Check if the component is initialized
-	if(gpNvm_FileDescriptor == NULL)
+	if(fallocate(gpNvm_FileDescriptor, 0, 0, GPNVM_IMAGE_SIZE) != 0)
 	{
-		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
-		return GPNVM_ERROR_NOT_INITIALIZED;
+		printf("[gpNvm][%s] Cannot preallocate file %s (%s)! Continue.\n",__FUNCTION__,gpNvm_FileName,strerror(errno));
 	}
-	//Validate input pointer
-	if(pValue == NULL)
+}
+
+/*
+ * Name: gpNvm_CheckBlockSize
+ *
+ * Description: Compare GPNVM_REGION_ALIGNMENT with the block size the file system reports for the file (st_blksize).
+ * When the block size does not divide the alignment, the regions straddle blocks: the image still works, but a write of
+ * one region may update a block shared with another one, so a warning is printed. Nothing is checked with the packed
+ * layout (alignment 1).
+ *
+ * Parameters: None
+ *
+ * Return value: None
+ */
+static void gpNvm_CheckBlockSize(void)
+{
+	struct stat status;
+
+	if((GPNVM_REGION_ALIGNMENT > 1) && (fstat(gpNvm_FileDescriptor, &status) == 0) && (status.st_blksize > 0) &&
+	   ((GPNVM_REGION_ALIGNMENT % status.st_blksize) != 0))
 	{
-		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
-		return GPNVM_ERROR_INVALID_PARAMETERS;
+		printf("[gpNvm][%s] GPNVM_REGION_ALIGNMENT %u is not a multiple of the block size %ld of file %s! Continue.\n",
+		       __FUNCTION__,GPNVM_REGION_ALIGNMENT,(long)status.st_blksize,gpNvm_FileName);
 	}
-	//Check if attribute is in non-volatile memory
-	attributeOffset = gpNvm_MemoryIndexTable[attrId];
+}
 
-	if(attributeOffset != 0xFFFF)
+/*
+ * Name: gpNvm_SetHeader
+ *
+ * Description: Fill gpNvm_ImageHeader with the format version and the geometry of this build, as written
+ * at the start of a new or upgraded image.
+ *
+ * Parameters: None
+ *
+ * Return value: None
+ */
+static void gpNvm_SetHeader(void)
+{
+	memset(&gpNvm_ImageHeader, 0xFF, sizeof(gpNvm_ImageHeader));
+	gpNvm_ImageHeader.magic = GPNVM_HEADER_MAGIC;
+	gpNvm_ImageHeader.version = GPNVM_FORMAT_VERSION;
+	gpNvm_ImageHeader.byteOrder = GPNVM_HEADER_BYTE_ORDER;
+	gpNvm_ImageHeader.imageSize = GPNVM_IMAGE_SIZE;
+	gpNvm_ImageHeader.memorySize = GPNVM_MEMORY_SIZE;
+	gpNvm_ImageHeader.regionAlignment = GPNVM_REGION_ALIGNMENT;
+	gpNvm_ImageHeader.sectorSize = GPNVM_SECTOR_SIZE;
+	gpNvm_ImageHeader.counterBitmapSize = GPNVM_COUNTER_BITMAP_SIZE;
+	gpNvm_ImageHeader.eccEntrySize = GPNVM_ECC_ENTRY_SIZE;
+	gpNvm_ImageHeader.encoding = GPNVM_VALUE_ENCODING;
+	gpNvm_ImageHeader.crc = gpNvm_CalculateChecksum((UInt8*)&gpNvm_ImageHeader, offsetof(gpNvm_Header, crc));
+}
+
+/*
+ * Name: gpNvm_CheckHeader
+ *
+ * Description: Check the first bytes of an existing file against gpNvm_ImageHeader, without reading anything else.
+ * A file without the magic is accepted as a format version 0 image, written before the header existed, only if it is
+ * not longer than such an image and its first index entries are free or inside the user area. Anything else without
+ * the magic is a foreign file.
+ *
+ * Parameters:
+ *            const UInt8* pImage: first sector of the file, bytes past its end set to 0xFF
+ *            off_t fileSize: size of the file
+ *            UInt16* pVersion: pointer to store the format version of the file
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the file is an image of this build, possibly of an older format version, or
+ *                                       written without GPNVM_DEDUP by a build with it
+ *                             GPNVM_ERROR_READING_FILE: foreign, corrupted, truncated or newer file, or written with another
+ *                                                       byte order or geometry
+ */
+static gpNvm_Result gpNvm_CheckHeader(const UInt8* pImage, off_t fileSize, UInt16* pVersion)
+{
+	gpNvm_Header header;
+	UInt16 entry;
+	UInt8 legacy;
+
+	memcpy(&header, pImage, sizeof(header));
+
+	if(header.magic == __builtin_bswap32(GPNVM_HEADER_MAGIC))
 	{
-		//Attribute is in non-volatile memory, compare old and new values
-		attributeLength = gpNvm_MemoryCache[attributeOffset];
+		printf("[gpNvm][%s] File %s was written with another byte order! Abort.\n",__FUNCTION__,gpNvm_FileName);
+		return GPNVM_ERROR_READING_FILE;
+	}
 
-		if(length != attributeLength)
+	if(header.magic != GPNVM_HEADER_MAGIC)
+	{
+		//Image without header, it starts with the index table
+		legacy = (fileSize <= (off_t)(GPNVM_IMAGE_SIZE - GPNVM_HEADER_AREA_SIZE));
+
+		for(UInt32 cpt = 0; (legacy != 0) && (cpt < sizeof(gpNvm_Header)); cpt += sizeof(UInt16))
 		{
-			printf("[gpNvm][%s] Invalid attribute length (%d != %d)! Abort.\n",__FUNCTION__,length,attributeLength);
-			return GPNVM_ERROR_INVALID_PARAMETERS;
+			memcpy(&entry, &pImage[cpt], sizeof(UInt16));
+			legacy = (entry == 0xFFFF) || (entry < GPNVM_USER_MEMORY_SIZE);
 		}
 
-		if(memcmp(pValue,&gpNvm_MemoryCache[attributeOffset + 1],length) == 0)
+		if(legacy == 0)
 		{
-			//New attribute value is identical to the stored one, do no thing
-			return GPNVM_OK;
+			printf("[gpNvm][%s] File %s is not a non-volatile memory image! Abort.\n",__FUNCTION__,gpNvm_FileName);
+			return GPNVM_ERROR_READING_FILE;
 		}
-		else
+		*pVersion = 0;
+		return GPNVM_OK;
+	}
+
+	if(header.crc != gpNvm_CalculateChecksum((UInt8*)&header, offsetof(gpNvm_Header, crc)))
+	{
+		printf("[gpNvm][%s] Header of file %s is corrupted! Abort.\n",__FUNCTION__,gpNvm_FileName);
+		return GPNVM_ERROR_READING_FILE;
+	}
+
+	if(header.version > GPNVM_FORMAT_VERSION)
+	{
+		printf("[gpNvm][%s] File %s has format version %u, newer than %u! Abort.\n",__FUNCTION__,gpNvm_FileName,header.version,GPNVM_FORMAT_VERSION);
+		return GPNVM_ERROR_READING_FILE;
+	}
+
+	//The geometry of an older version is checked by its upgrade
+	if((header.version == GPNVM_FORMAT_VERSION) &&
+	   ((header.imageSize != gpNvm_ImageHeader.imageSize) || (header.memorySize != gpNvm_ImageHeader.memorySize) ||
+	    (header.regionAlignment != gpNvm_ImageHeader.regionAlignment) || (header.sectorSize != gpNvm_ImageHeader.sectorSize) ||
+	    (header.counterBitmapSize != gpNvm_ImageHeader.counterBitmapSize) || (header.eccEntrySize != gpNvm_ImageHeader.eccEntrySize) ||
+	    ((header.encoding != gpNvm_ImageHeader.encoding) && ((GPNVM_DEDUP == 0) || (header.encoding != GPNVM_COMPRESSION_CODEC)))))
+	{
+		//An image without shared values is opened with GPNVM_DEDUP, its header is rewritten by gpNvm_Init
+		printf("[gpNvm][%s] File %s was written with another geometry! Abort.\n",__FUNCTION__,gpNvm_FileName);
+		return GPNVM_ERROR_READING_FILE;
+	}
+
+	if((header.version == GPNVM_FORMAT_VERSION) && (fileSize < (off_t)header.imageSize))
+	{
+		printf("[gpNvm][%s] File %s is truncated! Abort.\n",__FUNCTION__,gpNvm_FileName);
+		return GPNVM_ERROR_READING_FILE;
+	}
+	*pVersion = header.version;
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_MapFile
+ *
+ * Description: Open the existing file read-only and map it MAP_SHARED, for GPNVM_STORAGE_READ_ONLY. Nothing is read:
+ * the pages of the mapping are faulted in from the operating system page cache when an attribute is read.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the file is mapped successfully
+ *                             GPNVM_ERROR_OPENING_FILE: the file does not exist or cannot be mapped
+ *                             GPNVM_ERROR_READING_FILE: the file is shorter than an image, or its header is not the one of this
+ *                                                       build (an older format must be opened read-write once to be upgraded)
+ */
+static gpNvm_Result gpNvm_MapFile(void)
+{
+	struct stat status;
+	void* pMapping;
+	UInt16 version;
+	int fd = open(gpNvm_FileName, O_RDONLY);
+
+	if(fd < 0)
+	{
+		printf("[gpNvm][%s] Cannot open file %s read-only! Abort.\n",__FUNCTION__,gpNvm_FileName);
+		return GPNVM_ERROR_OPENING_FILE;
+	}
+
+	//Mapped bytes past the end of the file would fault
+	if((fstat(fd, &status) != 0) || (status.st_size < (off_t)GPNVM_IMAGE_SIZE))
+	{
+		printf("[gpNvm][%s] File %s is not a complete image! Abort.\n",__FUNCTION__,gpNvm_FileName);
+		close(fd);
+		return GPNVM_ERROR_READING_FILE;
+	}
+	pMapping = mmap(NULL, GPNVM_IMAGE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+
+	if(pMapping == MAP_FAILED)
+	{
+		printf("[gpNvm][%s] Cannot map file %s! Abort.\n",__FUNCTION__,gpNvm_FileName);
+		close(fd);
+		return GPNVM_ERROR_OPENING_FILE;
+	}
+
+	//An older format cannot be upgraded read-only
+	if((gpNvm_CheckHeader(pMapping, status.st_size, &version) != GPNVM_OK) || (version != GPNVM_FORMAT_VERSION))
+	{
+		printf("[gpNvm][%s] File %s is not an image of format version %u, it must be opened read-write once! Abort.\n",__FUNCTION__,gpNvm_FileName,GPNVM_FORMAT_VERSION);
+		munmap(pMapping, GPNVM_IMAGE_SIZE);
+		close(fd);
+		return GPNVM_ERROR_READING_FILE;
+	}
+	memset(&gpNvm_CacheStatistics, 0, sizeof(gpNvm_CacheStatistics));
+#if GPNVM_VERSION_TOKENS
+	memset(gpNvm_AttributeVersions, 0, sizeof(gpNvm_AttributeVersions));
+#endif
+	gpNvm_StoreVersion = 0;
+	gpNvm_SyncPending = 0;
+	gpNvm_Mapping = pMapping;
+	gpNvm_FileDescriptor = fd;
+	return GPNVM_OK;
+}
+
+#if GPNVM_CACHE_RAM_BUDGET > 0
+/*
+ * Name: gpNvm_CacheReset
+ *
+ * Description: Drop all the user pages from RAM without writing them. Used when the file is opened.
+ *
+ * Parameters: None
+ *
+ * Return value: None
+ */
+static void gpNvm_CacheReset(void)
+{
+	memset(gpNvm_CachePageNumber, 0xFF, sizeof(gpNvm_CachePageNumber));
+	memset(gpNvm_CachePageFlags, 0, sizeof(gpNvm_CachePageFlags));
+	memset(gpNvm_CacheSlot, 0xFF, sizeof(gpNvm_CacheSlot));
+	gpNvm_CacheClockHand = 0;
+}
+
+/*
+ * Name: gpNvm_CacheWritePage
+ *
+ * Description: Write a dirty user page into the file. The page buffer is sector aligned and the page is
+ * one sector of the file, so it is written directly, with or without O_DIRECT.
+ *
+ * Parameters:
+ *            UInt16 slot: slot of gpNvm_CachePages holding the page
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the page is written successfully
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written
+ */
+static gpNvm_Result gpNvm_CacheWritePage(UInt16 slot)
+{
+	off_t offset = GPNVM_USER_MEMORY_OFFSET + (off_t)gpNvm_CachePageNumber[slot]*GPNVM_SECTOR_SIZE;
+
+	if(gpNvm_WriteFile(gpNvm_CachePages[slot], GPNVM_SECTOR_SIZE, offset) != GPNVM_OK)
+	{
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+	gpNvm_CachePageFlags[slot] &= (UInt8)~GPNVM_CACHE_PAGE_DIRTY;
+	gpNvm_CacheStatistics.writebacks++;
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_CacheGetPage
+ *
+ * Description: Get a user page in RAM. If the page is not cached, a slot is chosen with the CLOCK algorithm:
+ * the clock hand skips (and clears) slots referenced since it last passed them, and the first slot not referenced
+ * is evicted. A dirty evicted page is written into the file before the new page is read into its slot.
+ *
+ * Parameters:
+ *            UInt16 page: user page number
+ *            UInt8** ppPage: pointer to store the address of the page in RAM
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the page is in RAM
+ *                             GPNVM_ERROR_READING_FILE: the page could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: the evicted page could not be written into the file
+ */
+static gpNvm_Result gpNvm_CacheGetPage(UInt16 page, UInt8** ppPage)
+{
+	UInt16 slot = gpNvm_CacheSlot[page];
+	ssize_t readSize;
+
+	if(slot != GPNVM_CACHE_NO_PAGE)
+	{
+		gpNvm_CacheStatistics.hits++;
+		gpNvm_CachePageFlags[slot] |= GPNVM_CACHE_PAGE_REFERENCED;
+		*ppPage = gpNvm_CachePages[slot];
+		return GPNVM_OK;
+	}
+	gpNvm_CacheStatistics.misses++;
+	//Look for a slot not referenced since the clock hand last passed it
+	while((gpNvm_CachePageFlags[gpNvm_CacheClockHand] & GPNVM_CACHE_PAGE_REFERENCED) != 0)
+	{
+		gpNvm_CachePageFlags[gpNvm_CacheClockHand] &= (UInt8)~GPNVM_CACHE_PAGE_REFERENCED;
+		gpNvm_CacheClockHand = (gpNvm_CacheClockHand + 1) % GPNVM_CACHE_PAGES;
+	}
+	slot = gpNvm_CacheClockHand;
+	gpNvm_CacheClockHand = (gpNvm_CacheClockHand + 1) % GPNVM_CACHE_PAGES;
+
+	if(gpNvm_CachePageNumber[slot] != GPNVM_CACHE_NO_PAGE)
+	{
+		//Evict the page held by the slot
+		if(((gpNvm_CachePageFlags[slot] & GPNVM_CACHE_PAGE_DIRTY) != 0) && (gpNvm_CacheWritePage(slot) != GPNVM_OK))
 		{
-			//Update attribute value
-			memcpy(&gpNvm_MemoryCache[attributeOffset + 1],pValue,length);
-			//Calculate new CRC and update gpNvm_AttributesCrcTable
-			gpNvm_AttributesCrcTable[attrId] = gpNvm_CalculateChecksum(pValue,length);
-			/* Write cache into non-volatile memory file */
-			//Write Memory index table section to the file
-			fseek(gpNvm_FileDescriptor, 0, SEEK_SET);
-			fwrite(gpNvm_MemoryIndexTable, sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE,1,gpNvm_FileDescriptor);
-			//Write attributes CRC table into the file
-			fseek(gpNvm_FileDescriptor, sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE, SEEK_SET);
-			fwrite(gpNvm_AttributesCrcTable, GPNVM_ATTRIBUTES_CRCS_SIZE,1,gpNvm_FileDescriptor);
-			//Write user attributes data section into the file
-			fseek(gpNvm_FileDescriptor, sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE + GPNVM_ATTRIBUTES_CRCS_SIZE, SEEK_SET);
-			fwrite(gpNvm_MemoryCache,GPNVM_USER_MEMORY_SIZE,1,gpNvm_FileDescriptor);
+			return GPNVM_ERROR_WRITING_FILE;
 		}
+		gpNvm_CacheSlot[gpNvm_CachePageNumber[slot]] = GPNVM_CACHE_NO_PAGE;
+		gpNvm_CachePageNumber[slot] = GPNVM_CACHE_NO_PAGE;
+		gpNvm_CacheStatistics.evictions++;
 	}
-	else
+	readSize = pread(gpNvm_FileDescriptor, gpNvm_CachePages[slot], GPNVM_SECTOR_SIZE, GPNVM_USER_MEMORY_OFFSET + (off_t)page*GPNVM_SECTOR_SIZE);
+
+	if(readSize < 0)
+	{
+		printf("[gpNvm][%s] Cannot read file %s! Abort.\n",__FUNCTION__,gpNvm_FileName);
+		return GPNVM_ERROR_READING_FILE;
+	}
+
+	if(readSize < GPNVM_SECTOR_SIZE)
+	{
+		//Short file, the missing bytes are an empty memory
+		memset(&gpNvm_CachePages[slot][readSize], 0xFF, GPNVM_SECTOR_SIZE - readSize);
+	}
+	gpNvm_CachePageNumber[slot] = page;
+	gpNvm_CachePageFlags[slot] = GPNVM_CACHE_PAGE_REFERENCED;
+	gpNvm_CacheSlot[page] = slot;
+	*ppPage = gpNvm_CachePages[slot];
+	return GPNVM_OK;
+}
+#endif
+
+#if GPNVM_RAM_MINIMAL > 0
+/*
+ * Name: gpNvm_AccessFile
+ *
+ * Description: Read or write bytes of the file emulating non-volatile memory at any offset. Each sector holding
+ * the bytes is read into gpNvm_IoBuffer and, for a write, updated then written back, so that all the file I/O
+ * stay sector aligned as required by O_DIRECT. Used in RAM minimal mode where nothing is cached.
+ *
+ * Parameters:
+ *            UInt32 offset: offset in the file of the first byte
+ *            UInt8* pData: pointer to the data to write, or to store the data read
+ *            UInt32 length: number of bytes to access
+ *            UInt8 write: 1 to write pData into the file, 0 to read the file into pData
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the file is accessed successfully
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written
+ */
+static gpNvm_Result gpNvm_AccessFile(UInt32 offset, UInt8* pData, UInt32 length, UInt8 write)
+{
+	off_t sectorOffset;
+	ssize_t readSize;
+	UInt32 chunk;
+
+	while(length > 0)
 	{
-		//Will add new attribute in non-volatile memory, calculate attribute crc and update crc attribute table
-		gpNvm_AttributesCrcTable[attrId] = gpNvm_CalculateChecksum(pValue,length);
-		//Calculate attribute offset in non-volatile memory cache
-		attributeOffset = 0;
+		sectorOffset = (off_t)(offset/GPNVM_SECTOR_SIZE)*GPNVM_SECTOR_SIZE;
+		chunk = GPNVM_SECTOR_SIZE - offset%GPNVM_SECTOR_SIZE;
+		chunk = (chunk < length) ? chunk : length;
+		readSize = pread(gpNvm_FileDescriptor, gpNvm_IoBuffer, GPNVM_SECTOR_SIZE, sectorOffset);
+
+		if(readSize < 0)
+		{
+			printf("[gpNvm][%s] Cannot read file %s! Abort.\n",__FUNCTION__,gpNvm_FileName);
+			return GPNVM_ERROR_READING_FILE;
+		}
+
+		if(readSize < GPNVM_SECTOR_SIZE)
+		{
+			//Short file, the missing bytes are an empty memory
+			memset(&gpNvm_IoBuffer[readSize], 0xFF, GPNVM_SECTOR_SIZE - readSize);
+		}
 
-		for(UInt16 cpt=0;cpt<GPNVM_MEMORY_INDEX_TABLE_SIZE;cpt++)
+		if(write != 0)
 		{
-			if(gpNvm_MemoryIndexTable[cpt] != 0xFFFF)
+			memcpy(&gpNvm_IoBuffer[offset%GPNVM_SECTOR_SIZE], pData, chunk);
+
+			if(gpNvm_WriteFile(gpNvm_IoBuffer, GPNVM_SECTOR_SIZE, sectorOffset) != GPNVM_OK)
 			{
-				attributeOffset += gpNvm_MemoryCache[gpNvm_MemoryIndexTable[cpt]] + 1;
+				return GPNVM_ERROR_WRITING_FILE;
 			}
 		}
-		//Check if we have spare place in non-volatile memory
-		if(attributeOffset >= GPNVM_USER_MEMORY_SIZE)
-        {
-            printf("[gpNvm][%s] Memory full! Abort.\n",__FUNCTION__);
-            return GPNVM_ERROR_MEMORY_FULL;
-        }
-		//Update non-volatile memory index table
-		gpNvm_MemoryIndexTable[attrId] = attributeOffset;
-        //Update non-volatile memory cache
-		gpNvm_MemoryCache[attributeOffset] = length;
-		memcpy(&gpNvm_MemoryCache[attributeOffset + 1],pValue,length);
-		/* Write cache into non-volatile memory file */
-		//Write Memory index table section to the file
-		fseek(gpNvm_FileDescriptor, 0, SEEK_SET);
-		fwrite(gpNvm_MemoryIndexTable, sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE,1,gpNvm_FileDescriptor);
-		//Write attributes CRC table into the file
-		fseek(gpNvm_FileDescriptor, sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE, SEEK_SET);
-		fwrite(gpNvm_AttributesCrcTable, GPNVM_ATTRIBUTES_CRCS_SIZE,1,gpNvm_FileDescriptor);
-		//Write user attributes data section into the file
-		fseek(gpNvm_FileDescriptor, sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE + GPNVM_ATTRIBUTES_CRCS_SIZE, SEEK_SET);
-		fwrite(gpNvm_MemoryCache,GPNVM_USER_MEMORY_SIZE,1,gpNvm_FileDescriptor);
+		else
+		{
+			memcpy(pData, &gpNvm_IoBuffer[offset%GPNVM_SECTOR_SIZE], chunk);
+		}
+		pData += chunk;
+		offset += chunk;
+		length -= chunk;
+	}
+	return GPNVM_OK;
+}
+#endif
+
+/*
+ * Name: gpNvm_GetIndexEntry
+ *
+ * Description: Get the offset of an attribute in user non-volatile memory from the index table, or from the
+ * file when the index table is not in RAM (GPNVM_RAM_MINIMAL 2). In that case the bitmap gpNvm_AttributesPresent
+ * answers for attributes not stored without reading the file. A read-only component reads it from the mapping.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt16* pOffset: pointer to store the offset, 0xFFFF if the attribute is not stored
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the offset is read successfully
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ */
+static gpNvm_Result gpNvm_GetIndexEntry(gpNvm_AttrId attrId, UInt16* pOffset)
+{
+	if(gpNvm_Mapping != NULL)
+	{
+		memcpy(pOffset, &gpNvm_Mapping[GPNVM_INDEX_TABLE_OFFSET + sizeof(UInt16)*attrId], sizeof(UInt16));
+		return GPNVM_OK;
+	}
+#if GPNVM_RAM_MINIMAL > 1
+	if((gpNvm_AttributesPresent[attrId/8] & (1 << (attrId%8))) == 0)
+	{
+		*pOffset = 0xFFFF;
+		return GPNVM_OK;
+	}
+	return gpNvm_AccessFile(GPNVM_INDEX_TABLE_OFFSET + sizeof(UInt16)*attrId, (UInt8*)pOffset, sizeof(UInt16), 0);
+#else
+	*pOffset = gpNvm_MemoryIndexTable[attrId];
+	return GPNVM_OK;
+#endif
+}
+
+/*
+ * Name: gpNvm_SetIndexEntry
+ *
+ * Description: Set the offset of an attribute in the index table. The entry is marked dirty in cache, or
+ * written directly into the file in RAM minimal mode.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt16 offset: offset of the attribute in user non-volatile memory, 0xFFFF if it is not stored
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the offset is set successfully
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written
+ */
+static gpNvm_Result gpNvm_SetIndexEntry(gpNvm_AttrId attrId, UInt16 offset)
+{
+#if GPNVM_RAM_MINIMAL > 1
+	if(offset != 0xFFFF)
+	{
+		gpNvm_AttributesPresent[attrId/8] |= (UInt8)(1 << (attrId%8));
+	}
+	else
+	{
+		gpNvm_AttributesPresent[attrId/8] &= (UInt8)~(1 << (attrId%8));
+	}
+	return gpNvm_AccessFile(GPNVM_INDEX_TABLE_OFFSET + sizeof(UInt16)*attrId, (UInt8*)&offset, sizeof(UInt16), 1);
+#elif GPNVM_RAM_MINIMAL == 1
+	gpNvm_MemoryIndexTable[attrId] = offset;
+	return gpNvm_AccessFile(GPNVM_INDEX_TABLE_OFFSET + sizeof(UInt16)*attrId, (UInt8*)&offset, sizeof(UInt16), 1);
+#else
+	gpNvm_MemoryIndexTable[attrId] = offset;
+	gpNvm_MarkDirty(GPNVM_INDEX_TABLE_OFFSET + sizeof(UInt16)*attrId, sizeof(UInt16));
+	return GPNVM_OK;
+#endif
+}
+
+/*
+ * Name: gpNvm_GetCrc
+ *
+ * Description: Get the CRC8 of an attribute from the CRC table, or from the file in RAM minimal mode, or from the
+ * mapping of a read-only component.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8* pCrc: pointer to store the CRC
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the CRC is read successfully
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ */
+static gpNvm_Result gpNvm_GetCrc(gpNvm_AttrId attrId, UInt8* pCrc)
+{
+	if(gpNvm_Mapping != NULL)
+	{
+		*pCrc = gpNvm_Mapping[GPNVM_CRC_TABLE_OFFSET + attrId];
+		return GPNVM_OK;
+	}
+#if GPNVM_RAM_MINIMAL > 0
+	return gpNvm_AccessFile(GPNVM_CRC_TABLE_OFFSET + attrId, pCrc, 1, 0);
+#else
+	*pCrc = gpNvm_AttributesCrcTable[attrId];
+	return GPNVM_OK;
+#endif
+}
+
+/*
+ * Name: gpNvm_SetCrc
+ *
+ * Description: Set the CRC8 of an attribute in the CRC table. The entry is marked dirty in cache, or written
+ * directly into the file in RAM minimal mode.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8 crc: CRC of the attribute data
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the CRC is set successfully
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written
+ */
+static gpNvm_Result gpNvm_SetCrc(gpNvm_AttrId attrId, UInt8 crc)
+{
+#if GPNVM_RAM_MINIMAL > 0
+	return gpNvm_AccessFile(GPNVM_CRC_TABLE_OFFSET + attrId, &crc, 1, 1);
+#else
+	gpNvm_AttributesCrcTable[attrId] = crc;
+	gpNvm_MarkDirty(GPNVM_CRC_TABLE_OFFSET + attrId, 1);
+	return GPNVM_OK;
+#endif
+}
+
+#if GPNVM_ECC_INTERLEAVE > 0
+/*
+ * Name: gpNvm_EccTimesAlpha
+ *
+ * Description: Multiply a GF(256) element by alpha (x), the generator of the field built on GPNVM_ECC_POLYNOMIAL.
+ *
+ * Parameters:
+ *            UInt8 element: element to multiply
+ *
+ * Return value: UInt8: element times alpha
+ */
+static UInt8 gpNvm_EccTimesAlpha(UInt8 element)
+{
+	return (UInt8)((element << 1) ^ (((element & 0x80) != 0) ? GPNVM_ECC_POLYNOMIAL : 0));
+}
+
+/*
+ * Name: gpNvm_EccCodeword
+ *
+ * Description: Compute the two check bytes of one interleaved codeword of a value. Byte i of the value is symbol
+ * i/GPNVM_ECC_INTERLEAVE of codeword i%GPNVM_ECC_INTERLEAVE. The check bytes are the sum of the symbols and the sum of
+ * each symbol times alpha^position over GF(256), the latter by Horner's rule from the last symbol, so that only
+ * multiplications by alpha are needed.
+ *
+ * Parameters:
+ *            UInt8 length: length of the value
+ *            const UInt8* pValue: pointer to the value
+ *            UInt8 codeword: index of the codeword
+ *            UInt8* pSum: pointer to store the sum of the symbols
+ *            UInt8* pWeighted: pointer to store the sum of the symbols times alpha^position
+ *
+ * Return value: UInt8: number of symbols of the codeword
+ */
+static UInt8 gpNvm_EccCodeword(UInt8 length, const UInt8* pValue, UInt8 codeword, UInt8* pSum, UInt8* pWeighted)
+{
+	UInt8 count = (length > codeword) ? (UInt8)((length - codeword + GPNVM_ECC_INTERLEAVE - 1)/GPNVM_ECC_INTERLEAVE) : 0;
+	UInt8 symbol;
+
+	*pSum = 0;
+	*pWeighted = 0;
+
+	for(UInt8 position = count; position > 0; position--)
+	{
+		symbol = pValue[codeword + (position - 1)*GPNVM_ECC_INTERLEAVE];
+		*pSum ^= symbol;
+		*pWeighted = gpNvm_EccTimesAlpha(*pWeighted) ^ symbol;
+	}
+	return count;
+}
+
+/*
+ * Name: gpNvm_EccCorrect
+ *
+ * Description: Correct a value with its ECC entry. In each codeword the differences between the stored and the computed
+ * check bytes are the syndromes: a symbol corrupted by e at position j gives e and e*alpha^j, so j is found by multiplying
+ * the first by alpha until it equals the second, and the symbol is fixed by adding e. One corrupted byte per codeword is
+ * corrected, a burst of up to GPNVM_ECC_INTERLEAVE bytes when the bytes are consecutive.
+ *
+ * Parameters:
+ *            UInt8 length: length of the value
+ *            UInt8* pValue: pointer to the value, corrected in place
+ *            const UInt8* pEntry: pointer to the ECC entry of the attribute
+ *            UInt8* pClean: pointer to store 1 if no codeword had an error
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the value is corrected, or had no error
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: a codeword has more errors than the ECC corrects
+ */
+static gpNvm_Result gpNvm_EccCorrect(UInt8 length, UInt8* pValue, const UInt8* pEntry, UInt8* pClean)
+{
+	UInt8 sum, weighted, count, position, syndrome;
+
+	*pClean = 1;
+
+	for(UInt8 codeword = 0; codeword < GPNVM_ECC_INTERLEAVE; codeword++)
+	{
+		count = gpNvm_EccCodeword(length, pValue, codeword, &sum, &weighted);
+		sum ^= pEntry[1 + 2*codeword];
+		weighted ^= pEntry[2 + 2*codeword];
+
+		if((sum == 0) && (weighted == 0))
+		{
+			continue;
+		}
+		*pClean = 0;
+
+		//A single error changes both syndromes
+		if((sum == 0) || (weighted == 0))
+		{
+			return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+		}
+
+		for(position = 0, syndrome = sum; (position < count) && (syndrome != weighted); position++)
+		{
+			syndrome = gpNvm_EccTimesAlpha(syndrome);
+		}
+
+		if(position == count)
+		{
+			return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+		}
+		pValue[codeword + position*GPNVM_ECC_INTERLEAVE] ^= sum;
 	}
 	return GPNVM_OK;
 }
+
+/*
+ * Name: gpNvm_GetEcc
+ *
+ * Description: Get the ECC entry of an attribute, from the ECC table in cache or from the file in RAM minimal mode.
+ * A read-only component reads it from the mapping.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8* pEntry: pointer to store the GPNVM_ECC_ENTRY_SIZE bytes of the entry
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the entry is read successfully
+ *                             GPNVM_ERROR_READING_FILE: the entry could not be read from the file
+ */
+static gpNvm_Result gpNvm_GetEcc(gpNvm_AttrId attrId, UInt8* pEntry)
+{
+	if(gpNvm_Mapping != NULL)
+	{
+		memcpy(pEntry, &gpNvm_Mapping[GPNVM_ECC_TABLE_OFFSET + attrId*GPNVM_ECC_ENTRY_SIZE], GPNVM_ECC_ENTRY_SIZE);
+		return GPNVM_OK;
+	}
+#if GPNVM_RAM_MINIMAL > 0
+	return gpNvm_AccessFile(GPNVM_ECC_TABLE_OFFSET + attrId*GPNVM_ECC_ENTRY_SIZE, pEntry, GPNVM_ECC_ENTRY_SIZE, 0);
+#else
+	memcpy(pEntry, &gpNvm_AttributesEccTable[attrId*GPNVM_ECC_ENTRY_SIZE], GPNVM_ECC_ENTRY_SIZE);
+	return GPNVM_OK;
+#endif
+}
+#endif
+
+/*
+ * Name: gpNvm_SetEcc
+ *
+ * Description: Set the ECC entry of an attribute: its length, then the check bytes of each interleaved codeword of its
+ * value (see gpNvm_EccCodeword). It is set in cache and marked dirty, or written directly in RAM minimal mode. Nothing
+ * is done without ECC (GPNVM_ECC_INTERLEAVE 0).
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8 length: length of attribute data
+ *            const UInt8* pValue: pointer to attribute data, NULL to erase the entry of a removed attribute
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the entry is set successfully
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written
+ */
+static gpNvm_Result gpNvm_SetEcc(gpNvm_AttrId attrId, UInt8 length, const UInt8* pValue)
+{
+#if GPNVM_ECC_INTERLEAVE > 0
+	UInt8 entry[GPNVM_ECC_ENTRY_SIZE];
+
+	memset(entry, 0xFF, sizeof(entry));
+
+	if(pValue != NULL)
+	{
+		entry[0] = length;
+
+		for(UInt8 codeword = 0; codeword < GPNVM_ECC_INTERLEAVE; codeword++)
+		{
+			gpNvm_EccCodeword(length, pValue, codeword, &entry[1 + 2*codeword], &entry[2 + 2*codeword]);
+		}
+	}
+#if GPNVM_RAM_MINIMAL > 0
+	return gpNvm_AccessFile(GPNVM_ECC_TABLE_OFFSET + attrId*GPNVM_ECC_ENTRY_SIZE, entry, GPNVM_ECC_ENTRY_SIZE, 1);
+#else
+	memcpy(&gpNvm_AttributesEccTable[attrId*GPNVM_ECC_ENTRY_SIZE], entry, GPNVM_ECC_ENTRY_SIZE);
+	gpNvm_MarkDirty(GPNVM_ECC_TABLE_OFFSET + attrId*GPNVM_ECC_ENTRY_SIZE, GPNVM_ECC_ENTRY_SIZE);
+	return GPNVM_OK;
+#endif
+#else
+	(void)attrId;
+	(void)length;
+	(void)pValue;
+	return GPNVM_OK;
+#endif
+}
+
+/*
+ * Name: gpNvm_AttributeChanged
+ *
+ * Description: Record that the value of an attribute changed: increment its version and the store version, and mark
+ * it for gpNvm_NotifyChanges and the change feed. Only called when the stored value really changes, so pollers and subscribers are not
+ * woken up by identical writes.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *
+ * Return value: None
+ */
+static void gpNvm_AttributeChanged(gpNvm_AttrId attrId)
+{
+#if GPNVM_VERSION_TOKENS
+	gpNvm_AttributeVersions[attrId]++;
+#endif
+#if GPNVM_MAX_SUBSCRIBERS > 0
+	gpNvm_ChangedAttributes[attrId/8] |= (UInt8)(1 << (attrId%8));
+	gpNvm_ChangesPending = 1;
+#endif
+#if GPNVM_CHANGE_FEED_SIZE > 0
+	gpNvm_FeedPending[attrId/8] |= (UInt8)(1 << (attrId%8));
+	gpNvm_FeedPendingAny = 1;
+#endif
+#if (GPNVM_VERSION_TOKENS == 0) && (GPNVM_MAX_SUBSCRIBERS == 0) && (GPNVM_CHANGE_FEED_SIZE == 0)
+	(void)attrId;
+#endif
+	gpNvm_StoreVersion++;
+}
+
+/*
+ * Name: gpNvm_NotifyChanges
+ *
+ * Description: Notify the subscribers of the attributes recorded in gpNvm_ChangedAttributes. The changed attributes
+ * and the subscribers are copied under gpNvm_Mutex, then the callbacks are called and the eventfds written without
+ * holding it, so a callback can call the API. Called by the API functions changing attributes, after they release
+ * gpNvm_Mutex, from the thread that made the change.
+ *
+ * Parameters: None
+ *
+ * Return value: None
+ */
+static void gpNvm_NotifyChanges(void)
+{
+#if GPNVM_MAX_SUBSCRIBERS > 0
+	UInt8 changed[sizeof(gpNvm_ChangedAttributes)];
+	gpNvm_Subscriber subscribers[GPNVM_MAX_SUBSCRIBERS];
+	uint64_t wakeup = 1;
+	UInt8 signaled;
+
+	pthread_mutex_lock(&gpNvm_Mutex);
+
+	if(gpNvm_ChangesPending == 0)
+	{
+		pthread_mutex_unlock(&gpNvm_Mutex);
+		return;
+	}
+	memcpy(changed, gpNvm_ChangedAttributes, sizeof(changed));
+	memcpy(subscribers, gpNvm_Subscribers, sizeof(subscribers));
+	memset(gpNvm_ChangedAttributes, 0, sizeof(gpNvm_ChangedAttributes));
+	gpNvm_ChangesPending = 0;
+	pthread_mutex_unlock(&gpNvm_Mutex);
+
+	for(UInt8 handle = 0; handle < GPNVM_MAX_SUBSCRIBERS; handle++)
+	{
+		signaled = 0;
+
+		for(UInt16 attrId = subscribers[handle].firstAttrId; (subscribers[handle].used != 0) && (attrId <= subscribers[handle].lastAttrId); attrId++)
+		{
+			if((changed[attrId/8] & (1 << (attrId%8))) == 0)
+			{
+				continue;
+			}
+
+			if(subscribers[handle].callback != NULL)
+			{
+				subscribers[handle].callback((gpNvm_AttrId)attrId, subscribers[handle].pContext);
+			}
+
+			if((subscribers[handle].eventFd >= 0) && (signaled == 0))
+			{
+				//One wakeup per notification, the subscriber reads its attributes or versions to know what changed
+				if(write(subscribers[handle].eventFd, &wakeup, sizeof(wakeup)) != sizeof(wakeup))
+				{
+					printf("[gpNvm][%s] Cannot signal eventfd %d! Abort.\n",__FUNCTION__,subscribers[handle].eventFd);
+				}
+				signaled = 1;
+			}
+		}
+	}
+#endif
+}
+
+/*
+ * Name: gpNvm_IsCounter
+ *
+ * Description: Tell if an attribute is a counter, from gpNvm_AttributesFlags or the mapping of a read-only component.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *
+ * Return value: UInt8: 1 for a counter, 0 for a plain attribute
+ */
+static UInt8 gpNvm_IsCounter(gpNvm_AttrId attrId)
+{
+	const UInt8* pFlags = (gpNvm_Mapping != NULL) ? &gpNvm_Mapping[GPNVM_FLAGS_TABLE_OFFSET] : gpNvm_AttributesFlags;
+
+	return ((pFlags[attrId/8] & (1 << (attrId%8))) == 0) ? 1 : 0;
+}
+
+/*
+ * Name: gpNvm_GetType
+ *
+ * Description: Get the type of an attribute from its flags: a counter, a value stored compressed (GPNVM_COMPRESSION)
+ * or a plain value.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *
+ * Return value: UInt8: GPNVM_TYPE_PLAIN, GPNVM_TYPE_COUNTER or GPNVM_TYPE_COMPRESSED
+ */
+static UInt8 gpNvm_GetType(gpNvm_AttrId attrId)
+{
+#if GPNVM_COMPRESSION > 0
+	const UInt8* pFlags = (gpNvm_Mapping != NULL) ? &gpNvm_Mapping[GPNVM_FLAGS_TABLE_OFFSET] : gpNvm_AttributesFlags;
+#endif
+
+	if(gpNvm_IsCounter(attrId) != 0)
+	{
+		return GPNVM_TYPE_COUNTER;
+	}
+#if GPNVM_COMPRESSION > 0
+	if((pFlags[GPNVM_TYPE_FLAGS_SIZE + attrId/8] & (1 << (attrId%8))) == 0)
+	{
+		return GPNVM_TYPE_COMPRESSED;
+	}
+#endif
+	return GPNVM_TYPE_PLAIN;
+}
+
+/*
+ * Name: gpNvm_WriteFlags
+ *
+ * Description: Write gpNvm_AttributesFlags into the file, marked dirty in cache or written directly in RAM minimal mode.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the flags are written successfully
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written
+ */
+static gpNvm_Result gpNvm_WriteFlags(void)
+{
+#if GPNVM_RAM_MINIMAL > 0
+	return gpNvm_AccessFile(GPNVM_FLAGS_TABLE_OFFSET, gpNvm_AttributesFlags, GPNVM_ATTRIBUTES_FLAGS_SIZE, 1);
+#else
+	gpNvm_MarkDirty(GPNVM_FLAGS_TABLE_OFFSET, GPNVM_ATTRIBUTES_FLAGS_SIZE);
+	return GPNVM_OK;
+#endif
+}
+
+/*
+ * Name: gpNvm_SetCompressed
+ *
+ * Description: Mark an attribute as stored compressed or not in the compression bitmap of gpNvm_AttributesFlags, and
+ * write the flags if it changes. Nothing is done without compression (GPNVM_COMPRESSION 0).
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8 compressed: 1 if the value of the attribute is stored compressed
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the flag is set successfully
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written
+ */
+static gpNvm_Result gpNvm_SetCompressed(gpNvm_AttrId attrId, UInt8 compressed)
+{
+#if GPNVM_COMPRESSION > 0
+	UInt8* pFlags = &gpNvm_AttributesFlags[GPNVM_TYPE_FLAGS_SIZE + attrId/8];
+	UInt8 flags = (compressed != 0) ? (UInt8)(*pFlags & ~(1 << (attrId%8))) : (UInt8)(*pFlags | (1 << (attrId%8)));
+
+	if(flags != *pFlags)
+	{
+		*pFlags = flags;
+		return gpNvm_WriteFlags();
+	}
+#else
+	(void)attrId;
+	(void)compressed;
+#endif
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_DecodeCounter
+ *
+ * Description: Decode the value of a counter attribute: its base plus the number of bits already cleared in its
+ * unary bitmap. Bits are cleared in order, from bit 0 of byte 0, so a valid bitmap is 0x00 bytes, at most one
+ * partially cleared byte, then 0xFF bytes.
+ *
+ * Parameters:
+ *            const UInt8* pValue: counter attribute value
+ *            UInt32* pCount: pointer to store the counter value
+ *            UInt8* pNextByte: pointer to store the index of the bitmap byte holding the next bit to clear,
+ *                              GPNVM_COUNTER_BITMAP_SIZE if the bitmap is full
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the counter is decoded successfully
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: the bitmap is not a valid unary encoding
+ */
+static gpNvm_Result gpNvm_DecodeCounter(const UInt8* pValue, UInt32* pCount, UInt8* pNextByte)
+{
+	const UInt8* pBitmap = &pValue[sizeof(UInt32)];
+	UInt8 byte = 0;
+	UInt8 bits;
+
+	memcpy(pCount, pValue, sizeof(UInt32));
+
+	while((byte < GPNVM_COUNTER_BITMAP_SIZE) && (pBitmap[byte] == 0x00))
+	{
+		byte++;
+	}
+	*pNextByte = byte;
+	*pCount += 8*byte;
+
+	if(byte < GPNVM_COUNTER_BITMAP_SIZE)
+	{
+		//Cleared bits of this byte are its low bits
+		for(bits = 0; (pBitmap[byte] & (1 << bits)) == 0; bits++);
+
+		if(pBitmap[byte] != (UInt8)(0xFF << bits))
+		{
+			return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+		}
+		*pCount += bits;
+
+		for(byte++; byte < GPNVM_COUNTER_BITMAP_SIZE; byte++)
+		{
+			if(pBitmap[byte] != 0xFF)
+			{
+				return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+			}
+		}
+	}
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_ReadUserMemory
+ *
+ * Description: Read bytes of the user non-volatile memory data area. They are read from gpNvm_MemoryCache,
+ * with a bounded cache from the user pages, which are loaded from the file on a miss, and in RAM minimal
+ * mode directly from the file. A read-only component reads them from the mapping.
+ *
+ * Parameters:
+ *            UInt32 offset: offset in the user non-volatile memory data area
+ *            UInt8* pData: pointer to store the data
+ *            UInt32 length: number of bytes to read
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: data is read successfully
+ *                             GPNVM_ERROR_READING_FILE: a page could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: an evicted page could not be written into the file
+ */
+static gpNvm_Result gpNvm_ReadUserMemory(UInt32 offset, UInt8* pData, UInt32 length)
+{
+#if GPNVM_CACHE_RAM_BUDGET > 0
+	gpNvm_Result result;
+	UInt8* pPage;
+	UInt32 chunk;
+#endif
+
+	if(gpNvm_Mapping != NULL)
+	{
+		gpNvm_CacheStatistics.hits++;
+		memcpy(pData, &gpNvm_Mapping[GPNVM_USER_MEMORY_OFFSET + offset], length);
+		return GPNVM_OK;
+	}
+#if GPNVM_CACHE_RAM_BUDGET > 0
+	while(length > 0)
+	{
+		result = gpNvm_CacheGetPage(offset/GPNVM_SECTOR_SIZE, &pPage);
+
+		if(result != GPNVM_OK)
+		{
+			return result;
+		}
+		chunk = GPNVM_SECTOR_SIZE - offset%GPNVM_SECTOR_SIZE;
+		chunk = (chunk < length) ? chunk : length;
+		memcpy(pData, &pPage[offset%GPNVM_SECTOR_SIZE], chunk);
+		pData += chunk;
+		offset += chunk;
+		length -= chunk;
+	}
+#elif GPNVM_RAM_MINIMAL > 0
+	gpNvm_CacheStatistics.misses++;
+	return gpNvm_AccessFile(GPNVM_USER_MEMORY_OFFSET + offset, pData, length, 0);
+#else
+	gpNvm_CacheStatistics.hits++;
+	memcpy(pData, &gpNvm_MemoryCache[offset], length);
+#endif
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_WriteUserMemory
+ *
+ * Description: Update bytes of the user non-volatile memory data area in cache and mark them dirty, so they
+ * are written into the file by the next gpNvm_WriteCache. In RAM minimal mode they are written directly into the file.
+ *
+ * Parameters:
+ *            UInt32 offset: offset in the user non-volatile memory data area
+ *            const UInt8* pData: data to write
+ *            UInt32 length: number of bytes to write
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: data is updated successfully
+ *                             GPNVM_ERROR_READING_FILE: a page could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: an evicted page could not be written into the file
+ */
+static gpNvm_Result gpNvm_WriteUserMemory(UInt32 offset, const UInt8* pData, UInt32 length)
+{
+#if GPNVM_CACHE_RAM_BUDGET > 0
+	gpNvm_Result result;
+	UInt8* pPage;
+	UInt32 chunk;
+
+	while(length > 0)
+	{
+		result = gpNvm_CacheGetPage(offset/GPNVM_SECTOR_SIZE, &pPage);
+
+		if(result != GPNVM_OK)
+		{
+			return result;
+		}
+		chunk = GPNVM_SECTOR_SIZE - offset%GPNVM_SECTOR_SIZE;
+		chunk = (chunk < length) ? chunk : length;
+		memcpy(&pPage[offset%GPNVM_SECTOR_SIZE], pData, chunk);
+		gpNvm_CachePageFlags[gpNvm_CacheSlot[offset/GPNVM_SECTOR_SIZE]] |= GPNVM_CACHE_PAGE_DIRTY;
+		pData += chunk;
+		offset += chunk;
+		length -= chunk;
+	}
+#elif GPNVM_RAM_MINIMAL > 0
+	return gpNvm_AccessFile(GPNVM_USER_MEMORY_OFFSET + offset, (UInt8*)pData, length, 1);
+#else
+	memcpy(&gpNvm_MemoryCache[offset], pData, length);
+	gpNvm_MarkDirty(GPNVM_USER_MEMORY_OFFSET + offset, length);
+#endif
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_FindUserMemoryEnd
+ *
+ * Description: Calculate gpNvm_UserMemoryEnd, the end of the last attribute stored in user non-volatile
+ * memory, from the index table and the attribute lengths. Called when the file is loaded, and when other processes
+ * wrote it (GPNVM_MULTI_PROCESS). An index entry past the user area is skipped, the attribute is reported corrupted
+ * when it is read.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: gpNvm_UserMemoryEnd is calculated successfully
+ *                             GPNVM_ERROR_READING_FILE: a page could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: an evicted page could not be written into the file
+ */
+static gpNvm_Result gpNvm_FindUserMemoryEnd(void)
+{
+	gpNvm_Result result;
+	UInt16 attributeOffset;
+	UInt8 attributeLength;
+
+	gpNvm_UserMemoryEnd = 0;
+
+	for(UInt16 cpt=0;cpt<GPNVM_MEMORY_INDEX_TABLE_SIZE;cpt++)
+	{
+#if GPNVM_RAM_MINIMAL > 1
+		//Index table is not in RAM, read the offset from the file and build the bitmap of stored attributes
+		result = gpNvm_AccessFile(GPNVM_INDEX_TABLE_OFFSET + sizeof(UInt16)*cpt, (UInt8*)&attributeOffset, sizeof(UInt16), 0);
+
+		if(result != GPNVM_OK)
+		{
+			return result;
+		}
+
+		if(attributeOffset != 0xFFFF)
+		{
+			gpNvm_AttributesPresent[cpt/8] |= (UInt8)(1 << (cpt%8));
+		}
+#else
+		attributeOffset = gpNvm_MemoryIndexTable[cpt];
+#endif
+
+		if((attributeOffset == 0xFFFF) || (attributeOffset >= GPNVM_USER_MEMORY_SIZE))
+		{
+			continue;
+		}
+		result = gpNvm_ReadUserMemory(attributeOffset, &attributeLength, 1);
+
+		if(result != GPNVM_OK)
+		{
+			return result;
+		}
+
+		if(attributeOffset + attributeLength + 1 > gpNvm_UserMemoryEnd)
+		{
+			gpNvm_UserMemoryEnd = attributeOffset + attributeLength + 1;
+		}
+	}
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_SortAttributes
+ *
+ * Description: List the stored attributes in increasing offset order, i.e. in the order of the user attributes data area.
+ *
+ * Parameters:
+ *            gpNvm_AttrId* pIds: pointer to store the ids, GPNVM_MEMORY_INDEX_TABLE_SIZE entries
+ *            UInt16* pOffsets: pointer to store their offsets, GPNVM_MEMORY_INDEX_TABLE_SIZE entries
+ *            UInt16* pCount: pointer to store the number of stored attributes
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the attributes are listed successfully
+ *                             GPNVM_ERROR_READING_FILE: an index entry could not be read from the file
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: an index entry points out of the user attributes data area
+ */
+static gpNvm_Result gpNvm_SortAttributes(gpNvm_AttrId* pIds, UInt16* pOffsets, UInt16* pCount)
+{
+	gpNvm_Result result;
+	UInt16 offset, position;
+
+	*pCount = 0;
+
+	for(UInt16 cpt=0;cpt<GPNVM_MEMORY_INDEX_TABLE_SIZE;cpt++)
+	{
+		result = gpNvm_GetIndexEntry((gpNvm_AttrId)cpt, &offset);
+
+		if(result != GPNVM_OK)
+		{
+			return result;
+		}
+
+		if(offset == 0xFFFF)
+		{
+			continue;
+		}
+
+		if(offset >= GPNVM_USER_MEMORY_SIZE)
+		{
+			printf("[gpNvm][%s] Attribute %u out of the user attributes data area! Abort.\n",__FUNCTION__,cpt);
+			return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+		}
+		//Insertion sort, there are at most GPNVM_MEMORY_INDEX_TABLE_SIZE attributes
+		for(position = *pCount; (position > 0) && (pOffsets[position - 1] > offset); position--)
+		{
+			pOffsets[position] = pOffsets[position - 1];
+			pIds[position] = pIds[position - 1];
+		}
+		pOffsets[position] = offset;
+		pIds[position] = (gpNvm_AttrId)cpt;
+		(*pCount)++;
+	}
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_LoadImage
+ *
+ * Description: Load bytes of the file into the cache buffers of the areas they belong to. The file is read
+ * by whole sectors through gpNvm_IoBuffer. Bytes missing at the end of a short file are loaded as 0xFF,
+ * i.e. as an empty memory.
+ *
+ * Parameters:
+ *            UInt32 start: offset in the file of the first byte to load, multiple of GPNVM_SECTOR_SIZE
+ *            UInt32 end: offset in the file after the last byte to load
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the bytes are loaded successfully
+ *                             GPNVM_ERROR_OPENING_FILE: the file could not be read
+ */
+static gpNvm_Result gpNvm_LoadImage(UInt32 start, UInt32 end)
+{
+	ssize_t readSize;
+	UInt32 length;
+
+	for(UInt32 offset = start; offset < end; offset += length)
+	{
+		length = (end - offset < sizeof(gpNvm_IoBuffer)) ? end - offset : sizeof(gpNvm_IoBuffer);
+		readSize = pread(gpNvm_FileDescriptor, gpNvm_IoBuffer, length, offset);
+
+		if(readSize < 0)
+		{
+			printf("[gpNvm][%s] Cannot read file %s! Abort.\n",__FUNCTION__,gpNvm_FileName);
+			return GPNVM_ERROR_OPENING_FILE;
+		}
+
+		if((UInt32)readSize < length)
+		{
+			//Short file, the missing bytes are an empty memory
+			memset(&gpNvm_IoBuffer[readSize], 0xFF, length - readSize);
+		}
+		gpNvm_CopyImage(offset, gpNvm_IoBuffer, length, 1);
+	}
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_LoadCache
+ *
+ * Description: Load the file emulating non-volatile memory into the cache gpNvm_MemoryIndexTable,
+ * gpNvm_AttributesCrcTable, gpNvm_MemoryCache and gpNvm_AttributesFlags.
+ * With a bounded cache (GPNVM_CACHE_RAM_BUDGET) only the tables are loaded, user pages are read on demand.
+ * In RAM minimal mode only the tables kept in RAM are loaded.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the cache is loaded successfully
+ *                             GPNVM_ERROR_OPENING_FILE: the file could not be read
+ */
+static gpNvm_Result gpNvm_LoadCache(void)
+{
+	gpNvm_Result result = gpNvm_LoadImage(0, GPNVM_RESIDENT_SIZE);
+
+	if((result == GPNVM_OK) && (GPNVM_RESIDENT_SIZE < GPNVM_IMAGE_SIZE))
+	{
+		//The flags and ECC areas are after the part of the file kept in RAM, load them on their own
+		result = gpNvm_LoadImage((GPNVM_FLAGS_TABLE_OFFSET/GPNVM_SECTOR_SIZE)*GPNVM_SECTOR_SIZE, GPNVM_IMAGE_SIZE);
+	}
+	return result;
+}
+
+/*
+ * Name: gpNvm_WriteCache
+ *
+ * Description: Write the dirty sectors of the cache gpNvm_MemoryIndexTable, gpNvm_AttributesCrcTable and gpNvm_MemoryCache
+ * into the file emulating non-volatile memory. Consecutive dirty sectors are gathered in gpNvm_IoBuffer and written with
+ * one sector aligned pwrite, so the same path works with and without O_DIRECT. With a bounded cache, dirty user pages
+ * are written first. The data is handed to the operating system (or to the device with O_DIRECT) but it is not
+ * guaranteed to be durable until gpNvm_SyncFile is called.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the cache is written successfully
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written
+ */
+static gpNvm_Result gpNvm_WriteCache(void)
+{
+	UInt32 first = 0;
+	UInt32 count = 0;
+
+#if GPNVM_CACHE_RAM_BUDGET > 0
+	//Write dirty user pages, they are already sector aligned buffers
+	for(UInt16 slot = 0; slot < GPNVM_CACHE_PAGES; slot++)
+	{
+		if(((gpNvm_CachePageFlags[slot] & GPNVM_CACHE_PAGE_DIRTY) != 0) && (gpNvm_CacheWritePage(slot) != GPNVM_OK))
+		{
+			return GPNVM_ERROR_WRITING_FILE;
+		}
+	}
+#endif
+	while(first < GPNVM_IMAGE_SECTORS)
+	{
+		if((gpNvm_DirtySectors[first/8] & (1 << (first%8))) == 0)
+		{
+			first++;
+			continue;
+		}
+		//Gather the run of dirty sectors starting at first
+		for(count = 1; (count < GPNVM_IO_BUFFER_SECTORS) && (first + count < GPNVM_IMAGE_SECTORS); count++)
+		{
+			if((gpNvm_DirtySectors[(first + count)/8] & (1 << ((first + count)%8))) == 0)
+			{
+				break;
+			}
+		}
+		gpNvm_CopyImage(first*GPNVM_SECTOR_SIZE, gpNvm_IoBuffer, count*GPNVM_SECTOR_SIZE, 0);
+
+		if(gpNvm_WriteFile(gpNvm_IoBuffer, count*GPNVM_SECTOR_SIZE, (off_t)first*GPNVM_SECTOR_SIZE) != GPNVM_OK)
+		{
+			return GPNVM_ERROR_WRITING_FILE;
+		}
+
+		for(; count > 0; count--, first++)
+		{
+			gpNvm_DirtySectors[first/8] &= (UInt8)~(1 << (first%8));
+#if GPNVM_MULTI_PROCESS
+			//The other processes reload this sector, this one already has it
+			gpNvm_SectorGenerations[first] = ++gpNvm_Shared->sectorGenerations[first];
+#endif
+		}
+#if GPNVM_MULTI_PROCESS
+		gpNvm_Generation = __atomic_add_fetch(&gpNvm_Shared->generation, 1, __ATOMIC_RELEASE);
+#endif
+	}
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_SyncFile
+ *
+ * Description: Durability point. Force the data already written into the file emulating non-volatile
+ * memory, then into its copies, to the storage device with fdatasync. All the writes done before are covered,
+ * so the order in which attributes were set is preserved on the device.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the file is synced successfully
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be synced
+ */
+static gpNvm_Result gpNvm_SyncFile(void)
+{
+	if(gpNvm_SyncPending == 0)
+	{
+		//Nothing written since the last sync
+		return GPNVM_OK;
+	}
+
+	if(fdatasync(gpNvm_FileDescriptor) != 0)
+	{
+		printf("[gpNvm][%s] Cannot sync file %s! Abort.\n",__FUNCTION__,gpNvm_FileName);
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+#if GPNVM_MIRROR_COPIES > 0
+	for(UInt8 copy = 0; copy < gpNvm_MirrorsOpen; copy++)
+	{
+		if(fdatasync(gpNvm_MirrorDescriptors[copy]) != 0)
+		{
+			printf("[gpNvm][%s] Cannot sync copy %u of file %s! Abort.\n",__FUNCTION__,copy + 1,gpNvm_FileName);
+			return GPNVM_ERROR_WRITING_FILE;
+		}
+	}
+#endif
+	gpNvm_SyncPending = 0;
+	gpNvm_LastSyncTimeMs = gpNvm_GetTimeMs();
+	gpNvm_CacheStatistics.syncs++;
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_SyncDeadline
+ *
+ * Description: Thread syncing the writes deferred by GPNVM_SYNC_PERIODIC once the interval since the last sync expires,
+ * when no commit did it before. It waits on gpNvm_SyncWakeup, signaled by a deferred commit and by gpNvm_StopSyncThread,
+ * and syncs under gpNvm_Mutex like the API calls. A failed sync is retried after another interval.
+ *
+ * Parameters:
+ *            void* pContext: unused
+ *
+ * Return value: void*: NULL
+ */
+static void* gpNvm_SyncDeadline(void* pContext)
+{
+	struct timespec deadline;
+	UInt32 elapsed, remaining;
+
+	(void)pContext;
+	pthread_mutex_lock(&gpNvm_Mutex);
+
+	while(gpNvm_SyncThreadState == 0x81)
+	{
+		if((gpNvm_SyncPending == 0) || (gpNvm_CurrentSyncPolicy != GPNVM_SYNC_PERIODIC))
+		{
+			pthread_cond_wait(&gpNvm_SyncWakeup, &gpNvm_Mutex);
+			continue;
+		}
+		elapsed = gpNvm_GetTimeMs() - gpNvm_LastSyncTimeMs;
+
+		if(elapsed >= gpNvm_SyncIntervalMs)
+		{
+			if(gpNvm_SyncFile() != GPNVM_OK)
+			{
+				gpNvm_LastSyncTimeMs = gpNvm_GetTimeMs();
+			}
+			continue;
+		}
+		remaining = gpNvm_SyncIntervalMs - elapsed;
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += remaining/1000;
+		deadline.tv_nsec += (long)(remaining%1000)*1000000;
+
+		if(deadline.tv_nsec >= 1000000000)
+		{
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+		pthread_cond_timedwait(&gpNvm_SyncWakeup, &gpNvm_Mutex, &deadline);
+	}
+	pthread_mutex_unlock(&gpNvm_Mutex);
+	return NULL;
+}
+
+/*
+ * Name: gpNvm_SyncForkPrepare, gpNvm_SyncForkParent, gpNvm_SyncForkChild
+ *
+ * Description: fork handlers. gpNvm_Mutex is held across fork so that the child does not inherit it locked by
+ * gpNvm_SyncDeadline, and the child, which has no such thread, starts its own at its first deferred write.
+ *
+ * Parameters: None
+ *
+ * Return value: None
+ */
+static void gpNvm_SyncForkPrepare(void)
+{
+	pthread_mutex_lock(&gpNvm_Mutex);
+}
+
+static void gpNvm_SyncForkParent(void)
+{
+	pthread_mutex_unlock(&gpNvm_Mutex);
+}
+
+static void gpNvm_SyncForkChild(void)
+{
+	gpNvm_SyncThreadState &= 0x80;
+	pthread_mutex_unlock(&gpNvm_Mutex);
+}
+
+/*
+ * Name: gpNvm_StartSyncThread
+ *
+ * Description: Make sure gpNvm_SyncDeadline will sync a deferred write: start it the first time, wake it up after.
+ * Called with gpNvm_Mutex held. If the thread cannot be started, the write is synced now.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the write will be synced in time
+ *                             GPNVM_ERROR_WRITING_FILE: the thread could not be started and the file could not be synced
+ */
+static gpNvm_Result gpNvm_StartSyncThread(void)
+{
+	pthread_condattr_t attributes;
+
+	if((gpNvm_SyncThreadState & 0x80) == 0)
+	{
+		pthread_atfork(gpNvm_SyncForkPrepare, gpNvm_SyncForkParent, gpNvm_SyncForkChild);
+		gpNvm_SyncThreadState = 0x80;
+	}
+
+	if(gpNvm_SyncThreadState == 0x80)
+	{
+		//The deadlines are computed on CLOCK_MONOTONIC, like gpNvm_LastSyncTimeMs
+		pthread_condattr_init(&attributes);
+		pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+		pthread_cond_init(&gpNvm_SyncWakeup, &attributes);
+		pthread_condattr_destroy(&attributes);
+		gpNvm_SyncThreadState = 0x81;
+
+		if(pthread_create(&gpNvm_SyncThread, NULL, gpNvm_SyncDeadline, NULL) != 0)
+		{
+			printf("[gpNvm][%s] Cannot start the sync thread, syncing now!\n",__FUNCTION__);
+			pthread_cond_destroy(&gpNvm_SyncWakeup);
+			gpNvm_SyncThreadState = 0x80;
+			return gpNvm_SyncFile();
+		}
+	}
+	pthread_cond_signal(&gpNvm_SyncWakeup);
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_StopSyncThread
+ *
+ * Description: Stop gpNvm_SyncDeadline if it is running and wait for it. Called by gpNvm_Uninit without gpNvm_Mutex held,
+ * before its own durability point.
+ *
+ * Parameters: None
+ *
+ * Return value: None
+ */
+static void gpNvm_StopSyncThread(void)
+{
+	pthread_mutex_lock(&gpNvm_Mutex);
+
+	if(gpNvm_SyncThreadState != 0x81)
+	{
+		pthread_mutex_unlock(&gpNvm_Mutex);
+		return;
+	}
+	gpNvm_SyncThreadState = 0x82;
+	pthread_cond_signal(&gpNvm_SyncWakeup);
+	pthread_mutex_unlock(&gpNvm_Mutex);
+	pthread_join(gpNvm_SyncThread, NULL);
+	pthread_cond_destroy(&gpNvm_SyncWakeup);
+	gpNvm_SyncThreadState = 0x80;
+}
+
+#if GPNVM_MIRROR_COPIES > 0
+/*
+ * Name: gpNvm_CloseCopies
+ *
+ * Description: Close the copies of the file opened by gpNvm_OpenCopies.
+ *
+ * Parameters: None
+ *
+ * Return value: None
+ */
+static void gpNvm_CloseCopies(void)
+{
+	for(; gpNvm_MirrorsOpen > 0; gpNvm_MirrorsOpen--)
+	{
+		close(gpNvm_MirrorDescriptors[gpNvm_MirrorsOpen - 1]);
+	}
+}
+
+/*
+ * Name: gpNvm_OpenCopies
+ *
+ * Description: Open, or create, the GPNVM_MIRROR_COPIES copies of the file emulating non-volatile memory, named
+ * after it with the suffixes .1, .2... They are opened before the file is written, so that a new image is
+ * written into them too.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the copies are opened successfully
+ *                             GPNVM_ERROR_OPENING_FILE: a copy could not be opened, none is left open
+ */
+static gpNvm_Result gpNvm_OpenCopies(void)
+{
+	char name[PATH_MAX];
+
+	for(gpNvm_MirrorsOpen = 0; gpNvm_MirrorsOpen < GPNVM_MIRROR_COPIES; gpNvm_MirrorsOpen++)
+	{
+		if((snprintf(name, sizeof(name), "%s.%u", gpNvm_FileName, gpNvm_MirrorsOpen + 1) >= (int)sizeof(name)) ||
+		   ((gpNvm_MirrorDescriptors[gpNvm_MirrorsOpen] = gpNvm_OpenFile(name)) < 0))
+		{
+			printf("[gpNvm][%s] Cannot open copy %u of file %s! Abort.\n",__FUNCTION__,gpNvm_MirrorsOpen + 1,gpNvm_FileName);
+			gpNvm_CloseCopies();
+			return GPNVM_ERROR_OPENING_FILE;
+		}
+	}
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_CheckCopies
+ *
+ * Description: Once the file is loaded, rebuild each copy which is not an image of the current format: new, truncated,
+ * not yet upgraded, or with a damaged header. The file is copied into it through gpNvm_IoBuffer, then it is synced.
+ * A copy with the right header is kept as is, it follows the file since every write goes to both.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the copies are checked successfully
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: a copy could not be written or synced
+ */
+static gpNvm_Result gpNvm_CheckCopies(void)
+{
+	UInt32 chunk;
+	int fd;
+
+	for(UInt8 copy = 0; copy < gpNvm_MirrorsOpen; copy++)
+	{
+		fd = gpNvm_MirrorDescriptors[copy];
+
+		if((lseek(fd, 0, SEEK_END) >= (off_t)GPNVM_IMAGE_SIZE) && (pread(fd, gpNvm_IoBuffer, GPNVM_SECTOR_SIZE, 0) == GPNVM_SECTOR_SIZE) &&
+		   (memcmp(gpNvm_IoBuffer, &gpNvm_ImageHeader, sizeof(gpNvm_ImageHeader)) == 0))
+		{
+			continue;
+		}
+		printf("[gpNvm][%s] Copy %u of file %s is rebuilt! Continue.\n",__FUNCTION__,copy + 1,gpNvm_FileName);
+
+		for(UInt32 position = 0; position < GPNVM_IMAGE_SIZE; position += chunk)
+		{
+			chunk = GPNVM_IMAGE_SIZE - position;
+			chunk = (chunk < sizeof(gpNvm_IoBuffer)) ? chunk : sizeof(gpNvm_IoBuffer);
+
+			if(pread(gpNvm_FileDescriptor, gpNvm_IoBuffer, chunk, position) != (ssize_t)chunk)
+			{
+				printf("[gpNvm][%s] Cannot read file %s! Abort.\n",__FUNCTION__,gpNvm_FileName);
+				return GPNVM_ERROR_READING_FILE;
+			}
+
+			if(pwrite(fd, gpNvm_IoBuffer, chunk, position) != (ssize_t)chunk)
+			{
+				printf("[gpNvm][%s] Cannot write copy %u of file %s! Abort.\n",__FUNCTION__,copy + 1,gpNvm_FileName);
+				return GPNVM_ERROR_WRITING_FILE;
+			}
+		}
+
+		if((ftruncate(fd, GPNVM_IMAGE_SIZE) != 0) || (fdatasync(fd) != 0))
+		{
+			printf("[gpNvm][%s] Cannot sync copy %u of file %s! Abort.\n",__FUNCTION__,copy + 1,gpNvm_FileName);
+			return GPNVM_ERROR_WRITING_FILE;
+		}
+	}
+	return GPNVM_OK;
+}
+#endif
+
+/*
+ * Name: gpNvm_ReadHeader
+ *
+ * Description: Read the first sector of the existing file and check its header with gpNvm_CheckHeader. This is the
+ * only read done before deciding whether the file can be loaded, whatever its size.
+ *
+ * Parameters:
+ *            off_t fileSize: size of the file
+ *            UInt16* pVersion: pointer to store the format version of the file
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the file is an image of this build, possibly of an older format version
+ *                             GPNVM_ERROR_OPENING_FILE: the file could not be read
+ *                             GPNVM_ERROR_READING_FILE: the file is not an image of this build
+ */
+static gpNvm_Result gpNvm_ReadHeader(off_t fileSize, UInt16* pVersion)
+{
+	ssize_t readSize = pread(gpNvm_FileDescriptor, gpNvm_IoBuffer, GPNVM_SECTOR_SIZE, 0);
+
+	if(readSize < 0)
+	{
+		printf("[gpNvm][%s] Cannot read file %s! Abort.\n",__FUNCTION__,gpNvm_FileName);
+		return GPNVM_ERROR_OPENING_FILE;
+	}
+	memset(&gpNvm_IoBuffer[readSize], 0xFF, GPNVM_SECTOR_SIZE - readSize);
+	return gpNvm_CheckHeader(gpNvm_IoBuffer, fileSize, pVersion);
+}
+
+/*
+ * Name: gpNvm_WriteJournal
+ *
+ * Description: Write the migration journal in its own sector after the image and sync it, after syncing the data it
+ * describes. Uses gpNvm_IoBuffer.
+ *
+ * Parameters:
+ *            gpNvm_Migration* pMigration: migration in progress
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the journal is durable
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced
+ */
+static gpNvm_Result gpNvm_WriteJournal(gpNvm_Migration* pMigration)
+{
+	gpNvm_Result result = gpNvm_SyncFile();
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	pMigration->journal.crc = gpNvm_CalculateChecksum((UInt8*)&pMigration->journal, offsetof(gpNvm_Journal, crc));
+	memset(gpNvm_IoBuffer, 0xFF, GPNVM_SECTOR_SIZE);
+	memcpy(gpNvm_IoBuffer, &pMigration->journal, sizeof(gpNvm_Journal));
+
+	if(pwrite(gpNvm_FileDescriptor, gpNvm_IoBuffer, GPNVM_SECTOR_SIZE, pMigration->journalOffset) != GPNVM_SECTOR_SIZE)
+	{
+		printf("[gpNvm][%s] Cannot write the migration journal of file %s! Abort.\n",__FUNCTION__,gpNvm_FileName);
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+	gpNvm_SyncPending = 1;
+	return gpNvm_SyncFile();
+}
+
+/*
+ * Name: gpNvm_ReadJournal
+ *
+ * Description: Look for the journal of an interrupted migration in the last sector of a file longer than an image.
+ *
+ * Parameters:
+ *            off_t fileSize: size of the file
+ *            gpNvm_Journal* pJournal: pointer to store the journal, its magic is cleared if there is none
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the journal is read, or there is none
+ *                             GPNVM_ERROR_OPENING_FILE: the file could not be read
+ */
+static gpNvm_Result gpNvm_ReadJournal(off_t fileSize, gpNvm_Journal* pJournal)
+{
+	memset(pJournal, 0, sizeof(gpNvm_Journal));
+
+	if((fileSize <= (off_t)GPNVM_IMAGE_SIZE) || ((fileSize % GPNVM_SECTOR_SIZE) != 0))
+	{
+		return GPNVM_OK;
+	}
+
+	if(pread(gpNvm_FileDescriptor, gpNvm_IoBuffer, GPNVM_SECTOR_SIZE, fileSize - GPNVM_SECTOR_SIZE) != GPNVM_SECTOR_SIZE)
+	{
+		printf("[gpNvm][%s] Cannot read file %s! Abort.\n",__FUNCTION__,gpNvm_FileName);
+		return GPNVM_ERROR_OPENING_FILE;
+	}
+	memcpy(pJournal, gpNvm_IoBuffer, sizeof(gpNvm_Journal));
+
+	//A torn journal write keeps the previous one on the device, only a complete one is found here
+	if((pJournal->magic != GPNVM_JOURNAL_MAGIC) ||
+	   (pJournal->crc != gpNvm_CalculateChecksum((UInt8*)pJournal, offsetof(gpNvm_Journal, crc))) ||
+	   (pJournal->version > GPNVM_FORMAT_VERSION))
+	{
+		memset(pJournal, 0, sizeof(gpNvm_Journal));
+	}
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_MigrateArea
+ *
+ * Description: Step of an upgrade hook: move an area of the image to its offset in the new layout, through gpNvm_IoBuffer.
+ * The area is moved by chunks no longer than the move distance, from its end when it moves towards the end of the file and
+ * from its start otherwise, so a chunk never overwrites its own bytes nor bytes not moved yet. After each chunk the data is
+ * synced and the journal records it, so a chunk is moved again at most once after a crash and reading it again is safe.
+ * The steps of a hook are numbered in call order: the steps completed before a crash are skipped when the hook is replayed.
+ * Offsets and size are multiples of GPNVM_SECTOR_SIZE.
+ *
+ * Parameters:
+ *            gpNvm_Migration* pMigration: migration in progress
+ *            UInt32 from: offset of the area in the old layout
+ *            UInt32 to: offset of the area in the new layout
+ *            UInt32 size: size of the area
+ *            UInt32 fillFrom: bytes of the old layout from this offset are moved as 0xFF (the end of the old file)
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the area is moved successfully
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced
+ */
+static gpNvm_Result gpNvm_MigrateArea(gpNvm_Migration* pMigration, UInt32 from, UInt32 to, UInt32 size, UInt32 fillFrom)
+{
+	gpNvm_Journal* pJournal = &pMigration->journal;
+	UInt32 chunk = (to > from) ? to - from : from - to;
+	UInt32 length, position, kept;
+	gpNvm_Result result = GPNVM_OK;
+	UInt16 step = pMigration->step++;
+
+	if((step < pJournal->step) || (to == from))
+	{
+		//Completed before the migration was interrupted
+		return GPNVM_OK;
+	}
+
+	if(step > pJournal->step)
+	{
+		pJournal->step = step;
+		pJournal->done = 0;
+	}
+
+	if(chunk > sizeof(gpNvm_IoBuffer))
+	{
+		chunk = sizeof(gpNvm_IoBuffer);
+	}
+
+	while((result == GPNVM_OK) && (pJournal->done < size))
+	{
+		length = (size - pJournal->done < chunk) ? size - pJournal->done : chunk;
+		position = (to > from) ? size - pJournal->done - length : pJournal->done;
+
+		if(pread(gpNvm_FileDescriptor, gpNvm_IoBuffer, length, from + position) < 0)
+		{
+			printf("[gpNvm][%s] Cannot read file %s! Abort.\n",__FUNCTION__,gpNvm_FileName);
+			return GPNVM_ERROR_READING_FILE;
+		}
+
+		if(from + position + length > fillFrom)
+		{
+			//Past the old end of file, including a short read and the zeros written by the preallocation
+			kept = (from + position < fillFrom) ? fillFrom - (from + position) : 0;
+			memset(&gpNvm_IoBuffer[kept], 0xFF, length - kept);
+		}
+
+		if(pwrite(gpNvm_FileDescriptor, gpNvm_IoBuffer, length, to + position) != (ssize_t)length)
+		{
+			printf("[gpNvm][%s] Cannot write file %s! Abort.\n",__FUNCTION__,gpNvm_FileName);
+			return GPNVM_ERROR_WRITING_FILE;
+		}
+		gpNvm_SyncPending = 1;
+		pJournal->done += length;
+		result = gpNvm_WriteJournal(pMigration);
+	}
+	return result;
+}
+
+/*
+ * Name: gpNvm_UpgradeFromVersion0
+ *
+ * Description: Upgrade hook from format version 0, the layout without header: every area moves GPNVM_HEADER_AREA_SIZE
+ * bytes further in the file to leave room for the header. The bytes past the end of the old file (an image written
+ * before it was preallocated, or before the flags area existed) become 0xFF, the empty memory.
+ *
+ * Parameters:
+ *            gpNvm_Migration* pMigration: migration in progress
+ *
+ * Return value: gpNvm_Result: same as gpNvm_MigrateArea
+ */
+static gpNvm_Result gpNvm_UpgradeFromVersion0(gpNvm_Migration* pMigration)
+{
+	return gpNvm_MigrateArea(pMigration, 0, GPNVM_HEADER_AREA_SIZE, GPNVM_IMAGE_SIZE - GPNVM_HEADER_AREA_SIZE, pMigration->journal.fileSize);
+}
+
+/* Upgrade hooks, gpNvm_Upgrades[v] converts an image of format version v into version v + 1 in place. A hook is a fixed
+ * sequence of gpNvm_MigrateArea steps, so it can be replayed after a crash */
+static const gpNvm_UpgradeHook gpNvm_Upgrades[GPNVM_FORMAT_VERSION] =
+{
+	gpNvm_UpgradeFromVersion0
+};
+
+/*
+ * Name: gpNvm_UpgradeImage
+ *
+ * Description: Bring an image of an older format version to GPNVM_FORMAT_VERSION in place, or finish the migration
+ * recorded by a journal found at init. The journal is written in a sector after the image before anything is moved,
+ * then the upgrade hooks run from the version of the file, the journal recording each completed version. Finally the
+ * header of this build is written and the file is truncated to GPNVM_IMAGE_SIZE, which drops the journal. A crash at
+ * any point leaves either the old image without journal or a journal from which gpNvm_Init resumes. Called at init,
+ * before the cache is loaded. Only gpNvm_IoBuffer is used, whatever the image size.
+ *
+ * Parameters:
+ *            gpNvm_Journal* pJournal: journal of an interrupted migration, or a journal with a cleared magic
+ *            UInt16 version: format version of the file, when there is no journal
+ *            off_t fileSize: size of the file before it was preallocated
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the image is upgraded successfully
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced
+ */
+static gpNvm_Result gpNvm_UpgradeImage(const gpNvm_Journal* pJournal, UInt16 version, off_t fileSize)
+{
+	gpNvm_Result result = GPNVM_OK;
+	gpNvm_Migration migration;
+
+	if(pJournal->magic == GPNVM_JOURNAL_MAGIC)
+	{
+		printf("[gpNvm][%s] Resuming the upgrade of file %s from format version %u to %u.\n",__FUNCTION__,gpNvm_FileName,pJournal->version,GPNVM_FORMAT_VERSION);
+		migration.journal = *pJournal;
+		migration.journalOffset = fileSize - GPNVM_SECTOR_SIZE;
+	}
+	else
+	{
+		printf("[gpNvm][%s] Upgrading file %s from format version %u to %u.\n",__FUNCTION__,gpNvm_FileName,version,GPNVM_FORMAT_VERSION);
+		memset(&migration.journal, 0, sizeof(migration.journal));
+		migration.journal.magic = GPNVM_JOURNAL_MAGIC;
+		migration.journal.version = version;
+		migration.journal.fileSize = (UInt32)fileSize;
+		migration.journalOffset = GPNVM_ALIGN_UP((UInt32)fileSize, GPNVM_SECTOR_SIZE);
+
+		if(migration.journalOffset < GPNVM_IMAGE_SIZE)
+		{
+			migration.journalOffset = GPNVM_IMAGE_SIZE;
+		}
+		result = gpNvm_WriteJournal(&migration);
+	}
+
+	while((result == GPNVM_OK) && (migration.journal.version < GPNVM_FORMAT_VERSION))
+	{
+		migration.step = 0;
+		result = gpNvm_Upgrades[migration.journal.version](&migration);
+
+		if(result == GPNVM_OK)
+		{
+			migration.journal.version++;
+			migration.journal.step = 0;
+			migration.journal.done = 0;
+			result = gpNvm_WriteJournal(&migration);
+		}
+	}
+
+	if(result == GPNVM_OK)
+	{
+		gpNvm_MarkDirty(0, sizeof(gpNvm_Header));
+		result = gpNvm_WriteCache();
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_SyncFile();
+	}
+
+	if((result == GPNVM_OK) && (ftruncate(gpNvm_FileDescriptor, GPNVM_IMAGE_SIZE) != 0))
+	{
+		printf("[gpNvm][%s] Cannot drop the migration journal of file %s! Abort.\n",__FUNCTION__,gpNvm_FileName);
+		result = GPNVM_ERROR_WRITING_FILE;
+	}
+
+	if(result == GPNVM_OK)
+	{
+		gpNvm_SyncPending = 1;
+		result = gpNvm_SyncFile();
+	}
+	return result;
+}
+
+/*
+ * Name: gpNvm_CommitCache
+ *
+ * Description: Write the dirty sectors of the cache into the file then decide, according to gpNvm_CurrentSyncPolicy,
+ * if a durability point is needed now:
+ *    - GPNVM_SYNC_ALWAYS: the file is synced after each write.
+ *    - GPNVM_SYNC_PERIODIC: the file is synced only if the last sync is older than gpNvm_SyncIntervalMs,
+ *      otherwise the sync is deferred to a next commit, gpNvm_Sync or gpNvm_Uninit, or to gpNvm_SyncDeadline when the
+ *      interval expires.
+ *    - GPNVM_SYNC_NONE: the file is synced only by gpNvm_Sync or gpNvm_Uninit.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the cache is committed successfully
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced
+ */
+static gpNvm_Result gpNvm_CommitCache(void)
+{
+	gpNvm_Result result = gpNvm_WriteCache();
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+
+	switch(gpNvm_CurrentSyncPolicy)
+	{
+		case GPNVM_SYNC_ALWAYS:
+			result = gpNvm_SyncFile();
+			break;
+		case GPNVM_SYNC_PERIODIC:
+			if((UInt32)(gpNvm_GetTimeMs() - gpNvm_LastSyncTimeMs) >= gpNvm_SyncIntervalMs)
+			{
+				result = gpNvm_SyncFile();
+			}
+			else
+			{
+				result = gpNvm_StartSyncThread();
+			}
+			break;
+		default:
+			break;
+	}
+	return result;
+}
+
+#if GPNVM_COMPRESSION > 0
+/*
+ * Name: gpNvm_Compress
+ *
+ * Description: Run-length encode a value, for sparse values with runs of zeros or erased bytes. The encoded value
+ * starts with the length of the value, then each control byte is followed by GPNVM_RLE_MAX_LITERALS literal bytes at
+ * most (control = count - 1, below 0x80) or by a byte repeated GPNVM_RLE_MIN_RUN to GPNVM_RLE_MAX_RUN times
+ * (control = 0x80 + count - GPNVM_RLE_MIN_RUN). Encoding stops as soon as it is not shorter than the value.
+ *
+ * Parameters:
+ *            UInt8 length: length of the value
+ *            const UInt8* pValue: pointer to the value
+ *            UInt8* pPacked: pointer to store the encoded value, length - 1 bytes
+ *
+ * Return value: UInt8: length of the encoded value, 0 if it is not shorter than the value
+ */
+static UInt8 gpNvm_Compress(UInt8 length, const UInt8* pValue, UInt8* pPacked)
+{
+	UInt16 in = 0, out = 1, literals = 0;
+	UInt16 run, count;
+
+	pPacked[0] = length;
+
+	while(literals < length)
+	{
+		for(run = 1; (in + run < length) && (run < GPNVM_RLE_MAX_RUN) && (pValue[in + run] == pValue[in]); run++);
+
+		if((in < length) && (run < GPNVM_RLE_MIN_RUN))
+		{
+			in += run;
+			continue;
+		}
+		//Flush the literals before the run, or at the end of the value
+		while(literals < in)
+		{
+			count = ((in - literals) < GPNVM_RLE_MAX_LITERALS) ? (in - literals) : GPNVM_RLE_MAX_LITERALS;
+
+			if(out + 1 + count >= length)
+			{
+				return 0;
+			}
+			pPacked[out++] = (UInt8)(count - 1);
+			memcpy(&pPacked[out], &pValue[literals], count);
+			out += count;
+			literals += count;
+		}
+
+		if(in < length)
+		{
+			if(out + 2 >= length)
+			{
+				return 0;
+			}
+			pPacked[out++] = (UInt8)(0x80 + run - GPNVM_RLE_MIN_RUN);
+			pPacked[out++] = pValue[in];
+			in += run;
+			literals = in;
+		}
+	}
+	return (out < length) ? (UInt8)out : 0;
+}
+
+/*
+ * Name: gpNvm_Decompress
+ *
+ * Description: Decode a value encoded by gpNvm_Compress. The encoding must give exactly the length it starts with.
+ *
+ * Parameters:
+ *            const UInt8* pRecord: pointer to the length then the encoded value, as stored in the user area
+ *            UInt8* pLength: pointer to store the length of the value
+ *            UInt8* pValue: pointer to store the value, 255 bytes
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the value is decoded successfully
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: the encoded value is invalid
+ */
+static gpNvm_Result gpNvm_Decompress(const UInt8* pRecord, UInt8* pLength, UInt8* pValue)
+{
+	UInt16 end = 1 + pRecord[0];
+	UInt16 in = 2, out = 0;
+	UInt16 count;
+
+	if(pRecord[0] == 0)
+	{
+		return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+	}
+
+	while(in < end)
+	{
+		if(pRecord[in] < 0x80)
+		{
+			count = pRecord[in] + 1;
+
+			if((in + 1 + count > end) || (out + count > pRecord[1]))
+			{
+				return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+			}
+			memcpy(&pValue[out], &pRecord[in + 1], count);
+			in += 1 + count;
+		}
+		else
+		{
+			count = pRecord[in] - 0x80 + GPNVM_RLE_MIN_RUN;
+
+			if((in + 2 > end) || (out + count > pRecord[1]))
+			{
+				return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+			}
+			memset(&pValue[out], pRecord[in + 1], count);
+			in += 2;
+		}
+		out += count;
+	}
+
+	if(out != pRecord[1])
+	{
+		return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+	}
+	*pLength = pRecord[1];
+	return GPNVM_OK;
+}
+#endif
+
+/*
+ * Name: gpNvm_CheckAttribute
+ *
+ * Description: Check the length and value of an attribute, as stored in the user attributes data area, against its
+ * CRC. The CRC of a counter only covers its base, its bitmap is checked by gpNvm_DecodeCounter. The CRC of a compressed
+ * value covers the decoded value, so a record read with the wrong type fails too.
+ *
+ * Parameters:
+ *            UInt8 type: type of the attribute, see gpNvm_GetType
+ *            const UInt8* pRecord: pointer to the length then the value of the attribute
+ *            UInt8 crc: stored CRC of the attribute
+ *            UInt8* pLength: pointer to a variable that will store the length of attribute data
+ *            UInt8* pValue: pointer to store attribute data, a counter is decoded as a UInt32, a compressed value is decoded
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: attribute data is sane
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: attribute data are corrupted
+ */
+static gpNvm_Result gpNvm_CheckAttribute(UInt8 type, const UInt8* pRecord, UInt8 crc, UInt8* pLength, UInt8* pValue)
+{
+	UInt32 count = 0;
+	UInt8 nextByte = 0;
+#if GPNVM_COMPRESSION > 0
+	UInt8 value[255];
+	UInt8 length = 0;
+
+	if(type == GPNVM_TYPE_COMPRESSED)
+	{
+		if((gpNvm_Decompress(pRecord, &length, value) != GPNVM_OK) || (gpNvm_CalculateChecksum(value,length) != crc))
+		{
+			return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+		}
+		*pLength = length;
+		memcpy(pValue,value,length);
+		return GPNVM_OK;
+	}
+#endif
+
+	if(type == GPNVM_TYPE_COUNTER)
+	{
+		if((pRecord[0] != GPNVM_COUNTER_LENGTH) || (gpNvm_CalculateChecksum((UInt8*)&pRecord[1],sizeof(UInt32)) != crc) ||
+		   (gpNvm_DecodeCounter(&pRecord[1], &count, &nextByte) != GPNVM_OK))
+		{
+			return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+		}
+		//A counter is read as its UInt32 value
+		*pLength = sizeof(count);
+		memcpy(pValue,&count,sizeof(count));
+		return GPNVM_OK;
+	}
+
+	if(gpNvm_CalculateChecksum((UInt8*)&pRecord[1],pRecord[0]) != crc)
+	{
+		return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+	}
+	*pLength = pRecord[0];
+	memcpy(pValue,&pRecord[1],pRecord[0]);
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_ReadStored
+ *
+ * Description: Read the offset, the length and value, and the CRC of an attribute, without checking them.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt16* pOffset: pointer to store the offset of the attribute in user non-volatile memory
+ *            UInt8* pRecord: pointer to store the length then the value of the attribute, 256 bytes
+ *            UInt8* pCrc: pointer to store the CRC of the attribute
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the attribute is read successfully
+ *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the provided attribute is not in non-volatile memory
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: the attribute ends out of the user attributes data area
+ *                             GPNVM_ERROR_READING_FILE: the attribute could not be read from the file
+ */
+static gpNvm_Result gpNvm_ReadStored(gpNvm_AttrId attrId, UInt16* pOffset, UInt8* pRecord, UInt8* pCrc)
+{
+	gpNvm_Result result = GPNVM_OK;
+
+	//Check if attribute is in non-volatile memory
+	result = gpNvm_GetIndexEntry(attrId, pOffset);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+
+	if(*pOffset == 0xFFFF)
+	{
+		printf("[gpNvm][%s] Invalid attribute! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_ATTRIBUTE_ID;
+	}
+
+	if(*pOffset >= GPNVM_USER_MEMORY_SIZE)
+	{
+		return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+	}
+	//Read attribute length, value and crc
+	result = gpNvm_ReadUserMemory(*pOffset, pRecord, 1);
+
+	if((result == GPNVM_OK) && (*pOffset + 1 + pRecord[0] > GPNVM_USER_MEMORY_SIZE))
+	{
+		return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_ReadUserMemory(*pOffset + 1, &pRecord[1], pRecord[0]);
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_GetCrc(attrId, pCrc);
+	}
+	return result;
+}
+
+#if GPNVM_MIRROR_COPIES > 0
+/*
+ * Name: gpNvm_ReadCopy
+ *
+ * Description: Read bytes of a copy of the file at any offset, one sector at a time through gpNvm_IoBuffer, so that
+ * the reads stay sector aligned as required by O_DIRECT.
+ *
+ * Parameters:
+ *            UInt8 copy: index of the copy in gpNvm_MirrorDescriptors
+ *            UInt32 offset: offset in the copy of the first byte
+ *            UInt8* pData: pointer to store the data read
+ *            UInt32 length: number of bytes to read
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the bytes are read successfully
+ *                             GPNVM_ERROR_READING_FILE: the copy could not be read
+ */
+static gpNvm_Result gpNvm_ReadCopy(UInt8 copy, UInt32 offset, UInt8* pData, UInt32 length)
+{
+	off_t sectorOffset;
+	UInt32 chunk;
+
+	while(length > 0)
+	{
+		sectorOffset = (off_t)(offset/GPNVM_SECTOR_SIZE)*GPNVM_SECTOR_SIZE;
+		chunk = GPNVM_SECTOR_SIZE - offset%GPNVM_SECTOR_SIZE;
+		chunk = (chunk < length) ? chunk : length;
+
+		if(pread(gpNvm_MirrorDescriptors[copy], gpNvm_IoBuffer, GPNVM_SECTOR_SIZE, sectorOffset) != GPNVM_SECTOR_SIZE)
+		{
+			printf("[gpNvm][%s] Cannot read copy %u of file %s! Abort.\n",__FUNCTION__,copy + 1,gpNvm_FileName);
+			return GPNVM_ERROR_READING_FILE;
+		}
+		memcpy(pData, &gpNvm_IoBuffer[offset%GPNVM_SECTOR_SIZE], chunk);
+		pData += chunk;
+		offset += chunk;
+		length -= chunk;
+	}
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_FetchCopy
+ *
+ * Description: Read an attribute from a copy of the file and check it. The copy must hold it with the type it has
+ * in the file.
+ *
+ * Parameters:
+ *            UInt8 copy: index of the copy in gpNvm_MirrorDescriptors
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt16* pOffset: pointer to store the offset of the attribute in the user area of the copy
+ *            UInt8* pRecord: pointer to store the length then the value of the attribute, 256 bytes
+ *            UInt8* pCrc: pointer to store the CRC of the attribute
+ *            UInt8* pLength: pointer to a variable that will store the length of attribute data
+ *            UInt8* pValue: pointer to store attribute data, a counter is decoded as a UInt32
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the copy holds the attribute sane
+ *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the copy does not hold the attribute
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: the attribute is corrupted in the copy too
+ *                             GPNVM_ERROR_READING_FILE: the copy could not be read
+ */
+static gpNvm_Result gpNvm_FetchCopy(UInt8 copy, gpNvm_AttrId attrId, UInt16* pOffset, UInt8* pRecord, UInt8* pCrc, UInt8* pLength, UInt8* pValue)
+{
+	gpNvm_Result result;
+	UInt8 flags[2] = {0xFF, 0xFF};
+	UInt8 type;
+
+	result = gpNvm_ReadCopy(copy, GPNVM_INDEX_TABLE_OFFSET + attrId*sizeof(UInt16), (UInt8*)pOffset, sizeof(UInt16));
+
+	if((result == GPNVM_OK) && (*pOffset == 0xFFFF))
+	{
+		return GPNVM_ERROR_INVALID_ATTRIBUTE_ID;
+	}
+
+	if((result == GPNVM_OK) && (*pOffset >= GPNVM_USER_MEMORY_SIZE))
+	{
+		return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_ReadCopy(copy, GPNVM_USER_MEMORY_OFFSET + *pOffset, pRecord, 1);
+	}
+
+	if((result == GPNVM_OK) && (*pOffset + 1 + pRecord[0] > GPNVM_USER_MEMORY_SIZE))
+	{
+		return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_ReadCopy(copy, GPNVM_USER_MEMORY_OFFSET + *pOffset + 1, &pRecord[1], pRecord[0]);
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_ReadCopy(copy, GPNVM_CRC_TABLE_OFFSET + attrId, pCrc, 1);
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_ReadCopy(copy, GPNVM_FLAGS_TABLE_OFFSET + attrId/8, &flags[0], 1);
+	}
+#if GPNVM_COMPRESSION > 0
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_ReadCopy(copy, GPNVM_FLAGS_TABLE_OFFSET + GPNVM_TYPE_FLAGS_SIZE + attrId/8, &flags[1], 1);
+	}
+#endif
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	type = ((flags[0] & (1 << (attrId%8))) == 0) ? GPNVM_TYPE_COUNTER :
+	       (((flags[1] & (1 << (attrId%8))) == 0) ? GPNVM_TYPE_COMPRESSED : GPNVM_TYPE_PLAIN);
+
+	if(type != gpNvm_GetType(attrId))
+	{
+		return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+	}
+	return gpNvm_CheckAttribute(type, pRecord, *pCrc, pLength, pValue);
+}
+
+/*
+ * Name: gpNvm_ReadCopies
+ *
+ * Description: Read an attribute corrupted in the file from the first copy holding it sane.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8* pLength: pointer to a variable that will store the length of attribute data
+ *            UInt8* pValue: pointer to store attribute data, a counter is decoded as a UInt32
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: attribute data is read successfully from a copy
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: no copy holds the attribute sane
+ */
+static gpNvm_Result gpNvm_ReadCopies(gpNvm_AttrId attrId, UInt8* pLength, UInt8* pValue)
+{
+	UInt8 record[1 + 255];
+	UInt16 offset;
+	UInt8 crc;
+
+	for(UInt8 copy = 0; copy < gpNvm_MirrorsOpen; copy++)
+	{
+		if(gpNvm_FetchCopy(copy, attrId, &offset, record, &crc, pLength, pValue) == GPNVM_OK)
+		{
+			return GPNVM_OK;
+		}
+	}
+	return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+}
+
+/*
+ * Name: gpNvm_CheckAttributes
+ *
+ * Description: Check every stored attribute once the file is loaded, and mark the ones failing their check to be
+ * repaired by the first writer (gpNvm_RepairAttributes), before its own update. A write copies whole sectors of the
+ * cache into the copies, so an attribute corrupted in the file would otherwise reach every copy with the first write
+ * of another attribute of its sector.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the attributes are checked successfully
+ *                             GPNVM_ERROR_READING_FILE: an attribute could not be read from the file
+ */
+static gpNvm_Result gpNvm_CheckAttributes(void)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt8 record[1 + 255];
+	UInt8 value[255];
+	UInt16 offset;
+	UInt8 length, crc;
+
+	for(UInt16 attrId = 0; (result == GPNVM_OK) && (attrId < GPNVM_MEMORY_INDEX_TABLE_SIZE); attrId++)
+	{
+		result = gpNvm_GetIndexEntry((gpNvm_AttrId)attrId, &offset);
+
+		if((result != GPNVM_OK) || (offset == 0xFFFF))
+		{
+			continue;
+		}
+		result = gpNvm_ReadStored((gpNvm_AttrId)attrId, &offset, record, &crc);
+
+		if((result == GPNVM_ERROR_CORRUPTED_ATTRIBUTE) ||
+		   ((result == GPNVM_OK) && (gpNvm_CheckAttribute(gpNvm_GetType((gpNvm_AttrId)attrId), record, crc, &length, value) != GPNVM_OK)))
+		{
+			gpNvm_RepairPending[attrId/8] |= (UInt8)(1 << (attrId%8));
+			gpNvm_RepairPendingAny = 1;
+			result = GPNVM_OK;
+		}
+	}
+	return result;
+}
+#endif
+
+#if GPNVM_ECC_INTERLEAVE > 0
+/*
+ * Name: gpNvm_CorrectAttribute
+ *
+ * Description: Correct an attribute failing its check with its ECC entry (gpNvm_EccCorrect). The length byte is not
+ * in the codewords but the entry keeps a copy of it: the value is corrected with the stored length, then with the
+ * length of the entry if it differs. The corrected attribute must pass its check, the CRC catching a miscorrection
+ * of more errors than the ECC corrects. A value without error in any codeword is sane: the CRC is the corrupted byte
+ * and it is computed again.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt16 offset: offset of the attribute in user non-volatile memory
+ *            UInt8* pRecord: pointer to the length then the value of the attribute as read, corrected in place
+ *            UInt8* pCrc: pointer to the stored CRC of the attribute, corrected in place
+ *            UInt8* pLength: pointer to a variable that will store the length of attribute data
+ *            UInt8* pValue: pointer to store attribute data, a counter is decoded as a UInt32
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the attribute is corrected successfully
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: the attribute has more errors than the ECC corrects
+ *                             GPNVM_ERROR_READING_FILE: the attribute could not be read from the file
+ */
+static gpNvm_Result gpNvm_CorrectAttribute(gpNvm_AttrId attrId, UInt16 offset, UInt8* pRecord, UInt8* pCrc, UInt8* pLength, UInt8* pValue)
+{
+	UInt8 entry[GPNVM_ECC_ENTRY_SIZE];
+	UInt8 lengths[2];
+	UInt8 type = gpNvm_GetType(attrId);
+	UInt8 clean, crc;
+	gpNvm_Result result = gpNvm_GetEcc(attrId, entry);
+
+	lengths[0] = pRecord[0];
+	lengths[1] = entry[0];
+
+	for(UInt8 cpt = 0; (result == GPNVM_OK) && (cpt < ((lengths[1] != lengths[0]) ? 2 : 1)); cpt++)
+	{
+		if((UInt32)(offset + 1 + lengths[cpt]) > GPNVM_USER_MEMORY_SIZE)
+		{
+			continue;
+		}
+		pRecord[0] = lengths[cpt];
+		result = gpNvm_ReadUserMemory(offset + 1, &pRecord[1], pRecord[0]);
+
+		if((result != GPNVM_OK) || (gpNvm_EccCorrect(pRecord[0], &pRecord[1], entry, &clean) != GPNVM_OK))
+		{
+			continue;
+		}
+		crc = *pCrc;
+
+		//Without error in any codeword the CRC is the corrupted byte, computed again as gpNvm_CheckAttribute checks it
+		if((clean != 0) && (type == GPNVM_TYPE_COUNTER))
+		{
+			crc = gpNvm_CalculateChecksum(&pRecord[1], sizeof(UInt32));
+		}
+#if GPNVM_COMPRESSION > 0
+		else if((clean != 0) && (type == GPNVM_TYPE_COMPRESSED))
+		{
+			crc = (gpNvm_Decompress(pRecord, pLength, pValue) == GPNVM_OK) ? gpNvm_CalculateChecksum(pValue, *pLength) : crc;
+		}
+#endif
+		else if(clean != 0)
+		{
+			crc = gpNvm_CalculateChecksum(&pRecord[1], pRecord[0]);
+		}
+
+		if(gpNvm_CheckAttribute(type, pRecord, crc, pLength, pValue) == GPNVM_OK)
+		{
+			*pCrc = crc;
+			return GPNVM_OK;
+		}
+	}
+	return (result == GPNVM_OK) ? GPNVM_ERROR_CORRUPTED_ATTRIBUTE : result;
+}
+
+/*
+ * Name: gpNvm_EccRebuild
+ *
+ * Description: Set the ECC entry of every stored attribute passing its check. Called once an image is upgraded, the
+ * upgrade leaving the ECC table erased.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the ECC entries are set successfully
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written
+ */
+static gpNvm_Result gpNvm_EccRebuild(void)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt8 record[1 + 255];
+	UInt8 value[255];
+	UInt16 offset;
+	UInt8 length, crc;
+
+	for(UInt16 attrId = 0; (result == GPNVM_OK) && (attrId < GPNVM_MEMORY_INDEX_TABLE_SIZE); attrId++)
+	{
+		result = gpNvm_GetIndexEntry((gpNvm_AttrId)attrId, &offset);
+
+		if((result != GPNVM_OK) || (offset == 0xFFFF))
+		{
+			continue;
+		}
+		result = gpNvm_ReadStored((gpNvm_AttrId)attrId, &offset, record, &crc);
+
+		if((result == GPNVM_OK) && (gpNvm_CheckAttribute(gpNvm_GetType((gpNvm_AttrId)attrId), record, crc, &length, value) == GPNVM_OK))
+		{
+			result = gpNvm_SetEcc((gpNvm_AttrId)attrId, record[0], &record[1]);
+		}
+	}
+	return result;
+}
+#endif
+
+#if GPNVM_REPAIR
+/*
+ * Name: gpNvm_RepairAttributes
+ *
+ * Description: Repair the attributes marked by gpNvm_ReadAttribute. An attribute still failing its check in the file is
+ * corrected with its ECC, or else gets the length, value and CRC of the first copy holding it sane. It is repaired in
+ * place, then written with the next write of the cache (directly in RAM minimal mode). An attribute moved or removed
+ * since is left as it is. Called by gpNvm_Lock for a writer, with the file locked.
+ *
+ * Parameters: None
+ *
+ * Return value: None
+ */
+static void gpNvm_RepairAttributes(void)
+{
+	UInt8 record[1 + 255];
+	UInt8 value[255];
+	UInt16 offset;
+	UInt8 length, crc;
+#if GPNVM_MIRROR_COPIES > 0
+	UInt16 copyOffset;
+	UInt8 copy;
+#endif
+
+	for(UInt16 attrId = 0; attrId < GPNVM_MEMORY_INDEX_TABLE_SIZE; attrId++)
+	{
+		if((gpNvm_RepairPending[attrId/8] & (1 << (attrId%8))) == 0)
+		{
+			continue;
+		}
+		gpNvm_RepairPending[attrId/8] &= (UInt8)~(1 << (attrId%8));
+
+		//Another writer may have set it again since it was read
+		if((gpNvm_ReadStored((gpNvm_AttrId)attrId, &offset, record, &crc) != GPNVM_OK) ||
+		   (gpNvm_CheckAttribute(gpNvm_GetType((gpNvm_AttrId)attrId), record, crc, &length, value) == GPNVM_OK))
+		{
+			continue;
+		}
+#if GPNVM_ECC_INTERLEAVE > 0
+		if(gpNvm_CorrectAttribute((gpNvm_AttrId)attrId, offset, record, &crc, &length, value) == GPNVM_OK)
+		{
+			if((gpNvm_WriteUserMemory(offset, record, 1 + record[0]) != GPNVM_OK) || (gpNvm_SetCrc((gpNvm_AttrId)attrId, crc) != GPNVM_OK))
+			{
+				printf("[gpNvm][%s] Cannot repair attribute %u! Continue.\n",__FUNCTION__,attrId);
+			}
+			continue;
+		}
+#endif
+#if GPNVM_MIRROR_COPIES > 0
+		for(copy = 0; copy < gpNvm_MirrorsOpen; copy++)
+		{
+			if(gpNvm_FetchCopy(copy, (gpNvm_AttrId)attrId, &copyOffset, record, &crc, &length, value) == GPNVM_OK)
+			{
+				break;
+			}
+		}
+
+		if((copy < gpNvm_MirrorsOpen) && ((copyOffset != offset) || (gpNvm_WriteUserMemory(offset, record, 1 + record[0]) != GPNVM_OK) ||
+		   (gpNvm_SetCrc((gpNvm_AttrId)attrId, crc) != GPNVM_OK) || (gpNvm_SetEcc((gpNvm_AttrId)attrId, record[0], &record[1]) != GPNVM_OK)))
+		{
+			printf("[gpNvm][%s] Cannot repair attribute %u! Continue.\n",__FUNCTION__,attrId);
+		}
+#endif
+	}
+	gpNvm_RepairPendingAny = 0;
+}
+#endif
+
+/*
+ * Name: gpNvm_ReadAttribute
+ *
+ * Description: Read an attribute and check its CRC. A counter is decoded and returned as a UInt32. An attribute failing
+ * its check is corrected with its ECC (GPNVM_ECC_INTERLEAVE), or else read from a copy of the file (GPNVM_MIRROR_COPIES),
+ * and marked to be repaired in the file by the next writer (gpNvm_RepairAttributes), so the read does not wait for the
+ * repair. Called with gpNvm_Mutex held.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8* pLength: pointer to a variable that will store the length of attribute data
+ *            UInt8* pValue: pointer to store attribute data
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: attribute data is read successfully
+ *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the provided attribute is not in non-volatile memory
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: attribute data are corrupted beyond correction, in every copy
+ *                             GPNVM_ERROR_READING_FILE: attribute data could not be read from the file
+ */
+static gpNvm_Result gpNvm_ReadAttribute(gpNvm_AttrId attrId, UInt8* pLength, UInt8* pValue)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt16 attributeOffset = 0;
+	UInt8 attributeRecord[1 + 255];
+	UInt8 attributeCrc = 0;
+
+	result = gpNvm_ReadStored(attrId, &attributeOffset, attributeRecord, &attributeCrc);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	//Validate attribute data by comparing attribute crc stored in gpNvm_AttributesCrcTable and the calculated crc of the attribute data
+	result = gpNvm_CheckAttribute(gpNvm_GetType(attrId), attributeRecord, attributeCrc, pLength, pValue);
+
+	if(result == GPNVM_OK)
+	{
+		return GPNVM_OK;
+	}
+#if GPNVM_ECC_INTERLEAVE > 0
+	result = gpNvm_CorrectAttribute(attrId, attributeOffset, attributeRecord, &attributeCrc, pLength, pValue);
+#endif
+#if GPNVM_MIRROR_COPIES > 0
+	if(result == GPNVM_ERROR_CORRUPTED_ATTRIBUTE)
+	{
+		result = gpNvm_ReadCopies(attrId, pLength, pValue);
+	}
+#endif
+#if GPNVM_REPAIR
+	if(result == GPNVM_OK)
+	{
+		gpNvm_RepairPending[attrId/8] |= (UInt8)(1 << (attrId%8));
+		gpNvm_RepairPendingAny = 1;
+		return GPNVM_OK;
+	}
+#endif
+	if(result == GPNVM_ERROR_CORRUPTED_ATTRIBUTE)
+	{
+		printf("[gpNvm][%s] Corrupted %s data! Abort.\n",__FUNCTION__,(gpNvm_IsCounter(attrId) != 0) ? "counter" : "attribute");
+	}
+	return result;
+}
+
+/*
+ * Name: gpNvm_SnapshotPreserve
+ *
+ * Description: Copy-on-write of an attribute about to change: each open snapshot that has not saved it yet keeps
+ * its current value in its arena, or records that it is not stored. Called with gpNvm_Mutex held, before the
+ * attribute is updated in cache.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *
+ * Return value: None
+ */
+static void gpNvm_SnapshotPreserve(gpNvm_AttrId attrId)
+{
+#if GPNVM_MAX_SNAPSHOTS > 0
+	gpNvm_Snapshot* pSnapshot;
+	gpNvm_Result result;
+	UInt16 attributeOffset = 0;
+	UInt8 value[255];
+	UInt8 length = 0;
+
+	for(UInt8 handle = 0; (gpNvm_SnapshotsOpen != 0) && (handle < GPNVM_MAX_SNAPSHOTS); handle++)
+	{
+		pSnapshot = &gpNvm_Snapshots[handle];
+
+		if((pSnapshot->used == 0) || (pSnapshot->full != 0) || ((pSnapshot->saved[attrId/8] & (1 << (attrId%8))) != 0))
+		{
+			continue;
+		}
+		pSnapshot->saved[attrId/8] |= (UInt8)(1 << (attrId%8));
+		result = gpNvm_GetIndexEntry(attrId, &attributeOffset);
+
+		if((result == GPNVM_OK) && (attributeOffset == 0xFFFF))
+		{
+			pSnapshot->absent[attrId/8] |= (UInt8)(1 << (attrId%8));
+			continue;
+		}
+		if(result == GPNVM_OK)
+		{
+			result = gpNvm_ReadAttribute(attrId, &length, value);
+		}
+
+		if((result == GPNVM_OK) && (pSnapshot->end + 2 + length > GPNVM_SNAPSHOT_ARENA_SIZE))
+		{
+			//Only a compressed or shared value can take more room saved than stored (see GPNVM_SNAPSHOT_ARENA_SIZE)
+			printf("[gpNvm][%s] Snapshot %u is full, it is lost! Continue.\n",__FUNCTION__,handle);
+			pSnapshot->full = 1;
+		}
+		else if(result == GPNVM_OK)
+		{
+			//Record [attrId][length][value]
+			pSnapshot->values[pSnapshot->end] = attrId;
+			pSnapshot->values[pSnapshot->end + 1] = length;
+			memcpy(&pSnapshot->values[pSnapshot->end + 2], value, length);
+			pSnapshot->end += length + 2;
+		}
+		else
+		{
+			//Unreadable value, the snapshot will read the attribute as it is in memory
+			pSnapshot->saved[attrId/8] &= (UInt8)~(1 << (attrId%8));
+		}
+	}
+#else
+	(void)attrId;
+#endif
+}
+
+#if GPNVM_MULTI_PROCESS
+/*
+ * Name: gpNvm_SharedLock
+ *
+ * Description: Take the lock shared by the processes. If its owner died while holding it, the file may hold a
+ * partial update: the lock is made consistent again and all the sector generations are incremented, so that every
+ * process reloads the whole file.
+ *
+ * Parameters: None
+ *
+ * Return value: None
+ */
+static void gpNvm_SharedLock(void)
+{
+	if(pthread_mutex_lock(&gpNvm_Shared->mutex) == EOWNERDEAD)
+	{
+		printf("[gpNvm][%s] A process died holding the lock, reloading the file.\n",__FUNCTION__);
+		pthread_mutex_consistent(&gpNvm_Shared->mutex);
+
+		for(UInt32 sector = 0; sector < GPNVM_IMAGE_SECTORS; sector++)
+		{
+			gpNvm_Shared->sectorGenerations[sector]++;
+		}
+		__atomic_add_fetch(&gpNvm_Shared->generation, 1, __ATOMIC_RELEASE);
+	}
+}
+
+/*
+ * Name: gpNvm_MapShared
+ *
+ * Description: Map the state shared by the processes using the file, named after the device and inode of the open
+ * file so that the processes using other files do not share it. The first process creates it and initializes its
+ * robust process-shared mutex, the others wait until it is initialized. A state too small or written by a build with
+ * another layout or image size is rejected.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the shared state is mapped successfully
+ *                             GPNVM_ERROR_OPENING_FILE: the shared memory object cannot be created, mapped or is not
+ *                                                       initialized, or it was created by another build
+ */
+static gpNvm_Result gpNvm_MapShared(void)
+{
+	pthread_mutexattr_t attributes;
+	struct stat status;
+	UInt8 creator = 1;
+	UInt16 retries = 0;
+	int fd = -1;
+
+	if(fstat(gpNvm_FileDescriptor, &status) == 0)
+	{
+		snprintf(gpNvm_SharedName, sizeof(gpNvm_SharedName), "%s.%lx.%lx", GPNVM_SHM_NAME, (unsigned long)status.st_dev,
+		         (unsigned long)status.st_ino);
+		fd = shm_open(gpNvm_SharedName, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+		if((fd < 0) && (errno == EEXIST))
+		{
+			creator = 0;
+			fd = shm_open(gpNvm_SharedName, O_RDWR, 0600);
+		}
+	}
+
+	if((fd >= 0) && (creator != 0) && (ftruncate(fd, sizeof(gpNvm_SharedState)) != 0))
+	{
+		close(fd);
+		fd = -1;
+	}
+	//Wait until the creator has sized the object, mapping it before would fault
+	while((fd >= 0) && ((fstat(fd, &status) != 0) || (status.st_size < (off_t)sizeof(gpNvm_SharedState))) && (retries++ < GPNVM_SHARED_WAIT_MS))
+	{
+		usleep(1000);
+	}
+
+	if((fd >= 0) && ((fstat(fd, &status) != 0) || (status.st_size < (off_t)sizeof(gpNvm_SharedState))))
+	{
+		printf("[gpNvm][%s] Shared memory %s is too small! Abort.\n",__FUNCTION__,gpNvm_SharedName);
+		close(fd);
+		return GPNVM_ERROR_OPENING_FILE;
+	}
+
+	if(fd >= 0)
+	{
+		gpNvm_Shared = mmap(NULL, sizeof(gpNvm_SharedState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+	}
+
+	if((fd < 0) || (gpNvm_Shared == MAP_FAILED))
+	{
+		printf("[gpNvm][%s] Cannot map shared memory %s! Abort.\n",__FUNCTION__,gpNvm_SharedName);
+		gpNvm_Shared = NULL;
+		return GPNVM_ERROR_OPENING_FILE;
+	}
+
+	if(creator != 0)
+	{
+		//Robust: a process dying with the lock does not block the others, see gpNvm_SharedLock
+		pthread_mutexattr_init(&attributes);
+		pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+		pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+		pthread_mutex_init(&gpNvm_Shared->mutex, &attributes);
+		pthread_mutexattr_destroy(&attributes);
+		gpNvm_Shared->version = GPNVM_SHARED_VERSION;
+		gpNvm_Shared->sectors = GPNVM_IMAGE_SECTORS;
+		__atomic_store_n(&gpNvm_Shared->magic, GPNVM_SHARED_MAGIC, __ATOMIC_RELEASE);
+	}
+
+	for(retries = 0; (__atomic_load_n(&gpNvm_Shared->magic, __ATOMIC_ACQUIRE) != GPNVM_SHARED_MAGIC) && (retries < GPNVM_SHARED_WAIT_MS); retries++)
+	{
+		usleep(1000);
+	}
+
+	if((gpNvm_Shared->magic != GPNVM_SHARED_MAGIC) || (gpNvm_Shared->version != GPNVM_SHARED_VERSION) ||
+	   (gpNvm_Shared->sectors != GPNVM_IMAGE_SECTORS))
+	{
+		printf("[gpNvm][%s] Shared memory %s is not initialized or was created by another build! Abort.\n",__FUNCTION__,gpNvm_SharedName);
+		munmap(gpNvm_Shared, sizeof(gpNvm_SharedState));
+		gpNvm_Shared = NULL;
+		return GPNVM_ERROR_OPENING_FILE;
+	}
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_AttachShared
+ *
+ * Description: Map the shared state with gpNvm_MapShared, take the shared lock and count this process in its users.
+ * If the last process removed the object after it was opened, it is mapped again, a new one being created.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the shared state is attached, the shared lock is held
+ *                             GPNVM_ERROR_OPENING_FILE: the shared state cannot be mapped
+ */
+static gpNvm_Result gpNvm_AttachShared(void)
+{
+	for(UInt8 attempt = 0; attempt < GPNVM_SHARED_ATTACH_RETRIES; attempt++)
+	{
+		if(gpNvm_MapShared() != GPNVM_OK)
+		{
+			return GPNVM_ERROR_OPENING_FILE;
+		}
+		gpNvm_SharedLock();
+
+		if(gpNvm_Shared->removed == 0)
+		{
+			gpNvm_Shared->users++;
+			gpNvm_SharedOwner = getpid();
+			return GPNVM_OK;
+		}
+		pthread_mutex_unlock(&gpNvm_Shared->mutex);
+		munmap(gpNvm_Shared, sizeof(gpNvm_SharedState));
+		gpNvm_Shared = NULL;
+	}
+	printf("[gpNvm][%s] Shared memory %s keeps being removed! Abort.\n",__FUNCTION__,gpNvm_SharedName);
+	return GPNVM_ERROR_OPENING_FILE;
+}
+
+/*
+ * Name: gpNvm_DetachShared
+ *
+ * Description: Unmap the shared state. The process that attached it leaves its users, and the last one removes the
+ * object under the shared lock. A forked child only unmaps its inherited mapping. The shared lock must not be held.
+ *
+ * Parameters: None
+ *
+ * Return value: None
+ */
+static void gpNvm_DetachShared(void)
+{
+	if(gpNvm_SharedOwner == getpid())
+	{
+		gpNvm_SharedLock();
+		gpNvm_Shared->users--;
+
+		if(gpNvm_Shared->users == 0)
+		{
+			gpNvm_Shared->removed = 1;
+			shm_unlink(gpNvm_SharedName);
+		}
+		pthread_mutex_unlock(&gpNvm_Shared->mutex);
+	}
+	gpNvm_SharedOwner = 0;
+	munmap(gpNvm_Shared, sizeof(gpNvm_SharedState));
+	gpNvm_Shared = NULL;
+}
+
+/*
+ * Name: gpNvm_SectorDiffers
+ *
+ * Description: Compare the old (cache) and new (file) bytes of a sector over the part of [offset, offset + length[
+ * that it holds.
+ *
+ * Parameters:
+ *            UInt32 sectorOffset: offset in the file of the sector
+ *            const UInt8* pOld: sector as in the cache
+ *            const UInt8* pNew: sector as in the file
+ *            UInt32 offset: offset in the file of the range to compare
+ *            UInt32 length: length of the range to compare
+ *
+ * Return value: UInt8: 1 if the range changed in this sector, 0 otherwise
+ */
+static UInt8 gpNvm_SectorDiffers(UInt32 sectorOffset, const UInt8* pOld, const UInt8* pNew, UInt32 offset, UInt32 length)
+{
+	UInt32 start = (offset > sectorOffset) ? offset : sectorOffset;
+	UInt32 end = (offset + length < sectorOffset + GPNVM_SECTOR_SIZE) ? offset + length : sectorOffset + GPNVM_SECTOR_SIZE;
+
+	return ((start < end) && (memcmp(&pOld[start - sectorOffset], &pNew[start - sectorOffset], end - start) != 0)) ? 1 : 0;
+}
+
+/*
+ * Name: gpNvm_Refresh
+ *
+ * Description: Cross-process invalidation. The sectors whose generation in the shared state differs from the one of
+ * this process were written by other processes. A first pass compares them with the cache to find the attributes
+ * they changed (index entry, CRC, flag or value), which are saved for the open snapshots while the cache still holds
+ * their old value. A second pass loads these sectors into the cache, then the changed attributes get new versions
+ * and are notified to the subscribers. Called with gpNvm_Mutex and the shared lock held.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the cache is up to date
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ */
+static gpNvm_Result gpNvm_Refresh(void)
+{
+	gpNvm_Result result;
+	UInt8 changed[GPNVM_MEMORY_INDEX_TABLE_SIZE/8];
+	UInt8 cached[GPNVM_SECTOR_SIZE];
+	UInt32 generation = gpNvm_Shared->generation;
+	UInt32 sectorOffset;
+	UInt16 offset;
+	UInt8 differs;
+
+	memset(changed, 0, sizeof(changed));
+
+	//First pass: compare the stale sectors with the cache
+	for(UInt32 sector = 0; sector < GPNVM_IMAGE_SECTORS; sector++)
+	{
+		if(gpNvm_SectorGenerations[sector] == gpNvm_Shared->sectorGenerations[sector])
+		{
+			continue;
+		}
+		sectorOffset = sector*GPNVM_SECTOR_SIZE;
+
+		if(pread(gpNvm_FileDescriptor, gpNvm_IoBuffer, GPNVM_SECTOR_SIZE, sectorOffset) != GPNVM_SECTOR_SIZE)
+		{
+			printf("[gpNvm][%s] Cannot read file %s! Abort.\n",__FUNCTION__,gpNvm_FileName);
+			return GPNVM_ERROR_READING_FILE;
+		}
+		gpNvm_CopyImage(sectorOffset, cached, GPNVM_SECTOR_SIZE, 0);
+
+		for(UInt16 attrId = 0; attrId < GPNVM_MEMORY_INDEX_TABLE_SIZE; attrId++)
+		{
+			differs = gpNvm_SectorDiffers(sectorOffset, cached, gpNvm_IoBuffer, GPNVM_INDEX_TABLE_OFFSET + sizeof(UInt16)*attrId, sizeof(UInt16));
+			differs |= gpNvm_SectorDiffers(sectorOffset, cached, gpNvm_IoBuffer, GPNVM_CRC_TABLE_OFFSET + attrId, 1);
+			offset = gpNvm_MemoryIndexTable[attrId];
+
+			//The entry may have been written by another process, it is range-checked before its length is read
+			if((offset != 0xFFFF) && (offset >= GPNVM_USER_MEMORY_SIZE))
+			{
+				differs = 1;
+			}
+			else if(offset != 0xFFFF)
+			{
+				differs |= gpNvm_SectorDiffers(sectorOffset, cached, gpNvm_IoBuffer, GPNVM_USER_MEMORY_OFFSET + offset, gpNvm_MemoryCache[offset] + 1);
+			}
+
+			if((GPNVM_FLAGS_TABLE_OFFSET + attrId/8 >= sectorOffset) && (GPNVM_FLAGS_TABLE_OFFSET + attrId/8 < sectorOffset + GPNVM_SECTOR_SIZE) &&
+			   (((cached[GPNVM_FLAGS_TABLE_OFFSET + attrId/8 - sectorOffset] ^ gpNvm_IoBuffer[GPNVM_FLAGS_TABLE_OFFSET + attrId/8 - sectorOffset]) & (1 << (attrId%8))) != 0))
+			{
+				differs = 1;
+			}
+
+			if(differs != 0)
+			{
+				changed[attrId/8] |= (UInt8)(1 << (attrId%8));
+			}
+		}
+	}
+
+	for(UInt16 attrId = 0; attrId < GPNVM_MEMORY_INDEX_TABLE_SIZE; attrId++)
+	{
+		if((changed[attrId/8] & (1 << (attrId%8))) != 0)
+		{
+			gpNvm_SnapshotPreserve((gpNvm_AttrId)attrId);
+		}
+	}
+
+	//Second pass: load the stale sectors into the cache
+	for(UInt32 sector = 0; sector < GPNVM_IMAGE_SECTORS; sector++)
+	{
+		if(gpNvm_SectorGenerations[sector] == gpNvm_Shared->sectorGenerations[sector])
+		{
+			continue;
+		}
+
+		if(gpNvm_LoadImage(sector*GPNVM_SECTOR_SIZE, (sector + 1)*GPNVM_SECTOR_SIZE) != GPNVM_OK)
+		{
+			return GPNVM_ERROR_READING_FILE;
+		}
+		gpNvm_SectorGenerations[sector] = gpNvm_Shared->sectorGenerations[sector];
+	}
+	result = gpNvm_FindUserMemoryEnd();
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+
+	for(UInt16 attrId = 0; attrId < GPNVM_MEMORY_INDEX_TABLE_SIZE; attrId++)
+	{
+		if((changed[attrId/8] & (1 << (attrId%8))) != 0)
+		{
+			gpNvm_AttributeChanged((gpNvm_AttrId)attrId);
+		}
+	}
+	gpNvm_Generation = generation;
+	return GPNVM_OK;
+}
+#endif
+
+#if GPNVM_CHANGE_FEED_SIZE > 0
+/*
+ * Name: gpNvm_FeedCopy
+ *
+ * Description: Copy bytes into or out of the ring gpNvm_Feed, wrapping around its end.
+ *
+ * Parameters:
+ *            UInt32 offset: offset in the ring, may be past its end
+ *            UInt8* pData: bytes to write, or pointer to store the bytes read
+ *            UInt32 length: number of bytes
+ *            UInt8 toFeed: 1 to write into the ring, 0 to read from it
+ *
+ * Return value: None
+ */
+static void gpNvm_FeedCopy(UInt32 offset, UInt8* pData, UInt32 length, UInt8 toFeed)
+{
+	for(UInt32 cpt = 0; cpt < length; cpt++)
+	{
+		if(toFeed != 0)
+		{
+			gpNvm_Feed[(offset + cpt) % GPNVM_CHANGE_FEED_SIZE] = pData[cpt];
+		}
+		else
+		{
+			pData[cpt] = gpNvm_Feed[(offset + cpt) % GPNVM_CHANGE_FEED_SIZE];
+		}
+	}
+}
+
+/*
+ * Name: gpNvm_FeedAppend
+ *
+ * Description: Add a change at the end of the feed with the next sequence number. The oldest changes are dropped until
+ * it fits, so a writer never waits for the consumers.
+ *
+ * Parameters:
+ *            UInt8 type: GPNVM_DELTA_SET, GPNVM_DELTA_COUNTER or GPNVM_DELTA_DELETE
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8 length: length of the new value
+ *            UInt8* pValue: new value
+ *
+ * Return value: None
+ */
+static void gpNvm_FeedAppend(UInt8 type, gpNvm_AttrId attrId, UInt8 length, UInt8* pValue)
+{
+	UInt8 header[GPNVM_FEED_ENTRY_HEADER_SIZE];
+	UInt8 dropped = 0;
+
+	while(gpNvm_FeedUsed + GPNVM_FEED_ENTRY_HEADER_SIZE + length > GPNVM_CHANGE_FEED_SIZE)
+	{
+		gpNvm_FeedCopy(gpNvm_FeedTail + GPNVM_FEED_ENTRY_HEADER_SIZE - 1, &dropped, 1, 0);
+		gpNvm_FeedTail += GPNVM_FEED_ENTRY_HEADER_SIZE + dropped;
+		gpNvm_FeedUsed -= GPNVM_FEED_ENTRY_HEADER_SIZE + dropped;
+
+		if(gpNvm_FeedTail >= GPNVM_CHANGE_FEED_SIZE)
+		{
+			gpNvm_FeedTail -= GPNVM_CHANGE_FEED_SIZE;
+			gpNvm_FeedTailWraps++;
+		}
+		gpNvm_FeedFirst++;
+	}
+	//[sequence][type][attrId][length] then the value
+	memcpy(header, &gpNvm_FeedNext, sizeof(UInt32));
+	header[sizeof(UInt32)] = type;
+	header[sizeof(UInt32) + 1] = attrId;
+	header[sizeof(UInt32) + 2] = length;
+	gpNvm_FeedCopy(gpNvm_FeedTail + gpNvm_FeedUsed, header, GPNVM_FEED_ENTRY_HEADER_SIZE, 1);
+	gpNvm_FeedCopy(gpNvm_FeedTail + gpNvm_FeedUsed + GPNVM_FEED_ENTRY_HEADER_SIZE, pValue, length, 1);
+	gpNvm_FeedUsed += GPNVM_FEED_ENTRY_HEADER_SIZE + length;
+	gpNvm_FeedNext++;
+}
+
+/*
+ * Name: gpNvm_NewFeedEpoch
+ *
+ * Description: Take the epoch of the sequence numbers of a new feed. The monotonic clock restarts at each boot, so the
+ * real time clock is used, mixed with a random value for two feeds started together or a clock set back.
+ *
+ * Parameters:
+ *            UInt32 previous: epoch of the previous feed of the process
+ *
+ * Return value: UInt32: new epoch, different from the previous one
+ */
+static UInt32 gpNvm_NewFeedEpoch(UInt32 previous)
+{
+	struct timespec now;
+	UInt32 random = 0;
+	UInt32 epoch;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	if(getrandom(&random, sizeof(random), GRND_NONBLOCK) != sizeof(random))
+	{
+		random = (UInt32)getpid();
+	}
+	epoch = (UInt32)now.tv_sec ^ (UInt32)now.tv_nsec ^ random;
+	return (epoch != previous) ? epoch : epoch + 1;
+}
+#endif
+
+/*
+ * Name: gpNvm_FeedLog
+ *
+ * Description: Add the attributes marked in gpNvm_FeedPending to the change feed, in increasing id order, with their
+ * value at the end of the API call: a delete if the attribute is no longer stored. Called by gpNvm_Unlock, with
+ * gpNvm_Mutex held, so the attributes are complete and the feed follows the order of the calls.
+ *
+ * Parameters: None
+ *
+ * Return value: None
+ */
+static void gpNvm_FeedLog(void)
+{
+#if GPNVM_CHANGE_FEED_SIZE > 0
+	UInt8 value[255];
+	UInt8 length = 0;
+	UInt16 offset = 0xFFFF;
+
+	for(UInt16 attrId = 0; (gpNvm_FeedPendingAny != 0) && (attrId < GPNVM_MEMORY_INDEX_TABLE_SIZE); attrId++)
+	{
+		if((gpNvm_FeedPending[attrId/8] & (1 << (attrId%8))) == 0)
+		{
+			continue;
+		}
+
+		if((gpNvm_GetIndexEntry(attrId, &offset) == GPNVM_OK) && (offset == 0xFFFF))
+		{
+			gpNvm_FeedAppend(GPNVM_DELTA_DELETE, (gpNvm_AttrId)attrId, 0, value);
+		}
+		else if(gpNvm_ReadAttribute(attrId, &length, value) == GPNVM_OK)
+		{
+			gpNvm_FeedAppend((gpNvm_IsCounter(attrId) != 0) ? GPNVM_DELTA_COUNTER : GPNVM_DELTA_SET, (gpNvm_AttrId)attrId, length, value);
+		}
+	}
+	memset(gpNvm_FeedPending, 0, sizeof(gpNvm_FeedPending));
+	gpNvm_FeedPendingAny = 0;
+#endif
+}
+
+/*
+ * Name: gpNvm_Lock
+ *
+ * Description: Serialize an API call on the cache. gpNvm_Mutex is taken against the other threads. In multi-process
+ * mode, a writer also takes the shared lock for the whole call and first loads the sectors written by the other
+ * processes. A reader only checks the shared generation: the cache is read without the shared lock unless another
+ * process wrote the file since the last refresh. A writer first repairs the attributes read from a copy of the file.
+ * If the refresh fails, the locks are released and the API call must return the error without using the cache: a writer
+ * would otherwise write stale sectors over the ones of the other processes. The refresh is tried again by the next call.
+ *
+ * Parameters:
+ *            UInt8 write: 1 if the call may change the cache, 0 if it only reads it
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the locks are taken and the cache is up to date
+ *                             GPNVM_ERROR_READING_FILE: the sectors written by another process could not be read, no lock is held
+ */
+static gpNvm_Result gpNvm_Lock(UInt8 write)
+{
+	pthread_mutex_lock(&gpNvm_Mutex);
+#if GPNVM_MULTI_PROCESS
+	gpNvm_Result result;
+
+	//A read-only component has no cache to refresh and shares no lock
+	if((gpNvm_Mapping == NULL) && ((write != 0) || (__atomic_load_n(&gpNvm_Shared->generation, __ATOMIC_ACQUIRE) != gpNvm_Generation)))
+	{
+		gpNvm_SharedLock();
+		result = gpNvm_Refresh();
+
+		if((write == 0) || (result != GPNVM_OK))
+		{
+			pthread_mutex_unlock(&gpNvm_Shared->mutex);
+		}
+
+		if(result != GPNVM_OK)
+		{
+			//The cache may miss the writes of the other processes, nothing is read nor written from it
+			pthread_mutex_unlock(&gpNvm_Mutex);
+			return result;
+		}
+	}
+#endif
+#if GPNVM_REPAIR
+	if((write != 0) && (gpNvm_RepairPendingAny != 0))
+	{
+		gpNvm_RepairAttributes();
+	}
+#endif
+	(void)write;
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_Unlock
+ *
+ * Description: End of an API call started with gpNvm_Lock. The attributes it changed are added to the change feed.
+ *
+ * Parameters:
+ *            UInt8 write: same value as given to gpNvm_Lock
+ *
+ * Return value: None
+ */
+static void gpNvm_Unlock(UInt8 write)
+{
+	gpNvm_FeedLog();
+#if GPNVM_MULTI_PROCESS
+	if((write != 0) && (gpNvm_Mapping == NULL))
+	{
+		pthread_mutex_unlock(&gpNvm_Shared->mutex);
+	}
+#else
+	(void)write;
+#endif
+	pthread_mutex_unlock(&gpNvm_Mutex);
+}
+
+/* ==================================================================== */
+/* ======================= Functions Definition ======================= */
+/* ==================================================================== */
+
+/*
+ * Name: gpNvm_Init
+ * 
+ * Description: Initilize non-volatile menory component. First this function
+ * will check if the component is already initilized. If not, it will open the
+ * file emulating the non-volatil memory. If the file is empty, it will initilize
+ * cache and write it into the file. If not, it will load file content into cache.
+ * 
+ * Parameters: None
+ * 
+ * Return value: gpNvm_Result: GPNVM_OK: the component is initilized successfully
+ *                             GPNVM_ERROR_ALREADY_INITIALIZED: the component is already initilized
+ *                             GPNVM_ERROR_OPENING_FILE: the is a problem when opening the file emulating the non-volatile memory
+ *                             GPNVM_ERROR_WRITING_FILE: the new or upgraded file could not be written or synced
+ *                             GPNVM_ERROR_READING_FILE: the header of the file is not the one of this build: foreign, corrupted,
+ *                                                       truncated or newer file, other byte order or geometry. Also an older
+ *                                                       format version or an incomplete image when read-only
+ */
+gpNvm_Result gpNvm_Init(void)
+{
+	gpNvm_Result result = GPNVM_OK;
+	off_t fileSize = 0;
+	UInt16 version = GPNVM_FORMAT_VERSION;
+	gpNvm_Journal journal;
+
+	//Check if the component is already initialized
+	if(gpNvm_FileDescriptor >= 0)
+	{
+		printf("[gpNvm][%s] Component already initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_ALREADY_INITIALIZED;
+	}
+
+	gpNvm_SetHeader();
+
+	if((gpNvm_StorageOptions & GPNVM_STORAGE_READ_ONLY) != 0)
+	{
+		//Readers map the file, nothing is loaded nor locked
+		return gpNvm_MapFile();
+	}
+	//Open the non-volatile memory file, it is created if it does not exist
+	gpNvm_FileDescriptor = gpNvm_OpenFile(gpNvm_FileName);
+
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Cannot oppen file %s! Abort.\n",__FUNCTION__,gpNvm_FileName);
+		return GPNVM_ERROR_OPENING_FILE;
+	}
+	gpNvm_CheckBlockSize();
+#if GPNVM_MULTI_PROCESS
+	//Map the state shared with the other processes, the file is created or loaded under the shared lock
+	if(gpNvm_AttachShared() != GPNVM_OK)
+	{
+		close(gpNvm_FileDescriptor);
+		gpNvm_FileDescriptor = -1;
+		return GPNVM_ERROR_OPENING_FILE;
+	}
+#endif
+	//Check if the non-volatile memory file is empty
+	fileSize = lseek(gpNvm_FileDescriptor, 0, SEEK_END);
+
+	//An interrupted migration is resumed, otherwise the header is checked before anything is written into the file
+	result = gpNvm_ReadJournal(fileSize, &journal);
+
+	if((result == GPNVM_OK) && (journal.magic != GPNVM_JOURNAL_MAGIC) && (fileSize > 0))
+	{
+		result = gpNvm_ReadHeader(fileSize, &version);
+	}
+
+	if((result == GPNVM_OK) && (version == GPNVM_FORMAT_VERSION) && (fileSize < (off_t)GPNVM_IMAGE_SIZE))
+	{
+		//Reserve the whole image, so that writes never extend the file. An older image is only extended by its journaled migration
+		gpNvm_PreallocateFile();
+	}
+#if GPNVM_MIRROR_COPIES > 0
+	//The copies are written with the file from now on
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_OpenCopies();
+	}
+#endif
+	memset(gpNvm_DirtySectors, 0, sizeof(gpNvm_DirtySectors));
+	memset(&gpNvm_CacheStatistics, 0, sizeof(gpNvm_CacheStatistics));
+#if GPNVM_REPAIR
+	memset(gpNvm_RepairPending, 0, sizeof(gpNvm_RepairPending));
+	gpNvm_RepairPendingAny = 0;
+#endif
+#if GPNVM_VERSION_TOKENS
+	memset(gpNvm_AttributeVersions, 0, sizeof(gpNvm_AttributeVersions));
+#endif
+	gpNvm_StoreVersion = 0;
+#if GPNVM_MAX_SUBSCRIBERS > 0
+	memset(gpNvm_ChangedAttributes, 0, sizeof(gpNvm_ChangedAttributes));
+	gpNvm_ChangesPending = 0;
+#endif
+#if GPNVM_MAX_SNAPSHOTS > 0
+	memset(gpNvm_Snapshots, 0, sizeof(gpNvm_Snapshots));
+	gpNvm_SnapshotsOpen = 0;
+#endif
+#if GPNVM_CHANGE_FEED_SIZE > 0
+	//A new epoch, so the cursors of a previous run get a gap
+	gpNvm_FeedEpoch = gpNvm_NewFeedEpoch(gpNvm_FeedEpoch);
+	gpNvm_FeedTail = 0;
+	gpNvm_FeedUsed = 0;
+	gpNvm_FeedTailWraps = 0;
+	gpNvm_FeedFirst = 0;
+	gpNvm_FeedNext = 0;
+	memset(gpNvm_FeedPending, 0, sizeof(gpNvm_FeedPending));
+	gpNvm_FeedPendingAny = 0;
+#endif
+	gpNvm_UserMemoryEnd = 0;
+#if GPNVM_RAM_MINIMAL > 1
+	memset(gpNvm_AttributesPresent, 0, sizeof(gpNvm_AttributesPresent));
+#endif
+
+	if((result == GPNVM_OK) && (fileSize == 0))
+	{
+		/* Initialize non-volatile memory file and the cache */
+		//Set Memory index table section to 0xFF in cache
+#if GPNVM_RAM_MINIMAL < 2
+		memset(gpNvm_MemoryIndexTable,0xFF,sizeof(UInt16)*GPNVM_MEMORY_INDEX_TABLE_SIZE);
+#endif
+		//Set attributes CRC table section to 0xFF in cache
+#if GPNVM_RAM_MINIMAL == 0
+		memset(gpNvm_AttributesCrcTable,0xFF,GPNVM_ATTRIBUTES_CRCS_SIZE);
+#endif
+		//Set attributes flags section to 0xFF (no counter) in cache
+		memset(gpNvm_AttributesFlags,0xFF,GPNVM_ATTRIBUTES_FLAGS_SIZE);
+#if (GPNVM_ECC_INTERLEAVE > 0) && (GPNVM_RAM_MINIMAL == 0)
+		memset(gpNvm_AttributesEccTable,0xFF,GPNVM_ECC_TABLE_SIZE);
+#endif
+		//Set user attributes data section to 0xFF in cache
+#if GPNVM_CACHE_RAM_BUDGET > 0
+		gpNvm_CacheReset();
+#elif GPNVM_RAM_MINIMAL == 0
+		memset(gpNvm_MemoryCache,0xFF,GPNVM_USER_MEMORY_SIZE);
+#endif
+		//Write the fresh image and make it durable before reporting success
+		gpNvm_MarkDirty(0, GPNVM_IMAGE_SIZE);
+		result = gpNvm_WriteCache();
+
+		if(result == GPNVM_OK)
+		{
+			result = gpNvm_SyncFile();
+		}
+	}
+	else if(result == GPNVM_OK)
+	{
+		/* Load non-volatile memory file data into cache */
+#if GPNVM_CACHE_RAM_BUDGET > 0
+		gpNvm_CacheReset();
+#endif
+		if((journal.magic == GPNVM_JOURNAL_MAGIC) || (version < GPNVM_FORMAT_VERSION))
+		{
+			result = gpNvm_UpgradeImage(&journal, version, fileSize);
+		}
+
+		if(result == GPNVM_OK)
+		{
+			result = gpNvm_LoadCache();
+		}
+
+		if(result == GPNVM_OK)
+		{
+			result = gpNvm_FindUserMemoryEnd();
+		}
+#if GPNVM_DEDUP > 0
+		if((result == GPNVM_OK) && (gpNvm_ImageHeader.encoding != GPNVM_VALUE_ENCODING))
+		{
+			//Written without GPNVM_DEDUP: values may be shared from now on, a build without it must not update them in place
+			printf("[gpNvm][%s] File %s is opened with shared values! Continue.\n",__FUNCTION__,gpNvm_FileName);
+			gpNvm_SetHeader();
+			gpNvm_MarkDirty(0, sizeof(gpNvm_Header));
+			result = gpNvm_WriteCache();
+
+			if(result == GPNVM_OK)
+			{
+				result = gpNvm_SyncFile();
+			}
+		}
+#endif
+#if GPNVM_ECC_INTERLEAVE > 0
+		if((result == GPNVM_OK) && ((journal.magic == GPNVM_JOURNAL_MAGIC) || (version < GPNVM_FORMAT_VERSION)))
+		{
+			//The upgrade left the ECC table erased
+			result = gpNvm_EccRebuild();
+
+			if(result == GPNVM_OK)
+			{
+				result = gpNvm_WriteCache();
+			}
+
+			if(result == GPNVM_OK)
+			{
+				result = gpNvm_SyncFile();
+			}
+		}
+#endif
+	}
+#if GPNVM_MIRROR_COPIES > 0
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_CheckCopies();
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_CheckAttributes();
+	}
+#endif
+
+#if GPNVM_MULTI_PROCESS
+	//The cache now holds the file as last written by any process
+	memcpy(gpNvm_SectorGenerations, gpNvm_Shared->sectorGenerations, sizeof(gpNvm_SectorGenerations));
+	gpNvm_Generation = gpNvm_Shared->generation;
+	pthread_mutex_unlock(&gpNvm_Shared->mutex);
+
+	if(result != GPNVM_OK)
+	{
+		gpNvm_DetachShared();
+	}
+#endif
+
+	if(result != GPNVM_OK)
+	{
+#if GPNVM_MIRROR_COPIES > 0
+		gpNvm_CloseCopies();
+#endif
+		close(gpNvm_FileDescriptor);
+		gpNvm_FileDescriptor = -1;
+		return result;
+	}
+	gpNvm_SyncPending = 0;
+	gpNvm_LastSyncTimeMs = gpNvm_GetTimeMs();
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_Uninit
+ * 
+ * Description: Uninitilize non-volatile menory component. First this function
+ * will check if the component is already initilized. Then it will write cache into
+ * the file emulating non-volatile memory.
+ * 
+ * Parameters: None
+ * 
+ * Return value: gpNvm_Result: GPNVM_OK: the component is uninitilized successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initilized
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced
+ */
+gpNvm_Result gpNvm_Uninit(void)
+{
+	gpNvm_Result result = GPNVM_OK;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(gpNvm_Mapping != NULL)
+	{
+		//Nothing to write
+		pthread_mutex_lock(&gpNvm_Mutex);
+		munmap((void*)gpNvm_Mapping, GPNVM_IMAGE_SIZE);
+		gpNvm_Mapping = NULL;
+		close(gpNvm_FileDescriptor);
+		gpNvm_FileDescriptor = -1;
+		pthread_mutex_unlock(&gpNvm_Mutex);
+		return GPNVM_OK;
+	}
+	/* Write cache into non-volatile memory file, this is always a durability point */
+	gpNvm_StopSyncThread();
+	result = gpNvm_Lock(1);
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_WriteCache();
+
+		if(result == GPNVM_OK)
+		{
+			result = gpNvm_SyncFile();
+		}
+		gpNvm_Unlock(1);
+	}
+#if GPNVM_MULTI_PROCESS
+	//The shared memory object is kept while other processes use the file
+	gpNvm_DetachShared();
+#endif
+	//Close the non-volatile memory file and its copies
+#if GPNVM_MIRROR_COPIES > 0
+	gpNvm_CloseCopies();
+#endif
+	close(gpNvm_FileDescriptor);
+	gpNvm_FileDescriptor = -1;
+	return result;
+}
+
+/*
+ * Name: gpNvm_GetAttribute
+ * 
+ * Description: Get attribute data from non-volatile memory.
+ * This function check if the component is already initialized, if the provided argument sare valid, if the attribute
+ * id is already stored in the non-volatile memory then check if the attribute data is corrupted or not by comparing 
+ * its stored crc by the calculated one. If data is sane, it will copy it into provided args.
+ * 
+ * Parameters: 
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8* pLength: pointer to a variable that will store the length of attribute data
+ *            UInt8* pValue: pointer to store attribute data
+ * 
+ * Return value: gpNvm_Result: GPNVM_OK: attribute data is read successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initilized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: pointers provided as arguments to the function are not valid
+ *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the provided attribute is not in non-volatile memory
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: attribute data are corrupted
+ *                             GPNVM_ERROR_READING_FILE: attribute data could not be read from the file (bounded cache)
+ */
+gpNvm_Result gpNvm_GetAttribute(gpNvm_AttrId attrId, UInt8* pLength, UInt8* pValue)
+{
+	gpNvm_Result result = GPNVM_OK;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+	//Validate input pointers
+	if((pLength == NULL) || (pValue == NULL))
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	result = gpNvm_Lock(0);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	result = gpNvm_ReadAttribute(attrId, pLength, pValue);
+
+	//A writer may be updating the mapped attribute, read it again before reporting it corrupted
+	for(UInt8 retry = 0; (gpNvm_Mapping != NULL) && (result == GPNVM_ERROR_CORRUPTED_ATTRIBUTE) && (retry < GPNVM_READ_ONLY_RETRIES); retry++)
+	{
+		usleep(100);
+		result = gpNvm_ReadAttribute(attrId, pLength, pValue);
+	}
+	gpNvm_Unlock(0);
+	return result;
+}
+
+/*
+ * Name: gpNvm_LinkAttribute
+ *
+ * Description: Make a value stored in the user area the one of an attribute: its CRC, ECC entry and compression flag
+ * are set, then its index entry which makes it visible.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt16 offset: offset of the value in user non-volatile memory
+ *            UInt8 length: length of attribute data, as stored
+ *            const UInt8* pValue: pointer to attribute data, as stored
+ *            UInt8 crc: CRC stored for the attribute
+ *            UInt8 compressed: 1 if the value is stored compressed (see gpNvm_Compress)
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the cache is updated successfully
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written
+ */
+static gpNvm_Result gpNvm_LinkAttribute(gpNvm_AttrId attrId, UInt16 offset, UInt8 length, const UInt8* pValue, UInt8 crc, UInt8 compressed)
+{
+	gpNvm_Result result;
+
+	gpNvm_AttributeChanged(attrId);
+	result = gpNvm_SetCrc(attrId, crc);
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_SetEcc(attrId, length, pValue);
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_SetCompressed(attrId, compressed);
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_SetIndexEntry(attrId, offset);
+	}
+	return result;
+}
+
+/*
+ * Name: gpNvm_AppendAttribute
+ *
+ * Description: Add a new attribute after the last stored one: its length and value are written in the user area,
+ * then its CRC, ECC entry and compression flag, then its index entry which makes it visible.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8 length: length of attribute data, as stored
+ *            const UInt8* pValue: pointer to attribute data, as stored
+ *            UInt8 crc: CRC stored for the attribute
+ *            UInt8 compressed: 1 if the value is stored compressed (see gpNvm_Compress)
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the cache is updated successfully
+ *                             GPNVM_ERROR_MEMORY_FULL: Memory is full
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written
+ */
+static gpNvm_Result gpNvm_AppendAttribute(gpNvm_AttrId attrId, UInt8 length, const UInt8* pValue, UInt8 crc, UInt8 compressed)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt16 attributeOffset = gpNvm_UserMemoryEnd;
+
+	//Check if we have spare place in non-volatile memory
+	if((UInt32)(attributeOffset + length + 1) > GPNVM_USER_MEMORY_SIZE)
+	{
+		printf("[gpNvm][%s] Memory full! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_MEMORY_FULL;
+	}
+	gpNvm_SnapshotPreserve(attrId);
+	//Update non-volatile memory cache
+	result = gpNvm_WriteUserMemory(attributeOffset,&length,1);
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_WriteUserMemory(attributeOffset + 1,pValue,length);
+	}
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	gpNvm_UserMemoryEnd = attributeOffset + length + 1;
+	return gpNvm_LinkAttribute(attrId, attributeOffset, length, pValue, crc, compressed);
+}
+
+/*
+ * Name: gpNvm_ReadLength
+ *
+ * Description: Read the length of the value of a stored attribute, and the length it takes in the user area. They
+ * differ for a value stored compressed, which starts with its length (see gpNvm_Compress).
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt16 offset: offset of the attribute in user non-volatile memory
+ *            UInt8* pStoredLength: pointer to store the length of the value as stored, NULL if not needed
+ *            UInt8* pLength: pointer to store the length of the value
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the lengths are read successfully
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ */
+static gpNvm_Result gpNvm_ReadLength(gpNvm_AttrId attrId, UInt16 offset, UInt8* pStoredLength, UInt8* pLength)
+{
+	UInt8 storedLength = 0;
+	gpNvm_Result result = gpNvm_ReadUserMemory(offset, &storedLength, 1);
+
+	*pLength = storedLength;
+#if GPNVM_COMPRESSION > 0
+	if((result == GPNVM_OK) && (storedLength > 0) && (gpNvm_GetType(attrId) == GPNVM_TYPE_COMPRESSED))
+	{
+		result = gpNvm_ReadUserMemory(offset + 1, pLength, 1);
+	}
+#else
+	(void)attrId;
+#endif
+	if(pStoredLength != NULL)
+	{
+		*pStoredLength = storedLength;
+	}
+	return result;
+}
+
+#if GPNVM_DEDUP > 0
+/*
+ * Name: gpNvm_CountReferences
+ *
+ * Description: Count the other attributes whose index entry points at a stored value. The reference count of a shared
+ * value is kept by the index table itself, so it cannot disagree with it after a crash.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute not to count
+ *            UInt16 offset: offset of the value in user non-volatile memory
+ *            UInt16* pCount: pointer to store the number of other attributes sharing the value
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the attributes are counted successfully
+ *                             GPNVM_ERROR_READING_FILE: an index entry could not be read from the file
+ */
+static gpNvm_Result gpNvm_CountReferences(gpNvm_AttrId attrId, UInt16 offset, UInt16* pCount)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt16 entry;
+
+	*pCount = 0;
+
+	for(UInt16 cpt = 0; (result == GPNVM_OK) && (cpt < GPNVM_MEMORY_INDEX_TABLE_SIZE); cpt++)
+	{
+		result = gpNvm_GetIndexEntry((gpNvm_AttrId)cpt, &entry);
+
+		if((result == GPNVM_OK) && (cpt != attrId) && (entry == offset))
+		{
+			(*pCount)++;
+		}
+	}
+	return result;
+}
+
+/*
+ * Name: gpNvm_FindDuplicate
+ *
+ * Description: Find a value stored for another attribute identical to a new one, for the attribute to share it. The CRC
+ * table is the content hash: only the attributes with the type and the CRC of the new value are compared, byte by byte
+ * in their stored form. Counters are never shared since they are updated in place.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute being set
+ *            UInt8 type: GPNVM_TYPE_PLAIN or GPNVM_TYPE_COMPRESSED, how the new value is stored
+ *            UInt8 crc: CRC of the new value
+ *            UInt8 length: length of the new value, as stored
+ *            const UInt8* pValue: pointer to the new value, as stored
+ *            UInt16* pOffset: pointer to store the offset of the identical value, 0xFFFF if there is none
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the stored values are searched successfully
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ */
+static gpNvm_Result gpNvm_FindDuplicate(gpNvm_AttrId attrId, UInt8 type, UInt8 crc, UInt8 length, const UInt8* pValue, UInt16* pOffset)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt8 record[1 + 255];
+	UInt16 offset;
+	UInt8 attributeCrc = 0;
+
+	*pOffset = 0xFFFF;
+
+	for(UInt16 cpt = 0; (result == GPNVM_OK) && (*pOffset == 0xFFFF) && (cpt < GPNVM_MEMORY_INDEX_TABLE_SIZE); cpt++)
+	{
+		result = gpNvm_GetIndexEntry((gpNvm_AttrId)cpt, &offset);
+
+		if((result != GPNVM_OK) || (offset == 0xFFFF) || (cpt == attrId) || (gpNvm_GetType((gpNvm_AttrId)cpt) != type))
+		{
+			continue;
+		}
+		result = gpNvm_GetCrc((gpNvm_AttrId)cpt, &attributeCrc);
+
+		if((result != GPNVM_OK) || (attributeCrc != crc))
+		{
+			continue;
+		}
+		result = gpNvm_ReadUserMemory(offset, record, 1);
+
+		if((result == GPNVM_OK) && (record[0] == length))
+		{
+			result = gpNvm_ReadUserMemory(offset + 1, &record[1], length);
+
+			if((result == GPNVM_OK) && (memcmp(&record[1], pValue, length) == 0))
+			{
+				*pOffset = offset;
+			}
+		}
+	}
+	return result;
+}
+#endif
+
+/*
+ * Name: gpNvm_StoreAttribute
+ *
+ * Description: Update the cache with an attribute, without writing it into the file. An attribute already stored
+ * gets its new value and CRC, a new attribute is added after the last stored one. Shared by gpNvm_SetAttribute,
+ * which commits each attribute, and the bulk load, which commits once for all of them.
+ * With GPNVM_COMPRESSION the value is stored compressed when it is shorter so. The CRC covers the value, not its
+ * compressed form. A stored value is updated in place if its new form is not longer, the bytes left become a hole,
+ * otherwise the attribute is added again after the last stored one.
+ * With GPNVM_DEDUP, a value already stored for another attribute is shared instead of written again, and a shared
+ * value is never updated in place: the attribute changing it is added again, the other ones keep it.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8 length: length of attribute data
+ *            const UInt8* pValue: pointer to attribute data
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the cache is updated successfully
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the attribute is stored with another length, or is a counter
+ *                             GPNVM_ERROR_MEMORY_FULL: Memory is full
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written
+ */
+static gpNvm_Result gpNvm_StoreAttribute(gpNvm_AttrId attrId, UInt8 length, const UInt8* pValue)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt16 attributeOffset = 0;
+	UInt8 attributeLength = 0;
+	UInt8 attributeStoredLength = 0;
+	UInt8 attributeValue[255];
+	const UInt8* pStored = pValue;
+	UInt8 storedLength = length;
+	UInt8 type = GPNVM_TYPE_PLAIN;
+	UInt8 crc = gpNvm_CalculateChecksum((UInt8*)pValue,length);
+	UInt16 references = 0;
+#if GPNVM_COMPRESSION > 0
+	UInt8 packed[255];
+#endif
+#if GPNVM_DEDUP > 0
+	UInt16 sharedOffset = 0xFFFF;
+#endif
+
+	if(gpNvm_IsCounter(attrId) != 0)
+	{
+		printf("[gpNvm][%s] Attribute %d is a counter, use gpNvm_CounterIncrement! Abort.\n",__FUNCTION__,attrId);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+#if GPNVM_COMPRESSION > 0
+	storedLength = gpNvm_Compress(length, pValue, packed);
+
+	if(storedLength != 0)
+	{
+		pStored = packed;
+		type = GPNVM_TYPE_COMPRESSED;
+	}
+	else
+	{
+		storedLength = length;
+	}
+#endif
+	//Check if attribute is in non-volatile memory
+	result = gpNvm_GetIndexEntry(attrId, &attributeOffset);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+
+	if(attributeOffset != 0xFFFF)
+	{
+		//Attribute is in non-volatile memory, compare old and new values
+		result = gpNvm_ReadLength(attrId, attributeOffset, &attributeStoredLength, &attributeLength);
+
+		if(result != GPNVM_OK)
+		{
+			return result;
+		}
+
+		if(length != attributeLength)
+		{
+			printf("[gpNvm][%s] Invalid attribute length (%d != %d)! Abort.\n",__FUNCTION__,length,attributeLength);
+			return GPNVM_ERROR_INVALID_PARAMETERS;
+		}
+
+		if((storedLength == attributeStoredLength) && (type == gpNvm_GetType(attrId)))
+		{
+			result = gpNvm_ReadUserMemory(attributeOffset + 1, attributeValue, storedLength);
+
+			if((result != GPNVM_OK) || (memcmp(pStored,attributeValue,storedLength) == 0))
+			{
+				//New attribute value is identical to the stored one, do no thing
+				return result;
+			}
+		}
+	}
+#if GPNVM_DEDUP > 0
+	//Share the value if another attribute stores it, otherwise check if the old value is shared before overwriting it
+	result = gpNvm_FindDuplicate(attrId, type, crc, storedLength, pStored, &sharedOffset);
+
+	if((result == GPNVM_OK) && (sharedOffset != 0xFFFF))
+	{
+		gpNvm_SnapshotPreserve(attrId);
+		return gpNvm_LinkAttribute(attrId, sharedOffset, storedLength, pStored, crc, (type == GPNVM_TYPE_COMPRESSED) ? 1 : 0);
+	}
+
+	if((result == GPNVM_OK) && (attributeOffset != 0xFFFF))
+	{
+		result = gpNvm_CountReferences(attrId, attributeOffset, &references);
+	}
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+#endif
+
+	if((attributeOffset != 0xFFFF) && (storedLength <= attributeStoredLength) && (references == 0))
+	{
+		//Update attribute value, after saving the old one for the open snapshots
+		gpNvm_SnapshotPreserve(attrId);
+		result = gpNvm_WriteUserMemory(attributeOffset,&storedLength,1);
+
+		if(result == GPNVM_OK)
+		{
+			result = gpNvm_WriteUserMemory(attributeOffset + 1,pStored,storedLength);
+		}
+
+		if(result != GPNVM_OK)
+		{
+			return result;
+		}
+		gpNvm_AttributeChanged(attrId);
+		//Calculate new CRC and update gpNvm_AttributesCrcTable, then the ECC entry and the compression flag
+		result = gpNvm_SetCrc(attrId, crc);
+
+		if(result == GPNVM_OK)
+		{
+			result = gpNvm_SetEcc(attrId, storedLength, pStored);
+		}
+
+		if(result == GPNVM_OK)
+		{
+			result = gpNvm_SetCompressed(attrId, (type == GPNVM_TYPE_COMPRESSED) ? 1 : 0);
+		}
+		return result;
+	}
+	//New attribute, or a value which does not fit or is shared where it is stored: it is added after the last attribute
+	return gpNvm_AppendAttribute(attrId, storedLength, pStored, crc, (type == GPNVM_TYPE_COMPRESSED) ? 1 : 0);
+}
+
+/*
+ * Name: gpNvm_SetAttribute
+ *
+ * Description: Set attribute data to non-volatile memory.
+ * This function checks if the component is already initialized and if the provided arguments are valid. Then it
+ * calculates its crc and offset in the user non-volatile memory, update cache then write the cache into the file in case
+ * the attributes is already stored. If not, it checks if there is still place to store a new attribute there. Then it
+ * calculates its crc and offset in the user non-volatile memory, update cache then write the cache into the file.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8 pLength: length of attribute data
+ *            UInt8* pValue: pointer to attribute data
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: attribute data is written successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initilized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: pointers provided as arguments to the function are not valid
+ *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the provided attribute is not in non-volatile memory
+ *                             GPNVM_ERROR_MEMORY_FULL: Memory is full
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced, or the component is read-only
+ */
+gpNvm_Result gpNvm_SetAttribute(gpNvm_AttrId attrId, UInt8 length, UInt8* pValue)
+{
+	gpNvm_Result result = GPNVM_OK;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(gpNvm_Mapping != NULL)
+	{
+		printf("[gpNvm][%s] Component opened read-only! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+	//Validate input pointer
+	if(pValue == NULL)
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	result = gpNvm_Lock(1);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	result = gpNvm_StoreAttribute(attrId, length, pValue);
+
+	if(result == GPNVM_OK)
+	{
+		/* Write cache into non-volatile memory file and apply the sync policy */
+		result = gpNvm_CommitCache();
+	}
+	gpNvm_Unlock(1);
+	gpNvm_NotifyChanges();
+	return result;
+}
+
+/*
+ * Name: gpNvm_CompareAndSetAttribute
+ *
+ * Description: Set an attribute only if it still holds an expected value, as one atomic step against the other
+ * threads using the component. The stored value is read and compared under gpNvm_Mutex, then the new value goes
+ * through gpNvm_StoreAttribute, so a new value identical to the stored one is not written.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8 expectedLength: length of the expected value
+ *            const UInt8* pExpected: expected value, NULL to expect the attribute not to be stored yet
+ *            UInt8 newLength: length of the new value
+ *            UInt8* pNewValue: pointer to the new value
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the attribute held the expected value and the new one is written successfully
+ *                             GPNVM_ERROR_COMPARE_FAILED: the attribute does not hold the expected value, nothing is written
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: invalid pointers, or a new length different from the stored one
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: the stored value is corrupted
+ *                             GPNVM_ERROR_MEMORY_FULL: Memory is full
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced, or the component is read-only
+ */
+gpNvm_Result gpNvm_CompareAndSetAttribute(gpNvm_AttrId attrId, UInt8 expectedLength, const UInt8* pExpected, UInt8 newLength, UInt8* pNewValue)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt16 attributeOffset = 0;
+	UInt8 attributeLength = 0;
+	UInt8 attributeValue[255];
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(gpNvm_Mapping != NULL)
+	{
+		printf("[gpNvm][%s] Component opened read-only! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+	//Validate input pointers
+	if((pNewValue == NULL) || ((pExpected == NULL) && (expectedLength != 0)))
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	result = gpNvm_Lock(1);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	result = gpNvm_GetIndexEntry(attrId, &attributeOffset);
+
+	if((result == GPNVM_OK) && (attributeOffset != 0xFFFF))
+	{
+		result = gpNvm_ReadAttribute(attrId, &attributeLength, attributeValue);
+
+		if((result == GPNVM_OK) && ((pExpected == NULL) || (attributeLength != expectedLength) || (memcmp(attributeValue, pExpected, expectedLength) != 0)))
+		{
+			result = GPNVM_ERROR_COMPARE_FAILED;
+		}
+	}
+	else if((result == GPNVM_OK) && (pExpected != NULL))
+	{
+		//Attribute is not stored but a value is expected
+		result = GPNVM_ERROR_COMPARE_FAILED;
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_StoreAttribute(attrId, newLength, pNewValue);
+	}
+
+	if(result == GPNVM_OK)
+	{
+		/* Write cache into non-volatile memory file and apply the sync policy */
+		result = gpNvm_CommitCache();
+	}
+	gpNvm_Unlock(1);
+	gpNvm_NotifyChanges();
+	return result;
+}
+
+#if GPNVM_VERSION_TOKENS
+/*
+ * Name: gpNvm_GetAttributeWithVersion
+ *
+ * Description: Get attribute data together with its version token, read under gpNvm_Mutex so the token
+ * matches the data. The token of an attribute not stored is also returned, to create it with
+ * gpNvm_CompareVersionAndSetAttribute.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8* pLength: pointer to a variable that will store the length of attribute data
+ *            UInt8* pValue: pointer to store attribute data
+ *            UInt32* pVersion: pointer to store the version token
+ *
+ * Return value: gpNvm_Result: same as gpNvm_GetAttribute
+ */
+gpNvm_Result gpNvm_GetAttributeWithVersion(gpNvm_AttrId attrId, UInt8* pLength, UInt8* pValue, UInt32* pVersion)
+{
+	gpNvm_Result result = GPNVM_OK;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+	//Validate input pointers
+	if((pLength == NULL) || (pValue == NULL) || (pVersion == NULL))
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	result = gpNvm_Lock(0);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	*pVersion = gpNvm_AttributeVersions[attrId];
+	result = gpNvm_ReadAttribute(attrId, pLength, pValue);
+	gpNvm_Unlock(0);
+	return result;
+}
+
+/*
+ * Name: gpNvm_CompareVersionAndSetAttribute
+ *
+ * Description: Set an attribute only if it was not changed since its version token was read. Cheaper than
+ * gpNvm_CompareAndSetAttribute as the stored value is not read to be compared.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt32 expectedVersion: version token returned by gpNvm_GetAttributeWithVersion
+ *            UInt8 newLength: length of the new value
+ *            UInt8* pNewValue: pointer to the new value
+ *            UInt32* pNewVersion: pointer to store the version token after the update, can be NULL
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the version matched and the new value is written successfully
+ *                             GPNVM_ERROR_COMPARE_FAILED: the attribute changed since the token was read, nothing is written
+ *                             other errors: same as gpNvm_SetAttribute
+ */
+gpNvm_Result gpNvm_CompareVersionAndSetAttribute(gpNvm_AttrId attrId, UInt32 expectedVersion, UInt8 newLength, UInt8* pNewValue, UInt32* pNewVersion)
+{
+	gpNvm_Result result = GPNVM_OK;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(gpNvm_Mapping != NULL)
+	{
+		printf("[gpNvm][%s] Component opened read-only! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+	//Validate input pointer
+	if(pNewValue == NULL)
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	result = gpNvm_Lock(1);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+
+	if(gpNvm_AttributeVersions[attrId] != expectedVersion)
+	{
+		result = GPNVM_ERROR_COMPARE_FAILED;
+	}
+	else
+	{
+		result = gpNvm_StoreAttribute(attrId, newLength, pNewValue);
+
+		if(result == GPNVM_OK)
+		{
+			/* Write cache into non-volatile memory file and apply the sync policy */
+			result = gpNvm_CommitCache();
+		}
+	}
+
+	if(pNewVersion != NULL)
+	{
+		*pNewVersion = gpNvm_AttributeVersions[attrId];
+	}
+	gpNvm_Unlock(1);
+	gpNvm_NotifyChanges();
+	return result;
+}
+
+/*
+ * Name: gpNvm_GetAttributeVersion
+ *
+ * Description: Get the version token of an attribute without reading its value, so a poller can detect a change
+ * by comparing 4 bytes. The token of an attribute not stored is returned as well, it changes when it is created.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt32* pVersion: pointer to store the version token
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the version is read successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ */
+gpNvm_Result gpNvm_GetAttributeVersion(gpNvm_AttrId attrId, UInt32* pVersion)
+{
+	gpNvm_Result result;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+	//Validate input pointer
+	if(pVersion == NULL)
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	result = gpNvm_Lock(0);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	*pVersion = gpNvm_AttributeVersions[attrId];
+	gpNvm_Unlock(0);
+	return GPNVM_OK;
+}
+#endif
+
+/*
+ * Name: gpNvm_GetStoreVersion
+ *
+ * Description: Get the version of the whole store, incremented each time any attribute value changes. A poller
+ * checks it first and only looks at the attribute versions (or values) when it moved.
+ *
+ * Parameters:
+ *            UInt32* pVersion: pointer to store the store version
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the version is read successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ */
+gpNvm_Result gpNvm_GetStoreVersion(UInt32* pVersion)
+{
+	gpNvm_Result result;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+	//Validate input pointer
+	if(pVersion == NULL)
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	result = gpNvm_Lock(0);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	*pVersion = gpNvm_StoreVersion;
+	gpNvm_Unlock(0);
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_CounterIncrement
+ *
+ * Description: Increment a counter attribute. A new counter is marked in gpNvm_AttributesFlags first, then added
+ * with a base of 0 and its first bit cleared. For a stored counter, the next bit of its bitmap is cleared, only this
+ * byte of the user area is updated. When the bitmap is full the counter is erased: base increased by the number of
+ * bits, bitmap set back to 0xFF with its first bit cleared, and CRC of the new base.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: counter attribute id
+ *            UInt32* pValue: pointer to store the counter value after the increment, can be NULL
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the counter is incremented successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the attribute is stored but is not a counter
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: the stored counter is corrupted
+ *                             GPNVM_ERROR_MEMORY_FULL: Memory is full
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced, or the component is read-only
+ */
+gpNvm_Result gpNvm_CounterIncrement(gpNvm_AttrId attrId, UInt32* pValue)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt16 attributeOffset = 0;
+	UInt8 attributeValue[GPNVM_COUNTER_LENGTH];
+	UInt8 attributeLength = 0;
+	UInt32 counter = 0;
+	UInt8 nextByte = 0;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(gpNvm_Mapping != NULL)
+	{
+		printf("[gpNvm][%s] Component opened read-only! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+	result = gpNvm_Lock(1);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	result = gpNvm_GetIndexEntry(attrId, &attributeOffset);
+
+	if(result == GPNVM_OK)
+	{
+		gpNvm_SnapshotPreserve(attrId);
+	}
+
+	if((result == GPNVM_OK) && (attributeOffset == 0xFFFF))
+	{
+		//New counter, check the space before marking it as a counter since flags bits are never set back
+		if((UInt32)(gpNvm_UserMemoryEnd + GPNVM_COUNTER_LENGTH + 1) > GPNVM_USER_MEMORY_SIZE)
+		{
+			printf("[gpNvm][%s] Memory full! Abort.\n",__FUNCTION__);
+			result = GPNVM_ERROR_MEMORY_FULL;
+		}
+		else
+		{
+			gpNvm_AttributesFlags[attrId/8] &= (UInt8)~(1 << (attrId%8));
+			result = gpNvm_WriteFlags();
+		}
+
+		if(result == GPNVM_OK)
+		{
+			memset(attributeValue, 0, sizeof(UInt32));
+			memset(&attributeValue[sizeof(UInt32)], 0xFF, GPNVM_COUNTER_BITMAP_SIZE);
+			attributeValue[sizeof(UInt32)] = 0xFE;
+			counter = 1;
+			result = gpNvm_AppendAttribute(attrId, GPNVM_COUNTER_LENGTH, attributeValue, gpNvm_CalculateChecksum(attributeValue, sizeof(UInt32)), 0);
+		}
+	}
+	else if(result == GPNVM_OK)
+	{
+		if(gpNvm_IsCounter(attrId) == 0)
+		{
+			printf("[gpNvm][%s] Attribute %d is not a counter! Abort.\n",__FUNCTION__,attrId);
+			result = GPNVM_ERROR_INVALID_PARAMETERS;
+		}
+
+		if(result == GPNVM_OK)
+		{
+			result = gpNvm_ReadUserMemory(attributeOffset, &attributeLength, 1);
+		}
+
+		if(result == GPNVM_OK)
+		{
+			result = gpNvm_ReadUserMemory(attributeOffset + 1, attributeValue, GPNVM_COUNTER_LENGTH);
+		}
+
+		if((result == GPNVM_OK) && ((attributeLength != GPNVM_COUNTER_LENGTH) || (gpNvm_DecodeCounter(attributeValue, &counter, &nextByte) != GPNVM_OK)))
+		{
+			printf("[gpNvm][%s] Corrupted counter data! Abort.\n",__FUNCTION__);
+			result = GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+		}
+
+		if((result == GPNVM_OK) && (nextByte < GPNVM_COUNTER_BITMAP_SIZE))
+		{
+			//Clear the next bit, only this byte is programmed
+			attributeValue[sizeof(UInt32) + nextByte] &= (UInt8)(attributeValue[sizeof(UInt32) + nextByte] - 1);
+			result = gpNvm_WriteUserMemory(attributeOffset + 1 + sizeof(UInt32) + nextByte, &attributeValue[sizeof(UInt32) + nextByte], 1);
+		}
+		else if(result == GPNVM_OK)
+		{
+			//Bitmap full, erase the counter into its base and clear the first bit
+			memcpy(attributeValue, &counter, sizeof(UInt32));
+			memset(&attributeValue[sizeof(UInt32)], 0xFF, GPNVM_COUNTER_BITMAP_SIZE);
+			attributeValue[sizeof(UInt32)] = 0xFE;
+			result = gpNvm_WriteUserMemory(attributeOffset + 1, attributeValue, GPNVM_COUNTER_LENGTH);
+
+			if(result == GPNVM_OK)
+			{
+				result = gpNvm_SetCrc(attrId, gpNvm_CalculateChecksum(attributeValue, sizeof(UInt32)));
+			}
+		}
+
+		if(result == GPNVM_OK)
+		{
+			//The ECC covers the bitmap too
+			result = gpNvm_SetEcc(attrId, GPNVM_COUNTER_LENGTH, attributeValue);
+		}
+		counter++;
+	}
+
+	if(result == GPNVM_OK)
+	{
+		gpNvm_AttributeChanged(attrId);
+		/* Write cache into non-volatile memory file and apply the sync policy */
+		result = gpNvm_CommitCache();
+	}
+	gpNvm_Unlock(1);
+	gpNvm_NotifyChanges();
+
+	if((result == GPNVM_OK) && (pValue != NULL))
+	{
+		*pValue = counter;
+	}
+	return result;
+}
+
+/*
+ * Name: gpNvm_CounterRead
+ *
+ * Description: Read a counter attribute, decoded by gpNvm_ReadAttribute.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: counter attribute id
+ *            UInt32* pValue: pointer to store the counter value
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the counter is read successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: invalid pointer, or the attribute is not a counter
+ *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the counter is not stored
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: the stored counter is corrupted
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ */
+gpNvm_Result gpNvm_CounterRead(gpNvm_AttrId attrId, UInt32* pValue)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt8 length = 0;
+	UInt16 offset = 0;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(pValue == NULL)
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	result = gpNvm_Lock(0);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+
+	if(gpNvm_IsCounter(attrId) == 0)
+	{
+		result = gpNvm_GetIndexEntry(attrId, &offset);
+
+		if((result == GPNVM_OK) && (offset == 0xFFFF))
+		{
+			result = GPNVM_ERROR_INVALID_ATTRIBUTE_ID;
+		}
+		else if(result == GPNVM_OK)
+		{
+			printf("[gpNvm][%s] Attribute %d is not a counter! Abort.\n",__FUNCTION__,attrId);
+			result = GPNVM_ERROR_INVALID_PARAMETERS;
+		}
+	}
+	else
+	{
+		result = gpNvm_ReadAttribute(attrId, &length, (UInt8*)pValue);
+	}
+	gpNvm_Unlock(0);
+	return result;
+}
+
+/*
+ * Name: gpNvm_BulkLoadStream
+ *
+ * Description: Load attributes delivered by a reader in increasing id order. Each attribute is laid out in the
+ * cache (user area, CRC and index tables) like gpNvm_SetAttribute does, but the file is written once, for all the
+ * dirty sectors, and synced once at the end. If an attribute is rejected, the attributes before it are still
+ * written and synced.
+ *
+ * Parameters:
+ *            gpNvm_BulkReader reader: function giving the next attribute, it returns 0 at the end of the stream
+ *            void* pContext: argument given to the reader
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: all attributes are loaded successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: invalid reader or value pointer, ids not in increasing
+ *                                                             order, or an attribute stored with another length
+ *                             GPNVM_ERROR_MEMORY_FULL: Memory is full
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced, or the component is read-only
+ */
+gpNvm_Result gpNvm_BulkLoadStream(gpNvm_BulkReader reader, void* pContext)
+{
+	gpNvm_Result result = GPNVM_OK;
+	gpNvm_Result writeResult;
+	gpNvm_BulkEntry entry;
+	UInt16 nextAttrId = 0;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(gpNvm_Mapping != NULL)
+	{
+		printf("[gpNvm][%s] Component opened read-only! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+
+	if(reader == NULL)
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	result = gpNvm_Lock(1);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+
+	while((result == GPNVM_OK) && (reader(pContext, &entry) != 0))
+	{
+		if((entry.pValue == NULL) || (entry.attrId < nextAttrId))
+		{
+			printf("[gpNvm][%s] Invalid attribute %d (NULL value or not sorted)! Abort.\n",__FUNCTION__,entry.attrId);
+			result = GPNVM_ERROR_INVALID_PARAMETERS;
+			break;
+		}
+		nextAttrId = entry.attrId + 1;
+		result = gpNvm_StoreAttribute(entry.attrId, entry.length, entry.pValue);
+	}
+	//One write of all the dirty sectors and one durability point for the whole load
+	writeResult = gpNvm_WriteCache();
+
+	if(writeResult == GPNVM_OK)
+	{
+		writeResult = gpNvm_SyncFile();
+	}
+	gpNvm_Unlock(1);
+	gpNvm_NotifyChanges();
+	return (result != GPNVM_OK) ? result : writeResult;
+}
+
+/*
+ * Name: gpNvm_ReadBulkArray
+ *
+ * Description: gpNvm_BulkReader over an array of attributes, used by gpNvm_BulkLoad.
+ *
+ * Parameters:
+ *            void* pContext: gpNvm_BulkArray holding the array and the next entry to read
+ *            gpNvm_BulkEntry* pEntry: pointer to store the next attribute
+ *
+ * Return value: UInt8: 1 if an attribute is read, 0 at the end of the array
+ */
+static UInt8 gpNvm_ReadBulkArray(void* pContext, gpNvm_BulkEntry* pEntry)
+{
+	gpNvm_BulkArray* pArray = (gpNvm_BulkArray*)pContext;
+
+	if(pArray->next >= pArray->count)
+	{
+		return 0;
+	}
+	*pEntry = pArray->pEntries[pArray->next++];
+	return 1;
+}
+
+/*
+ * Name: gpNvm_BulkLoad
+ *
+ * Description: Load an array of attributes sorted by increasing id, with one write and one sync of the file.
+ * See gpNvm_BulkLoadStream.
+ *
+ * Parameters:
+ *            const gpNvm_BulkEntry* pEntries: attributes sorted by increasing id
+ *            UInt16 count: number of attributes
+ *
+ * Return value: gpNvm_Result: same as gpNvm_BulkLoadStream
+ */
+gpNvm_Result gpNvm_BulkLoad(const gpNvm_BulkEntry* pEntries, UInt16 count)
+{
+	gpNvm_BulkArray array = {pEntries, count, 0};
+
+	if((pEntries == NULL) && (count != 0))
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	return gpNvm_BulkLoadStream(gpNvm_ReadBulkArray, &array);
+}
+
+/*
+ * Name: gpNvm_RemoveAttribute
+ *
+ * Description: Remove a stored attribute from the cache, without writing it into the file. Its index entry is cleared,
+ * which is the point where it disappears, and its CRC is erased. Shared by gpNvm_DeleteAttribute and gpNvm_DeltaApply.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: id of a stored attribute
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the attribute is removed successfully
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written
+ */
+static gpNvm_Result gpNvm_RemoveAttribute(gpNvm_AttrId attrId)
+{
+	gpNvm_Result result;
+
+	//Save the value for the open snapshots, then remove it from the index
+	gpNvm_SnapshotPreserve(attrId);
+	result = gpNvm_SetIndexEntry(attrId, 0xFFFF);
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_SetCrc(attrId, 0xFF);
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_SetEcc(attrId, 0, NULL);
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_SetCompressed(attrId, 0);
+	}
+
+	if((result == GPNVM_OK) && (gpNvm_IsCounter(attrId) != 0))
+	{
+		//The id can be reused by a plain attribute
+		gpNvm_AttributesFlags[attrId/8] |= (UInt8)(1 << (attrId%8));
+		result = gpNvm_WriteFlags();
+	}
+
+	if(result == GPNVM_OK)
+	{
+		gpNvm_AttributeChanged(attrId);
+	}
+	return result;
+}
+
+/*
+ * Name: gpNvm_DeleteAttribute
+ *
+ * Description: Remove an attribute, plain or counter, from the non-volatile memory. Its index entry is cleared, which
+ * is the point where it disappears, and its CRC is erased. Its bytes in the user attributes data area stay unused until
+ * gpNvm_Compact moves the attributes stored after them.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the attribute is deleted successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the attribute is not in non-volatile memory
+ *                             GPNVM_ERROR_READING_FILE: the index entry could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced, or the component is read-only
+ */
+gpNvm_Result gpNvm_DeleteAttribute(gpNvm_AttrId attrId)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt16 offset = 0xFFFF;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(gpNvm_Mapping != NULL)
+	{
+		printf("[gpNvm][%s] Component opened read-only! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+	result = gpNvm_Lock(1);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	result = gpNvm_GetIndexEntry(attrId, &offset);
+
+	if((result == GPNVM_OK) && (offset == 0xFFFF))
+	{
+		printf("[gpNvm][%s] Attribute %d is not in non-volatile memory! Abort.\n",__FUNCTION__,attrId);
+		result = GPNVM_ERROR_INVALID_ATTRIBUTE_ID;
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_RemoveAttribute(attrId);
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_CommitCache();
+	}
+	gpNvm_Unlock(1);
+	gpNvm_NotifyChanges();
+	return result;
+}
+
+/*
+ * Name: gpNvm_Compact
+ *
+ * Description: Reclaim the space left by deleted attributes: the stored attributes are moved, in the order of the user
+ * attributes data area, right after the previous one, then their index entries are updated. A value shared by several
+ * attributes (GPNVM_DEDUP) is moved once and stays shared. Values, CRCs, versions and open snapshots are not changed.
+ * The moves are written then synced once at the end, so an interrupted compaction can leave moved attributes
+ * corrupted: it is meant for maintenance (see gpnvm-tool, which keeps a copy of the file).
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the user attributes data area is compacted successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_READING_FILE: an attribute could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced, or the component is read-only
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: an attribute ends out of the user attributes data area, nothing is moved
+ */
+gpNvm_Result gpNvm_Compact(void)
+{
+	gpNvm_Result result = GPNVM_OK;
+	gpNvm_AttrId ids[GPNVM_MEMORY_INDEX_TABLE_SIZE];
+	UInt16 offsets[GPNVM_MEMORY_INDEX_TABLE_SIZE];
+	UInt8 attribute[1 + 255];
+	UInt16 count = 0;
+	UInt16 start = 0;
+	UInt16 end = 0;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(gpNvm_Mapping != NULL)
+	{
+		printf("[gpNvm][%s] Component opened read-only! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+	result = gpNvm_Lock(1);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	result = gpNvm_SortAttributes(ids, offsets, &count);
+
+	//Check every range before moving anything, a corrupted length would overwrite the following attributes
+	for(UInt16 cpt = 0; (result == GPNVM_OK) && (cpt < count); cpt++)
+	{
+		result = gpNvm_ReadUserMemory(offsets[cpt], attribute, 1);
+
+		if((result == GPNVM_OK) && (offsets[cpt] + 1 + attribute[0] > GPNVM_USER_MEMORY_SIZE))
+		{
+			printf("[gpNvm][%s] Attribute %u out of the user attributes data area! Abort.\n",__FUNCTION__,ids[cpt]);
+			result = GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+		}
+	}
+
+	for(UInt16 cpt = 0; (result == GPNVM_OK) && (cpt < count); cpt++)
+	{
+		if((cpt > 0) && (offsets[cpt] == offsets[cpt - 1]))
+		{
+			//Shares the value of the previous attribute, already moved to start
+			if(offsets[cpt] != start)
+			{
+				result = gpNvm_SetIndexEntry(ids[cpt], start);
+			}
+			continue;
+		}
+		start = end;
+		//Length then value, read whole before writing since the new place can overlap the old one
+		result = gpNvm_ReadUserMemory(offsets[cpt], attribute, 1);
+
+		if((result == GPNVM_OK) && (offsets[cpt] != end))
+		{
+			result = gpNvm_ReadUserMemory(offsets[cpt] + 1, &attribute[1], attribute[0]);
+
+			if(result == GPNVM_OK)
+			{
+				result = gpNvm_WriteUserMemory(end, attribute, 1 + attribute[0]);
+			}
+
+			if(result == GPNVM_OK)
+			{
+				result = gpNvm_SetIndexEntry(ids[cpt], end);
+			}
+		}
+		end += 1 + attribute[0];
+	}
+
+	if(result == GPNVM_OK)
+	{
+		gpNvm_UserMemoryEnd = end;
+		result = gpNvm_WriteCache();
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_SyncFile();
+	}
+	gpNvm_Unlock(1);
+	return result;
+}
+
+/*
+ * Name: gpNvm_ListAttributes
+ *
+ * Description: List the ids of the stored attributes, in increasing id order. Only the index is read.
+ *
+ * Parameters:
+ *            gpNvm_AttrId* pIds: pointer to store the ids, 256 entries
+ *            UInt16* pCount: pointer to store the number of stored attributes
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the attributes are listed successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: a pointer provided as argument is not valid
+ *                             GPNVM_ERROR_READING_FILE: an index entry could not be read from the file
+ */
+gpNvm_Result gpNvm_ListAttributes(gpNvm_AttrId* pIds, UInt16* pCount)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt16 offset;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if((pIds == NULL) || (pCount == NULL))
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	*pCount = 0;
+	result = gpNvm_Lock(0);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+
+	for(UInt16 cpt = 0; (result == GPNVM_OK) && (cpt < GPNVM_MEMORY_INDEX_TABLE_SIZE); cpt++)
+	{
+		result = gpNvm_GetIndexEntry((gpNvm_AttrId)cpt, &offset);
+
+		if((result == GPNVM_OK) && (offset != 0xFFFF))
+		{
+			pIds[(*pCount)++] = (gpNvm_AttrId)cpt;
+		}
+	}
+	gpNvm_Unlock(0);
+	return result;
+}
+
+/*
+ * Name: gpNvm_GetSpaceStats
+ *
+ * Description: Report the space usage of the user attributes data area: the bytes of the stored attributes, and the holes
+ * left by deleted attributes before the end of the last one, which gpNvm_Compact reclaims. A value shared by several
+ * attributes (GPNVM_DEDUP) is counted once. Only the index and the length of each attribute are read, so it is cheap
+ * on a read-only mapping.
+ *
+ * Parameters:
+ *            gpNvm_SpaceStats* pStats: pointer to store the space usage
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the space usage is read successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ *                             GPNVM_ERROR_READING_FILE: an attribute could not be read from the file
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: an attribute ends out of the user attributes data area
+ */
+gpNvm_Result gpNvm_GetSpaceStats(gpNvm_SpaceStats* pStats)
+{
+	gpNvm_Result result = GPNVM_OK;
+	gpNvm_AttrId ids[GPNVM_MEMORY_INDEX_TABLE_SIZE];
+	UInt16 offsets[GPNVM_MEMORY_INDEX_TABLE_SIZE];
+	UInt16 count = 0;
+	UInt8 length = 0;
+	UInt8 valueLength = 0;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(pStats == NULL)
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	memset(pStats, 0, sizeof(gpNvm_SpaceStats));
+	pStats->userMemorySize = GPNVM_USER_MEMORY_SIZE;
+	result = gpNvm_Lock(0);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	result = gpNvm_SortAttributes(ids, offsets, &count);
+
+	for(UInt16 cpt = 0; (result == GPNVM_OK) && (cpt < count); cpt++)
+	{
+		result = gpNvm_ReadLength(ids[cpt], offsets[cpt], &length, &valueLength);
+
+		if((result == GPNVM_OK) && (offsets[cpt] + 1 + length > GPNVM_USER_MEMORY_SIZE))
+		{
+			printf("[gpNvm][%s] Attribute %u out of the user attributes data area! Abort.\n",__FUNCTION__,ids[cpt]);
+			result = GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+		}
+
+		if(result != GPNVM_OK)
+		{
+			break;
+		}
+		pStats->attributes++;
+		pStats->counters += gpNvm_IsCounter(ids[cpt]);
+		pStats->compressed += (gpNvm_GetType(ids[cpt]) == GPNVM_TYPE_COMPRESSED);
+
+		if((cpt > 0) && (offsets[cpt] == offsets[cpt - 1]))
+		{
+			//Shares the value of the previous attribute, nothing more is stored
+			pStats->shared++;
+			pStats->savedBytes += 1 + valueLength;
+			continue;
+		}
+
+		if(offsets[cpt] > pStats->userMemoryEnd)
+		{
+			pStats->holes++;
+			pStats->holeBytes += offsets[cpt] - pStats->userMemoryEnd;
+
+			if(offsets[cpt] - pStats->userMemoryEnd > pStats->largestHole)
+			{
+				pStats->largestHole = offsets[cpt] - pStats->userMemoryEnd;
+			}
+		}
+		pStats->userMemoryEnd = offsets[cpt] + 1 + length;
+		pStats->usedBytes += 1 + length;
+		pStats->savedBytes += valueLength - length;
+	}
+	gpNvm_Unlock(0);
+	return result;
+}
+
+/*
+ * Name: gpNvm_Digest
+ *
+ * Description: Update a 32 bits FNV-1a digest with bytes. Unlike the CRC8 of the attributes, which lets 1 change in 256
+ * through, it is used to decide that two values are the same, and to check a whole delta.
+ *
+ * Parameters:
+ *            UInt32 digest: digest of the previous bytes, GPNVM_DIGEST_BASIS to start
+ *            const UInt8* pData: bytes to add
+ *            UInt32 length: number of bytes
+ *
+ * Return value: UInt32: updated digest
+ */
+static UInt32 gpNvm_Digest(UInt32 digest, const UInt8* pData, UInt32 length)
+{
+	for(UInt32 cpt = 0; cpt < length; cpt++)
+	{
+		digest = (digest ^ pData[cpt])*GPNVM_DIGEST_PRIME;
+	}
+	return digest;
+}
+
+/*
+ * Name: gpNvm_DigestAttribute
+ *
+ * Description: Read an attribute, a counter as its UInt32 count, and compute the digest of its type, length and value.
+ * Called with gpNvm_Mutex held.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: id of a stored attribute
+ *            UInt32* pDigest: pointer to store the digest
+ *            UInt8* pLength: pointer to store the length of attribute data
+ *            UInt8* pValue: pointer to store attribute data, 255 bytes
+ *
+ * Return value: gpNvm_Result: same as gpNvm_ReadAttribute
+ */
+static gpNvm_Result gpNvm_DigestAttribute(gpNvm_AttrId attrId, UInt32* pDigest, UInt8* pLength, UInt8* pValue)
+{
+	UInt8 type = (gpNvm_IsCounter(attrId) != 0) ? GPNVM_DELTA_COUNTER : GPNVM_DELTA_SET;
+	gpNvm_Result result = gpNvm_ReadAttribute(attrId, pLength, pValue);
+
+	if(result == GPNVM_OK)
+	{
+		*pDigest = gpNvm_Digest(gpNvm_Digest(gpNvm_Digest(GPNVM_DIGEST_BASIS, &type, 1), pLength, 1), pValue, *pLength);
+	}
+	return result;
+}
+
+/*
+ * Name: gpNvm_StoreCounter
+ *
+ * Description: Update the cache with a counter holding a given count, without writing it into the file: its base is set
+ * to the count and its bitmap erased. A counter already holding this count is left as it is. The id must not be used by
+ * a plain attribute.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: counter attribute id
+ *            UInt32 count: value of the counter
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the cache is updated successfully
+ *                             GPNVM_ERROR_MEMORY_FULL: Memory is full
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written
+ */
+static gpNvm_Result gpNvm_StoreCounter(gpNvm_AttrId attrId, UInt32 count)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt16 attributeOffset = 0;
+	UInt8 attributeValue[GPNVM_COUNTER_LENGTH];
+	UInt32 counter = 0;
+	UInt8 nextByte = 0;
+
+	result = gpNvm_GetIndexEntry(attrId, &attributeOffset);
+
+	if((result == GPNVM_OK) && (attributeOffset != 0xFFFF))
+	{
+		result = gpNvm_ReadUserMemory(attributeOffset + 1, attributeValue, GPNVM_COUNTER_LENGTH);
+
+		if((result != GPNVM_OK) || ((gpNvm_DecodeCounter(attributeValue, &counter, &nextByte) == GPNVM_OK) && (counter == count)))
+		{
+			return result;
+		}
+	}
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	memcpy(attributeValue, &count, sizeof(UInt32));
+	memset(&attributeValue[sizeof(UInt32)], 0xFF, GPNVM_COUNTER_BITMAP_SIZE);
+
+	if(attributeOffset == 0xFFFF)
+	{
+		//New counter, the space is checked by the caller before it is marked as a counter
+		gpNvm_AttributesFlags[attrId/8] &= (UInt8)~(1 << (attrId%8));
+		result = gpNvm_WriteFlags();
+
+		if(result == GPNVM_OK)
+		{
+			result = gpNvm_AppendAttribute(attrId, GPNVM_COUNTER_LENGTH, attributeValue, gpNvm_CalculateChecksum(attributeValue, sizeof(UInt32)), 0);
+		}
+		return result;
+	}
+	gpNvm_SnapshotPreserve(attrId);
+	result = gpNvm_WriteUserMemory(attributeOffset + 1, attributeValue, GPNVM_COUNTER_LENGTH);
+
+	if(result == GPNVM_OK)
+	{
+		gpNvm_AttributeChanged(attrId);
+		result = gpNvm_SetCrc(attrId, gpNvm_CalculateChecksum(attributeValue, sizeof(UInt32)));
+	}
+
+	if(result == GPNVM_OK)
+	{
+		result = gpNvm_SetEcc(attrId, GPNVM_COUNTER_LENGTH, attributeValue);
+	}
+	return result;
+}
+
+/*
+ * Name: gpNvm_CheckDelta
+ *
+ * Description: Check a delta before applying it: its magic, digest and records, with increasing ids and the lengths of
+ * their types, then that the attributes it adds or replaces fit after the last stored attribute. A shared value
+ * (GPNVM_DEDUP) is counted as added, since it is never written in place. Called with gpNvm_Mutex held.
+ *
+ * Parameters:
+ *            const UInt8* pDelta: delta
+ *            UInt32 length: length of the delta
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the delta can be applied
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the delta is malformed or corrupted
+ *                             GPNVM_ERROR_MEMORY_FULL: the new attributes do not fit
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ */
+static gpNvm_Result gpNvm_CheckDelta(const UInt8* pDelta, UInt32 length)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt32 magic = 0, digest = 0;
+	UInt32 needed = 0;
+	UInt32 offset = GPNVM_DELTA_HEADER_SIZE;
+	UInt16 count = 0, nextAttrId = 0;
+	UInt16 attributeOffset = 0;
+	UInt16 references = 0;
+	UInt8 attributeLength = 0;
+
+	if(length >= GPNVM_DELTA_HEADER_SIZE + sizeof(UInt32))
+	{
+		memcpy(&magic, pDelta, sizeof(UInt32));
+		memcpy(&count, &pDelta[sizeof(UInt32)], sizeof(UInt16));
+		memcpy(&digest, &pDelta[length - sizeof(UInt32)], sizeof(UInt32));
+	}
+
+	if((magic != GPNVM_DELTA_MAGIC) || (digest != gpNvm_Digest(GPNVM_DIGEST_BASIS, pDelta, length - sizeof(UInt32))))
+	{
+		printf("[gpNvm][%s] Invalid or corrupted delta! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	length -= sizeof(UInt32);
+
+	for(UInt16 cpt = 0; (result == GPNVM_OK) && (cpt < count); cpt++)
+	{
+		//[type][attrId][length][value]
+		if((offset + 3 > length) || (offset + 3 + pDelta[offset + 2] > length) || (pDelta[offset + 1] < nextAttrId) ||
+		   (pDelta[offset] > GPNVM_DELTA_DELETE) ||
+		   ((pDelta[offset] == GPNVM_DELTA_COUNTER) && (pDelta[offset + 2] != sizeof(UInt32))) ||
+		   ((pDelta[offset] == GPNVM_DELTA_DELETE) && (pDelta[offset + 2] != 0)))
+		{
+			printf("[gpNvm][%s] Invalid delta record %d! Abort.\n",__FUNCTION__,cpt);
+			return GPNVM_ERROR_INVALID_PARAMETERS;
+		}
+		nextAttrId = pDelta[offset + 1] + 1;
+		result = gpNvm_GetIndexEntry(pDelta[offset + 1], &attributeOffset);
+
+		if((result == GPNVM_OK) && (attributeOffset != 0xFFFF) && (pDelta[offset] == GPNVM_DELTA_SET) && (gpNvm_IsCounter(pDelta[offset + 1]) == 0))
+		{
+			result = gpNvm_ReadLength(pDelta[offset + 1], attributeOffset, NULL, &attributeLength);
+		}
+		references = 0;
+#if GPNVM_DEDUP > 0
+		if((result == GPNVM_OK) && (attributeOffset != 0xFFFF) && (pDelta[offset] == GPNVM_DELTA_SET))
+		{
+			result = gpNvm_CountReferences(pDelta[offset + 1], attributeOffset, &references);
+		}
+#endif
+
+		if((result == GPNVM_OK) && (pDelta[offset] != GPNVM_DELTA_DELETE) &&
+		   ((attributeOffset == 0xFFFF) || ((pDelta[offset] == GPNVM_DELTA_COUNTER) != (gpNvm_IsCounter(pDelta[offset + 1]) != 0)) ||
+		    ((pDelta[offset] == GPNVM_DELTA_SET) && ((attributeLength != pDelta[offset + 2]) || (GPNVM_COMPRESSION > 0) || (references > 0)))))
+		{
+			//Added, or replaced by an attribute of another type or length, or compressed and maybe moved if it grows, or
+			//shared (GPNVM_DEDUP) and never written in place
+			needed += 1 + ((pDelta[offset] == GPNVM_DELTA_COUNTER) ? GPNVM_COUNTER_LENGTH : pDelta[offset + 2]);
+		}
+		offset += 3 + pDelta[offset + 2];
+	}
+
+	if((result == GPNVM_OK) && (offset != length))
+	{
+		printf("[gpNvm][%s] Invalid delta length! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+
+	if((result == GPNVM_OK) && (gpNvm_UserMemoryEnd + needed > GPNVM_USER_MEMORY_SIZE))
+	{
+		printf("[gpNvm][%s] Memory full (%u bytes needed)! Abort.\n",__FUNCTION__,needed);
+		return GPNVM_ERROR_MEMORY_FULL;
+	}
+	return result;
+}
+
+/*
+ * Name: gpNvm_ApplyDeltaRecord
+ *
+ * Description: Update the cache with one record of a checked delta. A stored attribute of another type or length than
+ * the record is removed before the record is stored. Called with gpNvm_Mutex held.
+ *
+ * Parameters:
+ *            const UInt8* pRecord: record, [type][attrId][length][value]
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the cache is updated successfully
+ *                             GPNVM_ERROR_MEMORY_FULL: Memory is full
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written
+ */
+static gpNvm_Result gpNvm_ApplyDeltaRecord(const UInt8* pRecord)
+{
+	gpNvm_Result result = GPNVM_OK;
+	gpNvm_AttrId attrId = pRecord[1];
+	UInt16 attributeOffset = 0;
+	UInt8 attributeLength = 0;
+	UInt32 count = 0;
+
+	result = gpNvm_GetIndexEntry(attrId, &attributeOffset);
+
+	if((result != GPNVM_OK) || ((attributeOffset == 0xFFFF) && (pRecord[0] == GPNVM_DELTA_DELETE)))
+	{
+		return result;
+	}
+
+	if(attributeOffset != 0xFFFF)
+	{
+		result = gpNvm_ReadLength(attrId, attributeOffset, NULL, &attributeLength);
+
+		if((result == GPNVM_OK) && ((pRecord[0] == GPNVM_DELTA_DELETE) || ((pRecord[0] == GPNVM_DELTA_COUNTER) != (gpNvm_IsCounter(attrId) != 0)) ||
+		   ((pRecord[0] == GPNVM_DELTA_SET) && (attributeLength != pRecord[2]))))
+		{
+			result = gpNvm_RemoveAttribute(attrId);
+		}
+	}
+
+	if((result != GPNVM_OK) || (pRecord[0] == GPNVM_DELTA_DELETE))
+	{
+		return result;
+	}
+
+	if(pRecord[0] == GPNVM_DELTA_COUNTER)
+	{
+		memcpy(&count, &pRecord[3], sizeof(UInt32));
+		return gpNvm_StoreCounter(attrId, count);
+	}
+	return gpNvm_StoreAttribute(attrId, pRecord[2], &pRecord[3]);
+}
+
+/*
+ * Name: gpNvm_GetSignature
+ *
+ * Description: Compute the digest of every stored attribute, see gpNvm_DigestAttribute. A corrupted attribute is
+ * marked present with the digest 0, which no delta record matches, so it is rewritten by the next delta.
+ *
+ * Parameters:
+ *            gpNvm_Signature* pSignature: pointer to store the signature
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the signature is computed successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ *                             GPNVM_ERROR_READING_FILE: an attribute could not be read from the file
+ */
+gpNvm_Result gpNvm_GetSignature(gpNvm_Signature* pSignature)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt16 offset = 0xFFFF;
+	UInt8 length = 0;
+	UInt8 value[255];
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(pSignature == NULL)
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	memset(pSignature, 0, sizeof(gpNvm_Signature));
+	result = gpNvm_Lock(0);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+
+	for(UInt16 attrId = 0; (result == GPNVM_OK) && (attrId < GPNVM_MEMORY_INDEX_TABLE_SIZE); attrId++)
+	{
+		result = gpNvm_GetIndexEntry(attrId, &offset);
+
+		if((result != GPNVM_OK) || (offset == 0xFFFF))
+		{
+			continue;
+		}
+		pSignature->present[attrId/8] |= (UInt8)(1 << (attrId%8));
+		result = gpNvm_DigestAttribute(attrId, &pSignature->digests[attrId], &length, value);
+
+		if(result == GPNVM_ERROR_CORRUPTED_ATTRIBUTE)
+		{
+			pSignature->digests[attrId] = 0;
+			result = GPNVM_OK;
+		}
+	}
+	gpNvm_Unlock(0);
+	return result;
+}
+
+/*
+ * Name: gpNvm_DiffCreate
+ *
+ * Description: Build the delta turning a store with the given signature into this one. Each stored attribute is
+ * compared by digest with the signature and skipped if it matches, then the records are added in increasing id order,
+ * and the digest of the delta is appended. With a NULL buffer the delta is only measured.
+ *
+ * Parameters:
+ *            const gpNvm_Signature* pBase: signature of the other store, NULL for an empty store
+ *            UInt8* pDelta: buffer to store the delta, NULL to only compute its length
+ *            UInt32 size: size of the buffer
+ *            UInt32* pLength: pointer to store the length of the delta
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the delta is built successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: invalid pointer, or the buffer is too small
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: an attribute to send is corrupted
+ *                             GPNVM_ERROR_READING_FILE: an attribute could not be read from the file
+ */
+gpNvm_Result gpNvm_DiffCreate(const gpNvm_Signature* pBase, UInt8* pDelta, UInt32 size, UInt32* pLength)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt8 record[3 + 255];
+	UInt32 length = GPNVM_DELTA_HEADER_SIZE;
+	UInt32 magic = GPNVM_DELTA_MAGIC;
+	UInt32 digest = 0;
+	UInt16 offset = 0xFFFF;
+	UInt16 count = 0;
+	UInt8 inBase = 0;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(pLength == NULL)
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	result = gpNvm_Lock(0);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+
+	for(UInt16 attrId = 0; (result == GPNVM_OK) && (attrId < GPNVM_MEMORY_INDEX_TABLE_SIZE); attrId++)
+	{
+		inBase = (pBase != NULL) && ((pBase->present[attrId/8] & (1 << (attrId%8))) != 0);
+		result = gpNvm_GetIndexEntry(attrId, &offset);
+
+		if((result != GPNVM_OK) || ((offset == 0xFFFF) && !inBase))
+		{
+			continue;
+		}
+		record[0] = GPNVM_DELTA_DELETE;
+		record[1] = (UInt8)attrId;
+		record[2] = 0;
+
+		if(offset != 0xFFFF)
+		{
+			result = gpNvm_DigestAttribute(attrId, &digest, &record[2], &record[3]);
+
+			if((result != GPNVM_OK) || (inBase && (pBase->digests[attrId] == digest)))
+			{
+				//Unchanged attribute
+				continue;
+			}
+			record[0] = (gpNvm_IsCounter(attrId) != 0) ? GPNVM_DELTA_COUNTER : GPNVM_DELTA_SET;
+		}
+
+		if(pDelta != NULL)
+		{
+			if(length + 3 + record[2] + sizeof(UInt32) > size)
+			{
+				printf("[gpNvm][%s] Delta buffer too small! Abort.\n",__FUNCTION__);
+				result = GPNVM_ERROR_INVALID_PARAMETERS;
+				break;
+			}
+			memcpy(&pDelta[length], record, 3 + record[2]);
+		}
+		length += 3 + record[2];
+		count++;
+	}
+	gpNvm_Unlock(0);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+
+	if(pDelta != NULL)
+	{
+		memcpy(pDelta, &magic, sizeof(UInt32));
+		memcpy(&pDelta[sizeof(UInt32)], &count, sizeof(UInt16));
+		digest = gpNvm_Digest(GPNVM_DIGEST_BASIS, pDelta, length);
+		memcpy(&pDelta[length], &digest, sizeof(UInt32));
+	}
+	*pLength = length + sizeof(UInt32);
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_DeltaApply
+ *
+ * Description: Apply a delta built by gpNvm_DiffCreate. The whole delta is checked by gpNvm_CheckDelta before the first
+ * record is applied, then the records update the cache under gpNvm_Mutex, as a bulk load does, and the dirty sectors are
+ * written and synced once.
+ *
+ * Parameters:
+ *            const UInt8* pDelta: delta
+ *            UInt32 length: length of the delta
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the delta is applied successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: invalid pointer, or the delta is malformed or corrupted
+ *                             GPNVM_ERROR_MEMORY_FULL: the new attributes do not fit, nothing is changed
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced, or the component is read-only
+ */
+gpNvm_Result gpNvm_DeltaApply(const UInt8* pDelta, UInt32 length)
+{
+	gpNvm_Result result = GPNVM_OK;
+	gpNvm_Result writeResult = GPNVM_OK;
+	UInt32 offset = GPNVM_DELTA_HEADER_SIZE;
+	UInt16 count = 0;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(gpNvm_Mapping != NULL)
+	{
+		printf("[gpNvm][%s] Component opened read-only! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+
+	if(pDelta == NULL)
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	result = gpNvm_Lock(1);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	result = gpNvm_CheckDelta(pDelta, length);
+
+	if(result == GPNVM_OK)
+	{
+		memcpy(&count, &pDelta[sizeof(UInt32)], sizeof(UInt16));
+
+		for(UInt16 cpt = 0; (result == GPNVM_OK) && (cpt < count); cpt++)
+		{
+			result = gpNvm_ApplyDeltaRecord(&pDelta[offset]);
+			offset += 3 + pDelta[offset + 2];
+		}
+		//One write of all the dirty sectors and one durability point for the whole delta
+		writeResult = gpNvm_WriteCache();
+
+		if(writeResult == GPNVM_OK)
+		{
+			writeResult = gpNvm_SyncFile();
+		}
+	}
+	gpNvm_Unlock(1);
+	gpNvm_NotifyChanges();
+	return (result != GPNVM_OK) ? result : writeResult;
+}
+
+/*
+ * Name: gpNvm_GetCacheStats
+ *
+ * Description: Get the hit and miss counters of the user non-volatile memory data cache since gpNvm_Init.
+ * When the whole user area is in RAM (GPNVM_CACHE_RAM_BUDGET is 0) every access is a hit.
+ *
+ * Parameters:
+ *            gpNvm_CacheStats* pStats: pointer to store the counters
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: counters are read successfully
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ */
+gpNvm_Result gpNvm_GetCacheStats(gpNvm_CacheStats* pStats)
+{
+	if(pStats == NULL)
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	*pStats = gpNvm_CacheStatistics;
+	return GPNVM_OK;
+}
+
+#if GPNVM_MAX_SUBSCRIBERS > 0
+/*
+ * Name: gpNvm_Subscribe
+ *
+ * Description: Register a subscriber to the changes of a range of attributes. It is notified by gpNvm_NotifyChanges,
+ * after the change is written into the file, with a call of its callback for each changed attribute and/or one
+ * increment of its eventfd. It can be called before gpNvm_Init, subscriptions are kept across gpNvm_Init/gpNvm_Uninit.
+ *
+ * Parameters:
+ *            gpNvm_AttrId firstAttrId: first attribute id of the range
+ *            gpNvm_AttrId lastAttrId: last attribute id of the range, included
+ *            gpNvm_ChangeCallback callback: function called for each changed attribute, can be NULL
+ *            void* pContext: context passed to the callback
+ *            int eventFd: eventfd written once per notification, -1 for none
+ *            UInt8* pHandle: pointer to store the subscription handle, for gpNvm_Unsubscribe
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the subscriber is registered successfully
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: invalid range or pointer, or neither callback nor eventfd
+ *                             GPNVM_ERROR_MEMORY_FULL: GPNVM_MAX_SUBSCRIBERS are already registered
+ */
+gpNvm_Result gpNvm_Subscribe(gpNvm_AttrId firstAttrId, gpNvm_AttrId lastAttrId, gpNvm_ChangeCallback callback, void* pContext, int eventFd, UInt8* pHandle)
+{
+	gpNvm_Result result = GPNVM_ERROR_MEMORY_FULL;
+
+	//Validate input parameters
+	if((pHandle == NULL) || (firstAttrId > lastAttrId) || ((callback == NULL) && (eventFd < 0)))
+	{
+		printf("[gpNvm][%s] Invalid input parameters! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	pthread_mutex_lock(&gpNvm_Mutex);
+
+	for(UInt8 handle = 0; handle < GPNVM_MAX_SUBSCRIBERS; handle++)
+	{
+		if(gpNvm_Subscribers[handle].used == 0)
+		{
+			gpNvm_Subscribers[handle].callback = callback;
+			gpNvm_Subscribers[handle].pContext = pContext;
+			gpNvm_Subscribers[handle].eventFd = eventFd;
+			gpNvm_Subscribers[handle].firstAttrId = firstAttrId;
+			gpNvm_Subscribers[handle].lastAttrId = lastAttrId;
+			gpNvm_Subscribers[handle].used = 1;
+			*pHandle = handle;
+			result = GPNVM_OK;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&gpNvm_Mutex);
+
+	if(result != GPNVM_OK)
+	{
+		printf("[gpNvm][%s] Too many subscribers! Abort.\n",__FUNCTION__);
+	}
+	return result;
+}
+
+/*
+ * Name: gpNvm_Unsubscribe
+ *
+ * Description: Remove a subscriber. A notification already started by another thread may still reach it.
+ *
+ * Parameters:
+ *            UInt8 handle: subscription handle returned by gpNvm_Subscribe
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the subscriber is removed successfully
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the handle is not a registered subscriber
+ */
+gpNvm_Result gpNvm_Unsubscribe(UInt8 handle)
+{
+	gpNvm_Result result = GPNVM_OK;
+
+	pthread_mutex_lock(&gpNvm_Mutex);
+
+	if((handle >= GPNVM_MAX_SUBSCRIBERS) || (gpNvm_Subscribers[handle].used == 0))
+	{
+		printf("[gpNvm][%s] Invalid subscription handle %d! Abort.\n",__FUNCTION__,handle);
+		result = GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	else
+	{
+		gpNvm_Subscribers[handle].used = 0;
+	}
+	pthread_mutex_unlock(&gpNvm_Mutex);
+	return result;
+}
+#endif
+
+#if GPNVM_CHANGE_FEED_SIZE > 0
+/*
+ * Name: gpNvm_ChangeFeedStart
+ *
+ * Description: Get a cursor on the next change of the feed.
+ *
+ * Parameters:
+ *            gpNvm_FeedCursor* pCursor: pointer to store the cursor
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the cursor is set successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ */
+gpNvm_Result gpNvm_ChangeFeedStart(gpNvm_FeedCursor* pCursor)
+{
+	gpNvm_Result result;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(pCursor == NULL)
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	//In multi-process mode, the changes of the other processes are added to the feed first
+	result = gpNvm_Lock(0);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	pCursor->epoch = gpNvm_FeedEpoch;
+	pCursor->sequence = gpNvm_FeedNext;
+	pCursor->position = gpNvm_FeedTail + gpNvm_FeedUsed;
+	pCursor->wraps = gpNvm_FeedTailWraps;
+
+	if(pCursor->position >= GPNVM_CHANGE_FEED_SIZE)
+	{
+		pCursor->position -= GPNVM_CHANGE_FEED_SIZE;
+		pCursor->wraps++;
+	}
+	gpNvm_Unlock(0);
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_ChangeFeedRead
+ *
+ * Description: Read the change following a cursor. The cursor holds the position of the change in the ring and the
+ * number of times the ring wrapped before it, so its distance from the oldest change kept is computed directly, then the
+ * sequence number stored there is checked against the cursor. A cursor of another epoch, before the oldest change kept,
+ * or not on its change, is moved to the oldest change kept and a gap is reported. Positions are compared by difference,
+ * so the wrap counts can wrap around.
+ *
+ * Parameters:
+ *            gpNvm_FeedCursor* pCursor: cursor, moved after the change read, or to the oldest change kept after a gap
+ *            gpNvm_Change* pChange: pointer to store the change
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the change is read successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: invalid pointers
+ *                             GPNVM_ERROR_NO_CHANGE: no change after the cursor yet
+ *                             GPNVM_ERROR_FEED_GAP: changes after the cursor were dropped
+ */
+gpNvm_Result gpNvm_ChangeFeedRead(gpNvm_FeedCursor* pCursor, gpNvm_Change* pChange)
+{
+	gpNvm_Result result = GPNVM_OK;
+	UInt8 header[GPNVM_FEED_ENTRY_HEADER_SIZE];
+	UInt32 distance, sequence;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if((pCursor == NULL) || (pChange == NULL))
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	result = gpNvm_Lock(0);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+
+	//Bytes from the oldest change kept to the cursor, past gpNvm_FeedUsed when the change of the cursor was dropped
+	distance = (pCursor->wraps - gpNvm_FeedTailWraps)*GPNVM_CHANGE_FEED_SIZE + pCursor->position - gpNvm_FeedTail;
+	sequence = gpNvm_FeedNext;
+
+	if((pCursor->position < GPNVM_CHANGE_FEED_SIZE) && (distance < gpNvm_FeedUsed))
+	{
+		gpNvm_FeedCopy(pCursor->position, header, GPNVM_FEED_ENTRY_HEADER_SIZE, 0);
+		memcpy(&sequence, header, sizeof(UInt32));
+	}
+
+	if((pCursor->epoch != gpNvm_FeedEpoch) || (pCursor->position >= GPNVM_CHANGE_FEED_SIZE) || (distance > gpNvm_FeedUsed) ||
+	   (sequence != pCursor->sequence))
+	{
+		pCursor->epoch = gpNvm_FeedEpoch;
+		pCursor->sequence = gpNvm_FeedFirst;
+		pCursor->position = gpNvm_FeedTail;
+		pCursor->wraps = gpNvm_FeedTailWraps;
+		result = GPNVM_ERROR_FEED_GAP;
+	}
+	else if(distance == gpNvm_FeedUsed)
+	{
+		result = GPNVM_ERROR_NO_CHANGE;
+	}
+	else
+	{
+		pChange->sequence = sequence;
+		pChange->type = header[sizeof(UInt32)];
+		pChange->attrId = header[sizeof(UInt32) + 1];
+		pChange->length = header[sizeof(UInt32) + 2];
+		gpNvm_FeedCopy(pCursor->position + GPNVM_FEED_ENTRY_HEADER_SIZE, pChange->value, pChange->length, 0);
+		pCursor->sequence++;
+		pCursor->position += GPNVM_FEED_ENTRY_HEADER_SIZE + pChange->length;
+
+		if(pCursor->position >= GPNVM_CHANGE_FEED_SIZE)
+		{
+			pCursor->position -= GPNVM_CHANGE_FEED_SIZE;
+			pCursor->wraps++;
+		}
+	}
+	gpNvm_Unlock(0);
+	return result;
+}
+#endif
+
+#if GPNVM_MAX_SNAPSHOTS > 0
+/*
+ * Name: gpNvm_SnapshotOpen
+ *
+ * Description: Open a point-in-time view of all the attributes. Opening only takes a free entry of gpNvm_Snapshots,
+ * values are copied later by gpNvm_SnapshotPreserve, and only for the attributes that change while it is open.
+ *
+ * Parameters:
+ *            UInt8* pHandle: pointer to store the snapshot handle
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the snapshot is opened successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ *                             GPNVM_ERROR_MEMORY_FULL: GPNVM_MAX_SNAPSHOTS snapshots are already open
+ *                             GPNVM_ERROR_WRITING_FILE: the component is read-only (GPNVM_STORAGE_READ_ONLY)
+ */
+gpNvm_Result gpNvm_SnapshotOpen(UInt8* pHandle)
+{
+	gpNvm_Result result = GPNVM_ERROR_MEMORY_FULL;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(gpNvm_Mapping != NULL)
+	{
+		printf("[gpNvm][%s] Component opened read-only! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+	//Validate input pointer
+	if(pHandle == NULL)
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	result = gpNvm_Lock(0);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+
+	for(UInt8 handle = 0; handle < GPNVM_MAX_SNAPSHOTS; handle++)
+	{
+		if(gpNvm_Snapshots[handle].used == 0)
+		{
+			memset(gpNvm_Snapshots[handle].saved, 0, sizeof(gpNvm_Snapshots[handle].saved));
+			memset(gpNvm_Snapshots[handle].absent, 0, sizeof(gpNvm_Snapshots[handle].absent));
+			gpNvm_Snapshots[handle].end = 0;
+			gpNvm_Snapshots[handle].full = 0;
+			gpNvm_Snapshots[handle].used = 1;
+			gpNvm_SnapshotsOpen++;
+			*pHandle = handle;
+			result = GPNVM_OK;
+			break;
+		}
+	}
+	gpNvm_Unlock(0);
+
+	if(result != GPNVM_OK)
+	{
+		printf("[gpNvm][%s] Too many open snapshots! Abort.\n",__FUNCTION__);
+	}
+	return result;
+}
+
+/*
+ * Name: gpNvm_SnapshotGet
+ *
+ * Description: Get an attribute as it was when the snapshot was opened: from the snapshot arena if it changed since,
+ * from the cache otherwise. gpNvm_Mutex is only held for this attribute, not for the whole life of the snapshot.
+ *
+ * Parameters:
+ *            UInt8 handle: snapshot handle
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8* pLength: pointer to a variable that will store the length of attribute data
+ *            UInt8* pValue: pointer to store attribute data
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: attribute data is read successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: invalid pointers or snapshot handle
+ *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the attribute was not stored when the snapshot was opened
+ *                             GPNVM_ERROR_MEMORY_FULL: the arena of the snapshot filled up, the snapshot is lost
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: attribute data are corrupted
+ *                             GPNVM_ERROR_READING_FILE: attribute data could not be read from the file
+ */
+gpNvm_Result gpNvm_SnapshotGet(UInt8 handle, gpNvm_AttrId attrId, UInt8* pLength, UInt8* pValue)
+{
+	gpNvm_Result result = GPNVM_OK;
+	gpNvm_Snapshot* pSnapshot;
+	UInt16 offset = 0;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+	//Validate input pointers
+	if((pLength == NULL) || (pValue == NULL) || (handle >= GPNVM_MAX_SNAPSHOTS))
+	{
+		printf("[gpNvm][%s] Invalid input parameters! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	result = gpNvm_Lock(0);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	pSnapshot = &gpNvm_Snapshots[handle];
+
+	if(pSnapshot->used == 0)
+	{
+		printf("[gpNvm][%s] Snapshot %d is not open! Abort.\n",__FUNCTION__,handle);
+		result = GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	else if(pSnapshot->full != 0)
+	{
+		printf("[gpNvm][%s] Snapshot %d is full, it must be closed! Abort.\n",__FUNCTION__,handle);
+		result = GPNVM_ERROR_MEMORY_FULL;
+	}
+	else if((pSnapshot->absent[attrId/8] & (1 << (attrId%8))) != 0)
+	{
+		//Attribute created after the snapshot was opened
+		result = GPNVM_ERROR_INVALID_ATTRIBUTE_ID;
+	}
+	else if((pSnapshot->saved[attrId/8] & (1 << (attrId%8))) != 0)
+	{
+		//Attribute changed after the snapshot was opened, find its old value in the arena
+		while(pSnapshot->values[offset] != attrId)
+		{
+			offset += pSnapshot->values[offset + 1] + 2;
+		}
+		*pLength = pSnapshot->values[offset + 1];
+		memcpy(pValue, &pSnapshot->values[offset + 2], *pLength);
+	}
+	else
+	{
+		//Attribute unchanged since the snapshot was opened
+		result = gpNvm_ReadAttribute(attrId, pLength, pValue);
+	}
+	gpNvm_Unlock(0);
+	return result;
+}
+
+/*
+ * Name: gpNvm_SnapshotClose
+ *
+ * Description: Close a snapshot and free its entry of gpNvm_Snapshots.
+ *
+ * Parameters:
+ *            UInt8 handle: snapshot handle
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the snapshot is closed successfully
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the handle is not an open snapshot
+ */
+gpNvm_Result gpNvm_SnapshotClose(UInt8 handle)
+{
+	gpNvm_Result result = GPNVM_OK;
+
+	pthread_mutex_lock(&gpNvm_Mutex);
+
+	if((handle >= GPNVM_MAX_SNAPSHOTS) || (gpNvm_Snapshots[handle].used == 0))
+	{
+		printf("[gpNvm][%s] Invalid snapshot handle %d! Abort.\n",__FUNCTION__,handle);
+		result = GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	else
+	{
+		gpNvm_Snapshots[handle].used = 0;
+		gpNvm_SnapshotsOpen--;
+	}
+	pthread_mutex_unlock(&gpNvm_Mutex);
+	return result;
+}
+#endif
+
+/*
+ * Name: gpNvm_GetRamFootprint
+ *
+ * Description: Get the static RAM used by the component in the configuration it is built with
+ * (GPNVM_MEMORY_SIZE, GPNVM_CACHE_RAM_BUDGET, GPNVM_RAM_MINIMAL, GPNVM_SECTOR_SIZE).
+ *
+ * Parameters: None
+ *
+ * Return value: UInt32: RAM footprint in bytes
+ */
+UInt32 gpNvm_GetRamFootprint(void)
+{
+	UInt32 footprint = 0;
+
+	//Caches of the non-volatile memory areas
+#if GPNVM_CACHE_RAM_BUDGET > 0
+	footprint += sizeof(gpNvm_CachePages) + sizeof(gpNvm_CachePageNumber) + sizeof(gpNvm_CachePageFlags);
+	footprint += sizeof(gpNvm_CacheSlot) + sizeof(gpNvm_CacheClockHand);
+#elif GPNVM_RAM_MINIMAL == 0
+	footprint += sizeof(gpNvm_MemoryCache);
+#endif
+#if GPNVM_RAM_MINIMAL < 2
+	footprint += sizeof(gpNvm_MemoryIndexTable);
+#else
+	footprint += sizeof(gpNvm_AttributesPresent);
+#endif
+#if GPNVM_RAM_MINIMAL == 0
+	footprint += sizeof(gpNvm_AttributesCrcTable);
+#endif
+	//File I/O and state
+	footprint += sizeof(gpNvm_IoBuffer) + sizeof(gpNvm_DirtySectors) + sizeof(gpNvm_Regions) + sizeof(gpNvm_ImageHeader);
+	footprint += sizeof(gpNvm_FileDescriptor) + sizeof(gpNvm_StorageOptions) + sizeof(gpNvm_CacheStatistics) + sizeof(gpNvm_UserMemoryEnd);
+	footprint += sizeof(gpNvm_CurrentSyncPolicy) + sizeof(gpNvm_SyncIntervalMs) + sizeof(gpNvm_LastSyncTimeMs) + sizeof(gpNvm_SyncPending);
+	footprint += sizeof(gpNvm_SyncThread) + sizeof(gpNvm_SyncWakeup) + sizeof(gpNvm_SyncThreadState);
+	footprint += sizeof(gpNvm_Mutex) + sizeof(gpNvm_AttributesFlags) + sizeof(gpNvm_StoreVersion);
+#if GPNVM_MAX_SUBSCRIBERS > 0
+	footprint += sizeof(gpNvm_Subscribers) + sizeof(gpNvm_ChangedAttributes) + sizeof(gpNvm_ChangesPending);
+#endif
+#if GPNVM_MAX_SNAPSHOTS > 0
+	footprint += sizeof(gpNvm_Snapshots) + sizeof(gpNvm_SnapshotsOpen);
+#endif
+#if GPNVM_CHANGE_FEED_SIZE > 0
+	footprint += sizeof(gpNvm_Feed) + sizeof(gpNvm_FeedTail) + sizeof(gpNvm_FeedUsed) + sizeof(gpNvm_FeedFirst) + sizeof(gpNvm_FeedNext);
+	footprint += sizeof(gpNvm_FeedTailWraps) + sizeof(gpNvm_FeedEpoch) + sizeof(gpNvm_FeedPending) + sizeof(gpNvm_FeedPendingAny);
+#endif
+#if GPNVM_MULTI_PROCESS
+	footprint += sizeof(gpNvm_Shared) + sizeof(gpNvm_Generation) + sizeof(gpNvm_SectorGenerations);
+#endif
+#if (GPNVM_ECC_INTERLEAVE > 0) && (GPNVM_RAM_MINIMAL == 0)
+	footprint += sizeof(gpNvm_AttributesEccTable);
+#endif
+#if GPNVM_MIRROR_COPIES > 0
+	footprint += sizeof(gpNvm_MirrorDescriptors) + sizeof(gpNvm_MirrorsOpen);
+#endif
+#if GPNVM_REPAIR
+	footprint += sizeof(gpNvm_RepairPending) + sizeof(gpNvm_RepairPendingAny);
+#endif
+#if GPNVM_VERSION_TOKENS
+	footprint += sizeof(gpNvm_AttributeVersions);
+#endif
+	return footprint;
+}
+
+/*
+ * Name: gpNvm_SetSyncPolicy
+ *
+ * Description: Select when data written into the file emulating non-volatile memory is forced to the
+ * storage device. It can be called before or after gpNvm_Init. Switching to GPNVM_SYNC_ALWAYS while data
+ * is pending will sync it at the next commit, gpNvm_Sync or gpNvm_Uninit.
+ *
+ * Parameters:
+ *            gpNvm_SyncPolicy policy: GPNVM_SYNC_ALWAYS, GPNVM_SYNC_PERIODIC or GPNVM_SYNC_NONE
+ *            UInt32 intervalMs: minimum time between two syncs, only used by GPNVM_SYNC_PERIODIC
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the policy is set successfully
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: unknown policy
+ */
+gpNvm_Result gpNvm_SetSyncPolicy(gpNvm_SyncPolicy policy, UInt32 intervalMs)
+{
+	if((policy != GPNVM_SYNC_ALWAYS) && (policy != GPNVM_SYNC_PERIODIC) && (policy != GPNVM_SYNC_NONE))
+	{
+		printf("[gpNvm][%s] Invalid sync policy %d! Abort.\n",__FUNCTION__,policy);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	gpNvm_CurrentSyncPolicy = policy;
+	gpNvm_SyncIntervalMs = intervalMs;
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_SetStorageOptions
+ *
+ * Description: Select how the file emulating non-volatile memory is accessed. Options are applied when
+ * the file is opened, so this function must be called before gpNvm_Init.
+ *
+ * Parameters:
+ *            UInt8 options: combination of GPNVM_STORAGE_xxx flags, 0 for the default buffered access
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the options are set successfully
+ *                             GPNVM_ERROR_ALREADY_INITIALIZED: the component is already initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: unknown option
+ */
+gpNvm_Result gpNvm_SetStorageOptions(UInt8 options)
+{
+	//Options are used when opening the file
+	if(gpNvm_FileDescriptor >= 0)
+	{
+		printf("[gpNvm][%s] Component already initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_ALREADY_INITIALIZED;
+	}
+
+	if((options & ~(GPNVM_STORAGE_DIRECT | GPNVM_STORAGE_READ_ONLY)) != 0)
+	{
+		printf("[gpNvm][%s] Invalid storage options 0x%x! Abort.\n",__FUNCTION__,options);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	gpNvm_StorageOptions = options;
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_SetFileName
+ *
+ * Description: Select the file emulating non-volatile memory, GPNVM_FILE_NAME by default. It must be called before gpNvm_Init,
+ * e.g. by a tool opening images copied from devices.
+ *
+ * Parameters:
+ *            const char* pFileName: path of the file, kept by the component until it is changed
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the file name is set successfully
+ *                             GPNVM_ERROR_ALREADY_INITIALIZED: the component is already initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ */
+gpNvm_Result gpNvm_SetFileName(const char* pFileName)
+{
+	if(gpNvm_FileDescriptor >= 0)
+	{
+		printf("[gpNvm][%s] Component already initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_ALREADY_INITIALIZED;
+	}
+
+	if(pFileName == NULL)
+	{
+		printf("[gpNvm][%s] Invalid input pointers! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	gpNvm_FileName = pFileName;
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvm_Sync
+ *
+ * Description: Explicit durability point. All the attributes set before this call are on the storage
+ * device when it returns, whatever the sync policy is.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the file is synced successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be synced
+ */
+gpNvm_Result gpNvm_Sync(void)
+{
+	gpNvm_Result result;
+
+	//Check if the component is initialized
+	if(gpNvm_FileDescriptor < 0)
+	{
+		printf("[gpNvm][%s] Component not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+	pthread_mutex_lock(&gpNvm_Mutex);
+	result = gpNvm_SyncFile();
+	pthread_mutex_unlock(&gpNvm_Mutex);
+	return result;
+}
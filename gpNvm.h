@@ -21,9 +21,107 @@
 /* ==================================================================== */
 /* ====================== Macros and constants  ======================= */
 /* ==================================================================== */
+#ifndef GPNVM_MEMORY_SIZE
 #define GPNVM_MEMORY_SIZE                    2048     /* Total non-volatile memory data size */
+#endif
+#ifndef GPNVM_REGION_ALIGNMENT
+#define GPNVM_REGION_ALIGNMENT               1        /* Alignment of each memory area in the file, e.g. file system block size. 1 keeps the areas packed */
+#endif
 #define GPNVM_FILE_NAME                      "gpNvm"  /* File to be used to emulate non-volaltile memory */
 
+#ifndef GPNVM_SECTOR_SIZE
+#define GPNVM_SECTOR_SIZE                    512      /* Unit of file I/O and dirty tracking, must match the device logical block size for O_DIRECT */
+#endif
+
+#ifndef GPNVM_IO_BUFFER_SECTORS
+#define GPNVM_IO_BUFFER_SECTORS              1        /* Maximum number of sectors read or written by one file I/O, costs as many sectors of RAM */
+#endif
+#ifndef GPNVM_CACHE_RAM_BUDGET
+#define GPNVM_CACHE_RAM_BUDGET               0        /* RAM in bytes caching user attributes data, 0 keeps the whole user area in RAM */
+#endif
+
+#ifndef GPNVM_RAM_MINIMAL
+#define GPNVM_RAM_MINIMAL                    0        /* 1: only the index table is in RAM, 2: no table in RAM. Values and CRCs are read from the file */
+#endif
+
+#ifndef GPNVM_COUNTER_BITMAP_SIZE
+#define GPNVM_COUNTER_BITMAP_SIZE            8        /* Bytes of the unary bitmap of a counter attribute, erased every 8*size increments */
+#endif
+
+#ifndef GPNVM_VERSION_TOKENS
+#if GPNVM_RAM_MINIMAL > 0
+#define GPNVM_VERSION_TOKENS                 0        /* No version table by default in RAM minimal mode */
+#else
+#define GPNVM_VERSION_TOKENS                 1        /* 1: keep a version per attribute in RAM (1 KB) for gpNvm_CompareVersionAndSetAttribute */
+#endif
+#endif
+
+#ifndef GPNVM_MAX_SUBSCRIBERS
+#if GPNVM_RAM_MINIMAL > 0
+#define GPNVM_MAX_SUBSCRIBERS                0        /* No change subscription by default in RAM minimal mode */
+#else
+#define GPNVM_MAX_SUBSCRIBERS                4        /* Number of gpNvm_Subscribe subscribers, 0 removes the subscription API */
+#endif
+#endif
+
+#ifndef GPNVM_MAX_SNAPSHOTS
+#if (GPNVM_RAM_MINIMAL > 0) || (GPNVM_CACHE_RAM_BUDGET > 0)
+#define GPNVM_MAX_SNAPSHOTS                  0        /* No snapshot by default when the RAM is bounded */
+#else
+#define GPNVM_MAX_SNAPSHOTS                  2        /* Number of snapshots open at once, each costs about the user area size of RAM */
+#endif
+#endif
+
+#ifndef GPNVM_CHANGE_FEED_SIZE
+#if (GPNVM_RAM_MINIMAL > 0) || (GPNVM_CACHE_RAM_BUDGET > 0)
+#define GPNVM_CHANGE_FEED_SIZE               0        /* No change feed by default when the RAM is bounded */
+#else
+#define GPNVM_CHANGE_FEED_SIZE               1024     /* Bytes of RAM keeping the last changes for gpNvm_ChangeFeedRead, 0 removes the feed API */
+#endif
+#endif
+
+#ifndef GPNVM_MULTI_PROCESS
+#define GPNVM_MULTI_PROCESS                  0        /* 1: processes share the file, coherent through a shared memory state */
+#endif
+
+#ifndef GPNVM_COMPRESSION
+#define GPNVM_COMPRESSION                    0        /* 1: values are stored run-length encoded when it makes them shorter */
+#endif
+
+#ifndef GPNVM_DEDUP
+#define GPNVM_DEDUP                          0        /* 1: attributes set to the same value share one copy of it in the user area */
+#endif
+
+#ifndef GPNVM_ECC_INTERLEAVE
+#define GPNVM_ECC_INTERLEAVE                 0        /* Interleaved ECC codewords per attribute, each corrects one corrupted byte. 0: CRC detection only */
+#endif
+
+#ifndef GPNVM_MIRROR_COPIES
+#define GPNVM_MIRROR_COPIES                  0        /* Redundant copies of the file (<file>.1, <file>.2...) healing corrupted attributes */
+#endif
+#define GPNVM_SHM_NAME                       "/gpNvm" /* Prefix of the shared memory object of a file in the multi-process mode */
+
+/* Storage options, see gpNvm_SetStorageOptions */
+#define GPNVM_STORAGE_DIRECT                 0x01     /* Open the file with O_DIRECT to bypass the operating system page cache */
+#define GPNVM_STORAGE_READ_ONLY              0x02     /* Map the file read-only and read the attributes from the mapping, writes are rejected */
+
+/* Delta between two stores, see gpNvm_DiffCreate. Fields are in host byte order:
+ * [magic (4)][record count (2)] then per record [type (1)][attrId (1)][length (1)][value (length)], ids increasing,
+ * then a 32 bits FNV-1a digest of all the bytes before it */
+#define GPNVM_DELTA_MAGIC                    0x644E7067  /* "gpNd" in a little-endian delta */
+#define GPNVM_DELTA_HEADER_SIZE              6        /* Magic and record count */
+#define GPNVM_DELTA_SET                      0        /* Record setting a plain attribute to its value */
+#define GPNVM_DELTA_COUNTER                  1        /* Record setting a counter attribute, value is its UInt32 count */
+#define GPNVM_DELTA_DELETE                   2        /* Record deleting an attribute, without value */
+#define GPNVM_DELTA_MAX_SIZE                 (GPNVM_DELTA_HEADER_SIZE + 256*(3 + 255) + 4)   /* Largest delta, every attribute set */
+
+#ifndef GPNVM_SYNC_POLICY_DEFAULT
+#define GPNVM_SYNC_POLICY_DEFAULT            GPNVM_SYNC_ALWAYS   /* Sync policy used until gpNvm_SetSyncPolicy is called */
+#endif
+#ifndef GPNVM_SYNC_INTERVAL_MS
+#define GPNVM_SYNC_INTERVAL_MS               100      /* Default minimum time between two syncs for GPNVM_SYNC_PERIODIC */
+#endif
+
 enum gpNvm_ErrorStatus
 {
 	GPNVM_OK,                           /* Function result is OK */
@@ -34,7 +132,12 @@ enum gpNvm_ErrorStatus
 	GPNVM_ERROR_INVALID_ATTRIBUTE_ID,   /* Attribute id not found error */
 	GPNVM_ERROR_CORRUPTED_ATTRIBUTE,    /* Corrupted attribute data error */
     GPNVM_ERROR_MEMORY_FULL,            /* Memory full error */
-	GPNVM_ERROR_UNKNOWN                 /* Unknown error */
+	GPNVM_ERROR_UNKNOWN,                /* Unknown error */
+	GPNVM_ERROR_WRITING_FILE,           /* Error while writing or syncing the file error */
+	GPNVM_ERROR_READING_FILE,           /* Error while reading the file error */
+	GPNVM_ERROR_COMPARE_FAILED,         /* Attribute does not hold the expected value or version error */
+	GPNVM_ERROR_NO_CHANGE,              /* No change after the change feed cursor */
+	GPNVM_ERROR_FEED_GAP                /* Changes after the change feed cursor are no longer kept error */
 };
 
 /* ==================================================================== */
@@ -47,6 +150,80 @@ typedef unsigned char UInt8;
 typedef UInt8 gpNvm_AttrId;
 typedef UInt8 gpNvm_Result;
 
+/* When data written into the file emulating non-volatile memory is forced to the storage device */
+typedef enum
+{
+	GPNVM_SYNC_ALWAYS,                  /* fdatasync after each write: every successful set is durable */
+	GPNVM_SYNC_PERIODIC,                /* fdatasync at most once per interval, writes in between are batched */
+	GPNVM_SYNC_NONE                     /* fdatasync only on gpNvm_Sync and gpNvm_Uninit */
+} gpNvm_SyncPolicy;
+
+/* Counters of the user attributes data cache */
+typedef struct
+{
+	UInt32 hits;                        /* Accesses to a page already in RAM */
+	UInt32 misses;                      /* Accesses that had to read a page from the file */
+	UInt32 evictions;                   /* Pages dropped from RAM to load another page */
+	UInt32 writebacks;                  /* Dirty pages written into the file */
+	UInt32 syncs;                       /* Durability points, fdatasync of the file */
+} gpNvm_CacheStats;
+
+/* Space usage of the user attributes data area, see gpNvm_GetSpaceStats */
+typedef struct
+{
+	UInt32 userMemorySize;              /* Size of the user attributes data area */
+	UInt32 userMemoryEnd;               /* End of the last stored attribute, new attributes are added after it */
+	UInt32 usedBytes;                   /* Bytes of the stored attributes, length bytes included */
+	UInt32 holes;                       /* Unused ranges before userMemoryEnd, left by deleted attributes */
+	UInt32 holeBytes;                   /* Bytes of these ranges, reclaimed by gpNvm_Compact */
+	UInt32 largestHole;                 /* Size of the largest of these ranges */
+	UInt32 savedBytes;                  /* Bytes saved by storing values compressed (GPNVM_COMPRESSION) or shared (GPNVM_DEDUP) */
+	UInt16 attributes;                  /* Number of stored attributes */
+	UInt16 counters;                    /* Number of stored counter attributes */
+	UInt16 compressed;                  /* Number of attributes stored compressed */
+	UInt16 shared;                      /* Number of attributes sharing the stored value of another one */
+} gpNvm_SpaceStats;
+
+/* Summary of the attributes of a store, compared by gpNvm_DiffCreate to find the attributes that differ */
+typedef struct
+{
+	UInt8 present[256/8];               /* Bitmap of the stored attributes */
+	UInt32 digests[256];                /* Digest of the type, length and value of each stored attribute, 0 if it is corrupted */
+} gpNvm_Signature;
+
+/* Change of an attribute, see gpNvm_ChangeFeedRead */
+typedef struct
+{
+	UInt32 sequence;                    /* Sequence number of the change, consecutive in the feed */
+	gpNvm_AttrId attrId;                /* Attribute id */
+	UInt8 type;                         /* GPNVM_DELTA_SET, GPNVM_DELTA_COUNTER (value is the UInt32 count) or GPNVM_DELTA_DELETE */
+	UInt8 length;                       /* Length of the new value, 0 for a delete */
+	UInt8 value[255];                   /* New value */
+} gpNvm_Change;
+
+/* Position of a consumer in the change feed, see gpNvm_ChangeFeedStart */
+typedef struct
+{
+	UInt32 epoch;                       /* Feed the sequence belongs to, a new one is started by each gpNvm_Init */
+	UInt32 sequence;                    /* Sequence number of the next change to read */
+	UInt32 position;                    /* Offset of this change in the ring of the feed */
+	UInt32 wraps;                       /* Number of times the ring wrapped around before this change */
+} gpNvm_FeedCursor;
+
+/* Attribute given to the bulk load */
+typedef struct
+{
+	gpNvm_AttrId attrId;                /* Attribute id, attributes are loaded in increasing id order */
+	UInt8 length;                       /* Length of attribute data */
+	const UInt8* pValue;                /* Pointer to attribute data */
+} gpNvm_BulkEntry;
+
+/* Source of a bulk load stream: fills *pEntry with the next attribute and returns 1, or returns 0 at the end */
+typedef UInt8 (*gpNvm_BulkReader)(void* pContext, gpNvm_BulkEntry* pEntry);
+
+/* Called with the id of an attribute whose value changed, see gpNvm_Subscribe */
+typedef void (*gpNvm_ChangeCallback)(gpNvm_AttrId attrId, void* pContext);
+
 /* ==================================================================== */
 /* ======================= Functions prototypes ======================= */
 /* ==================================================================== */
@@ -64,6 +241,10 @@ typedef UInt8 gpNvm_Result;
  * Return value: gpNvm_Result: GPNVM_OK: the component is initialized successfully
  *                             GPNVM_ERROR_ALREADY_INITIALIZED: the component is already initialized
  *                             GPNVM_ERROR_OPENING_FILE: the is a problem when opening the file emulating the non-volatile memory
+ *                             GPNVM_ERROR_WRITING_FILE: the new or upgraded file could not be written or synced
+ *                             GPNVM_ERROR_READING_FILE: the file is not an image of this build (foreign, corrupted, truncated,
+ *                                                       newer format, other byte order or geometry), or read-only
+ *                                                       (GPNVM_STORAGE_READ_ONLY) and the image is incomplete or of an older format
  */
 gpNvm_Result gpNvm_Init(void);
 
@@ -72,12 +253,13 @@ gpNvm_Result gpNvm_Init(void);
  *
  * Description: Uninitialize non-volatile memory component. First this function
  * will check if the component is already unitiliazed. Then it will write cache into
- * the file emulating non-volatile memory.
+ * the file emulating non-volatile memory and sync it to the storage device.
  *
  * Parameters: None
  *
  * Return value: gpNvm_Result: GPNVM_OK: the component is uninitialized successfully
  *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced
  */
 gpNvm_Result gpNvm_Uninit(void);
 
@@ -88,6 +270,8 @@ gpNvm_Result gpNvm_Uninit(void);
  * This function check if the component is already initialized, if the provided arguments are valid, if the attribute
  * id is already stored in the non-volatile memory then check if the attribute data is corrupted or not by comparing
  * its stored crc by the calculated one. If data is sane, it will copy it into provided args.
+ * With GPNVM_ECC_INTERLEAVE, corrupted data is corrected when each codeword has at most one corrupted byte, otherwise
+ * with GPNVM_MIRROR_COPIES it is read from the first copy holding it sane. Either way it is repaired later.
  *
  * Parameters:
  *            gpNvm_AttrId attrId: attribute id
@@ -98,7 +282,8 @@ gpNvm_Result gpNvm_Uninit(void);
  *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
  *                             GPNVM_ERROR_INVALID_PARAMETERS: pointers provided as arguments to the function are not valid
  *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the provided attribute is not in non-volatile memory
- *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: attribute data are corrupted
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: attribute data are corrupted beyond correction, in every copy
+ *                             GPNVM_ERROR_READING_FILE: attribute data could not be read from the file (bounded cache)
  */
 gpNvm_Result gpNvm_GetAttribute(gpNvm_AttrId attrId, UInt8* pLength, UInt8* pValue);
 
@@ -110,6 +295,11 @@ gpNvm_Result gpNvm_GetAttribute(gpNvm_AttrId attrId, UInt8* pLength, UInt8* pVal
  * calculates its crc and offset in the user non-volatile memory, update cache then write the cache into the file in case
  * the attributes is already stored. If not, it checks if there is still place to store a new attribute there. Then it
  * calculates its crc and offset in the user non-volatile memory, update cache then write the cache into the file.
+ * With GPNVM_COMPRESSION, the value is stored run-length encoded when it is shorter so. An attribute keeps the length it
+ * was created with, but its compressed size changes with its value: when it grows the attribute is moved after the
+ * last one, leaving a hole reclaimed by gpNvm_Compact.
+ * With GPNVM_DEDUP, an attribute set to the value of another one shares its copy instead of storing its own. Updating
+ * it gives it its own copy again, the shared one stays with the other attributes.
  *
  * Parameters:
  *            gpNvm_AttrId attrId: attribute id
@@ -121,7 +311,520 @@ gpNvm_Result gpNvm_GetAttribute(gpNvm_AttrId attrId, UInt8* pLength, UInt8* pVal
  *                             GPNVM_ERROR_INVALID_PARAMETERS: pointers provided as arguments to the function are not valid
  *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the provided attribute is not in non-volatile memory
  *                             GPNVM_ERROR_MEMORY_FULL: Memory is full
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced, or the component is read-only
  */
 gpNvm_Result gpNvm_SetAttribute(gpNvm_AttrId attrId, UInt8 length, UInt8* pValue);
 
+/*
+ * Name: gpNvm_CompareAndSetAttribute
+ *
+ * Description: Set attribute data only if the attribute still holds an expected value. The comparison and the update
+ * are done atomically against the other threads of the process using the component, so concurrent updaters can do an
+ * optimistic read-modify-write: read with gpNvm_GetAttribute, compute, then retry from the read on
+ * GPNVM_ERROR_COMPARE_FAILED. As with gpNvm_SetAttribute, a stored attribute keeps its length.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8 expectedLength: length of the expected value
+ *            const UInt8* pExpected: expected value, NULL to expect the attribute not to be stored yet
+ *            UInt8 newLength: length of the new value
+ *            UInt8* pNewValue: pointer to the new value
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the attribute held the expected value and the new one is written successfully
+ *                             GPNVM_ERROR_COMPARE_FAILED: the attribute does not hold the expected value, nothing is written
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: invalid pointers, or a new length different from the stored one
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: the stored value is corrupted
+ *                             GPNVM_ERROR_MEMORY_FULL: Memory is full
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced, or the component is read-only
+ */
+gpNvm_Result gpNvm_CompareAndSetAttribute(gpNvm_AttrId attrId, UInt8 expectedLength, const UInt8* pExpected, UInt8 newLength, UInt8* pNewValue);
+
+#if GPNVM_VERSION_TOKENS
+/*
+ * Name: gpNvm_GetAttributeWithVersion
+ *
+ * Description: Get attribute data and its version token. The token changes each time the attribute value changes,
+ * it is kept in RAM and restarts from 0 at gpNvm_Init. For an attribute not stored, GPNVM_ERROR_INVALID_ATTRIBUTE_ID
+ * is returned but the token is still set, so the attribute can be created with gpNvm_CompareVersionAndSetAttribute.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8* pLength: pointer to a variable that will store the length of attribute data
+ *            UInt8* pValue: pointer to store attribute data
+ *            UInt32* pVersion: pointer to store the version token
+ *
+ * Return value: gpNvm_Result: same as gpNvm_GetAttribute
+ */
+gpNvm_Result gpNvm_GetAttributeWithVersion(gpNvm_AttrId attrId, UInt8* pLength, UInt8* pValue, UInt32* pVersion);
+
+/*
+ * Name: gpNvm_CompareVersionAndSetAttribute
+ *
+ * Description: Set attribute data only if the attribute did not change since its version token was read with
+ * gpNvm_GetAttributeWithVersion. Unlike gpNvm_CompareAndSetAttribute the caller does not keep the old value.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt32 expectedVersion: version token read with the value
+ *            UInt8 newLength: length of the new value
+ *            UInt8* pNewValue: pointer to the new value
+ *            UInt32* pNewVersion: pointer to store the current version token, can be NULL
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the version matched and the new value is written successfully
+ *                             GPNVM_ERROR_COMPARE_FAILED: the attribute changed since the token was read, nothing is written
+ *                             other errors: same as gpNvm_SetAttribute
+ */
+gpNvm_Result gpNvm_CompareVersionAndSetAttribute(gpNvm_AttrId attrId, UInt32 expectedVersion, UInt8 newLength, UInt8* pNewValue, UInt32* pNewVersion);
+
+/*
+ * Name: gpNvm_GetAttributeVersion
+ *
+ * Description: Get the version token of an attribute without reading its value. The token only changes when the
+ * value really changes (setting an identical value keeps it), so a consumer can poll it to detect changes.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt32* pVersion: pointer to store the version token
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the version is read successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ */
+gpNvm_Result gpNvm_GetAttributeVersion(gpNvm_AttrId attrId, UInt32* pVersion);
+#endif
+
+/*
+ * Name: gpNvm_GetStoreVersion
+ *
+ * Description: Get the version of the whole store, incremented each time any attribute value changes. It is
+ * available whatever GPNVM_VERSION_TOKENS and restarts from 0 at gpNvm_Init.
+ *
+ * Parameters:
+ *            UInt32* pVersion: pointer to store the store version
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the version is read successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ */
+gpNvm_Result gpNvm_GetStoreVersion(UInt32* pVersion);
+
+#if GPNVM_MAX_SUBSCRIBERS > 0
+/*
+ * Name: gpNvm_Subscribe
+ *
+ * Description: Subscribe to the changes of a range of attributes. When a set, compare-and-set, counter increment or bulk
+ * load really changes an attribute of the range, the callback is called with its id and/or the eventfd (created by the
+ * caller with eventfd(2)) is written once. Notifications are sent by the thread that made the change, after it released
+ * the component lock, so the callback can call the API. Setting an identical value notifies nobody.
+ *
+ * Parameters:
+ *            gpNvm_AttrId firstAttrId: first attribute id of the range
+ *            gpNvm_AttrId lastAttrId: last attribute id of the range, included
+ *            gpNvm_ChangeCallback callback: function called for each changed attribute, can be NULL
+ *            void* pContext: context passed to the callback
+ *            int eventFd: eventfd to wake up, -1 for none
+ *            UInt8* pHandle: pointer to store the subscription handle
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the subscription is registered successfully
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: invalid range or pointer, or neither callback nor eventfd
+ *                             GPNVM_ERROR_MEMORY_FULL: GPNVM_MAX_SUBSCRIBERS subscriptions are already registered
+ */
+gpNvm_Result gpNvm_Subscribe(gpNvm_AttrId firstAttrId, gpNvm_AttrId lastAttrId, gpNvm_ChangeCallback callback, void* pContext, int eventFd, UInt8* pHandle);
+
+/*
+ * Name: gpNvm_Unsubscribe
+ *
+ * Description: Remove a subscription registered with gpNvm_Subscribe.
+ *
+ * Parameters:
+ *            UInt8 handle: subscription handle
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the subscription is removed successfully
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the handle is not registered
+ */
+gpNvm_Result gpNvm_Unsubscribe(UInt8 handle);
+#endif
+
+#if GPNVM_CHANGE_FEED_SIZE > 0
+/*
+ * Name: gpNvm_ChangeFeedStart
+ *
+ * Description: Get a cursor on the end of the change feed, e.g. before a consumer scans the whole store, so the changes
+ * made during the scan are read from the feed afterwards.
+ *
+ * Parameters:
+ *            gpNvm_FeedCursor* pCursor: pointer to store the cursor
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the cursor is set successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ */
+gpNvm_Result gpNvm_ChangeFeedStart(gpNvm_FeedCursor* pCursor);
+
+/*
+ * Name: gpNvm_ChangeFeedRead
+ *
+ * Description: Read the change following a cursor and advance the cursor. Every effective change of an attribute (set
+ * to another value, counter increment, delete, including the ones made by gpNvm_BulkLoad and gpNvm_DeltaApply) is in
+ * the feed, in the order the changes were made, with the value the attribute had at the end of the API call that changed
+ * it. The feed keeps the last GPNVM_CHANGE_FEED_SIZE bytes of changes and writers never wait for consumers: a consumer
+ * that fell behind, or holds a cursor of a previous gpNvm_Init, gets a gap and must scan the store again. A consumer
+ * can wait for changes with gpNvm_Subscribe.
+ *
+ * Parameters:
+ *            gpNvm_FeedCursor* pCursor: cursor, moved after the change read, or to the oldest change kept after a gap
+ *            gpNvm_Change* pChange: pointer to store the change
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the change is read successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: invalid pointers
+ *                             GPNVM_ERROR_NO_CHANGE: no change after the cursor yet
+ *                             GPNVM_ERROR_FEED_GAP: changes after the cursor were dropped, the cursor is moved to the oldest
+ *                                                   change kept
+ */
+gpNvm_Result gpNvm_ChangeFeedRead(gpNvm_FeedCursor* pCursor, gpNvm_Change* pChange);
+#endif
+
+#if GPNVM_MAX_SNAPSHOTS > 0
+/*
+ * Name: gpNvm_SnapshotOpen
+ *
+ * Description: Open a consistent point-in-time view of all the attributes. Reads through the snapshot do not see
+ * the changes made after it was opened, and a gpNvm_BulkLoad is seen entirely or not at all. Writers are not blocked,
+ * they save the old value of the attributes they change while the snapshot is open.
+ *
+ * Parameters:
+ *            UInt8* pHandle: pointer to store the snapshot handle
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the snapshot is opened successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ *                             GPNVM_ERROR_MEMORY_FULL: GPNVM_MAX_SNAPSHOTS snapshots are already open
+ *                             GPNVM_ERROR_WRITING_FILE: the component is read-only (GPNVM_STORAGE_READ_ONLY)
+ */
+gpNvm_Result gpNvm_SnapshotOpen(UInt8* pHandle);
+
+/*
+ * Name: gpNvm_SnapshotGet
+ *
+ * Description: Get attribute data as it was when the snapshot was opened.
+ *
+ * Parameters:
+ *            UInt8 handle: snapshot handle
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8* pLength: pointer to a variable that will store the length of attribute data
+ *            UInt8* pValue: pointer to store attribute data
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: attribute data is read successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: invalid pointers or snapshot handle
+ *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the attribute was not stored when the snapshot was opened
+ *                             GPNVM_ERROR_MEMORY_FULL: the old values of the attributes changed since do not fit in the
+ *                                                      snapshot (GPNVM_COMPRESSION or GPNVM_DEDUP), it must be
+ *                                                      closed
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: attribute data are corrupted
+ *                             GPNVM_ERROR_READING_FILE: attribute data could not be read from the file
+ */
+gpNvm_Result gpNvm_SnapshotGet(UInt8 handle, gpNvm_AttrId attrId, UInt8* pLength, UInt8* pValue);
+
+/*
+ * Name: gpNvm_SnapshotClose
+ *
+ * Description: Close a snapshot opened with gpNvm_SnapshotOpen.
+ *
+ * Parameters:
+ *            UInt8 handle: snapshot handle
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the snapshot is closed successfully
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the handle is not an open snapshot
+ */
+gpNvm_Result gpNvm_SnapshotClose(UInt8 handle);
+#endif
+
+/*
+ * Name: gpNvm_CounterIncrement
+ *
+ * Description: Increment a counter attribute, creating it with value 1 if it is not stored. The counter is encoded so that
+ * an increment only clears one bit of the file, the counter being rewritten once every 8*GPNVM_COUNTER_BITMAP_SIZE
+ * increments. The write follows the sync policy as gpNvm_SetAttribute.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: counter attribute id
+ *            UInt32* pValue: pointer to store the counter value after the increment, can be NULL
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the counter is incremented successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the attribute is stored but is not a counter
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: the stored counter is corrupted
+ *                             GPNVM_ERROR_MEMORY_FULL: Memory is full
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced, or the component is read-only
+ */
+gpNvm_Result gpNvm_CounterIncrement(gpNvm_AttrId attrId, UInt32* pValue);
+
+/*
+ * Name: gpNvm_CounterRead
+ *
+ * Description: Read a counter attribute.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: counter attribute id
+ *            UInt32* pValue: pointer to store the counter value
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the counter is read successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: invalid pointer, or the attribute is not a counter
+ *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the counter is not stored
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: the stored counter is corrupted
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ */
+gpNvm_Result gpNvm_CounterRead(gpNvm_AttrId attrId, UInt32* pValue);
+
+/*
+ * Name: gpNvm_BulkLoad
+ *
+ * Description: Set many attributes at once, e.g. to provision a new image. The attributes are laid out in cache
+ * one after the other as gpNvm_SetAttribute does, then the file is written once and synced once. Attributes already
+ * stored are updated, with the same length. If an attribute is rejected, the attributes before it are stored.
+ *
+ * Parameters:
+ *            const gpNvm_BulkEntry* pEntries: attributes sorted by increasing id
+ *            UInt16 count: number of attributes
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: all attributes are written successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: invalid pointers, ids not in increasing order, or an
+ *                                                             attribute already stored with another length
+ *                             GPNVM_ERROR_MEMORY_FULL: Memory is full
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced, or the component is read-only
+ */
+gpNvm_Result gpNvm_BulkLoad(const gpNvm_BulkEntry* pEntries, UInt16 count);
+
+/*
+ * Name: gpNvm_BulkLoadStream
+ *
+ * Description: Same as gpNvm_BulkLoad for attributes delivered one by one by a reader, e.g. parsed from a
+ * provisioning file, so they do not have to be held in RAM together.
+ *
+ * Parameters:
+ *            gpNvm_BulkReader reader: function giving the next attribute in increasing id order
+ *            void* pContext: argument given to the reader
+ *
+ * Return value: gpNvm_Result: same as gpNvm_BulkLoad
+ */
+gpNvm_Result gpNvm_BulkLoadStream(gpNvm_BulkReader reader, void* pContext);
+
+/*
+ * Name: gpNvm_DeleteAttribute
+ *
+ * Description: Remove an attribute, plain or counter, from the non-volatile memory. The space it used is reclaimed by
+ * gpNvm_Compact, once no other attribute shares its value (GPNVM_DEDUP).
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the attribute is deleted successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the attribute is not in non-volatile memory
+ *                             GPNVM_ERROR_READING_FILE: the index entry could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced, or the component is read-only
+ */
+gpNvm_Result gpNvm_DeleteAttribute(gpNvm_AttrId attrId);
+
+/*
+ * Name: gpNvm_Compact
+ *
+ * Description: Move the stored attributes next to each other to reclaim the space of the deleted ones. The moves are
+ * synced once at the end, so it is meant for maintenance with a copy of the file kept until it succeeds.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the user attributes data area is compacted successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_READING_FILE: an attribute could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced, or the component is read-only
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: an attribute ends out of the user attributes data area, nothing is moved
+ */
+gpNvm_Result gpNvm_Compact(void);
+
+/*
+ * Name: gpNvm_ListAttributes
+ *
+ * Description: List the ids of the stored attributes, in increasing id order.
+ *
+ * Parameters:
+ *            gpNvm_AttrId* pIds: pointer to store the ids, 256 entries
+ *            UInt16* pCount: pointer to store the number of stored attributes
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the attributes are listed successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: a pointer provided as argument is not valid
+ *                             GPNVM_ERROR_READING_FILE: an index entry could not be read from the file
+ */
+gpNvm_Result gpNvm_ListAttributes(gpNvm_AttrId* pIds, UInt16* pCount);
+
+/*
+ * Name: gpNvm_GetSpaceStats
+ *
+ * Description: Get the space usage of the user attributes data area and its fragmentation by deleted attributes.
+ *
+ * Parameters:
+ *            gpNvm_SpaceStats* pStats: pointer to store the space usage
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the space usage is read successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ *                             GPNVM_ERROR_READING_FILE: an attribute could not be read from the file
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: an attribute ends out of the user attributes data area
+ */
+gpNvm_Result gpNvm_GetSpaceStats(gpNvm_SpaceStats* pStats);
+
+/*
+ * Name: gpNvm_GetSignature
+ *
+ * Description: Summarize the stored attributes with one digest each, e.g. on a mirror sending it to the store it
+ * follows. A corrupted attribute gets the digest 0, so the next delta rewrites it.
+ *
+ * Parameters:
+ *            gpNvm_Signature* pSignature: pointer to store the signature
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the signature is computed successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ *                             GPNVM_ERROR_READING_FILE: an attribute could not be read from the file
+ */
+gpNvm_Result gpNvm_GetSignature(gpNvm_Signature* pSignature);
+
+/*
+ * Name: gpNvm_DiffCreate
+ *
+ * Description: Build the delta turning a store with the given signature into this one: a record for each attribute
+ * whose digest differs or that is missing there, and a delete record for each attribute only stored there. Unchanged
+ * attributes are skipped, so two identical stores give an empty delta. See GPNVM_DELTA_MAGIC for the format.
+ *
+ * Parameters:
+ *            const gpNvm_Signature* pBase: signature of the other store, NULL for an empty store
+ *            UInt8* pDelta: buffer to store the delta, NULL to only compute its length
+ *            UInt32 size: size of the buffer, GPNVM_DELTA_MAX_SIZE is always enough
+ *            UInt32* pLength: pointer to store the length of the delta
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the delta is built successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: invalid pointer, or the buffer is too small
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: an attribute to send is corrupted
+ *                             GPNVM_ERROR_READING_FILE: an attribute could not be read from the file
+ */
+gpNvm_Result gpNvm_DiffCreate(const gpNvm_Signature* pBase, UInt8* pDelta, UInt32 size, UInt32* pLength);
+
+/*
+ * Name: gpNvm_DeltaApply
+ *
+ * Description: Apply a delta built by gpNvm_DiffCreate, as one update: the delta and the space it needs are checked
+ * before anything changes, other threads and snapshots see all of it or none of it, and the file is written and synced
+ * once. An attribute whose length or type changed is replaced. Records hold whole values, so applying a delta again,
+ * e.g. after a crash, completes it.
+ *
+ * Parameters:
+ *            const UInt8* pDelta: delta
+ *            UInt32 length: length of the delta
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the delta is applied successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: invalid pointer, or the delta is malformed or corrupted
+ *                             GPNVM_ERROR_MEMORY_FULL: the new attributes do not fit, nothing is changed
+ *                             GPNVM_ERROR_READING_FILE: the file could not be read
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced, or the component is read-only
+ */
+gpNvm_Result gpNvm_DeltaApply(const UInt8* pDelta, UInt32 length);
+
+/*
+ * Name: gpNvm_GetCacheStats
+ *
+ * Description: Get the hit and miss counters of the user attributes data cache since gpNvm_Init.
+ * When the whole user area is in RAM (GPNVM_CACHE_RAM_BUDGET is 0) every access is a hit.
+ *
+ * Parameters:
+ *            gpNvm_CacheStats* pStats: pointer to store the counters
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: counters are read successfully
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ */
+gpNvm_Result gpNvm_GetCacheStats(gpNvm_CacheStats* pStats);
+
+/*
+ * Name: gpNvm_GetRamFootprint
+ *
+ * Description: Get the static RAM used by the component in the configuration it is built with
+ * (GPNVM_MEMORY_SIZE, GPNVM_CACHE_RAM_BUDGET, GPNVM_RAM_MINIMAL, GPNVM_SECTOR_SIZE).
+ *
+ * Parameters: None
+ *
+ * Return value: UInt32: RAM footprint in bytes
+ */
+UInt32 gpNvm_GetRamFootprint(void);
+
+/*
+ * Name: gpNvm_SetSyncPolicy
+ *
+ * Description: Select when data written into the file emulating non-volatile memory is forced to the
+ * storage device. It can be called before or after gpNvm_Init.
+ *
+ * Parameters:
+ *            gpNvm_SyncPolicy policy: GPNVM_SYNC_ALWAYS, GPNVM_SYNC_PERIODIC or GPNVM_SYNC_NONE
+ *            UInt32 intervalMs: minimum time between two syncs, only used by GPNVM_SYNC_PERIODIC
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the policy is set successfully
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: unknown policy
+ */
+gpNvm_Result gpNvm_SetSyncPolicy(gpNvm_SyncPolicy policy, UInt32 intervalMs);
+
+/*
+ * Name: gpNvm_SetStorageOptions
+ *
+ * Description: Select how the file emulating non-volatile memory is accessed. Options are applied when
+ * the file is opened, so this function must be called before gpNvm_Init.
+ * With GPNVM_STORAGE_READ_ONLY, gpNvm_Init maps the existing file instead of loading it: nothing is copied into RAM
+ * and no lock is shared with the writers, so many short-lived reader processes open it cheaply and see the attributes
+ * as last written into the file. The API calls changing attributes and gpNvm_SnapshotOpen return GPNVM_ERROR_WRITING_FILE.
+ *
+ * Parameters:
+ *            UInt8 options: combination of GPNVM_STORAGE_xxx flags, 0 for the default buffered access
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the options are set successfully
+ *                             GPNVM_ERROR_ALREADY_INITIALIZED: the component is already initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: unknown option
+ */
+gpNvm_Result gpNvm_SetStorageOptions(UInt8 options);
+
+/*
+ * Name: gpNvm_SetFileName
+ *
+ * Description: Select the file emulating non-volatile memory instead of GPNVM_FILE_NAME. It must be called before gpNvm_Init.
+ *
+ * Parameters:
+ *            const char* pFileName: path of the file, it must stay valid until it is changed
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the file name is set successfully
+ *                             GPNVM_ERROR_ALREADY_INITIALIZED: the component is already initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ */
+gpNvm_Result gpNvm_SetFileName(const char* pFileName);
+
+/*
+ * Name: gpNvm_Sync
+ *
+ * Description: Explicit durability point. All the attributes set before this call are on the storage
+ * device when it returns, whatever the sync policy is.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the file is synced successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the component is not initialized
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be synced
+ */
+gpNvm_Result gpNvm_Sync(void);
+
 #endif //_GPNVM_H_
@@ -0,0 +1,642 @@
+/*
+ * File gpNvmClient.c
+ *
+ * Client library of the gpNvm daemon (gpnvmd).
+ *
+ */
+
+/* ==================================================================== */
+/* ========================== Include files =========================== */
+/* ==================================================================== */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "gpNvmClient.h"
+
+/* ==================================================================== */
+/* ====================== Macros and constants  ======================= */
+/* ==================================================================== */
+
+#if GPNVM_CLIENT_PIPELINE_DEPTH > GPNVM_DAEMON_RING_SLOTS
+#error "GPNVM_CLIENT_PIPELINE_DEPTH requests must fit in the slots of a ring"
+#endif
+
+#define GPNVM_CLIENT_RING_TIMEOUT_MS         100      /* Sleep on the response ring before checking that the daemon is alive */
+
+/* ==================================================================== */
+/* ========================= Global variables ========================= */
+/* ==================================================================== */
+
+/* Serializes the requests of the threads of the process: a request and its responses are never interleaved with
+ * another one on the socket, and the process stays the single producer of the request ring */
+static pthread_mutex_t gpNvmClient_Mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Connection to the daemon, -1 if not connected */
+static int gpNvmClient_Fd = -1;
+
+/* Shared memory rings of the daemon, NULL if the ring of the connection is not attached */
+static gpNvmDaemon_Rings* gpNvmClient_Rings = NULL;
+
+/* Channel of the connection in gpNvmClient_Rings */
+static gpNvmDaemon_Channel* gpNvmClient_Channel = NULL;
+
+/* Polls of the response ring before sleeping, 0 on a single CPU where polling only delays the daemon */
+static UInt32 gpNvmClient_RingSpin = GPNVM_DAEMON_RING_SPIN;
+
+/* ==================================================================== */
+/* ======================= Functions Definition ======================= */
+/* ==================================================================== */
+
+/*
+ * Name: gpNvmClient_SendSocket
+ *
+ * Description: Send a buffer to the daemon over the socket.
+ *
+ * Parameters:
+ *            const UInt8* pData: bytes to send
+ *            UInt16 length: number of bytes
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: all the bytes are sent
+ *                             GPNVM_ERROR_WRITING_FILE: the connection failed
+ */
+static gpNvm_Result gpNvmClient_SendSocket(const UInt8* pData, UInt16 length)
+{
+	ssize_t sent;
+
+	while(length > 0)
+	{
+		sent = send(gpNvmClient_Fd, pData, length, MSG_NOSIGNAL);
+
+		if(sent < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			return GPNVM_ERROR_WRITING_FILE;
+		}
+		pData += sent;
+		length -= (UInt16)sent;
+	}
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvmClient_ReceiveSocket
+ *
+ * Description: Receive the next response of the daemon from the socket.
+ *
+ * Parameters:
+ *            UInt8* pLength: pointer to store the length of the value, may be NULL if no value is expected
+ *            UInt8* pValue: pointer to store the value (up to 255 bytes), may be NULL if no value is expected
+ *
+ * Return value: gpNvm_Result: result of the request, or GPNVM_ERROR_READING_FILE if the response could not be received
+ */
+static gpNvm_Result gpNvmClient_ReceiveSocket(UInt8* pLength, UInt8* pValue)
+{
+	UInt8 response[GPNVM_DAEMON_MAX_RESPONSE];
+	UInt16 expected = GPNVM_DAEMON_HEADER_SIZE;
+	UInt16 received = 0;
+	ssize_t length;
+
+	while(received < expected)
+	{
+		length = recv(gpNvmClient_Fd, &response[received], expected - received, 0);
+
+		if(length <= 0)
+		{
+			if((length < 0) && (errno == EINTR))
+			{
+				continue;
+			}
+			return GPNVM_ERROR_READING_FILE;
+		}
+		received += (UInt16)length;
+
+		if(received == GPNVM_DAEMON_HEADER_SIZE)
+		{
+			expected += response[2];
+		}
+	}
+
+	if(pLength != NULL)
+	{
+		*pLength = response[2];
+	}
+
+	if(pValue != NULL)
+	{
+		memcpy(pValue, &response[GPNVM_DAEMON_HEADER_SIZE], response[2]);
+	}
+	return response[1];
+}
+
+/*
+ * Name: gpNvmClient_DaemonGone
+ *
+ * Description: Check whether the daemon closed the connection. It never sends anything while requests are on the ring,
+ * so a readable socket means that it is closed.
+ *
+ * Parameters: None
+ *
+ * Return value: UInt8: 1 if the daemon is gone, 0 otherwise
+ */
+static UInt8 gpNvmClient_DaemonGone(void)
+{
+	struct pollfd fds = {gpNvmClient_Fd, POLLIN, 0};
+
+	return ((poll(&fds, 1, 0) != 0) && (fds.revents != 0)) ? 1 : 0;
+}
+
+/*
+ * Name: gpNvmClient_SendRing
+ *
+ * Description: Publish requests on the request ring, one frame per slot, then ring the doorbell of the daemon.
+ * The futex is only woken up if the daemon sleeps on it.
+ *
+ * Parameters:
+ *            const UInt8* pData: GPNVM_DAEMON_OP_GET, GPNVM_DAEMON_OP_SET or GPNVM_DAEMON_OP_SYNC requests, at most
+ *                                GPNVM_DAEMON_RING_SLOTS
+ *            UInt16 length: number of bytes
+ *
+ * Return value: gpNvm_Result: GPNVM_OK
+ */
+static gpNvm_Result gpNvmClient_SendRing(const UInt8* pData, UInt16 length)
+{
+	gpNvmDaemon_Ring* pRing = &gpNvmClient_Channel->requests;
+	UInt32 head = pRing->head;
+	UInt16 frameLength;
+
+	for(UInt16 offset = 0; offset < length; offset += frameLength, head++)
+	{
+		frameLength = GPNVM_DAEMON_HEADER_SIZE + ((pData[offset] == GPNVM_DAEMON_OP_SET) ? pData[offset + 2] : 0);
+		memcpy(pRing->slots[head % GPNVM_DAEMON_RING_SLOTS], &pData[offset], frameLength);
+	}
+	__atomic_store_n(&pRing->head, head, __ATOMIC_RELEASE);
+	__atomic_fetch_add(&gpNvmClient_Rings->doorbell, 1, __ATOMIC_SEQ_CST);
+
+	if(__atomic_load_n(&gpNvmClient_Rings->waiting, __ATOMIC_SEQ_CST) != 0)
+	{
+		gpNvmDaemon_FutexWake(&gpNvmClient_Rings->doorbell);
+	}
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvmClient_ReceiveRing
+ *
+ * Description: Receive the next response of the daemon from the response ring. The ring is polled GPNVM_DAEMON_RING_SPIN
+ * times on a multi-CPU machine, then the client sleeps on its head until the daemon publishes the response.
+ *
+ * Parameters:
+ *            UInt8* pLength: pointer to store the length of the value, may be NULL if no value is expected
+ *            UInt8* pValue: pointer to store the value (up to 255 bytes), may be NULL if no value is expected
+ *
+ * Return value: gpNvm_Result: result of the request, or GPNVM_ERROR_READING_FILE if the daemon is gone
+ */
+static gpNvm_Result gpNvmClient_ReceiveRing(UInt8* pLength, UInt8* pValue)
+{
+	gpNvmDaemon_Ring* pRing = &gpNvmClient_Channel->responses;
+	UInt32 tail = pRing->tail;
+	UInt32 spins = 0;
+	UInt8* pResponse;
+	gpNvm_Result result;
+
+	while(__atomic_load_n(&pRing->head, __ATOMIC_ACQUIRE) == tail)
+	{
+		if(spins++ < gpNvmClient_RingSpin)
+		{
+			continue;
+		}
+		//Set the flag then check head, the daemon publishes head then checks the flag: one of them sees the other
+		__atomic_store_n(&pRing->waiting, 1, __ATOMIC_SEQ_CST);
+
+		if(__atomic_load_n(&pRing->head, __ATOMIC_SEQ_CST) == tail)
+		{
+			gpNvmDaemon_FutexWait(&pRing->head, tail, GPNVM_CLIENT_RING_TIMEOUT_MS);
+		}
+		__atomic_store_n(&pRing->waiting, 0, __ATOMIC_SEQ_CST);
+
+		if((__atomic_load_n(&pRing->head, __ATOMIC_ACQUIRE) == tail) && (gpNvmClient_DaemonGone() != 0))
+		{
+			return GPNVM_ERROR_READING_FILE;
+		}
+	}
+	pResponse = pRing->slots[tail % GPNVM_DAEMON_RING_SLOTS];
+
+	if(pLength != NULL)
+	{
+		*pLength = pResponse[2];
+	}
+
+	if(pValue != NULL)
+	{
+		memcpy(pValue, &pResponse[GPNVM_DAEMON_HEADER_SIZE], pResponse[2]);
+	}
+	result = pResponse[1];
+	__atomic_store_n(&pRing->tail, tail + 1, __ATOMIC_RELEASE);
+	return result;
+}
+
+/*
+ * Name: gpNvmClient_Send
+ *
+ * Description: Send requests to the daemon, on the ring if it is attached, on the socket otherwise.
+ *
+ * Parameters:
+ *            const UInt8* pData: requests, at most GPNVM_CLIENT_PIPELINE_DEPTH
+ *            UInt16 length: number of bytes
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: all the bytes are sent
+ *                             GPNVM_ERROR_WRITING_FILE: the connection failed
+ */
+static gpNvm_Result gpNvmClient_Send(const UInt8* pData, UInt16 length)
+{
+	return (gpNvmClient_Channel != NULL) ? gpNvmClient_SendRing(pData, length) : gpNvmClient_SendSocket(pData, length);
+}
+
+/*
+ * Name: gpNvmClient_Receive
+ *
+ * Description: Receive the next response of the daemon, from the ring if it is attached, from the socket otherwise.
+ *
+ * Parameters:
+ *            UInt8* pLength: pointer to store the length of the value, may be NULL if no value is expected
+ *            UInt8* pValue: pointer to store the value (up to 255 bytes), may be NULL if no value is expected
+ *
+ * Return value: gpNvm_Result: result of the request, or GPNVM_ERROR_READING_FILE if the response could not be received
+ */
+static gpNvm_Result gpNvmClient_Receive(UInt8* pLength, UInt8* pValue)
+{
+	return (gpNvmClient_Channel != NULL) ? gpNvmClient_ReceiveRing(pLength, pValue) : gpNvmClient_ReceiveSocket(pLength, pValue);
+}
+
+/*
+ * Name: gpNvmClient_Connect
+ *
+ * Description: Connect the process to the daemon.
+ *
+ * Parameters:
+ *            const char* pSocketPath: path of the Unix socket of the daemon
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the process is connected
+ *                             GPNVM_ERROR_ALREADY_INITIALIZED: the process is already connected
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ *                             GPNVM_ERROR_OPENING_FILE: the daemon cannot be reached
+ */
+gpNvm_Result gpNvmClient_Connect(const char* pSocketPath)
+{
+	struct sockaddr_un address;
+	gpNvm_Result result = GPNVM_OK;
+
+	if((pSocketPath == NULL) || (strlen(pSocketPath) >= sizeof(address.sun_path)))
+	{
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, pSocketPath);
+	pthread_mutex_lock(&gpNvmClient_Mutex);
+
+	if(gpNvmClient_Fd >= 0)
+	{
+		pthread_mutex_unlock(&gpNvmClient_Mutex);
+		return GPNVM_ERROR_ALREADY_INITIALIZED;
+	}
+	gpNvmClient_Fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if((gpNvmClient_Fd >= 0) && (connect(gpNvmClient_Fd, (struct sockaddr*)&address, sizeof(address)) != 0))
+	{
+		close(gpNvmClient_Fd);
+		gpNvmClient_Fd = -1;
+	}
+
+	if(gpNvmClient_Fd < 0)
+	{
+		result = GPNVM_ERROR_OPENING_FILE;
+	}
+	pthread_mutex_unlock(&gpNvmClient_Mutex);
+	return result;
+}
+
+/*
+ * Name: gpNvmClient_Disconnect
+ *
+ * Description: Close the connection to the daemon.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the connection is closed
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the process is not connected
+ */
+gpNvm_Result gpNvmClient_Disconnect(void)
+{
+	pthread_mutex_lock(&gpNvmClient_Mutex);
+
+	if(gpNvmClient_Fd < 0)
+	{
+		pthread_mutex_unlock(&gpNvmClient_Mutex);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(gpNvmClient_Rings != NULL)
+	{
+		munmap(gpNvmClient_Rings, sizeof(gpNvmDaemon_Rings));
+		gpNvmClient_Rings = NULL;
+		gpNvmClient_Channel = NULL;
+	}
+	//The daemon frees the channel when the socket is closed
+	close(gpNvmClient_Fd);
+	gpNvmClient_Fd = -1;
+	pthread_mutex_unlock(&gpNvmClient_Mutex);
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvmClient_MapRing
+ *
+ * Description: Ask the daemon for the channel of the connection and map its shared memory rings. Called with
+ * gpNvmClient_Mutex held.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: same as gpNvmClient_AttachRing
+ */
+static gpNvm_Result gpNvmClient_MapRing(void)
+{
+	UInt8 request[GPNVM_DAEMON_HEADER_SIZE] = {GPNVM_DAEMON_OP_ATTACH_RING, 0, 0};
+	UInt8 response[255];
+	char name[255];
+	gpNvm_Result result;
+	UInt8 length = 0;
+	int fd;
+
+	if(gpNvmClient_Fd < 0)
+	{
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(gpNvmClient_Rings != NULL)
+	{
+		return GPNVM_ERROR_ALREADY_INITIALIZED;
+	}
+	result = gpNvmClient_SendSocket(request, sizeof(request));
+	result = (result == GPNVM_OK) ? gpNvmClient_ReceiveSocket(&length, response) : result;
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+
+	//[channel][shared memory name]
+	if((length < 2) || (response[0] >= GPNVM_DAEMON_MAX_CLIENTS))
+	{
+		return GPNVM_ERROR_READING_FILE;
+	}
+	memcpy(name, &response[1], length - 1);
+	name[length - 1] = '\0';
+	fd = shm_open(name, O_RDWR, 0);
+
+	if(fd < 0)
+	{
+		return GPNVM_ERROR_OPENING_FILE;
+	}
+	gpNvmClient_Rings = mmap(NULL, sizeof(gpNvmDaemon_Rings), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(gpNvmClient_Rings == MAP_FAILED)
+	{
+		gpNvmClient_Rings = NULL;
+		return GPNVM_ERROR_OPENING_FILE;
+	}
+	gpNvmClient_Channel = &gpNvmClient_Rings->channels[response[0]];
+	gpNvmClient_RingSpin = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? GPNVM_DAEMON_RING_SPIN : 0;
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvmClient_AttachRing
+ *
+ * Description: Attach the shared memory ring of the connection, used by the next gets, sets and syncs.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the ring is attached
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the process is not connected
+ *                             GPNVM_ERROR_ALREADY_INITIALIZED: the ring is already attached
+ *                             GPNVM_ERROR_OPENING_FILE: the daemon has no rings, or they cannot be mapped
+ *                             GPNVM_ERROR_WRITING_FILE: the request could not be sent
+ *                             GPNVM_ERROR_READING_FILE: the response could not be received
+ */
+gpNvm_Result gpNvmClient_AttachRing(void)
+{
+	gpNvm_Result result;
+
+	pthread_mutex_lock(&gpNvmClient_Mutex);
+	result = gpNvmClient_MapRing();
+	pthread_mutex_unlock(&gpNvmClient_Mutex);
+	return result;
+}
+
+/*
+ * Name: gpNvmClient_GetAttribute
+ *
+ * Description: Same as gpNvm_GetAttribute, served by the daemon.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8* pLength: pointer to a variable that will store the length of the attribute
+ *            UInt8* pValue: pointer to store the attribute value (up to 255 bytes)
+ *
+ * Return value: gpNvm_Result: same as gpNvm_GetAttribute, or a connection error
+ */
+gpNvm_Result gpNvmClient_GetAttribute(gpNvm_AttrId attrId, UInt8* pLength, UInt8* pValue)
+{
+	UInt8 request[GPNVM_DAEMON_HEADER_SIZE] = {GPNVM_DAEMON_OP_GET, attrId, 0};
+	gpNvm_Result result = GPNVM_ERROR_NOT_INITIALIZED;
+
+	if((pLength == NULL) || (pValue == NULL))
+	{
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	pthread_mutex_lock(&gpNvmClient_Mutex);
+
+	if(gpNvmClient_Fd >= 0)
+	{
+		result = gpNvmClient_Send(request, sizeof(request));
+		result = (result == GPNVM_OK) ? gpNvmClient_Receive(pLength, pValue) : result;
+	}
+	pthread_mutex_unlock(&gpNvmClient_Mutex);
+	return result;
+}
+
+/*
+ * Name: gpNvmClient_SetAttribute
+ *
+ * Description: Same as gpNvm_SetAttribute, served by the daemon.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8 length: length of attribute data
+ *            const UInt8* pValue: pointer to attribute data
+ *
+ * Return value: gpNvm_Result: same as gpNvm_SetAttribute, or a connection error
+ */
+gpNvm_Result gpNvmClient_SetAttribute(gpNvm_AttrId attrId, UInt8 length, const UInt8* pValue)
+{
+	gpNvm_BulkEntry entry = {attrId, length, pValue};
+
+	return gpNvmClient_SetAttributes(&entry, 1);
+}
+
+/*
+ * Name: gpNvmClient_SetAttributes
+ *
+ * Description: Set several attributes, GPNVM_CLIENT_PIPELINE_DEPTH requests in flight at most. The depth bounds
+ * the bytes waiting in the daemon, which stops reading a client whose responses are not read.
+ *
+ * Parameters:
+ *            const gpNvm_BulkEntry* pEntries: attributes to set
+ *            UInt16 count: number of attributes
+ *
+ * Return value: gpNvm_Result: GPNVM_OK if all the attributes are set, the first error otherwise
+ */
+gpNvm_Result gpNvmClient_SetAttributes(const gpNvm_BulkEntry* pEntries, UInt16 count)
+{
+	UInt8 request[GPNVM_CLIENT_PIPELINE_DEPTH * GPNVM_DAEMON_MAX_RESPONSE];
+	gpNvm_Result result = GPNVM_OK;
+	gpNvm_Result status;
+	UInt16 requestLength;
+	UInt16 window;
+
+	if(pEntries == NULL)
+	{
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+
+	for(UInt16 entry = 0; entry < count; entry++)
+	{
+		if(pEntries[entry].pValue == NULL)
+		{
+			return GPNVM_ERROR_INVALID_PARAMETERS;
+		}
+	}
+	pthread_mutex_lock(&gpNvmClient_Mutex);
+
+	if(gpNvmClient_Fd < 0)
+	{
+		pthread_mutex_unlock(&gpNvmClient_Mutex);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	for(UInt16 first = 0; first < count; first += window)
+	{
+		window = ((count - first) < GPNVM_CLIENT_PIPELINE_DEPTH) ? (count - first) : GPNVM_CLIENT_PIPELINE_DEPTH;
+		requestLength = 0;
+
+		for(UInt16 entry = first; entry < first + window; entry++)
+		{
+			request[requestLength] = GPNVM_DAEMON_OP_SET;
+			request[requestLength + 1] = pEntries[entry].attrId;
+			request[requestLength + 2] = pEntries[entry].length;
+			memcpy(&request[requestLength + GPNVM_DAEMON_HEADER_SIZE], pEntries[entry].pValue, pEntries[entry].length);
+			requestLength += GPNVM_DAEMON_HEADER_SIZE + pEntries[entry].length;
+		}
+		status = gpNvmClient_Send(request, requestLength);
+
+		for(UInt16 entry = 0; (status == GPNVM_OK) && (entry < window); entry++)
+		{
+			status = gpNvmClient_Receive(NULL, NULL);
+			result = (result == GPNVM_OK) ? status : result;
+			status = (status == GPNVM_ERROR_READING_FILE) ? status : GPNVM_OK;
+		}
+
+		if(status != GPNVM_OK)
+		{
+			//The connection failed, the responses still expected are lost
+			result = status;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&gpNvmClient_Mutex);
+	return result;
+}
+
+/*
+ * Name: gpNvmClient_BulkLoad
+ *
+ * Description: Same as gpNvm_BulkLoad, served by the daemon in one request.
+ *
+ * Parameters:
+ *            const gpNvm_BulkEntry* pEntries: attributes sorted by increasing id
+ *            UInt16 count: number of attributes, up to 255
+ *
+ * Return value: gpNvm_Result: same as gpNvm_BulkLoad, or a connection error
+ */
+gpNvm_Result gpNvmClient_BulkLoad(const gpNvm_BulkEntry* pEntries, UInt16 count)
+{
+	UInt8 request[GPNVM_DAEMON_BUFFER_SIZE];
+	UInt16 requestLength = 2;
+	gpNvm_Result result = GPNVM_ERROR_NOT_INITIALIZED;
+
+	if((pEntries == NULL) || (count > 255))
+	{
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	request[0] = GPNVM_DAEMON_OP_BULK_LOAD;
+	request[1] = (UInt8)count;
+
+	for(UInt16 entry = 0; entry < count; entry++)
+	{
+		if((pEntries[entry].pValue == NULL) || (requestLength + 2 + pEntries[entry].length > GPNVM_DAEMON_BUFFER_SIZE))
+		{
+			return GPNVM_ERROR_INVALID_PARAMETERS;
+		}
+		request[requestLength] = pEntries[entry].attrId;
+		request[requestLength + 1] = pEntries[entry].length;
+		memcpy(&request[requestLength + 2], pEntries[entry].pValue, pEntries[entry].length);
+		requestLength += 2 + pEntries[entry].length;
+	}
+	pthread_mutex_lock(&gpNvmClient_Mutex);
+
+	if(gpNvmClient_Fd >= 0)
+	{
+		//Always on the socket, the request does not fit in a ring slot
+		result = gpNvmClient_SendSocket(request, requestLength);
+		result = (result == GPNVM_OK) ? gpNvmClient_ReceiveSocket(NULL, NULL) : result;
+	}
+	pthread_mutex_unlock(&gpNvmClient_Mutex);
+	return result;
+}
+
+/*
+ * Name: gpNvmClient_Sync
+ *
+ * Description: Same as gpNvm_Sync, served by the daemon.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: same as gpNvm_Sync, or a connection error
+ */
+gpNvm_Result gpNvmClient_Sync(void)
+{
+	UInt8 request[GPNVM_DAEMON_HEADER_SIZE] = {GPNVM_DAEMON_OP_SYNC, 0, 0};
+	gpNvm_Result result = GPNVM_ERROR_NOT_INITIALIZED;
+
+	pthread_mutex_lock(&gpNvmClient_Mutex);
+
+	if(gpNvmClient_Fd >= 0)
+	{
+		result = gpNvmClient_Send(request, sizeof(request));
+		result = (result == GPNVM_OK) ? gpNvmClient_Receive(NULL, NULL) : result;
+	}
+	pthread_mutex_unlock(&gpNvmClient_Mutex);
+	return result;
+}
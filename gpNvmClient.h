@@ -0,0 +1,154 @@
+/*
+ * File gpNvmClient.h
+ *
+ * Client library of the gpNvm daemon (gpnvmd). It mirrors the gpNvm attribute API, the requests
+ * are sent to the daemon over its Unix domain socket instead of accessing the file. The threads of
+ * a process share its connection: each call holds a mutex from its request to its last response.
+ *
+ */
+
+#ifndef _GPNVMCLIENT_H_
+#define _GPNVMCLIENT_H_
+/* ==================================================================== */
+/* ========================== Include files =========================== */
+/* ==================================================================== */
+
+#include "gpNvmDaemon.h"
+
+/* ==================================================================== */
+/* ====================== Macros and constants  ======================= */
+/* ==================================================================== */
+#ifndef GPNVM_CLIENT_PIPELINE_DEPTH
+#define GPNVM_CLIENT_PIPELINE_DEPTH          8        /* Requests sent by gpNvmClient_SetAttributes before reading their responses, up to GPNVM_DAEMON_RING_SLOTS */
+#endif
+
+/* ==================================================================== */
+/* ======================= Functions prototypes ======================= */
+/* ==================================================================== */
+
+/*
+ * Name: gpNvmClient_Connect
+ *
+ * Description: Connect the process to the daemon. The following gpNvmClient calls use this connection.
+ *
+ * Parameters:
+ *            const char* pSocketPath: path of the Unix socket of the daemon, e.g. GPNVM_DAEMON_SOCKET
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the process is connected
+ *                             GPNVM_ERROR_ALREADY_INITIALIZED: the process is already connected
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ *                             GPNVM_ERROR_OPENING_FILE: the daemon cannot be reached
+ */
+gpNvm_Result gpNvmClient_Connect(const char* pSocketPath);
+
+/*
+ * Name: gpNvmClient_Disconnect
+ *
+ * Description: Close the connection to the daemon.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the connection is closed
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the process is not connected
+ */
+gpNvm_Result gpNvmClient_Disconnect(void);
+
+/*
+ * Name: gpNvmClient_AttachRing
+ *
+ * Description: Attach the shared memory ring of the connection. The next gets, sets and syncs are exchanged with the
+ * daemon through shared memory instead of the socket, without system calls while the daemon is busy: each side only
+ * sleeps on a futex once the ring is idle. Bulk loads still use the socket. The daemon must run as the same user.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the ring is attached
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the process is not connected
+ *                             GPNVM_ERROR_ALREADY_INITIALIZED: the ring is already attached
+ *                             GPNVM_ERROR_OPENING_FILE: the daemon has no rings, or they cannot be mapped
+ *                             GPNVM_ERROR_WRITING_FILE: the request could not be sent
+ *                             GPNVM_ERROR_READING_FILE: the response could not be received
+ */
+gpNvm_Result gpNvmClient_AttachRing(void);
+
+/*
+ * Name: gpNvmClient_GetAttribute
+ *
+ * Description: Same as gpNvm_GetAttribute, served by the daemon.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8* pLength: pointer to a variable that will store the length of the attribute
+ *            UInt8* pValue: pointer to store the attribute value (up to 255 bytes)
+ *
+ * Return value: gpNvm_Result: same as gpNvm_GetAttribute, and
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the process is not connected
+ *                             GPNVM_ERROR_WRITING_FILE: the request could not be sent
+ *                             GPNVM_ERROR_READING_FILE: the response could not be received
+ */
+gpNvm_Result gpNvmClient_GetAttribute(gpNvm_AttrId attrId, UInt8* pLength, UInt8* pValue);
+
+/*
+ * Name: gpNvmClient_SetAttribute
+ *
+ * Description: Same as gpNvm_SetAttribute, served by the daemon. The call returns once the attribute is durable.
+ *
+ * Parameters:
+ *            gpNvm_AttrId attrId: attribute id
+ *            UInt8 length: length of attribute data
+ *            const UInt8* pValue: pointer to attribute data
+ *
+ * Return value: gpNvm_Result: same as gpNvm_SetAttribute, and
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the process is not connected
+ *                             GPNVM_ERROR_WRITING_FILE: the request could not be sent, or the attribute could not be synced
+ *                             GPNVM_ERROR_READING_FILE: the response could not be received
+ */
+gpNvm_Result gpNvmClient_SetAttribute(gpNvm_AttrId attrId, UInt8 length, const UInt8* pValue);
+
+/*
+ * Name: gpNvmClient_SetAttributes
+ *
+ * Description: Set several attributes one by one, pipelined: up to GPNVM_CLIENT_PIPELINE_DEPTH requests are sent
+ * before their responses are read, so the attributes share the round trips and the syncs of the daemon. Unlike
+ * gpNvmClient_BulkLoad, the other clients can see some of the attributes before all of them are set.
+ *
+ * Parameters:
+ *            const gpNvm_BulkEntry* pEntries: attributes to set, in any order
+ *            UInt16 count: number of attributes
+ *
+ * Return value: gpNvm_Result: GPNVM_OK if all the attributes are set, the first error otherwise (see gpNvmClient_SetAttribute)
+ */
+gpNvm_Result gpNvmClient_SetAttributes(const gpNvm_BulkEntry* pEntries, UInt16 count);
+
+/*
+ * Name: gpNvmClient_BulkLoad
+ *
+ * Description: Same as gpNvm_BulkLoad, served by the daemon in one request. The other clients see the attributes once
+ * all of them are loaded, but if one is rejected the ones before it are kept, see gpNvm_BulkLoadStream.
+ *
+ * Parameters:
+ *            const gpNvm_BulkEntry* pEntries: attributes sorted by increasing id
+ *            UInt16 count: number of attributes, up to 255
+ *
+ * Return value: gpNvm_Result: same as gpNvm_BulkLoad, and
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the process is not connected
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the request would not fit in GPNVM_DAEMON_BUFFER_SIZE
+ *                             GPNVM_ERROR_WRITING_FILE: the request could not be sent
+ *                             GPNVM_ERROR_READING_FILE: the response could not be received
+ */
+gpNvm_Result gpNvmClient_BulkLoad(const gpNvm_BulkEntry* pEntries, UInt16 count);
+
+/*
+ * Name: gpNvmClient_Sync
+ *
+ * Description: Same as gpNvm_Sync, served by the daemon.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: same as gpNvm_Sync, and
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the process is not connected
+ *                             GPNVM_ERROR_READING_FILE: the response could not be received
+ */
+gpNvm_Result gpNvmClient_Sync(void);
+
+#endif //_GPNVMCLIENT_H_
@@ -0,0 +1,818 @@
+/*
+ * File gpNvmDaemon.c
+ *
+ * Daemon owning the non-volatile memory file and serving gpNvm requests to local clients
+ * over a Unix domain socket.
+ *
+ */
+
+/* ==================================================================== */
+/* ====================== Component Description  ====================== */
+/* ==================================================================== */
+
+/*
+ * Processes sharing attributes through the daemon do not open the file: the daemon is the only user of gpNvm, and the
+ * clients (gpNvmClient) send it requests over a Unix domain socket. The daemon serializes the writes and decides when
+ * they are made durable.
+ *
+ * 1) Protocol
+ *
+ * Requests and responses are small binary frames (see GPNVM_DAEMON_OP_xxx in gpNvmDaemon.h). A client can pipeline its
+ * requests: it sends several of them then reads the responses, which come back in the same order.
+ *
+ * 2) Event loop
+ *
+ * The daemon is single threaded. One poll call waits for new connections, input from the clients and room in their sockets
+ * for the pending output. Each client has an input buffer, where partial requests wait for the rest of their bytes, and
+ * an output buffer. A client is only read while its output buffer can hold one more response, so a client not reading its
+ * responses is slowed down instead of growing the buffers.
+ *
+ * 3) Group commit
+ *
+ * gpNvm runs with GPNVM_SYNC_NONE. All the requests received in one poll round, from all the clients, are executed, then a
+ * single gpNvm_Sync makes the sets of the round durable before their responses are sent. Under load many sets share one sync,
+ * while a lone set is still answered after its own sync. If the sync fails, the responses of the sets of the round are turned
+ * into GPNVM_ERROR_WRITING_FILE before they are sent.
+ *
+ * 4) Shared memory rings
+ *
+ * A socket request costs a few system calls and context switches. A client on the same machine can instead attach the
+ * channel of its connection (GPNVM_DAEMON_OP_ATTACH_RING): two single producer single consumer rings in a shared memory
+ * object created by the daemon, one for its requests and one for the responses. A ring slot holds one frame of the socket
+ * protocol, and the producer publishes slots by moving the head of the ring, so a get costs a few cache line transfers.
+ *
+ * A ring thread of the daemon polls the attached rings, executes their requests and publishes the responses, with the
+ * same group commit as the event loop. Polling only lasts while requests keep coming: after GPNVM_DAEMON_RING_SPIN idle
+ * polls (none on a single CPU, where the polling side would only keep the other one from running) the thread sets the
+ * waiting flag and sleeps on the doorbell futex, which a client increments after publishing requests and wakes only
+ * when the flag is set. A client waiting for a response spins the same way, then sleeps on the head of its response
+ * ring. The socket stays open: it gives the channel, frees it when the client goes away, and carries the bulk loads
+ * which do not fit in a slot.
+ */
+
+/* ==================================================================== */
+/* ========================== Include files =========================== */
+/* ==================================================================== */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "gpNvmDaemon.h"
+
+/* ==================================================================== */
+/* ========================== Types Definition ======================== */
+/* ==================================================================== */
+
+/* Connection of a client */
+typedef struct
+{
+	int fd;                                         /* Socket of the client, -1 if the entry is free */
+	UInt16 inLength;                                /* Bytes received and not yet executed */
+	UInt16 outLength;                               /* Bytes of responses not yet sent */
+	UInt16 roundStart;                              /* Offset in out of the first response of the current round */
+	UInt8 in[GPNVM_DAEMON_BUFFER_SIZE];             /* Received requests */
+	UInt8 out[GPNVM_DAEMON_BUFFER_SIZE];            /* Responses to send */
+} gpNvmDaemon_Client;
+
+/* ==================================================================== */
+/* ========================= Global variables ========================= */
+/* ==================================================================== */
+
+/* Connected clients */
+static gpNvmDaemon_Client gpNvmDaemon_Clients[GPNVM_DAEMON_MAX_CLIENTS];
+
+/* Set by SIGTERM or SIGINT to stop the event loop */
+static volatile sig_atomic_t gpNvmDaemon_Stop = 0;
+
+/* Shared memory rings of the clients, NULL if they could not be created */
+static gpNvmDaemon_Rings* gpNvmDaemon_SharedRings = NULL;
+
+/* Name of the shared memory object of the rings */
+static char gpNvmDaemon_RingsName[32];
+
+/* Channels attached by their client, indexed like gpNvmDaemon_Clients */
+static UInt8 gpNvmDaemon_Attached[GPNVM_DAEMON_MAX_CLIENTS];
+
+/* Serializes the attachment of the channels against the ring thread */
+static pthread_mutex_t gpNvmDaemon_RingMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Set by gpNvmDaemon_Run to stop the ring thread */
+static UInt32 gpNvmDaemon_RingStop = 0;
+
+/* Idle polls of the rings before sleeping, 0 on a single CPU where polling only delays the clients */
+static UInt32 gpNvmDaemon_RingSpin = GPNVM_DAEMON_RING_SPIN;
+
+/* ==================================================================== */
+/* ======================= Functions Definition ======================= */
+/* ==================================================================== */
+
+/*
+ * Name: gpNvmDaemon_OnSignal
+ *
+ * Description: SIGTERM and SIGINT handler, stop the event loop.
+ *
+ * Parameters:
+ *            int signalNumber: received signal
+ *
+ * Return value: None
+ */
+static void gpNvmDaemon_OnSignal(int signalNumber)
+{
+	(void)signalNumber;
+	gpNvmDaemon_Stop = 1;
+}
+
+/*
+ * Name: gpNvmDaemon_Listen
+ *
+ * Description: Create the Unix socket of the daemon, replacing the one left by a previous run.
+ *
+ * Parameters:
+ *            const char* pSocketPath: path of the socket
+ *
+ * Return value: int: listening socket, -1 on error
+ */
+static int gpNvmDaemon_Listen(const char* pSocketPath)
+{
+	struct sockaddr_un address;
+	int fd;
+
+	if(strlen(pSocketPath) >= sizeof(address.sun_path))
+	{
+		return -1;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, pSocketPath);
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+	if(fd < 0)
+	{
+		return -1;
+	}
+	unlink(pSocketPath);
+
+	if((bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0) || (listen(fd, GPNVM_DAEMON_MAX_CLIENTS) != 0))
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ * Name: gpNvmDaemon_RequestLength
+ *
+ * Description: Get the length of the first request of a buffer.
+ *
+ * Parameters:
+ *            const UInt8* pRequest: received bytes
+ *            UInt16 length: number of received bytes
+ *
+ * Return value: UInt16: length of the request, 0 if it is not complete yet, 0xFFFF if it is not a valid request
+ */
+static UInt16 gpNvmDaemon_RequestLength(const UInt8* pRequest, UInt16 length)
+{
+	UInt32 requestLength = 2;
+
+	if(length < 1)
+	{
+		return 0;
+	}
+
+	switch(pRequest[0])
+	{
+		case GPNVM_DAEMON_OP_GET:
+		case GPNVM_DAEMON_OP_SYNC:
+		case GPNVM_DAEMON_OP_ATTACH_RING:
+			requestLength = GPNVM_DAEMON_HEADER_SIZE;
+			break;
+		case GPNVM_DAEMON_OP_SET:
+			requestLength = (length < GPNVM_DAEMON_HEADER_SIZE) ? GPNVM_DAEMON_HEADER_SIZE : GPNVM_DAEMON_HEADER_SIZE + pRequest[2];
+			break;
+		case GPNVM_DAEMON_OP_BULK_LOAD:
+			//[op][count] then count [attrId][length][value], walked as far as received
+			if(length < 2)
+			{
+				return 0;
+			}
+
+			for(UInt16 entry = 0; entry < pRequest[1]; entry++)
+			{
+				if(requestLength + 2 > length)
+				{
+					//A full buffer that does not hold the request never will
+					return (length >= GPNVM_DAEMON_BUFFER_SIZE) ? 0xFFFF : 0;
+				}
+				requestLength += 2 + pRequest[requestLength + 1];
+			}
+			break;
+		default:
+			return 0xFFFF;
+	}
+
+	if(requestLength > GPNVM_DAEMON_BUFFER_SIZE)
+	{
+		return 0xFFFF;
+	}
+	return (requestLength <= length) ? (UInt16)requestLength : 0;
+}
+
+/*
+ * Name: gpNvmDaemon_Execute
+ *
+ * Description: Execute one request received from a socket or a ring and write its response.
+ *
+ * Parameters:
+ *            UInt8* pRequest: complete request
+ *            UInt8* pResponse: buffer of GPNVM_DAEMON_MAX_RESPONSE bytes to store the response
+ *            UInt8* pWritten: set to 1 if the request changed attributes which are not durable yet
+ *
+ * Return value: UInt16: length of the response
+ */
+static UInt16 gpNvmDaemon_Execute(UInt8* pRequest, UInt8* pResponse, UInt8* pWritten)
+{
+	gpNvm_BulkEntry entries[255];
+	UInt8 length = 0;
+	UInt16 offset = 2;
+
+	pResponse[0] = pRequest[0];
+
+	switch(pRequest[0])
+	{
+		case GPNVM_DAEMON_OP_GET:
+			pResponse[1] = gpNvm_GetAttribute(pRequest[1], &length, &pResponse[GPNVM_DAEMON_HEADER_SIZE]);
+
+			if(pResponse[1] != GPNVM_OK)
+			{
+				length = 0;
+			}
+			break;
+		case GPNVM_DAEMON_OP_SET:
+			pResponse[1] = gpNvm_SetAttribute(pRequest[1], pRequest[2], &pRequest[GPNVM_DAEMON_HEADER_SIZE]);
+			*pWritten = 1;
+			break;
+		case GPNVM_DAEMON_OP_SYNC:
+			pResponse[1] = gpNvm_Sync();
+			break;
+		default:
+			for(UInt16 entry = 0; entry < pRequest[1]; entry++)
+			{
+				entries[entry].attrId = pRequest[offset];
+				entries[entry].length = pRequest[offset + 1];
+				entries[entry].pValue = &pRequest[offset + 2];
+				offset += 2 + pRequest[offset + 1];
+			}
+			pResponse[1] = gpNvm_BulkLoad(entries, pRequest[1]);
+			break;
+	}
+	pResponse[2] = length;
+	return GPNVM_DAEMON_HEADER_SIZE + length;
+}
+
+/*
+ * Name: gpNvmDaemon_Close
+ *
+ * Description: Close the connection of a client and free its entry.
+ *
+ * Parameters:
+ *            gpNvmDaemon_Client* pClient: client to close
+ *
+ * Return value: None
+ */
+static void gpNvmDaemon_Close(gpNvmDaemon_Client* pClient)
+{
+	close(pClient->fd);
+	pClient->fd = -1;
+	pthread_mutex_lock(&gpNvmDaemon_RingMutex);
+	gpNvmDaemon_Attached[pClient - gpNvmDaemon_Clients] = 0;
+	pthread_mutex_unlock(&gpNvmDaemon_RingMutex);
+}
+
+/*
+ * Name: gpNvmDaemon_Attach
+ *
+ * Description: Attach the channel of a client, its rings are reset. The response gives the channel and the name
+ * of the shared memory object holding it.
+ *
+ * Parameters:
+ *            gpNvmDaemon_Client* pClient: client that sent GPNVM_DAEMON_OP_ATTACH_RING
+ *            UInt8* pResponse: buffer of GPNVM_DAEMON_MAX_RESPONSE bytes to store the response
+ *
+ * Return value: UInt16: length of the response
+ */
+static UInt16 gpNvmDaemon_Attach(gpNvmDaemon_Client* pClient, UInt8* pResponse)
+{
+	UInt8 channel = (UInt8)(pClient - gpNvmDaemon_Clients);
+	UInt8 length = (UInt8)strlen(gpNvmDaemon_RingsName);
+
+	pResponse[0] = GPNVM_DAEMON_OP_ATTACH_RING;
+
+	if(gpNvmDaemon_SharedRings == NULL)
+	{
+		pResponse[1] = GPNVM_ERROR_OPENING_FILE;
+		pResponse[2] = 0;
+		return GPNVM_DAEMON_HEADER_SIZE;
+	}
+	pthread_mutex_lock(&gpNvmDaemon_RingMutex);
+	memset(&gpNvmDaemon_SharedRings->channels[channel], 0, sizeof(gpNvmDaemon_Channel));
+	gpNvmDaemon_Attached[channel] = 1;
+	pthread_mutex_unlock(&gpNvmDaemon_RingMutex);
+	pResponse[1] = GPNVM_OK;
+	pResponse[2] = 1 + length;
+	pResponse[GPNVM_DAEMON_HEADER_SIZE] = channel;
+	memcpy(&pResponse[GPNVM_DAEMON_HEADER_SIZE + 1], gpNvmDaemon_RingsName, length);
+	return GPNVM_DAEMON_HEADER_SIZE + 1 + length;
+}
+
+/*
+ * Name: gpNvmDaemon_Receive
+ *
+ * Description: Read the bytes available from a client, then execute its complete requests while its output buffer
+ * can hold their responses. The client is closed when it disconnects or sends an invalid request.
+ *
+ * Parameters:
+ *            gpNvmDaemon_Client* pClient: client to serve
+ *            UInt8 readable: 1 if poll reported the socket readable
+ *            UInt8* pWritten: set to 1 if a request changed attributes which are not durable yet
+ *
+ * Return value: None
+ */
+static void gpNvmDaemon_Receive(gpNvmDaemon_Client* pClient, UInt8 readable, UInt8* pWritten)
+{
+	UInt16 consumed = 0;
+	UInt16 requestLength;
+	ssize_t received;
+
+	if((readable != 0) && (pClient->inLength < GPNVM_DAEMON_BUFFER_SIZE))
+	{
+		received = recv(pClient->fd, &pClient->in[pClient->inLength], GPNVM_DAEMON_BUFFER_SIZE - pClient->inLength, 0);
+
+		if((received == 0) || ((received < 0) && (errno != EAGAIN) && (errno != EINTR)))
+		{
+			gpNvmDaemon_Close(pClient);
+			return;
+		}
+		pClient->inLength += (received > 0) ? (UInt16)received : 0;
+	}
+
+	while(pClient->outLength + GPNVM_DAEMON_MAX_RESPONSE <= GPNVM_DAEMON_BUFFER_SIZE)
+	{
+		requestLength = gpNvmDaemon_RequestLength(&pClient->in[consumed], pClient->inLength - consumed);
+
+		if(requestLength == 0xFFFF)
+		{
+			printf("[gpNvmDaemon][%s] Invalid request! Abort.\n",__FUNCTION__);
+			gpNvmDaemon_Close(pClient);
+			return;
+		}
+
+		if(requestLength == 0)
+		{
+			break;
+		}
+		if(pClient->in[consumed] == GPNVM_DAEMON_OP_ATTACH_RING)
+		{
+			pClient->outLength += gpNvmDaemon_Attach(pClient, &pClient->out[pClient->outLength]);
+		}
+		else
+		{
+			pClient->outLength += gpNvmDaemon_Execute(&pClient->in[consumed], &pClient->out[pClient->outLength], pWritten);
+		}
+		consumed += requestLength;
+	}
+	//Keep the partial request at the start of the buffer
+	memmove(pClient->in, &pClient->in[consumed], pClient->inLength - consumed);
+	pClient->inLength -= consumed;
+}
+
+/*
+ * Name: gpNvmDaemon_FailWrites
+ *
+ * Description: The sync of the round failed: report GPNVM_ERROR_WRITING_FILE for the sets answered in this round.
+ *
+ * Parameters:
+ *            gpNvmDaemon_Client* pClient: client whose responses are updated
+ *
+ * Return value: None
+ */
+static void gpNvmDaemon_FailWrites(gpNvmDaemon_Client* pClient)
+{
+	for(UInt16 offset = pClient->roundStart; offset < pClient->outLength; offset += GPNVM_DAEMON_HEADER_SIZE + pClient->out[offset + 2])
+	{
+		if((pClient->out[offset] == GPNVM_DAEMON_OP_SET) && (pClient->out[offset + 1] == GPNVM_OK))
+		{
+			pClient->out[offset + 1] = GPNVM_ERROR_WRITING_FILE;
+		}
+	}
+}
+
+/*
+ * Name: gpNvmDaemon_Send
+ *
+ * Description: Send as many pending responses as the socket of the client accepts.
+ *
+ * Parameters:
+ *            gpNvmDaemon_Client* pClient: client to send to
+ *
+ * Return value: None
+ */
+static void gpNvmDaemon_Send(gpNvmDaemon_Client* pClient)
+{
+	ssize_t sent;
+
+	if(pClient->outLength == 0)
+	{
+		return;
+	}
+	sent = send(pClient->fd, pClient->out, pClient->outLength, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+	if((sent < 0) && (errno != EAGAIN) && (errno != EINTR))
+	{
+		gpNvmDaemon_Close(pClient);
+		return;
+	}
+
+	if(sent > 0)
+	{
+		memmove(pClient->out, &pClient->out[sent], pClient->outLength - sent);
+		pClient->outLength -= (UInt16)sent;
+	}
+}
+
+/*
+ * Name: gpNvmDaemon_FutexWait
+ *
+ * Description: Sleep until a futex word of the shared rings changes or is woken up.
+ *
+ * Parameters:
+ *            UInt32* pWord: futex word
+ *            UInt32 value: value seen in the word before sleeping
+ *            UInt32 timeoutMs: maximum sleep, 0 to sleep until woken up
+ *
+ * Return value: None
+ */
+void gpNvmDaemon_FutexWait(UInt32* pWord, UInt32 value, UInt32 timeoutMs)
+{
+	struct timespec timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+
+	//Not FUTEX_PRIVATE_FLAG: the word is shared with other processes
+	syscall(SYS_futex, pWord, FUTEX_WAIT, value, (timeoutMs != 0) ? &timeout : NULL, NULL, 0);
+}
+
+/*
+ * Name: gpNvmDaemon_FutexWake
+ *
+ * Description: Wake up the process sleeping on a futex word of the shared rings.
+ *
+ * Parameters:
+ *            UInt32* pWord: futex word
+ *
+ * Return value: None
+ */
+void gpNvmDaemon_FutexWake(UInt32* pWord)
+{
+	syscall(SYS_futex, pWord, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+/*
+ * Name: gpNvmDaemon_ServeRings
+ *
+ * Description: Execute the requests published on the rings of the attached channels. As for the sockets, the sets
+ * of the pass are made durable with one gpNvm_Sync before their responses are published.
+ *
+ * Parameters: None
+ *
+ * Return value: UInt32: number of requests executed
+ */
+static UInt32 gpNvmDaemon_ServeRings(void)
+{
+	UInt8 staged[GPNVM_DAEMON_MAX_CLIENTS];
+	gpNvmDaemon_Channel* pChannel;
+	UInt8* pRequest;
+	UInt8* pResponse;
+	UInt32 served = 0;
+	UInt32 head, tail;
+	UInt8 written = 0;
+	UInt8 failed;
+
+	pthread_mutex_lock(&gpNvmDaemon_RingMutex);
+
+	for(UInt8 channel = 0; channel < GPNVM_DAEMON_MAX_CLIENTS; channel++)
+	{
+		pChannel = &gpNvmDaemon_SharedRings->channels[channel];
+		staged[channel] = 0;
+
+		if(gpNvmDaemon_Attached[channel] == 0)
+		{
+			continue;
+		}
+		head = __atomic_load_n(&pChannel->requests.head, __ATOMIC_ACQUIRE);
+
+		//The client keeps at most GPNVM_DAEMON_RING_SLOTS requests in flight, so the responses always fit
+		for(tail = pChannel->requests.tail; (tail != head) && (staged[channel] < GPNVM_DAEMON_RING_SLOTS); tail++)
+		{
+			pRequest = pChannel->requests.slots[tail % GPNVM_DAEMON_RING_SLOTS];
+			pResponse = pChannel->responses.slots[(pChannel->responses.head + staged[channel]) % GPNVM_DAEMON_RING_SLOTS];
+
+			if((pRequest[0] == GPNVM_DAEMON_OP_GET) || (pRequest[0] == GPNVM_DAEMON_OP_SET) || (pRequest[0] == GPNVM_DAEMON_OP_SYNC))
+			{
+				gpNvmDaemon_Execute(pRequest, pResponse, &written);
+			}
+			else
+			{
+				pResponse[0] = pRequest[0];
+				pResponse[1] = GPNVM_ERROR_INVALID_PARAMETERS;
+				pResponse[2] = 0;
+			}
+			staged[channel]++;
+		}
+		__atomic_store_n(&pChannel->requests.tail, tail, __ATOMIC_RELEASE);
+		served += staged[channel];
+	}
+	failed = ((written != 0) && (gpNvm_Sync() != GPNVM_OK)) ? 1 : 0;
+
+	for(UInt8 channel = 0; channel < GPNVM_DAEMON_MAX_CLIENTS; channel++)
+	{
+		pChannel = &gpNvmDaemon_SharedRings->channels[channel];
+
+		if(staged[channel] == 0)
+		{
+			continue;
+		}
+
+		for(UInt8 slot = 0; (failed != 0) && (slot < staged[channel]); slot++)
+		{
+			pResponse = pChannel->responses.slots[(pChannel->responses.head + slot) % GPNVM_DAEMON_RING_SLOTS];
+
+			if((pResponse[0] == GPNVM_DAEMON_OP_SET) && (pResponse[1] == GPNVM_OK))
+			{
+				pResponse[1] = GPNVM_ERROR_WRITING_FILE;
+			}
+		}
+		//Publish then check the sleeping flag, the client sets it then checks head: one of them sees the other
+		__atomic_store_n(&pChannel->responses.head, pChannel->responses.head + staged[channel], __ATOMIC_SEQ_CST);
+
+		if(__atomic_load_n(&pChannel->responses.waiting, __ATOMIC_SEQ_CST) != 0)
+		{
+			gpNvmDaemon_FutexWake(&pChannel->responses.head);
+		}
+	}
+	pthread_mutex_unlock(&gpNvmDaemon_RingMutex);
+	return served;
+}
+
+/*
+ * Name: gpNvmDaemon_RingThread
+ *
+ * Description: Serve the rings, polling them while requests keep coming and sleeping on the doorbell futex once
+ * they have been idle for GPNVM_DAEMON_RING_SPIN polls.
+ *
+ * Parameters:
+ *            void* pArgument: unused
+ *
+ * Return value: void*: NULL
+ */
+static void* gpNvmDaemon_RingThread(void* pArgument)
+{
+	UInt32 spins = 0;
+	UInt32 doorbell;
+
+	(void)pArgument;
+
+	while(__atomic_load_n(&gpNvmDaemon_RingStop, __ATOMIC_ACQUIRE) == 0)
+	{
+		//Read before the rings: a request published after the pass changes it, and the wait returns at once
+		doorbell = __atomic_load_n(&gpNvmDaemon_SharedRings->doorbell, __ATOMIC_SEQ_CST);
+
+		if(spins < gpNvmDaemon_RingSpin)
+		{
+			spins = (gpNvmDaemon_ServeRings() != 0) ? 0 : spins + 1;
+			continue;
+		}
+		__atomic_store_n(&gpNvmDaemon_SharedRings->waiting, 1, __ATOMIC_SEQ_CST);
+
+		if(gpNvmDaemon_ServeRings() == 0)
+		{
+			gpNvmDaemon_FutexWait(&gpNvmDaemon_SharedRings->doorbell, doorbell, 0);
+		}
+		__atomic_store_n(&gpNvmDaemon_SharedRings->waiting, 0, __ATOMIC_SEQ_CST);
+		spins = 0;
+	}
+	return NULL;
+}
+
+/*
+ * Name: gpNvmDaemon_MapRings
+ *
+ * Description: Create the shared memory object holding the rings of the clients. Without it, the clients
+ * use their socket only.
+ *
+ * Parameters: None
+ *
+ * Return value: None
+ */
+static void gpNvmDaemon_MapRings(void)
+{
+	int fd;
+
+	snprintf(gpNvmDaemon_RingsName, sizeof(gpNvmDaemon_RingsName), "/gpnvmd-%d", (int)getpid());
+	fd = shm_open(gpNvmDaemon_RingsName, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+	if((fd >= 0) && (ftruncate(fd, sizeof(gpNvmDaemon_Rings)) == 0))
+	{
+		gpNvmDaemon_SharedRings = mmap(NULL, sizeof(gpNvmDaemon_Rings), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		gpNvmDaemon_SharedRings = (gpNvmDaemon_SharedRings == MAP_FAILED) ? NULL : gpNvmDaemon_SharedRings;
+	}
+
+	if(fd >= 0)
+	{
+		close(fd);
+	}
+
+	if(gpNvmDaemon_SharedRings == NULL)
+	{
+		printf("[gpNvmDaemon][%s] Cannot map shared memory %s, clients use their socket only!\n",__FUNCTION__,gpNvmDaemon_RingsName);
+		shm_unlink(gpNvmDaemon_RingsName);
+	}
+}
+
+/*
+ * Name: gpNvmDaemon_Run
+ *
+ * Description: Event loop of the daemon: accept clients, execute their requests, make the sets of each poll
+ * round durable with one gpNvm_Sync, then send the responses.
+ *
+ * Parameters:
+ *            const char* pSocketPath: path of the Unix socket, created by the daemon
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the daemon stopped on a signal
+ *                             GPNVM_ERROR_OPENING_FILE: the file or the socket cannot be opened
+ *                             other errors: same as gpNvm_Init and gpNvm_Uninit
+ */
+gpNvm_Result gpNvmDaemon_Run(const char* pSocketPath)
+{
+	struct pollfd fds[GPNVM_DAEMON_MAX_CLIENTS + 1];
+	struct sigaction action;
+	sigset_t signals, previousSignals;
+	pthread_t ringThread;
+	gpNvm_Result result;
+	UInt8 written;
+	int listenFd, fd;
+
+	//No SA_RESTART, so that poll returns when the daemon is stopped
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = gpNvmDaemon_OnSignal;
+	sigaction(SIGTERM, &action, NULL);
+	sigaction(SIGINT, &action, NULL);
+	gpNvmDaemon_Stop = 0;
+	//Durability is handled by the group commit of each round
+	gpNvm_SetSyncPolicy(GPNVM_SYNC_NONE, 0);
+	result = gpNvm_Init();
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	listenFd = gpNvmDaemon_Listen(pSocketPath);
+
+	if(listenFd < 0)
+	{
+		printf("[gpNvmDaemon][%s] Cannot listen on %s! Abort.\n",__FUNCTION__,pSocketPath);
+		gpNvm_Uninit();
+		return GPNVM_ERROR_OPENING_FILE;
+	}
+
+	for(UInt8 cpt = 0; cpt < GPNVM_DAEMON_MAX_CLIENTS; cpt++)
+	{
+		gpNvmDaemon_Clients[cpt].fd = -1;
+		gpNvmDaemon_Attached[cpt] = 0;
+	}
+	gpNvmDaemon_RingStop = 0;
+	gpNvmDaemon_RingSpin = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? GPNVM_DAEMON_RING_SPIN : 0;
+	gpNvmDaemon_MapRings();
+
+	if(gpNvmDaemon_SharedRings != NULL)
+	{
+		//The signals must interrupt the poll of this thread, not be taken by the ring thread
+		sigemptyset(&signals);
+		sigaddset(&signals, SIGTERM);
+		sigaddset(&signals, SIGINT);
+		pthread_sigmask(SIG_BLOCK, &signals, &previousSignals);
+
+		if(pthread_create(&ringThread, NULL, gpNvmDaemon_RingThread, NULL) != 0)
+		{
+			printf("[gpNvmDaemon][%s] Cannot start the ring thread, clients use their socket only!\n",__FUNCTION__);
+			munmap(gpNvmDaemon_SharedRings, sizeof(gpNvmDaemon_Rings));
+			shm_unlink(gpNvmDaemon_RingsName);
+			gpNvmDaemon_SharedRings = NULL;
+		}
+		pthread_sigmask(SIG_SETMASK, &previousSignals, NULL);
+	}
+
+	while(gpNvmDaemon_Stop == 0)
+	{
+		fds[0].fd = listenFd;
+		fds[0].events = POLLIN;
+
+		for(UInt8 cpt = 0; cpt < GPNVM_DAEMON_MAX_CLIENTS; cpt++)
+		{
+			//A client is only read while its response fits, and only polled for output when it has some
+			fds[cpt + 1].fd = gpNvmDaemon_Clients[cpt].fd;
+			fds[cpt + 1].events = (gpNvmDaemon_Clients[cpt].outLength + GPNVM_DAEMON_MAX_RESPONSE <= GPNVM_DAEMON_BUFFER_SIZE) ? POLLIN : 0;
+			fds[cpt + 1].events |= (gpNvmDaemon_Clients[cpt].outLength > 0) ? POLLOUT : 0;
+			fds[cpt + 1].revents = 0;
+		}
+
+		if(poll(fds, GPNVM_DAEMON_MAX_CLIENTS + 1, -1) < 0)
+		{
+			continue;
+		}
+
+		if((fds[0].revents & POLLIN) != 0)
+		{
+			fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+			for(UInt8 cpt = 0; (fd >= 0) && (cpt < GPNVM_DAEMON_MAX_CLIENTS); cpt++)
+			{
+				if(gpNvmDaemon_Clients[cpt].fd < 0)
+				{
+					gpNvmDaemon_Clients[cpt].fd = fd;
+					gpNvmDaemon_Clients[cpt].inLength = 0;
+					gpNvmDaemon_Clients[cpt].outLength = 0;
+					fd = -1;
+				}
+			}
+
+			if(fd >= 0)
+			{
+				//No free entry, refuse the client
+				close(fd);
+			}
+		}
+		//Execute the requests of all the clients, then one sync for all the sets of the round
+		written = 0;
+
+		for(UInt8 cpt = 0; cpt < GPNVM_DAEMON_MAX_CLIENTS; cpt++)
+		{
+			if((gpNvmDaemon_Clients[cpt].fd >= 0) && (fds[cpt + 1].fd == gpNvmDaemon_Clients[cpt].fd))
+			{
+				gpNvmDaemon_Clients[cpt].roundStart = gpNvmDaemon_Clients[cpt].outLength;
+				gpNvmDaemon_Receive(&gpNvmDaemon_Clients[cpt], ((fds[cpt + 1].revents & (POLLIN | POLLHUP | POLLERR)) != 0) ? 1 : 0, &written);
+			}
+		}
+
+		if((written != 0) && (gpNvm_Sync() != GPNVM_OK))
+		{
+			for(UInt8 cpt = 0; cpt < GPNVM_DAEMON_MAX_CLIENTS; cpt++)
+			{
+				if(gpNvmDaemon_Clients[cpt].fd >= 0)
+				{
+					gpNvmDaemon_FailWrites(&gpNvmDaemon_Clients[cpt]);
+				}
+			}
+		}
+
+		for(UInt8 cpt = 0; cpt < GPNVM_DAEMON_MAX_CLIENTS; cpt++)
+		{
+			if(gpNvmDaemon_Clients[cpt].fd >= 0)
+			{
+				gpNvmDaemon_Send(&gpNvmDaemon_Clients[cpt]);
+			}
+		}
+	}
+
+	for(UInt8 cpt = 0; cpt < GPNVM_DAEMON_MAX_CLIENTS; cpt++)
+	{
+		if(gpNvmDaemon_Clients[cpt].fd >= 0)
+		{
+			gpNvmDaemon_Close(&gpNvmDaemon_Clients[cpt]);
+		}
+	}
+	close(listenFd);
+	unlink(pSocketPath);
+
+	if(gpNvmDaemon_SharedRings != NULL)
+	{
+		__atomic_store_n(&gpNvmDaemon_RingStop, 1, __ATOMIC_SEQ_CST);
+		__atomic_fetch_add(&gpNvmDaemon_SharedRings->doorbell, 1, __ATOMIC_SEQ_CST);
+		gpNvmDaemon_FutexWake(&gpNvmDaemon_SharedRings->doorbell);
+		pthread_join(ringThread, NULL);
+		munmap(gpNvmDaemon_SharedRings, sizeof(gpNvmDaemon_Rings));
+		shm_unlink(gpNvmDaemon_RingsName);
+		gpNvmDaemon_SharedRings = NULL;
+	}
+	return gpNvm_Uninit();
+}
@@ -0,0 +1,124 @@
+/*
+ * File gpNvmDaemon.h
+ *
+ * Daemon owning the non-volatile memory file and serving gpNvm requests to local clients
+ * over a Unix domain socket. The protocol is shared with the client library gpNvmClient.
+ *
+ */
+
+#ifndef _GPNVMDAEMON_H_
+#define _GPNVMDAEMON_H_
+/* ==================================================================== */
+/* ========================== Include files =========================== */
+/* ==================================================================== */
+
+#include "gpNvm.h"
+
+/* ==================================================================== */
+/* ====================== Macros and constants  ======================= */
+/* ==================================================================== */
+#define GPNVM_DAEMON_SOCKET                  "gpnvmd.sock"  /* Default Unix socket path of the daemon */
+
+#ifndef GPNVM_DAEMON_MAX_CLIENTS
+#define GPNVM_DAEMON_MAX_CLIENTS             16       /* Number of clients connected at once */
+#endif
+#ifndef GPNVM_DAEMON_BUFFER_SIZE
+#define GPNVM_DAEMON_BUFFER_SIZE             4096     /* Input and output buffer of each client, also the maximum request size */
+#endif
+#ifndef GPNVM_DAEMON_RING_SLOTS
+#define GPNVM_DAEMON_RING_SLOTS              8        /* Requests in flight on the shared memory ring of a client */
+#endif
+#ifndef GPNVM_DAEMON_RING_SPIN
+#define GPNVM_DAEMON_RING_SPIN               20000    /* Polls of idle rings before sleeping on a futex */
+#endif
+
+/* Protocol: a request is [op][attrId][length][value], or [op][count] followed by count [attrId][length][value]
+ * for GPNVM_DAEMON_OP_BULK_LOAD. The response is [op][result][length][value], value only for GPNVM_DAEMON_OP_GET.
+ * Requests of a client are answered in order, so a client can send several requests before reading the responses. */
+#define GPNVM_DAEMON_OP_GET                  1        /* gpNvm_GetAttribute */
+#define GPNVM_DAEMON_OP_SET                  2        /* gpNvm_SetAttribute, answered once durable */
+#define GPNVM_DAEMON_OP_SYNC                 3        /* gpNvm_Sync */
+#define GPNVM_DAEMON_OP_BULK_LOAD            4        /* gpNvm_BulkLoadStream: others see the attributes once all are loaded, but
+                                                         * the ones before a rejected attribute are kept and synced */
+#define GPNVM_DAEMON_OP_ATTACH_RING          5        /* Socket only: attach the ring of the connection, the value is [channel][shared memory name] */
+#define GPNVM_DAEMON_HEADER_SIZE             3        /* Size of a request or response before the value */
+#define GPNVM_DAEMON_MAX_RESPONSE            (GPNVM_DAEMON_HEADER_SIZE + 255)
+
+/* ==================================================================== */
+/* ========================== Types Definition ======================== */
+/* ==================================================================== */
+
+/* Single producer single consumer ring of frames, in shared memory. Frames use the socket protocol,
+ * GPNVM_DAEMON_OP_GET, GPNVM_DAEMON_OP_SET and GPNVM_DAEMON_OP_SYNC only. */
+typedef struct
+{
+	UInt32 head __attribute__((aligned(64)));   /* Frames published by the producer, futex word of a sleeping consumer */
+	UInt32 waiting;                             /* Set by the consumer before sleeping on head */
+	UInt32 tail __attribute__((aligned(64)));   /* Frames consumed by the consumer */
+	UInt8 slots[GPNVM_DAEMON_RING_SLOTS][GPNVM_DAEMON_MAX_RESPONSE] __attribute__((aligned(64)));
+} gpNvmDaemon_Ring;
+
+/* Rings of one client connection */
+typedef struct
+{
+	gpNvmDaemon_Ring requests;                  /* Produced by the client */
+	gpNvmDaemon_Ring responses;                 /* Produced by the daemon */
+} gpNvmDaemon_Channel;
+
+/* Shared memory object of the daemon, one channel per client entry */
+typedef struct
+{
+	UInt32 doorbell __attribute__((aligned(64))); /* Incremented by the clients after publishing requests, futex word of the sleeping daemon */
+	UInt32 waiting;                             /* Set by the daemon before sleeping on doorbell */
+	gpNvmDaemon_Channel channels[GPNVM_DAEMON_MAX_CLIENTS];
+} gpNvmDaemon_Rings;
+
+/* ==================================================================== */
+/* ======================= Functions prototypes ======================= */
+/* ==================================================================== */
+
+/*
+ * Name: gpNvmDaemon_Run
+ *
+ * Description: Initialize gpNvm, listen on the Unix socket and serve the clients until SIGTERM or SIGINT is received.
+ * All the requests received in one poll round are executed, then the sets of the round are made durable with one
+ * gpNvm_Sync before they are answered (group commit), instead of one sync per set. The requests published by the
+ * clients on their shared memory rings are served by a second thread, with the same group commit.
+ *
+ * Parameters:
+ *            const char* pSocketPath: path of the Unix socket, created by the daemon
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the daemon stopped on a signal
+ *                             GPNVM_ERROR_OPENING_FILE: the file or the socket cannot be opened
+ *                             other errors: same as gpNvm_Init and gpNvm_Uninit
+ */
+gpNvm_Result gpNvmDaemon_Run(const char* pSocketPath);
+
+/*
+ * Name: gpNvmDaemon_FutexWait
+ *
+ * Description: Sleep until a futex word of the shared rings changes or is woken up. Returns at once if the word
+ * is not equal to the expected value.
+ *
+ * Parameters:
+ *            UInt32* pWord: futex word
+ *            UInt32 value: value seen in the word before sleeping
+ *            UInt32 timeoutMs: maximum sleep, 0 to sleep until woken up
+ *
+ * Return value: None
+ */
+void gpNvmDaemon_FutexWait(UInt32* pWord, UInt32 value, UInt32 timeoutMs);
+
+/*
+ * Name: gpNvmDaemon_FutexWake
+ *
+ * Description: Wake up the process sleeping on a futex word of the shared rings.
+ *
+ * Parameters:
+ *            UInt32* pWord: futex word
+ *
+ * Return value: None
+ */
+void gpNvmDaemon_FutexWake(UInt32* pWord);
+
+#endif //_GPNVMDAEMON_H_
@@ -0,0 +1,1251 @@
+/*
+ * File gpNvmStore.c
+ *
+ * Non-volatile record store with an on-disk extendible hash index.
+ * For simplicity, the underlying non-volatile memory is modeled as a file
+ *
+ */
+
+/* ==================================================================== */
+/* ====================== Component Description  ====================== */
+/* ==================================================================== */
+
+/*
+ * gpNvm stores at most 256 attributes, indexed by a dense table kept in RAM. This component stores records with 32 bits keys,
+ * so millions of records, in the file defined by GPNVM_STORE_FILE_NAME. Its index lives in the file and only a few pages of it
+ * are cached in RAM.
+ *
+ * 1) Layout
+ *
+ * The file is divided into pages of GPNVM_STORE_PAGE_SIZE bytes:
+ *     a- Page 0, header: magic, page size, global depth of the directory, first directory page, number of pages,
+ *        first free page, number of records and generation (gpNvmStore_Header).
+ *     b- Directory pages: 2^globalDepth consecutive UInt32 entries, each one is the bucket page of the keys whose
+ *        hash ends with the entry index. The directory is stored on consecutive pages.
+ *     c- Bucket pages: a bucket header (local depth, number of records, used bytes) followed by the records.
+ *        Each record consists of:
+ *           - key: record key (4 bytes)
+ *           - length: length of record value (1 byte)
+ *           - crc: CRC8 of record value (1 byte)
+ *           - value: record value (length bytes)
+ *          ________________________________________________________________________________
+ *          |bucket header|key|length|crc|     value     |key|length|crc| value | ...  |free|
+ *          |_____________|___|______|___|_______________|___|______|___|_______|______|____|
+ *                                        Layout of a bucket page
+ *     d- Free pages: pages no longer used (an old directory), linked by their first UInt32 and reused by the next allocation.
+ *
+ * 2) Extendible hashing
+ *
+ * The key is hashed and the globalDepth low bits of the hash select a directory entry, so a lookup reads one directory page
+ * and one bucket page whatever the number of records. A bucket with local depth d holds all the keys whose hash ends with the
+ * same d bits, 2^(globalDepth - d) directory entries point to it.
+ * When a record does not fit in its bucket, the bucket is split: its records are shared with a new bucket on bit d of their
+ * hash, both get local depth d + 1 and half of the directory entries move to the new bucket. If d is already globalDepth, the
+ * directory is doubled first: while it fits in one page it is doubled in place, then it is copied to twice as many new pages at
+ * the end of the file and its old pages are freed. Buckets are not merged when records are removed.
+ *
+ * 3) Page cache
+ *
+ * Pages are accessed through GPNVM_STORE_CACHE_PAGES slots in gpNvmStore_CachePages, managed with the CLOCK algorithm like the
+ * bounded cache of gpNvm. A dirty page is written into the file when it is evicted, on gpNvmStore_Sync and on gpNvmStore_Uninit.
+ * The page pointer returned by gpNvmStore_GetPage is only valid until the next page access, so no function keeps two pages.
+ *
+ * 4) Durability
+ *
+ * Records are written back lazily by the page cache. gpNvmStore_Sync and gpNvmStore_Uninit write all the dirty pages and the
+ * header then sync the file, the store on the device is consistent after them.
+ * Between two syncs, an evicted page is written in place, so a crash could leave the store with part of an operation: half
+ * of a split bucket, a directory entry pointing to a bucket never written, or an old directory page already reused. Every
+ * sync is therefore a transaction, committed by the header write, which increments the generation of the store.
+ * Before a page of the last committed store (below its page count) is first written in place, its content in the file is
+ * appended to the journal file GPNVM_STORE_JOURNAL_NAME, tagged with the generation and a digest, and the journal is synced.
+ * The pages of the cache are journaled together, so one journal sync covers them all. Pages allocated since the commit
+ * are not journaled, the committed header does not refer to them.
+ * gpNvmStore_Init rolls back the entries of the current generation, in reverse order so the oldest copy of a page is
+ * written last, and the store is back to its last sync. After a commit, the journal entries belong to an older generation:
+ * they are ignored even if a crash prevents truncating the journal, and a torn entry fails its digest.
+ */
+
+/* ==================================================================== */
+/* ========================== Include files =========================== */
+/* ==================================================================== */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "gpNvmStore.h"
+
+/* ==================================================================== */
+/* ====================== Macros and constants  ======================= */
+/* ==================================================================== */
+
+#define GPNVM_STORE_MAGIC                    0x534E5047  /* "GPNS" */
+#define GPNVM_STORE_NO_PAGE                  0xFFFFFFFF  /* Free slot, or end of the free pages list */
+/* Directory entries held by one page */
+#define GPNVM_STORE_ENTRIES_PER_PAGE         (GPNVM_STORE_PAGE_SIZE/sizeof(UInt32))
+/* Size of the record fields before the value: key, length and crc */
+#define GPNVM_STORE_RECORD_HEADER_SIZE       (sizeof(gpNvmStore_Key) + 2)
+/* Bytes of a bucket page available for records */
+#define GPNVM_STORE_BUCKET_SPACE             (GPNVM_STORE_PAGE_SIZE - sizeof(gpNvmStore_BucketHeader))
+/* gpNvmStore_GetPage flags */
+#define GPNVM_STORE_PAGE_WRITE               0x01     /* The page will be updated, mark it dirty */
+#define GPNVM_STORE_PAGE_NEW                 0x02     /* The page is newly allocated, do not read it from the file */
+/* Page cache flags */
+#define GPNVM_STORE_CACHE_REFERENCED         0x01     /* Page accessed since the clock hand last passed it */
+#define GPNVM_STORE_CACHE_DIRTY              0x02     /* Page updated in RAM and not yet written into the file */
+#define GPNVM_STORE_CACHE_JOURNALED          0x04     /* Committed content of the page already in the journal */
+
+#if (GPNVM_STORE_PAGE_SIZE < 1024) || (GPNVM_STORE_PAGE_SIZE > 65535)
+#error "GPNVM_STORE_PAGE_SIZE must hold several 255 bytes records and its used bytes must fit 16 bits"
+#endif
+#if GPNVM_STORE_CACHE_PAGES == 0
+#error "GPNVM_STORE_CACHE_PAGES must be at least 1"
+#endif
+
+/* ==================================================================== */
+/* ========================== Types Definition ======================== */
+/* ==================================================================== */
+
+/* Header of the store, page 0 of the file */
+typedef struct
+{
+	UInt32 magic;                       /* GPNVM_STORE_MAGIC */
+	UInt32 pageSize;                    /* GPNVM_STORE_PAGE_SIZE of the store */
+	UInt32 globalDepth;                 /* Number of hash bits used by the directory */
+	UInt32 directoryPage;               /* First page of the directory */
+	UInt32 pageCount;                   /* Number of pages in the file */
+	UInt32 freePage;                    /* First page of the free pages list, GPNVM_STORE_NO_PAGE if empty */
+	UInt32 records;                     /* Number of records stored */
+	UInt32 generation;                  /* Number of commits of the store, read as 0 from a store written before it existed */
+} gpNvmStore_Header;
+
+/* Journal entry, followed by the content of the page as of the last commit */
+typedef struct
+{
+	UInt32 generation;                  /* Generation of the store the page content belongs to */
+	UInt32 page;                        /* Page number in the store file */
+	UInt32 digest;                      /* gpNvmStore_CalculateDigest of the generation, page number and content */
+} gpNvmStore_JournalEntry;
+
+/* Header of a bucket page, followed by the records */
+typedef struct
+{
+	UInt8 localDepth;                   /* Number of hash bits shared by the keys of the bucket */
+	UInt8 reserved;
+	UInt16 count;                       /* Number of records in the bucket */
+	UInt16 used;                        /* Bytes used by the records */
+} gpNvmStore_BucketHeader;
+
+/* ==================================================================== */
+/* ========================= Global variables ========================= */
+/* ==================================================================== */
+
+/* File descriptor of the file emulating the store */
+static int gpNvmStore_FileDescriptor = -1;
+
+/* File descriptor of the journal file */
+static int gpNvmStore_JournalDescriptor = -1;
+
+/* Size of the journal entries of the current generation */
+static off_t gpNvmStore_JournalEnd = 0;
+
+/* Page count of the last committed header, pages from this one on are not journaled */
+static UInt32 gpNvmStore_CommittedPages = 0;
+
+/* Header of the store, written into page 0 by gpNvmStore_Flush */
+static gpNvmStore_Header gpNvmStore_StoreHeader;
+
+/* Pages of the store cached in RAM, managed with the CLOCK algorithm */
+static UInt8 gpNvmStore_CachePages[GPNVM_STORE_CACHE_PAGES][GPNVM_STORE_PAGE_SIZE] __attribute__((aligned(8)));
+
+/* Page held by each slot of gpNvmStore_CachePages, GPNVM_STORE_NO_PAGE if the slot is free */
+static UInt32 gpNvmStore_CachePageNumber[GPNVM_STORE_CACHE_PAGES];
+
+/* GPNVM_STORE_CACHE_xxx flags of each slot of gpNvmStore_CachePages */
+static UInt8 gpNvmStore_CachePageFlags[GPNVM_STORE_CACHE_PAGES];
+
+/* Next slot examined by the CLOCK algorithm to find a page to evict */
+static UInt16 gpNvmStore_CacheClockHand = 0;
+
+/* Hit and miss counters of the page cache */
+static gpNvm_CacheStats gpNvmStore_CacheStatistics;
+
+/* Copy of the page being split or of the directory page being doubled */
+static UInt8 gpNvmStore_PageBuffer[GPNVM_STORE_PAGE_SIZE] __attribute__((aligned(8)));
+
+/* Committed content of the page being journaled or rolled back */
+static UInt8 gpNvmStore_JournalBuffer[GPNVM_STORE_PAGE_SIZE] __attribute__((aligned(8)));
+
+/* ==================================================================== */
+/* ========================= Local Functions ========================== */
+/* ==================================================================== */
+
+/*
+ * Name: gpNvmStore_CalculateChecksum
+ *
+ * Description: CRC8 of a record value, the same polynomial as gpNvm attributes.
+ *
+ * Parameters:
+ *           const UInt8* ptr: Pointer to the data calculate its CRC
+ *           UInt8 length: Length of data
+ *
+ * Return value: UInt8: calculated CRC
+ */
+static UInt8 gpNvmStore_CalculateChecksum(const UInt8* ptr, UInt8 length)
+{
+	UInt8 crc = 0xFF;
+
+	for(UInt8 i = 0; i < length; i++)
+	{
+		crc ^= ptr[i];
+
+		for(UInt8 j = 0; j < 8; j++)
+		{
+			crc = ((crc & 0x80) != 0) ? (UInt8)((crc << 1) ^ 0x31) : (UInt8)(crc << 1);
+		}
+	}
+	return crc;
+}
+
+/*
+ * Name: gpNvmStore_Hash
+ *
+ * Description: Hash a key so that its low bits are evenly spread, even for consecutive keys
+ * (finalizer of MurmurHash3).
+ *
+ * Parameters:
+ *            gpNvmStore_Key key: record key
+ *
+ * Return value: UInt32: hash of the key
+ */
+static UInt32 gpNvmStore_Hash(gpNvmStore_Key key)
+{
+	UInt32 hash = key;
+
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6B;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+/*
+ * Name: gpNvmStore_CalculateDigest
+ *
+ * Description: 32 bits FNV-1a digest of a journal entry, strong enough to reject a torn entry where a CRC8 is not.
+ *
+ * Parameters:
+ *           const gpNvmStore_JournalEntry* pEntry: entry, its digest field is not included
+ *           const UInt8* pPageData: content of the page
+ *
+ * Return value: UInt32: calculated digest
+ */
+static UInt32 gpNvmStore_CalculateDigest(const gpNvmStore_JournalEntry* pEntry, const UInt8* pPageData)
+{
+	UInt32 digest = 0x811C9DC5;
+
+	for(UInt32 i = 0; i < offsetof(gpNvmStore_JournalEntry, digest); i++)
+	{
+		digest = (digest ^ ((const UInt8*)pEntry)[i])*0x01000193;
+	}
+
+	for(UInt32 i = 0; i < GPNVM_STORE_PAGE_SIZE; i++)
+	{
+		digest = (digest ^ pPageData[i])*0x01000193;
+	}
+	return digest;
+}
+
+/*
+ * Name: gpNvmStore_JournalPages
+ *
+ * Description: Append the committed content of the dirty cached pages to the journal, then sync it, before any of them
+ * is written in place. Pages allocated since the last commit and pages already journaled are skipped. The content is read
+ * from the file: it is the committed one, or a later one already journaled after it, which the rollback overwrites.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the pages are journaled successfully, or there is none to journal
+ *                             GPNVM_ERROR_READING_FILE: a page could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: the journal could not be written or synced
+ */
+static gpNvm_Result gpNvmStore_JournalPages(void)
+{
+	gpNvmStore_JournalEntry entry;
+	struct iovec vectors[2];
+	UInt8 journaled = 0;
+
+	for(UInt16 slot = 0; slot < GPNVM_STORE_CACHE_PAGES; slot++)
+	{
+		if(((gpNvmStore_CachePageFlags[slot] & (GPNVM_STORE_CACHE_DIRTY | GPNVM_STORE_CACHE_JOURNALED)) != GPNVM_STORE_CACHE_DIRTY) ||
+		   (gpNvmStore_CachePageNumber[slot] >= gpNvmStore_CommittedPages))
+		{
+			continue;
+		}
+		entry.generation = gpNvmStore_StoreHeader.generation;
+		entry.page = gpNvmStore_CachePageNumber[slot];
+
+		if(pread(gpNvmStore_FileDescriptor, gpNvmStore_JournalBuffer, GPNVM_STORE_PAGE_SIZE, (off_t)entry.page*GPNVM_STORE_PAGE_SIZE) != GPNVM_STORE_PAGE_SIZE)
+		{
+			printf("[gpNvmStore][%s] Cannot read page %u of file %s! Abort.\n",__FUNCTION__,entry.page,GPNVM_STORE_FILE_NAME);
+			return GPNVM_ERROR_READING_FILE;
+		}
+		entry.digest = gpNvmStore_CalculateDigest(&entry, gpNvmStore_JournalBuffer);
+		vectors[0].iov_base = &entry;
+		vectors[0].iov_len = sizeof(entry);
+		vectors[1].iov_base = gpNvmStore_JournalBuffer;
+		vectors[1].iov_len = GPNVM_STORE_PAGE_SIZE;
+
+		if(pwritev(gpNvmStore_JournalDescriptor, vectors, 2, gpNvmStore_JournalEnd) != (ssize_t)(sizeof(entry) + GPNVM_STORE_PAGE_SIZE))
+		{
+			printf("[gpNvmStore][%s] Cannot write file %s! Abort.\n",__FUNCTION__,GPNVM_STORE_JOURNAL_NAME);
+			return GPNVM_ERROR_WRITING_FILE;
+		}
+		gpNvmStore_JournalEnd += sizeof(entry) + GPNVM_STORE_PAGE_SIZE;
+		gpNvmStore_CachePageFlags[slot] |= GPNVM_STORE_CACHE_JOURNALED;
+		journaled = 1;
+	}
+
+	if((journaled != 0) && (fdatasync(gpNvmStore_JournalDescriptor) != 0))
+	{
+		printf("[gpNvmStore][%s] Cannot sync file %s! Abort.\n",__FUNCTION__,GPNVM_STORE_JOURNAL_NAME);
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvmStore_Rollback
+ *
+ * Description: Bring the store back to its last commit after a crash: the journal entries of the current generation
+ * are found, up to the first torn or older one, and their pages are written back from the last entry to the first,
+ * so each page ends with its committed content. The file is synced, then the journal is emptied.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the store is rolled back, or there was nothing to roll back
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced
+ */
+static gpNvm_Result gpNvmStore_Rollback(void)
+{
+	gpNvmStore_JournalEntry entry;
+	const off_t entrySize = sizeof(entry) + GPNVM_STORE_PAGE_SIZE;
+	off_t entries = 0;
+
+	while((pread(gpNvmStore_JournalDescriptor, &entry, sizeof(entry), entries*entrySize) == sizeof(entry)) &&
+	      (entry.generation == gpNvmStore_StoreHeader.generation) &&
+	      (pread(gpNvmStore_JournalDescriptor, gpNvmStore_JournalBuffer, GPNVM_STORE_PAGE_SIZE, entries*entrySize + sizeof(entry)) == GPNVM_STORE_PAGE_SIZE) &&
+	      (entry.digest == gpNvmStore_CalculateDigest(&entry, gpNvmStore_JournalBuffer)))
+	{
+		entries++;
+	}
+
+	for(off_t index = entries - 1; index >= 0; index--)
+	{
+		if((pread(gpNvmStore_JournalDescriptor, &entry, sizeof(entry), index*entrySize) != sizeof(entry)) ||
+		   (pread(gpNvmStore_JournalDescriptor, gpNvmStore_JournalBuffer, GPNVM_STORE_PAGE_SIZE, index*entrySize + sizeof(entry)) != GPNVM_STORE_PAGE_SIZE) ||
+		   (pwrite(gpNvmStore_FileDescriptor, gpNvmStore_JournalBuffer, GPNVM_STORE_PAGE_SIZE, (off_t)entry.page*GPNVM_STORE_PAGE_SIZE) != GPNVM_STORE_PAGE_SIZE))
+		{
+			printf("[gpNvmStore][%s] Cannot roll back page %u of file %s! Abort.\n",__FUNCTION__,entry.page,GPNVM_STORE_FILE_NAME);
+			return GPNVM_ERROR_WRITING_FILE;
+		}
+	}
+
+	if((entries != 0) && (fdatasync(gpNvmStore_FileDescriptor) != 0))
+	{
+		printf("[gpNvmStore][%s] Cannot sync file %s! Abort.\n",__FUNCTION__,GPNVM_STORE_FILE_NAME);
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+	//Emptying the journal needs no sync, the entries left by a crash are ignored once the generation changes
+	if(ftruncate(gpNvmStore_JournalDescriptor, 0) != 0)
+	{
+		printf("[gpNvmStore][%s] Cannot empty file %s! Abort.\n",__FUNCTION__,GPNVM_STORE_JOURNAL_NAME);
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+	gpNvmStore_JournalEnd = 0;
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvmStore_CacheReset
+ *
+ * Description: Drop all the pages from RAM without writing them. Used when the file is opened.
+ *
+ * Parameters: None
+ *
+ * Return value: None
+ */
+static void gpNvmStore_CacheReset(void)
+{
+	memset(gpNvmStore_CachePageNumber, 0xFF, sizeof(gpNvmStore_CachePageNumber));
+	memset(gpNvmStore_CachePageFlags, 0, sizeof(gpNvmStore_CachePageFlags));
+	memset(&gpNvmStore_CacheStatistics, 0, sizeof(gpNvmStore_CacheStatistics));
+	gpNvmStore_CacheClockHand = 0;
+}
+
+/*
+ * Name: gpNvmStore_CacheWritePage
+ *
+ * Description: Write a dirty cached page into the file.
+ *
+ * Parameters:
+ *            UInt16 slot: slot of gpNvmStore_CachePages holding the page
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the page is written successfully
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written
+ */
+static gpNvm_Result gpNvmStore_CacheWritePage(UInt16 slot)
+{
+	off_t offset = (off_t)gpNvmStore_CachePageNumber[slot]*GPNVM_STORE_PAGE_SIZE;
+
+	if(pwrite(gpNvmStore_FileDescriptor, gpNvmStore_CachePages[slot], GPNVM_STORE_PAGE_SIZE, offset) != GPNVM_STORE_PAGE_SIZE)
+	{
+		printf("[gpNvmStore][%s] Cannot write file %s! Abort.\n",__FUNCTION__,GPNVM_STORE_FILE_NAME);
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+	gpNvmStore_CachePageFlags[slot] &= (UInt8)~GPNVM_STORE_CACHE_DIRTY;
+	gpNvmStore_CacheStatistics.writebacks++;
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvmStore_GetPage
+ *
+ * Description: Get a page of the store in RAM. If the page is not cached, a slot is chosen with the CLOCK algorithm
+ * and a dirty evicted page is journaled then written into the file first. The returned pointer is valid until the next call.
+ *
+ * Parameters:
+ *            UInt32 page: page number in the file
+ *            UInt8 flags: GPNVM_STORE_PAGE_WRITE to mark the page dirty, GPNVM_STORE_PAGE_NEW to get a zeroed page
+ *                         without reading the file
+ *            UInt8** ppPage: pointer to store the address of the page in RAM
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the page is in RAM
+ *                             GPNVM_ERROR_READING_FILE: the page, or a page to journal, could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: the evicted page could not be journaled or written into the file
+ */
+static gpNvm_Result gpNvmStore_GetPage(UInt32 page, UInt8 flags, UInt8** ppPage)
+{
+	gpNvm_Result result;
+	UInt16 slot;
+	ssize_t readSize;
+
+	for(slot = 0; slot < GPNVM_STORE_CACHE_PAGES; slot++)
+	{
+		if(gpNvmStore_CachePageNumber[slot] == page)
+		{
+			break;
+		}
+	}
+
+	if(slot < GPNVM_STORE_CACHE_PAGES)
+	{
+		gpNvmStore_CacheStatistics.hits++;
+	}
+	else
+	{
+		gpNvmStore_CacheStatistics.misses++;
+		//Look for a slot not referenced since the clock hand last passed it
+		while((gpNvmStore_CachePageFlags[gpNvmStore_CacheClockHand] & GPNVM_STORE_CACHE_REFERENCED) != 0)
+		{
+			gpNvmStore_CachePageFlags[gpNvmStore_CacheClockHand] &= (UInt8)~GPNVM_STORE_CACHE_REFERENCED;
+			gpNvmStore_CacheClockHand = (gpNvmStore_CacheClockHand + 1) % GPNVM_STORE_CACHE_PAGES;
+		}
+		slot = gpNvmStore_CacheClockHand;
+		gpNvmStore_CacheClockHand = (gpNvmStore_CacheClockHand + 1) % GPNVM_STORE_CACHE_PAGES;
+
+		if(gpNvmStore_CachePageNumber[slot] != GPNVM_STORE_NO_PAGE)
+		{
+			//Evict the page held by the slot, once the committed content of the dirty pages is in the journal
+			if((gpNvmStore_CachePageFlags[slot] & GPNVM_STORE_CACHE_DIRTY) != 0)
+			{
+				result = gpNvmStore_JournalPages();
+
+				if((result == GPNVM_OK) && (gpNvmStore_CacheWritePage(slot) != GPNVM_OK))
+				{
+					result = GPNVM_ERROR_WRITING_FILE;
+				}
+
+				if(result != GPNVM_OK)
+				{
+					return result;
+				}
+			}
+			gpNvmStore_CachePageNumber[slot] = GPNVM_STORE_NO_PAGE;
+			gpNvmStore_CacheStatistics.evictions++;
+		}
+		gpNvmStore_CachePageFlags[slot] = 0;
+
+		if((flags & GPNVM_STORE_PAGE_NEW) == 0)
+		{
+			readSize = pread(gpNvmStore_FileDescriptor, gpNvmStore_CachePages[slot], GPNVM_STORE_PAGE_SIZE, (off_t)page*GPNVM_STORE_PAGE_SIZE);
+
+			if(readSize != GPNVM_STORE_PAGE_SIZE)
+			{
+				printf("[gpNvmStore][%s] Cannot read page %u of file %s! Abort.\n",__FUNCTION__,page,GPNVM_STORE_FILE_NAME);
+				return GPNVM_ERROR_READING_FILE;
+			}
+		}
+		gpNvmStore_CachePageNumber[slot] = page;
+	}
+
+	if((flags & GPNVM_STORE_PAGE_NEW) != 0)
+	{
+		memset(gpNvmStore_CachePages[slot], 0, GPNVM_STORE_PAGE_SIZE);
+	}
+	gpNvmStore_CachePageFlags[slot] |= GPNVM_STORE_CACHE_REFERENCED;
+
+	if((flags & (GPNVM_STORE_PAGE_WRITE | GPNVM_STORE_PAGE_NEW)) != 0)
+	{
+		gpNvmStore_CachePageFlags[slot] |= GPNVM_STORE_CACHE_DIRTY;
+	}
+	*ppPage = gpNvmStore_CachePages[slot];
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvmStore_AllocatePage
+ *
+ * Description: Get a page for a new bucket, from the free pages list if it is not empty, otherwise at the end
+ * of the file. The page content is not initialized.
+ *
+ * Parameters:
+ *            UInt32* pPage: pointer to store the page number
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the page is allocated successfully
+ *                             GPNVM_ERROR_READING_FILE: the free page could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: an evicted page could not be written into the file
+ */
+static gpNvm_Result gpNvmStore_AllocatePage(UInt32* pPage)
+{
+	gpNvm_Result result;
+	UInt8* pPageData;
+
+	if(gpNvmStore_StoreHeader.freePage == GPNVM_STORE_NO_PAGE)
+	{
+		*pPage = gpNvmStore_StoreHeader.pageCount++;
+		return GPNVM_OK;
+	}
+	*pPage = gpNvmStore_StoreHeader.freePage;
+	result = gpNvmStore_GetPage(*pPage, 0, &pPageData);
+
+	if(result == GPNVM_OK)
+	{
+		memcpy(&gpNvmStore_StoreHeader.freePage, pPageData, sizeof(UInt32));
+	}
+	return result;
+}
+
+/*
+ * Name: gpNvmStore_FreePage
+ *
+ * Description: Add a page no longer used to the free pages list.
+ *
+ * Parameters:
+ *            UInt32 page: page number
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the page is freed successfully
+ *                             GPNVM_ERROR_WRITING_FILE: an evicted page could not be written into the file
+ */
+static gpNvm_Result gpNvmStore_FreePage(UInt32 page)
+{
+	gpNvm_Result result;
+	UInt8* pPageData;
+
+	result = gpNvmStore_GetPage(page, GPNVM_STORE_PAGE_NEW, &pPageData);
+
+	if(result == GPNVM_OK)
+	{
+		memcpy(pPageData, &gpNvmStore_StoreHeader.freePage, sizeof(UInt32));
+		gpNvmStore_StoreHeader.freePage = page;
+	}
+	return result;
+}
+
+/*
+ * Name: gpNvmStore_AccessDirectory
+ *
+ * Description: Read or write one entry of the directory.
+ *
+ * Parameters:
+ *            UInt32 index: directory entry, low globalDepth bits of the key hash
+ *            UInt32* pBucketPage: pointer to the bucket page to write, or to store the bucket page read
+ *            UInt8 write: 1 to write the entry, 0 to read it
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the entry is accessed successfully
+ *                             GPNVM_ERROR_READING_FILE: the directory page could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: an evicted page could not be written into the file
+ */
+static gpNvm_Result gpNvmStore_AccessDirectory(UInt32 index, UInt32* pBucketPage, UInt8 write)
+{
+	gpNvm_Result result;
+	UInt8* pPageData;
+	UInt32* pEntries;
+
+	result = gpNvmStore_GetPage(gpNvmStore_StoreHeader.directoryPage + index/GPNVM_STORE_ENTRIES_PER_PAGE,
+	                            (write != 0) ? GPNVM_STORE_PAGE_WRITE : 0, &pPageData);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	pEntries = (UInt32*)pPageData;
+
+	if(write != 0)
+	{
+		pEntries[index%GPNVM_STORE_ENTRIES_PER_PAGE] = *pBucketPage;
+	}
+	else
+	{
+		*pBucketPage = pEntries[index%GPNVM_STORE_ENTRIES_PER_PAGE];
+	}
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvmStore_DoubleDirectory
+ *
+ * Description: Use one more hash bit in the directory. Entry i + 2^globalDepth of the new directory points
+ * to the same bucket as entry i. A directory held by one page is doubled in place, a larger one is copied
+ * twice to new pages at the end of the file and its old pages are freed.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the directory is doubled successfully
+ *                             GPNVM_ERROR_MEMORY_FULL: the directory already uses GPNVM_STORE_MAX_DEPTH bits
+ *                             GPNVM_ERROR_READING_FILE: a directory page could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: an evicted page could not be written into the file
+ */
+static gpNvm_Result gpNvmStore_DoubleDirectory(void)
+{
+	gpNvm_Result result;
+	UInt8* pPageData;
+	UInt32 entries = (UInt32)1 << gpNvmStore_StoreHeader.globalDepth;
+	UInt32 oldPages, oldDirectory, newDirectory;
+
+	if(gpNvmStore_StoreHeader.globalDepth >= GPNVM_STORE_MAX_DEPTH)
+	{
+		printf("[gpNvmStore][%s] Directory reached %u bits! Abort.\n",__FUNCTION__,GPNVM_STORE_MAX_DEPTH);
+		return GPNVM_ERROR_MEMORY_FULL;
+	}
+
+	if(2*entries <= GPNVM_STORE_ENTRIES_PER_PAGE)
+	{
+		result = gpNvmStore_GetPage(gpNvmStore_StoreHeader.directoryPage, GPNVM_STORE_PAGE_WRITE, &pPageData);
+
+		if(result != GPNVM_OK)
+		{
+			return result;
+		}
+		memcpy(&pPageData[entries*sizeof(UInt32)], pPageData, entries*sizeof(UInt32));
+		gpNvmStore_StoreHeader.globalDepth++;
+		return GPNVM_OK;
+	}
+	//The directory fills whole pages, copy each of them twice
+	oldPages = entries/GPNVM_STORE_ENTRIES_PER_PAGE;
+	oldDirectory = gpNvmStore_StoreHeader.directoryPage;
+	newDirectory = gpNvmStore_StoreHeader.pageCount;
+	gpNvmStore_StoreHeader.pageCount += 2*oldPages;
+
+	for(UInt32 page = 0; page < oldPages; page++)
+	{
+		result = gpNvmStore_GetPage(oldDirectory + page, 0, &pPageData);
+
+		if(result != GPNVM_OK)
+		{
+			return result;
+		}
+		memcpy(gpNvmStore_PageBuffer, pPageData, GPNVM_STORE_PAGE_SIZE);
+
+		for(UInt32 copy = 0; copy < 2; copy++)
+		{
+			result = gpNvmStore_GetPage(newDirectory + copy*oldPages + page, GPNVM_STORE_PAGE_NEW, &pPageData);
+
+			if(result != GPNVM_OK)
+			{
+				return result;
+			}
+			memcpy(pPageData, gpNvmStore_PageBuffer, GPNVM_STORE_PAGE_SIZE);
+		}
+	}
+	gpNvmStore_StoreHeader.directoryPage = newDirectory;
+	gpNvmStore_StoreHeader.globalDepth++;
+
+	for(UInt32 page = 0; page < oldPages; page++)
+	{
+		result = gpNvmStore_FreePage(oldDirectory + page);
+
+		if(result != GPNVM_OK)
+		{
+			return result;
+		}
+	}
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvmStore_SplitBucket
+ *
+ * Description: Split a full bucket. Its records are shared with a new bucket on the next bit of their hash,
+ * the directory entries having this bit set are moved to the new bucket. The directory is doubled first
+ * if the bucket already uses all its bits.
+ *
+ * Parameters:
+ *            UInt32 bucketPage: page of the bucket to split
+ *            UInt32 hash: hash of a key of the bucket
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the bucket is split successfully
+ *                             GPNVM_ERROR_MEMORY_FULL: the directory cannot be doubled
+ *                             GPNVM_ERROR_READING_FILE: a page could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: an evicted page could not be written into the file
+ */
+static gpNvm_Result gpNvmStore_SplitBucket(UInt32 bucketPage, UInt32 hash)
+{
+	gpNvm_Result result;
+	gpNvmStore_BucketHeader* pOld = (gpNvmStore_BucketHeader*)gpNvmStore_PageBuffer;
+	gpNvmStore_BucketHeader* pBucket;
+	UInt8* pPageData;
+	UInt32 newPage, offset, recordSize, bucketPages[2];
+	UInt8 localDepth;
+	gpNvmStore_Key key;
+
+	result = gpNvmStore_GetPage(bucketPage, 0, &pPageData);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	localDepth = ((gpNvmStore_BucketHeader*)pPageData)->localDepth;
+
+	if(localDepth == gpNvmStore_StoreHeader.globalDepth)
+	{
+		result = gpNvmStore_DoubleDirectory();
+
+		if(result != GPNVM_OK)
+		{
+			return result;
+		}
+	}
+	result = gpNvmStore_AllocatePage(&newPage);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	//Keep a copy of the bucket, then rebuild it and the new bucket from this copy one after the other
+	result = gpNvmStore_GetPage(bucketPage, 0, &pPageData);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	memcpy(gpNvmStore_PageBuffer, pPageData, GPNVM_STORE_PAGE_SIZE);
+	bucketPages[0] = bucketPage;
+	bucketPages[1] = newPage;
+
+	for(UInt8 side = 0; side < 2; side++)
+	{
+		result = gpNvmStore_GetPage(bucketPages[side], GPNVM_STORE_PAGE_NEW, &pPageData);
+
+		if(result != GPNVM_OK)
+		{
+			return result;
+		}
+		pBucket = (gpNvmStore_BucketHeader*)pPageData;
+		pBucket->localDepth = (UInt8)(localDepth + 1);
+
+		for(offset = sizeof(gpNvmStore_BucketHeader); offset < sizeof(gpNvmStore_BucketHeader) + pOld->used; offset += recordSize)
+		{
+			memcpy(&key, &gpNvmStore_PageBuffer[offset], sizeof(key));
+			recordSize = GPNVM_STORE_RECORD_HEADER_SIZE + gpNvmStore_PageBuffer[offset + sizeof(key)];
+
+			if(((gpNvmStore_Hash(key) >> localDepth) & 1) == side)
+			{
+				memcpy(&pPageData[sizeof(gpNvmStore_BucketHeader) + pBucket->used], &gpNvmStore_PageBuffer[offset], recordSize);
+				pBucket->used = (UInt16)(pBucket->used + recordSize);
+				pBucket->count++;
+			}
+		}
+	}
+
+	//Entries pointing to the bucket end with the same localDepth bits, move those with the next bit set
+	for(UInt32 index = hash & (((UInt32)1 << localDepth) - 1); index < ((UInt32)1 << gpNvmStore_StoreHeader.globalDepth); index += (UInt32)1 << localDepth)
+	{
+		if(((index >> localDepth) & 1) != 0)
+		{
+			result = gpNvmStore_AccessDirectory(index, &newPage, 1);
+
+			if(result != GPNVM_OK)
+			{
+				return result;
+			}
+		}
+	}
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvmStore_FindRecord
+ *
+ * Description: Look for a key in a bucket page.
+ *
+ * Parameters:
+ *            UInt8* pPageData: bucket page
+ *            gpNvmStore_Key key: record key
+ *
+ * Return value: UInt32: offset of the record in the page, 0 if the key is not in the bucket
+ */
+static UInt32 gpNvmStore_FindRecord(UInt8* pPageData, gpNvmStore_Key key)
+{
+	gpNvmStore_BucketHeader* pBucket = (gpNvmStore_BucketHeader*)pPageData;
+	gpNvmStore_Key recordKey;
+	UInt32 offset;
+
+	for(offset = sizeof(gpNvmStore_BucketHeader); offset < sizeof(gpNvmStore_BucketHeader) + pBucket->used;
+	    offset += GPNVM_STORE_RECORD_HEADER_SIZE + pPageData[offset + sizeof(gpNvmStore_Key)])
+	{
+		memcpy(&recordKey, &pPageData[offset], sizeof(recordKey));
+
+		if(recordKey == key)
+		{
+			return offset;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Name: gpNvmStore_GetBucket
+ *
+ * Description: Get the bucket page holding a key in RAM.
+ *
+ * Parameters:
+ *            UInt32 hash: hash of the key
+ *            UInt8 flags: gpNvmStore_GetPage flags
+ *            UInt32* pBucketPage: pointer to store the bucket page number
+ *            UInt8** ppPage: pointer to store the address of the bucket page in RAM
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the bucket page is in RAM
+ *                             GPNVM_ERROR_READING_FILE: a page could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: an evicted page could not be written into the file
+ */
+static gpNvm_Result gpNvmStore_GetBucket(UInt32 hash, UInt8 flags, UInt32* pBucketPage, UInt8** ppPage)
+{
+	gpNvm_Result result;
+
+	result = gpNvmStore_AccessDirectory(hash & (((UInt32)1 << gpNvmStore_StoreHeader.globalDepth) - 1), pBucketPage, 0);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	return gpNvmStore_GetPage(*pBucketPage, flags, ppPage);
+}
+
+/*
+ * Name: gpNvmStore_Flush
+ *
+ * Description: Commit the store: journal then write the dirty cached pages, sync the file, and write the header
+ * of the next generation. The journal of the previous generation is emptied.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the store is written and synced successfully
+ *                             GPNVM_ERROR_READING_FILE: a page to journal could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: the file or the journal could not be written or synced
+ */
+static gpNvm_Result gpNvmStore_Flush(void)
+{
+	gpNvm_Result result;
+
+	result = gpNvmStore_JournalPages();
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+
+	for(UInt16 slot = 0; slot < GPNVM_STORE_CACHE_PAGES; slot++)
+	{
+		if(((gpNvmStore_CachePageFlags[slot] & GPNVM_STORE_CACHE_DIRTY) != 0) && (gpNvmStore_CacheWritePage(slot) != GPNVM_OK))
+		{
+			return GPNVM_ERROR_WRITING_FILE;
+		}
+	}
+
+	//The header is written last, the pages it refers to are already in the file
+	gpNvmStore_StoreHeader.generation++;
+
+	if((fdatasync(gpNvmStore_FileDescriptor) != 0) ||
+	   (pwrite(gpNvmStore_FileDescriptor, &gpNvmStore_StoreHeader, sizeof(gpNvmStore_StoreHeader), 0) != sizeof(gpNvmStore_StoreHeader)) ||
+	   (fdatasync(gpNvmStore_FileDescriptor) != 0))
+	{
+		printf("[gpNvmStore][%s] Cannot write file %s! Abort.\n",__FUNCTION__,GPNVM_STORE_FILE_NAME);
+		gpNvmStore_StoreHeader.generation--;
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+	gpNvmStore_CommittedPages = gpNvmStore_StoreHeader.pageCount;
+
+	for(UInt16 slot = 0; slot < GPNVM_STORE_CACHE_PAGES; slot++)
+	{
+		gpNvmStore_CachePageFlags[slot] &= (UInt8)~GPNVM_STORE_CACHE_JOURNALED;
+	}
+
+	if((gpNvmStore_JournalEnd != 0) && (ftruncate(gpNvmStore_JournalDescriptor, 0) != 0))
+	{
+		printf("[gpNvmStore][%s] Cannot empty file %s! Abort.\n",__FUNCTION__,GPNVM_STORE_JOURNAL_NAME);
+		return GPNVM_ERROR_WRITING_FILE;
+	}
+	gpNvmStore_JournalEnd = 0;
+	return GPNVM_OK;
+}
+
+/* ==================================================================== */
+/* ========================== API Functions =========================== */
+/* ==================================================================== */
+
+/*
+ * Name: gpNvmStore_Init
+ *
+ * Description: Initialize the record store. Refer to API description in gpNvmStore.h.
+ */
+gpNvm_Result gpNvmStore_Init(void)
+{
+	gpNvm_Result result = GPNVM_OK;
+	gpNvmStore_BucketHeader* pBucket;
+	UInt8* pPageData;
+	ssize_t readSize;
+	UInt32 bucketPage = 2;
+
+	if(gpNvmStore_FileDescriptor >= 0)
+	{
+		printf("[gpNvmStore][%s] Record store is already initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_ALREADY_INITIALIZED;
+	}
+	gpNvmStore_FileDescriptor = open(GPNVM_STORE_FILE_NAME, O_RDWR | O_CREAT, 0644);
+
+	if(gpNvmStore_FileDescriptor < 0)
+	{
+		printf("[gpNvmStore][%s] Cannot open file %s! Abort.\n",__FUNCTION__,GPNVM_STORE_FILE_NAME);
+		return GPNVM_ERROR_OPENING_FILE;
+	}
+	gpNvmStore_JournalDescriptor = open(GPNVM_STORE_JOURNAL_NAME, O_RDWR | O_CREAT, 0644);
+
+	if(gpNvmStore_JournalDescriptor < 0)
+	{
+		printf("[gpNvmStore][%s] Cannot open file %s! Abort.\n",__FUNCTION__,GPNVM_STORE_JOURNAL_NAME);
+		close(gpNvmStore_FileDescriptor);
+		gpNvmStore_FileDescriptor = -1;
+		return GPNVM_ERROR_OPENING_FILE;
+	}
+	gpNvmStore_CacheReset();
+	gpNvmStore_JournalEnd = 0;
+	gpNvmStore_CommittedPages = 0;
+	memset(&gpNvmStore_StoreHeader, 0, sizeof(gpNvmStore_StoreHeader));
+	readSize = pread(gpNvmStore_FileDescriptor, &gpNvmStore_StoreHeader, sizeof(gpNvmStore_StoreHeader), 0);
+
+	if(readSize == 0)
+	{
+		//Empty file: header in page 0, a one entry directory in page 1 and an empty bucket in page 2
+		gpNvmStore_StoreHeader.magic = GPNVM_STORE_MAGIC;
+		gpNvmStore_StoreHeader.pageSize = GPNVM_STORE_PAGE_SIZE;
+		gpNvmStore_StoreHeader.globalDepth = 0;
+		gpNvmStore_StoreHeader.directoryPage = 1;
+		gpNvmStore_StoreHeader.pageCount = 3;
+		gpNvmStore_StoreHeader.freePage = GPNVM_STORE_NO_PAGE;
+		gpNvmStore_StoreHeader.records = 0;
+		gpNvmStore_StoreHeader.generation = 0;
+		result = gpNvmStore_GetPage(gpNvmStore_StoreHeader.directoryPage, GPNVM_STORE_PAGE_NEW, &pPageData);
+
+		if(result == GPNVM_OK)
+		{
+			result = gpNvmStore_GetPage(bucketPage, GPNVM_STORE_PAGE_NEW, &pPageData);
+		}
+
+		if(result == GPNVM_OK)
+		{
+			pBucket = (gpNvmStore_BucketHeader*)pPageData;
+			pBucket->localDepth = 0;
+			result = gpNvmStore_AccessDirectory(0, &bucketPage, 1);
+		}
+
+		if(result == GPNVM_OK)
+		{
+			result = gpNvmStore_Flush();
+		}
+	}
+	else if((readSize != sizeof(gpNvmStore_StoreHeader)) || (gpNvmStore_StoreHeader.magic != GPNVM_STORE_MAGIC) ||
+	        (gpNvmStore_StoreHeader.pageSize != GPNVM_STORE_PAGE_SIZE))
+	{
+		printf("[gpNvmStore][%s] File %s is not a record store with %u bytes pages! Abort.\n",__FUNCTION__,GPNVM_STORE_FILE_NAME,GPNVM_STORE_PAGE_SIZE);
+		result = GPNVM_ERROR_READING_FILE;
+	}
+	else
+	{
+		//Undo the pages written after the last commit
+		result = gpNvmStore_Rollback();
+		gpNvmStore_CommittedPages = gpNvmStore_StoreHeader.pageCount;
+	}
+
+	if(result != GPNVM_OK)
+	{
+		close(gpNvmStore_JournalDescriptor);
+		close(gpNvmStore_FileDescriptor);
+		gpNvmStore_JournalDescriptor = -1;
+		gpNvmStore_FileDescriptor = -1;
+	}
+	return result;
+}
+
+/*
+ * Name: gpNvmStore_Uninit
+ *
+ * Description: Uninitialize the record store. Refer to API description in gpNvmStore.h.
+ */
+gpNvm_Result gpNvmStore_Uninit(void)
+{
+	gpNvm_Result result;
+
+	if(gpNvmStore_FileDescriptor < 0)
+	{
+		printf("[gpNvmStore][%s] Record store is not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+	result = gpNvmStore_Flush();
+	close(gpNvmStore_JournalDescriptor);
+	close(gpNvmStore_FileDescriptor);
+	gpNvmStore_JournalDescriptor = -1;
+	gpNvmStore_FileDescriptor = -1;
+	return result;
+}
+
+/*
+ * Name: gpNvmStore_GetRecord
+ *
+ * Description: Get a record from the store. Refer to API description in gpNvmStore.h.
+ */
+gpNvm_Result gpNvmStore_GetRecord(gpNvmStore_Key key, UInt8* pLength, UInt8* pValue)
+{
+	gpNvm_Result result;
+	UInt8* pPageData;
+	UInt32 bucketPage, offset;
+	UInt8 length;
+
+	if(gpNvmStore_FileDescriptor < 0)
+	{
+		printf("[gpNvmStore][%s] Record store is not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if((pLength == NULL) || (pValue == NULL))
+	{
+		printf("[gpNvmStore][%s] Invalid parameters! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	result = gpNvmStore_GetBucket(gpNvmStore_Hash(key), 0, &bucketPage, &pPageData);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	offset = gpNvmStore_FindRecord(pPageData, key);
+
+	if(offset == 0)
+	{
+		return GPNVM_ERROR_INVALID_ATTRIBUTE_ID;
+	}
+	length = pPageData[offset + sizeof(gpNvmStore_Key)];
+
+	if(gpNvmStore_CalculateChecksum(&pPageData[offset + GPNVM_STORE_RECORD_HEADER_SIZE], length) != pPageData[offset + sizeof(gpNvmStore_Key) + 1])
+	{
+		printf("[gpNvmStore][%s] Record %u data is corrupted! Abort.\n",__FUNCTION__,key);
+		return GPNVM_ERROR_CORRUPTED_ATTRIBUTE;
+	}
+	*pLength = length;
+	memcpy(pValue, &pPageData[offset + GPNVM_STORE_RECORD_HEADER_SIZE], length);
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvmStore_SetRecord
+ *
+ * Description: Add or update a record. Refer to API description in gpNvmStore.h.
+ */
+gpNvm_Result gpNvmStore_SetRecord(gpNvmStore_Key key, UInt8 length, UInt8* pValue)
+{
+	gpNvm_Result result;
+	gpNvmStore_BucketHeader* pBucket;
+	UInt8* pPageData;
+	UInt32 hash = gpNvmStore_Hash(key);
+	UInt32 bucketPage, offset, oldSize;
+
+	if(gpNvmStore_FileDescriptor < 0)
+	{
+		printf("[gpNvmStore][%s] Record store is not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if((pValue == NULL) && (length != 0))
+	{
+		printf("[gpNvmStore][%s] Invalid parameters! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+
+	while(1)
+	{
+		result = gpNvmStore_GetBucket(hash, 0, &bucketPage, &pPageData);
+
+		if(result != GPNVM_OK)
+		{
+			return result;
+		}
+		pBucket = (gpNvmStore_BucketHeader*)pPageData;
+		offset = gpNvmStore_FindRecord(pPageData, key);
+		oldSize = (offset != 0) ? GPNVM_STORE_RECORD_HEADER_SIZE + pPageData[offset + sizeof(gpNvmStore_Key)] : 0;
+
+		if((offset != 0) && (pPageData[offset + sizeof(gpNvmStore_Key)] == length))
+		{
+			if((length == 0) || (memcmp(&pPageData[offset + GPNVM_STORE_RECORD_HEADER_SIZE], pValue, length) == 0))
+			{
+				//Same value already stored, nothing to be done
+				return GPNVM_OK;
+			}
+			//Same length: update the value in place
+			result = gpNvmStore_GetPage(bucketPage, GPNVM_STORE_PAGE_WRITE, &pPageData);
+
+			if(result == GPNVM_OK)
+			{
+				pPageData[offset + sizeof(gpNvmStore_Key) + 1] = gpNvmStore_CalculateChecksum(pValue, length);
+				memcpy(&pPageData[offset + GPNVM_STORE_RECORD_HEADER_SIZE], pValue, length);
+			}
+			return result;
+		}
+
+		if(pBucket->used - oldSize + GPNVM_STORE_RECORD_HEADER_SIZE + length <= GPNVM_STORE_BUCKET_SPACE)
+		{
+			break;
+		}
+		//Not enough space left in the bucket even without the old record, split it and look again
+		result = gpNvmStore_SplitBucket(bucketPage, hash);
+
+		if(result != GPNVM_OK)
+		{
+			return result;
+		}
+	}
+	result = gpNvmStore_GetPage(bucketPage, GPNVM_STORE_PAGE_WRITE, &pPageData);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	pBucket = (gpNvmStore_BucketHeader*)pPageData;
+
+	if(offset != 0)
+	{
+		//Remove the old record, the following records are moved down
+		memmove(&pPageData[offset], &pPageData[offset + oldSize], sizeof(gpNvmStore_BucketHeader) + pBucket->used - offset - oldSize);
+		pBucket->used = (UInt16)(pBucket->used - oldSize);
+		pBucket->count--;
+		gpNvmStore_StoreHeader.records--;
+	}
+	//Append the record at the end of the bucket
+	offset = sizeof(gpNvmStore_BucketHeader) + pBucket->used;
+	memcpy(&pPageData[offset], &key, sizeof(key));
+	pPageData[offset + sizeof(key)] = length;
+	pPageData[offset + sizeof(key) + 1] = gpNvmStore_CalculateChecksum(pValue, length);
+	memcpy(&pPageData[offset + GPNVM_STORE_RECORD_HEADER_SIZE], pValue, length);
+	pBucket->used = (UInt16)(pBucket->used + GPNVM_STORE_RECORD_HEADER_SIZE + length);
+	pBucket->count++;
+	gpNvmStore_StoreHeader.records++;
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvmStore_DeleteRecord
+ *
+ * Description: Remove a record from the store. Refer to API description in gpNvmStore.h.
+ */
+gpNvm_Result gpNvmStore_DeleteRecord(gpNvmStore_Key key)
+{
+	gpNvm_Result result;
+	gpNvmStore_BucketHeader* pBucket;
+	UInt8* pPageData;
+	UInt32 bucketPage, offset, recordSize;
+
+	if(gpNvmStore_FileDescriptor < 0)
+	{
+		printf("[gpNvmStore][%s] Record store is not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+	result = gpNvmStore_GetBucket(gpNvmStore_Hash(key), 0, &bucketPage, &pPageData);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	offset = gpNvmStore_FindRecord(pPageData, key);
+
+	if(offset == 0)
+	{
+		return GPNVM_ERROR_INVALID_ATTRIBUTE_ID;
+	}
+	result = gpNvmStore_GetPage(bucketPage, GPNVM_STORE_PAGE_WRITE, &pPageData);
+
+	if(result != GPNVM_OK)
+	{
+		return result;
+	}
+	pBucket = (gpNvmStore_BucketHeader*)pPageData;
+	recordSize = GPNVM_STORE_RECORD_HEADER_SIZE + pPageData[offset + sizeof(gpNvmStore_Key)];
+	memmove(&pPageData[offset], &pPageData[offset + recordSize], sizeof(gpNvmStore_BucketHeader) + pBucket->used - offset - recordSize);
+	pBucket->used = (UInt16)(pBucket->used - recordSize);
+	pBucket->count--;
+	gpNvmStore_StoreHeader.records--;
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvmStore_GetStats
+ *
+ * Description: Get the record store counters. Refer to API description in gpNvmStore.h.
+ */
+gpNvm_Result gpNvmStore_GetStats(gpNvmStore_Stats* pStats)
+{
+	if(gpNvmStore_FileDescriptor < 0)
+	{
+		printf("[gpNvmStore][%s] Record store is not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+
+	if(pStats == NULL)
+	{
+		printf("[gpNvmStore][%s] Invalid parameters! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_INVALID_PARAMETERS;
+	}
+	pStats->records = gpNvmStore_StoreHeader.records;
+	pStats->pages = gpNvmStore_StoreHeader.pageCount;
+	pStats->globalDepth = (UInt8)gpNvmStore_StoreHeader.globalDepth;
+	pStats->cache = gpNvmStore_CacheStatistics;
+	return GPNVM_OK;
+}
+
+/*
+ * Name: gpNvmStore_Sync
+ *
+ * Description: Durability point of the record store. Refer to API description in gpNvmStore.h.
+ */
+gpNvm_Result gpNvmStore_Sync(void)
+{
+	if(gpNvmStore_FileDescriptor < 0)
+	{
+		printf("[gpNvmStore][%s] Record store is not initialized! Abort.\n",__FUNCTION__);
+		return GPNVM_ERROR_NOT_INITIALIZED;
+	}
+	return gpNvmStore_Flush();
+}
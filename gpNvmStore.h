@@ -0,0 +1,172 @@
+/*
+ * File gpNvmStore.h
+ *
+ * Non-volatile record store with an on-disk extendible hash index.
+ * For simplicity, the underlying non-volatile memory is modeled as a file
+ *
+ */
+
+#ifndef _GPNVMSTORE_H_
+#define _GPNVMSTORE_H_
+/* ==================================================================== */
+/* ========================== Include files =========================== */
+/* ==================================================================== */
+
+#include "gpNvm.h"
+
+/* ==================================================================== */
+/* ====================== Macros and constants  ======================= */
+/* ==================================================================== */
+#define GPNVM_STORE_FILE_NAME                "gpNvmStore"   /* File to be used to emulate the record store */
+#define GPNVM_STORE_JOURNAL_NAME             "gpNvmStore-journal"   /* Pages of the store as of the last sync, rolled back after a crash */
+
+#ifndef GPNVM_STORE_PAGE_SIZE
+#define GPNVM_STORE_PAGE_SIZE                4096     /* Size of a bucket or directory page in the file, unit of file I/O */
+#endif
+#ifndef GPNVM_STORE_CACHE_PAGES
+#define GPNVM_STORE_CACHE_PAGES              16       /* Number of pages cached in RAM, costs as many pages of RAM */
+#endif
+#ifndef GPNVM_STORE_MAX_DEPTH
+#define GPNVM_STORE_MAX_DEPTH                24       /* Maximum number of hash bits used by the directory, limits it to 2^depth buckets */
+#endif
+
+/* ==================================================================== */
+/* ========================== Types Definition ======================== */
+/* ==================================================================== */
+
+typedef UInt32 gpNvmStore_Key;
+
+/* Counters of the record store */
+typedef struct
+{
+	UInt32 records;                     /* Number of records stored */
+	UInt32 pages;                       /* Number of pages in the file, header and free pages included */
+	UInt8 globalDepth;                  /* Number of hash bits used by the directory */
+	gpNvm_CacheStats cache;             /* Counters of the page cache since gpNvmStore_Init */
+} gpNvmStore_Stats;
+
+/* ==================================================================== */
+/* ======================= Functions prototypes ======================= */
+/* ==================================================================== */
+
+/*
+ * Name: gpNvmStore_Init
+ *
+ * Description: Initialize the record store. It opens the file emulating the store, creates an empty store
+ * (header, one directory page and one bucket) if the file is empty, or reads its header if not. The pages written
+ * after the last gpNvmStore_Sync by a process that crashed are rolled back from the journal (GPNVM_STORE_JOURNAL_NAME).
+ * Records are not loaded, pages are read on demand into the page cache.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the store is initialized successfully
+ *                             GPNVM_ERROR_ALREADY_INITIALIZED: the store is already initialized
+ *                             GPNVM_ERROR_OPENING_FILE: the file emulating the store cannot be opened
+ *                             GPNVM_ERROR_READING_FILE: the file is not a record store with GPNVM_STORE_PAGE_SIZE pages
+ *                             GPNVM_ERROR_WRITING_FILE: the new store could not be written or synced, or could not be rolled back
+ */
+gpNvm_Result gpNvmStore_Init(void);
+
+/*
+ * Name: gpNvmStore_Uninit
+ *
+ * Description: Uninitialize the record store. The dirty cached pages and the header are written into the file,
+ * the file is synced to the storage device then closed.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the store is uninitialized successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the store is not initialized
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced
+ */
+gpNvm_Result gpNvmStore_Uninit(void);
+
+/*
+ * Name: gpNvmStore_GetRecord
+ *
+ * Description: Get a record from the store. The directory gives the bucket page of the key, so a lookup
+ * reads at most one directory page and one bucket page. The record CRC is checked before it is copied.
+ *
+ * Parameters:
+ *            gpNvmStore_Key key: record key
+ *            UInt8* pLength: pointer to a variable that will store the length of the record value
+ *            UInt8* pValue: pointer to store the record value (up to 255 bytes)
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the record is read successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the store is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: pointers provided as arguments to the function are not valid
+ *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the key is not in the store
+ *                             GPNVM_ERROR_CORRUPTED_ATTRIBUTE: the record value is corrupted
+ *                             GPNVM_ERROR_READING_FILE: a page could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: an evicted page could not be written into the file
+ */
+gpNvm_Result gpNvmStore_GetRecord(gpNvmStore_Key key, UInt8* pLength, UInt8* pValue);
+
+/*
+ * Name: gpNvmStore_SetRecord
+ *
+ * Description: Add or update a record. Unlike gpNvm attributes, the new value can have any length.
+ * A full bucket is split in two and the directory is doubled when needed, so an insert reads and
+ * writes a constant number of pages apart from the rare directory doubling.
+ * The record is durable after the next gpNvmStore_Sync or gpNvmStore_Uninit.
+ *
+ * Parameters:
+ *            gpNvmStore_Key key: record key
+ *            UInt8 length: length of the record value
+ *            UInt8* pValue: pointer to the record value
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the record is written successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the store is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: pointers provided as arguments to the function are not valid
+ *                             GPNVM_ERROR_MEMORY_FULL: the directory reached GPNVM_STORE_MAX_DEPTH
+ *                             GPNVM_ERROR_READING_FILE: a page could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: an evicted page could not be written into the file
+ */
+gpNvm_Result gpNvmStore_SetRecord(gpNvmStore_Key key, UInt8 length, UInt8* pValue);
+
+/*
+ * Name: gpNvmStore_DeleteRecord
+ *
+ * Description: Remove a record from the store. Its space is reused by the next records of the same bucket,
+ * buckets are never merged.
+ *
+ * Parameters:
+ *            gpNvmStore_Key key: record key
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the record is removed successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the store is not initialized
+ *                             GPNVM_ERROR_INVALID_ATTRIBUTE_ID: the key is not in the store
+ *                             GPNVM_ERROR_READING_FILE: a page could not be read from the file
+ *                             GPNVM_ERROR_WRITING_FILE: an evicted page could not be written into the file
+ */
+gpNvm_Result gpNvmStore_DeleteRecord(gpNvmStore_Key key);
+
+/*
+ * Name: gpNvmStore_GetStats
+ *
+ * Description: Get the number of records, the size of the store and the page cache counters.
+ *
+ * Parameters:
+ *            gpNvmStore_Stats* pStats: pointer to store the counters
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: counters are read successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the store is not initialized
+ *                             GPNVM_ERROR_INVALID_PARAMETERS: the pointer provided as argument is not valid
+ */
+gpNvm_Result gpNvmStore_GetStats(gpNvmStore_Stats* pStats);
+
+/*
+ * Name: gpNvmStore_Sync
+ *
+ * Description: Durability point. The dirty cached pages and the header are written into the file and synced
+ * to the storage device, so all the records set before this call are on the device when it returns.
+ *
+ * Parameters: None
+ *
+ * Return value: gpNvm_Result: GPNVM_OK: the store is synced successfully
+ *                             GPNVM_ERROR_NOT_INITIALIZED: the store is not initialized
+ *                             GPNVM_ERROR_WRITING_FILE: the file could not be written or synced
+ */
+gpNvm_Result gpNvmStore_Sync(void);
+
+#endif //_GPNVMSTORE_H_
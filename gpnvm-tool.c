@@ -0,0 +1,523 @@
+/*
+ * File gpnvm-tool.c
+ *
+ * Offline tool triaging non-volatile memory images, e.g. copied from devices. dump, verify and stats map the
+ * image read-only (GPNVM_STORAGE_READ_ONLY), so only the pages of the attributes read are loaded.
+ *
+ * Usage: gpnvm-tool <image> dump [--json]   print the attributes, in hex or as JSON
+ *        gpnvm-tool <image> verify          check the CRC of every attribute, exit status 1 if one is corrupted
+ *        gpnvm-tool <image> stats           print the space usage and fragmentation of the user attributes data area
+ *        gpnvm-tool <image> compact         reclaim the space of deleted attributes, keeping <image>.bak until it verifies
+ *        gpnvm-tool <image> upgrade         convert an image of an older format version to the current one
+ *        gpnvm-tool <image> diff <base> [<delta>]  print the attributes differing from the image <base>, and write the
+ *                                                  delta turning <base> into <image>, exit status 1 if they differ
+ *        gpnvm-tool <image> apply <delta>   apply a delta written by diff
+ *
+ * The messages of the component are sent to stderr, so the output can be parsed.
+ *
+ */
+
+/* ==================================================================== */
+/* ========================== Include files =========================== */
+/* ==================================================================== */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "gpNvm.h"
+
+/* ==================================================================== */
+/* ====================== Macros and constants  ======================= */
+/* ==================================================================== */
+
+#define TOOL_BACKUP_SUFFIX        ".bak"
+#define TOOL_COPY_BUFFER_SIZE     4096
+
+/* ==================================================================== */
+/* ========================= Global variables ========================= */
+/* ==================================================================== */
+
+/* Output of the tool, stdout before it is redirected to stderr for the messages of the component */
+static FILE* gpTool_Output = NULL;
+
+/* Delta built by diff or read by apply */
+static UInt8 gpTool_Delta[GPNVM_DELTA_MAX_SIZE];
+
+/* ==================================================================== */
+/* ==================== Local functions Definition ==================== */
+/* ==================================================================== */
+
+/*
+ * Name: gpTool_Open
+ *
+ * Description: Open the image with the component.
+ *
+ * Parameters:
+ *            const char* pImage: path of the image
+ *            UInt8 readOnly: 1 to map the image read-only, 0 to open it read-write
+ *
+ * Return value: int: 0 if the image is opened, -1 otherwise
+ */
+static int gpTool_Open(const char* pImage, UInt8 readOnly)
+{
+    gpNvm_Result result;
+
+    if((gpNvm_SetFileName(pImage) != GPNVM_OK) ||
+       (gpNvm_SetStorageOptions(readOnly ? GPNVM_STORAGE_READ_ONLY : 0) != GPNVM_OK))
+    {
+        return -1;
+    }
+
+    if(!readOnly && (access(pImage, F_OK) != 0))
+    {
+        //gpNvm_Init would create an empty image
+        fprintf(stderr, "Image %s does not exist!\n", pImage);
+        return -1;
+    }
+    result = gpNvm_Init();
+
+    if(result != GPNVM_OK)
+    {
+        fprintf(stderr, "Cannot open image %s (error %d)!%s\n", pImage, result,
+                readOnly ? " An image of an older format must be upgraded first." : "");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Name: gpTool_Dump
+ *
+ * Description: Print every stored attribute: id, length and value in hex, or a JSON array of objects.
+ * A corrupted attribute is reported instead of its value.
+ *
+ * Parameters:
+ *            UInt8 json: 1 for JSON, 0 for hex lines
+ *
+ * Return value: int: 0 if all the attributes are read, 1 if one is corrupted, -1 on error
+ */
+static int gpTool_Dump(UInt8 json)
+{
+    UInt8 value[255];
+    UInt8 length;
+    UInt8 first = 1;
+    int status = 0;
+    gpNvm_AttrId ids[256];
+    UInt16 count = 0;
+    gpNvm_Result result;
+
+    if(gpNvm_ListAttributes(ids, &count) != GPNVM_OK)
+    {
+        return -1;
+    }
+    fputs(json ? "[" : "", gpTool_Output);
+
+    for(UInt16 cpt = 0; cpt < count; cpt++)
+    {
+        result = gpNvm_GetAttribute(ids[cpt], &length, value);
+
+        if((result != GPNVM_OK) && (result != GPNVM_ERROR_CORRUPTED_ATTRIBUTE))
+        {
+            return -1;
+        }
+
+        if(json)
+        {
+            fprintf(gpTool_Output, "%s\n  {\"id\": %u, ", first ? "" : ",", ids[cpt]);
+        }
+        else
+        {
+            fprintf(gpTool_Output, "0x%02x ", ids[cpt]);
+        }
+        first = 0;
+
+        if(result == GPNVM_ERROR_CORRUPTED_ATTRIBUTE)
+        {
+            fputs(json ? "\"error\": \"corrupted\"}" : "corrupted\n", gpTool_Output);
+            status = 1;
+            continue;
+        }
+        fprintf(gpTool_Output, json ? "\"length\": %u, \"value\": \"" : "[%3u] ", length);
+
+        for(UInt16 cpt = 0; cpt < length; cpt++)
+        {
+            fprintf(gpTool_Output, json ? "%02x" : "%02x ", value[cpt]);
+        }
+        fputs(json ? "\"}" : "\n", gpTool_Output);
+    }
+    fputs(json ? "\n]\n" : "", gpTool_Output);
+    return status;
+}
+
+/*
+ * Name: gpTool_Verify
+ *
+ * Description: Read every stored attribute and report the ones failing their CRC check.
+ *
+ * Parameters: None
+ *
+ * Return value: int: 0 if no attribute is corrupted, 1 otherwise, -1 on error
+ */
+static int gpTool_Verify(void)
+{
+    UInt8 value[255];
+    UInt8 length;
+    UInt16 valid = 0, corrupted = 0;
+    gpNvm_AttrId ids[256];
+    UInt16 count = 0;
+    gpNvm_Result result;
+
+    if(gpNvm_ListAttributes(ids, &count) != GPNVM_OK)
+    {
+        return -1;
+    }
+
+    for(UInt16 cpt = 0; cpt < count; cpt++)
+    {
+        result = gpNvm_GetAttribute(ids[cpt], &length, value);
+
+        if(result == GPNVM_OK)
+        {
+            valid++;
+        }
+        else if(result == GPNVM_ERROR_CORRUPTED_ATTRIBUTE)
+        {
+            fprintf(gpTool_Output, "0x%02x corrupted\n", ids[cpt]);
+            corrupted++;
+        }
+        else
+        {
+            return -1;
+        }
+    }
+    fprintf(gpTool_Output, "%u attributes valid, %u corrupted\n", valid, corrupted);
+    return (corrupted == 0) ? 0 : 1;
+}
+
+/*
+ * Name: gpTool_Stats
+ *
+ * Description: Print the space usage of the user attributes data area and its fragmentation, the part of the space
+ * before the end of the last attribute that is not used by an attribute.
+ *
+ * Parameters: None
+ *
+ * Return value: int: 0 if the statistics are printed, -1 on error
+ */
+static int gpTool_Stats(void)
+{
+    gpNvm_SpaceStats stats;
+
+    if(gpNvm_GetSpaceStats(&stats) != GPNVM_OK)
+    {
+        return -1;
+    }
+    fprintf(gpTool_Output, "attributes:     %u (%u counters)\n", stats.attributes, stats.counters);
+    fprintf(gpTool_Output, "user area:      %u bytes\n", stats.userMemorySize);
+    fprintf(gpTool_Output, "used:           %u bytes\n", stats.usedBytes);
+    fprintf(gpTool_Output, "free:           %u bytes after the last attribute\n", stats.userMemorySize - stats.userMemoryEnd);
+    fprintf(gpTool_Output, "holes:          %u, %u bytes, largest %u bytes\n", stats.holes, stats.holeBytes, stats.largestHole);
+    fprintf(gpTool_Output, "fragmentation:  %u%%\n", (stats.userMemoryEnd == 0) ? 0 : (100*stats.holeBytes)/stats.userMemoryEnd);
+#if GPNVM_COMPRESSION > 0
+    fprintf(gpTool_Output, "compressed:     %u attributes\n", stats.compressed);
+#endif
+#if GPNVM_DEDUP > 0
+    fprintf(gpTool_Output, "shared:         %u attributes sharing the value of another one\n", stats.shared);
+#endif
+#if (GPNVM_COMPRESSION > 0) || (GPNVM_DEDUP > 0)
+    fprintf(gpTool_Output, "saved:          %u bytes\n", stats.savedBytes);
+#endif
+    return 0;
+}
+
+/*
+ * Name: gpTool_Copy
+ *
+ * Description: Copy a file, and sync the copy.
+ *
+ * Parameters:
+ *            const char* pFrom: path of the file to copy
+ *            const char* pTo: path of the copy, replaced if it exists
+ *
+ * Return value: int: 0 if the file is copied, -1 otherwise
+ */
+static int gpTool_Copy(const char* pFrom, const char* pTo)
+{
+    char buffer[TOOL_COPY_BUFFER_SIZE];
+    ssize_t length = 0;
+    int status = 0;
+    int from = open(pFrom, O_RDONLY);
+    int to = open(pTo, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    while((from >= 0) && (to >= 0) && ((length = read(from, buffer, sizeof(buffer))) > 0))
+    {
+        if(write(to, buffer, length) != length)
+        {
+            break;
+        }
+    }
+
+    if((from < 0) || (to < 0) || (length != 0) || (fsync(to) != 0))
+    {
+        fprintf(stderr, "Cannot copy %s to %s!\n", pFrom, pTo);
+        status = -1;
+    }
+
+    if(from >= 0)
+    {
+        close(from);
+    }
+
+    if(to >= 0)
+    {
+        close(to);
+    }
+    return status;
+}
+
+/*
+ * Name: gpTool_Compact
+ *
+ * Description: Compact the image opened read-write, with a backup copy kept until the compacted image is synced and
+ * every attribute of it passes its CRC check.
+ *
+ * Parameters:
+ *            const char* pImage: path of the image
+ *
+ * Return value: int: 0 if the image is compacted, -1 otherwise
+ */
+static int gpTool_Compact(const char* pImage)
+{
+    char backup[4096];
+    gpNvm_SpaceStats stats;
+    int status = 0;
+
+    snprintf(backup, sizeof(backup), "%s%s", pImage, TOOL_BACKUP_SUFFIX);
+
+    if((gpTool_Copy(pImage, backup) != 0) || (gpTool_Open(pImage, 0) != 0))
+    {
+        return -1;
+    }
+
+    if((gpNvm_GetSpaceStats(&stats) != GPNVM_OK) || (gpNvm_Compact() != GPNVM_OK))
+    {
+        status = -1;
+    }
+
+    if((gpNvm_Uninit() != GPNVM_OK) || (status != 0))
+    {
+        fprintf(stderr, "Compaction failed, the original image is kept in %s!\n", backup);
+        return -1;
+    }
+    fprintf(gpTool_Output, "%u bytes reclaimed from %u holes\n", stats.holeBytes, stats.holes);
+
+    //Read the compacted image back before dropping the backup
+    if(gpTool_Open(pImage, 1) != 0)
+    {
+        status = -1;
+    }
+    else
+    {
+        status = (gpTool_Verify() == 0) ? 0 : -1;
+
+        if(gpNvm_Uninit() != GPNVM_OK)
+        {
+            status = -1;
+        }
+    }
+
+    if(status != 0)
+    {
+        fprintf(stderr, "Verification of the compacted image failed, the original image is kept in %s!\n", backup);
+        return -1;
+    }
+    unlink(backup);
+    return 0;
+}
+
+/*
+ * Name: gpTool_Diff
+ *
+ * Description: Compare the image with a base image: the signature of the base is computed, then the delta turning the
+ * base into the image is built and its records are printed. Both images are mapped read-only.
+ *
+ * Parameters:
+ *            const char* pImage: path of the image
+ *            const char* pBase: path of the base image
+ *            const char* pDeltaFile: path of the file to write the delta into, or NULL
+ *
+ * Return value: int: 0 if the images hold the same attributes, 1 if they differ, -1 on error
+ */
+static int gpTool_Diff(const char* pImage, const char* pBase, const char* pDeltaFile)
+{
+    gpNvm_Signature signature;
+    UInt32 length = 0, offset = GPNVM_DELTA_HEADER_SIZE, counter = 0;
+    UInt16 count = 0;
+    gpNvm_Result result;
+    FILE* pFile;
+
+    if((gpTool_Open(pBase, 1) != 0) || (gpNvm_GetSignature(&signature) != GPNVM_OK) || (gpNvm_Uninit() != GPNVM_OK) ||
+       (gpTool_Open(pImage, 1) != 0))
+    {
+        return -1;
+    }
+
+    result = gpNvm_DiffCreate(&signature, gpTool_Delta, sizeof(gpTool_Delta), &length);
+
+    if((gpNvm_Uninit() != GPNVM_OK) || (result != GPNVM_OK))
+    {
+        return -1;
+    }
+    memcpy(&count, &gpTool_Delta[sizeof(UInt32)], sizeof(UInt16));
+
+    for(UInt16 cpt = 0; cpt < count; cpt++)
+    {
+        //[type][attrId][length][value]
+        if(gpTool_Delta[offset] == GPNVM_DELTA_DELETE)
+        {
+            fprintf(gpTool_Output, "0x%02x deleted\n", gpTool_Delta[offset + 1]);
+        }
+        else if(gpTool_Delta[offset] == GPNVM_DELTA_COUNTER)
+        {
+            memcpy(&counter, &gpTool_Delta[offset + 3], sizeof(UInt32));
+            fprintf(gpTool_Output, "0x%02x counter %u\n", gpTool_Delta[offset + 1], counter);
+        }
+        else
+        {
+            fprintf(gpTool_Output, "0x%02x [%3u] ", gpTool_Delta[offset + 1], gpTool_Delta[offset + 2]);
+
+            for(UInt16 byte = 0; byte < gpTool_Delta[offset + 2]; byte++)
+            {
+                fprintf(gpTool_Output, "%02x ", gpTool_Delta[offset + 3 + byte]);
+            }
+            fputs("\n", gpTool_Output);
+        }
+        offset += 3 + gpTool_Delta[offset + 2];
+    }
+    fprintf(gpTool_Output, "%u attributes differ, delta of %u bytes\n", count, length);
+
+    if(pDeltaFile != NULL)
+    {
+        pFile = fopen(pDeltaFile, "wb");
+
+        if((pFile == NULL) || (fwrite(gpTool_Delta, 1, length, pFile) != length) || (fclose(pFile) != 0))
+        {
+            fprintf(stderr, "Cannot write the delta into %s!\n", pDeltaFile);
+            return -1;
+        }
+    }
+    return (count == 0) ? 0 : 1;
+}
+
+/*
+ * Name: gpTool_Apply
+ *
+ * Description: Read a delta written by diff and apply it to the image opened read-write.
+ *
+ * Parameters:
+ *            const char* pImage: path of the image
+ *            const char* pDeltaFile: path of the delta
+ *
+ * Return value: int: 0 if the delta is applied, -1 otherwise
+ */
+static int gpTool_Apply(const char* pImage, const char* pDeltaFile)
+{
+    FILE* pFile = fopen(pDeltaFile, "rb");
+    size_t length = 0;
+    gpNvm_Result result;
+
+    if(pFile != NULL)
+    {
+        length = fread(gpTool_Delta, 1, sizeof(gpTool_Delta), pFile);
+        fclose(pFile);
+    }
+
+    if(length == 0)
+    {
+        fprintf(stderr, "Cannot read the delta %s!\n", pDeltaFile);
+        return -1;
+    }
+
+    if(gpTool_Open(pImage, 0) != 0)
+    {
+        return -1;
+    }
+    result = gpNvm_DeltaApply(gpTool_Delta, length);
+
+    if((gpNvm_Uninit() != GPNVM_OK) || (result != GPNVM_OK))
+    {
+        fprintf(stderr, "Cannot apply the delta (error %d)!\n", result);
+        return -1;
+    }
+    fprintf(gpTool_Output, "Delta of %u bytes applied\n", (UInt32)length);
+    return 0;
+}
+
+/* ==================================================================== */
+/* ============================== Main ================================ */
+/* ==================================================================== */
+
+int main(int argc, char* argv[])
+{
+    const char* pImage = (argc > 2) ? argv[1] : NULL;
+    const char* pCommand = (argc > 2) ? argv[2] : "";
+    UInt8 readOnly = (strcmp(pCommand, "compact") != 0) && (strcmp(pCommand, "upgrade") != 0);
+    int status = -1;
+
+    //Keep stdout for the output, the component prints its messages on stdout
+    gpTool_Output = fdopen(dup(STDOUT_FILENO), "w");
+
+    if((gpTool_Output == NULL) || (dup2(STDERR_FILENO, STDOUT_FILENO) < 0))
+    {
+        return 2;
+    }
+
+    if((strcmp(pCommand, "dump") != 0) && (strcmp(pCommand, "verify") != 0) && (strcmp(pCommand, "stats") != 0) && readOnly &&
+       (((strcmp(pCommand, "diff") != 0) && (strcmp(pCommand, "apply") != 0)) || (argc < 4)))
+    {
+        fprintf(stderr, "Usage: %s <image> dump [--json] | verify | stats | compact | upgrade | diff <base> [<delta>] | apply <delta>\n", argv[0]);
+        return 2;
+    }
+
+    if(strcmp(pCommand, "compact") == 0)
+    {
+        status = gpTool_Compact(pImage);
+    }
+    else if(strcmp(pCommand, "diff") == 0)
+    {
+        status = gpTool_Diff(pImage, argv[3], (argc > 4) ? argv[4] : NULL);
+    }
+    else if(strcmp(pCommand, "apply") == 0)
+    {
+        status = gpTool_Apply(pImage, argv[3]);
+    }
+    else if(gpTool_Open(pImage, readOnly) == 0)
+    {
+        if(strcmp(pCommand, "dump") == 0)
+        {
+            status = gpTool_Dump((argc > 3) && (strcmp(argv[3], "--json") == 0));
+        }
+        else if(strcmp(pCommand, "verify") == 0)
+        {
+            status = gpTool_Verify();
+        }
+        else if(strcmp(pCommand, "stats") == 0)
+        {
+            status = gpTool_Stats();
+        }
+        else
+        {
+            //gpNvm_Init converted the image
+            status = 0;
+            fprintf(gpTool_Output, "%s is in the current format\n", pImage);
+        }
+
+        if(gpNvm_Uninit() != GPNVM_OK)
+        {
+            status = -1;
+        }
+    }
+    fclose(gpTool_Output);
+    return (status < 0) ? 2 : status;
+}
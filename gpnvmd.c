@@ -0,0 +1,20 @@
+/*
+ * File gpnvmd.c
+ *
+ * gpNvm daemon: serves the attributes of the non-volatile memory file to local clients
+ * until it is stopped by SIGTERM or SIGINT.
+ *
+ * Usage: gpnvmd [socket path]
+ *
+ */
+
+/* ==================================================================== */
+/* ========================== Include files =========================== */
+/* ==================================================================== */
+
+#include "gpNvmDaemon.h"
+
+int main(int argc, char* argv[])
+{
+    return (gpNvmDaemon_Run((argc > 1) ? argv[1] : GPNVM_DAEMON_SOCKET) == GPNVM_OK) ? 0 : 1;
+}
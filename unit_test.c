@@ -13,9 +13,22 @@
 /* ==================================================================== */
 /* ========================== Include files =========================== */
 /* ==================================================================== */
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include "gpNvm.h"
+#include "gpNvmStore.h"
+#include "gpNvmClient.h"
 
 /* ==================================================================== */
 /* ====================== Macros and constants  ======================= */
@@ -27,6 +40,55 @@
 #define ATTRIBUTE_ID_3            0x03
 #define ATTRIBUTE_ID_4            0x04
 #define ATTRIBUTE_ID_5            0x05
+#define ATTRIBUTE_ID_FIRST_BULK   0x10
+#define ATTRIBUTE_ID_LAST_BULK    0x3F
+#define BULK_MASK                 0xA5
+#define ATTRIBUTE_ID_SYNC         0x7A
+#define SYNC_INTERVAL_MS          50
+#define STORE_RECORDS             20000
+#define STORE_CRASH_RECORDS       5000
+#define ATTRIBUTE_ID_COUNTER      0x40
+#define CAS_THREADS               4
+#define CAS_INCREMENTS            250
+#define ATTRIBUTE_ID_BOOT_COUNTER 0x41
+#define COUNTER_INCREMENTS        100
+#define ATTRIBUTE_ID_FIRST_DELETE 0x60
+#define DELETE_ATTRIBUTES         3
+#define MIRROR_FILE_NAME          "gpNvmMirror"
+/* Header area of an image, GPNVM_HEADER_AREA_SIZE of gpNvm.c for a header shorter than a sector */
+#define UPGRADE_HEADER_SIZE       (((GPNVM_REGION_ALIGNMENT + GPNVM_SECTOR_SIZE - 1)/GPNVM_SECTOR_SIZE)*GPNVM_SECTOR_SIZE)
+#define UPGRADE_JOURNAL_MAGIC     0x47494D67
+#define ATTRIBUTE_ID_FEED         0x70
+#define FEED_CHANGES              200
+#define ATTRIBUTE_ID_MIRROR_ONLY  0xF0
+#define ATTRIBUTE_ID_HEAL         0x71
+#define ATTRIBUTE_ID_SPREAD       0x7E
+#define ATTRIBUTE_ID_NEIGHBOUR    0x7F
+#define ATTRIBUTE_ID_ECC          0x72
+#define ECC_LENGTH                32
+#define ECC_OPERATIONS            1000
+#define ATTRIBUTE_ID_SPARSE       0x73
+#define ATTRIBUTE_ID_PLAIN        0x74
+#define SPARSE_LENGTH             128
+#define ATTRIBUTE_ID_FIRST_SNAPSHOT 0x80
+#define SNAPSHOT_ATTRIBUTES       32
+#define SNAPSHOT_LENGTH           56
+#define ATTRIBUTE_ID_FIRST_DEDUP  0x75
+#define DEDUP_ATTRIBUTES          4
+#define DEDUP_LENGTH              24
+#define DEDUP_FILE_NAME           "gpNvmDedup"
+#define DEDUP_ENCODING_OFFSET     26
+#define ATTRIBUTE_ID_FIRST_DAEMON 0x50
+#define DAEMON_ATTRIBUTES         12
+#define DAEMON_RING_GETS          10000
+/* gpnvm-tool built with the same configuration, relative to the directory the test runs in */
+#ifndef TOOL_PATH
+#define TOOL_PATH                 "./gpnvm-tool"
+#endif
+#define TOOL_IMAGE_NAME           "gpNvmTool"
+#define ATTRIBUTE_ID_FIRST_TOOL   0x7B
+#define TOOL_ATTRIBUTES           3
+#define TOOL_OUTPUT_SIZE          4096
 
 /* ==================================================================== */
 /* ========================== Types Definition ======================== */
@@ -39,10 +101,2393 @@ typedef struct /*(__attribute__ ((__packed__)))*/{
     UInt8  data[MAX_LENGTH];
 } gpTestData_t;
 
+/* Journal of a format migration, same layout as gpNvm_Journal of gpNvm.c */
+typedef struct {
+    UInt32 magic;
+    UInt16 version;
+    UInt16 step;
+    UInt32 done;
+    UInt32 fileSize;
+    UInt8 crc;
+} gpTest_Journal;
+
+/* State of the gpNvm_BulkLoadStream reader of gpTest_BulkLoad */
+typedef struct {
+    UInt8 attrId;
+    UInt8 value[MAX_LENGTH];
+} gpTest_BulkStream;
+
 /* ==================================================================== */
 /* ======================= Functions Definition ======================= */
 /* ==================================================================== */
 
+/*
+ * Name: gpTest_ManyAttributes
+ *
+ * Description: Set attributes ATTRIBUTE_ID_FIRST_BULK to ATTRIBUTE_ID_LAST_BULK, each one filled with its id,
+ * then read them all back. With a small GPNVM_CACHE_RAM_BUDGET this forces pages to be evicted and reloaded.
+ *
+ * Return value: int: 0 if all attributes match, -1 otherwise
+ */
+static int gpTest_ManyAttributes(void)
+{
+    UInt8 writeData[MAX_LENGTH];
+    UInt8 readData[MAX_LENGTH];
+    UInt8 length;
+    gpNvm_CacheStats stats;
+
+    for(UInt8 attrId = ATTRIBUTE_ID_FIRST_BULK; attrId <= ATTRIBUTE_ID_LAST_BULK; attrId++)
+    {
+        memset(writeData, attrId, sizeof(writeData));
+
+        if(gpNvm_SetAttribute(attrId, sizeof(writeData), writeData) != GPNVM_OK)
+        {
+            printf("Cannot set attribute %d data into non-volatile memory!\n", attrId);
+            return -1;
+        }
+    }
+
+    for(UInt8 attrId = ATTRIBUTE_ID_FIRST_BULK; attrId <= ATTRIBUTE_ID_LAST_BULK; attrId++)
+    {
+        memset(writeData, attrId, sizeof(writeData));
+
+        if((gpNvm_GetAttribute(attrId, &length, readData) != GPNVM_OK) || (length != sizeof(writeData)) || (memcmp(writeData, readData, length) != 0))
+        {
+            printf("Error! Mismatch between written/read data of attribute %d!\n", attrId);
+            return -1;
+        }
+    }
+    gpNvm_GetCacheStats(&stats);
+    printf("Written/read data of attributes %d to %d match! (cache hits=%u misses=%u evictions=%u)\n",
+           ATTRIBUTE_ID_FIRST_BULK, ATTRIBUTE_ID_LAST_BULK, stats.hits, stats.misses, stats.evictions);
+    return 0;
+}
+
+/*
+ * Name: gpTest_CheckBulk
+ *
+ * Description: Read back attributes ATTRIBUTE_ID_FIRST_BULK to ATTRIBUTE_ID_LAST_BULK, each one expected to be
+ * filled with its id xored with a mask.
+ *
+ * Parameters:
+ *            UInt8 mask: mask xored with the id
+ *
+ * Return value: int: 0 if all attributes match, -1 otherwise
+ */
+static int gpTest_CheckBulk(UInt8 mask)
+{
+    UInt8 writeData[MAX_LENGTH];
+    UInt8 readData[MAX_LENGTH];
+    UInt8 length;
+
+    for(UInt8 attrId = ATTRIBUTE_ID_FIRST_BULK; attrId <= ATTRIBUTE_ID_LAST_BULK; attrId++)
+    {
+        memset(writeData, attrId ^ mask, sizeof(writeData));
+
+        if((gpNvm_GetAttribute(attrId, &length, readData) != GPNVM_OK) || (length != sizeof(writeData)) || (memcmp(writeData, readData, length) != 0))
+        {
+            printf("Error! Mismatch between bulk loaded/read data of attribute %d!\n", attrId);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Name: gpTest_ReadBulk
+ *
+ * Description: gpNvm_BulkReader giving attributes ATTRIBUTE_ID_FIRST_BULK to ATTRIBUTE_ID_LAST_BULK, each one
+ * filled with its id, one at a time from the same buffer.
+ *
+ * Parameters:
+ *            void* pContext: gpTest_BulkStream of the stream
+ *            gpNvm_BulkEntry* pEntry: pointer to store the next attribute
+ *
+ * Return value: UInt8: 1 if an attribute is given, 0 at the end
+ */
+static UInt8 gpTest_ReadBulk(void* pContext, gpNvm_BulkEntry* pEntry)
+{
+    gpTest_BulkStream* pStream = (gpTest_BulkStream*)pContext;
+
+    if(pStream->attrId > ATTRIBUTE_ID_LAST_BULK)
+    {
+        return 0;
+    }
+    memset(pStream->value, pStream->attrId, sizeof(pStream->value));
+    pEntry->attrId = pStream->attrId++;
+    pEntry->length = sizeof(pStream->value);
+    pEntry->pValue = pStream->value;
+    return 1;
+}
+
+/*
+ * Name: gpTest_BulkLoad
+ *
+ * Description: Update the attributes set by gpTest_ManyAttributes at once with gpNvm_BulkLoad, then restore them
+ * with gpNvm_BulkLoadStream, reading them all back after each load.
+ *
+ * Return value: int: 0 if all attributes match, -1 otherwise
+ */
+static int gpTest_BulkLoad(void)
+{
+    UInt8 bulkData[ATTRIBUTE_ID_LAST_BULK - ATTRIBUTE_ID_FIRST_BULK + 1][MAX_LENGTH];
+    gpNvm_BulkEntry entries[ATTRIBUTE_ID_LAST_BULK - ATTRIBUTE_ID_FIRST_BULK + 1];
+    gpTest_BulkStream stream = { .attrId = ATTRIBUTE_ID_FIRST_BULK };
+
+    for(UInt8 attrId = ATTRIBUTE_ID_FIRST_BULK; attrId <= ATTRIBUTE_ID_LAST_BULK; attrId++)
+    {
+        memset(bulkData[attrId - ATTRIBUTE_ID_FIRST_BULK], attrId ^ BULK_MASK, MAX_LENGTH);
+        entries[attrId - ATTRIBUTE_ID_FIRST_BULK].attrId = attrId;
+        entries[attrId - ATTRIBUTE_ID_FIRST_BULK].length = MAX_LENGTH;
+        entries[attrId - ATTRIBUTE_ID_FIRST_BULK].pValue = bulkData[attrId - ATTRIBUTE_ID_FIRST_BULK];
+    }
+
+    if(gpNvm_BulkLoad(entries, ATTRIBUTE_ID_LAST_BULK - ATTRIBUTE_ID_FIRST_BULK + 1) != GPNVM_OK)
+    {
+        printf("Cannot bulk load attributes %d to %d into non-volatile memory!\n", ATTRIBUTE_ID_FIRST_BULK, ATTRIBUTE_ID_LAST_BULK);
+        return -1;
+    }
+
+    if(gpTest_CheckBulk(BULK_MASK) != 0)
+    {
+        return -1;
+    }
+
+    if(gpNvm_BulkLoadStream(gpTest_ReadBulk, &stream) != GPNVM_OK)
+    {
+        printf("Cannot stream attributes %d to %d into non-volatile memory!\n", ATTRIBUTE_ID_FIRST_BULK, ATTRIBUTE_ID_LAST_BULK);
+        return -1;
+    }
+
+    if(gpTest_CheckBulk(0) != 0)
+    {
+        return -1;
+    }
+    printf("Bulk loaded/read data of attributes %d to %d match!\n", ATTRIBUTE_ID_FIRST_BULK, ATTRIBUTE_ID_LAST_BULK);
+    return 0;
+}
+
+/*
+ * Name: gpTest_SyncDeadline
+ *
+ * Description: With GPNVM_SYNC_PERIODIC, set an attribute right after a sync, so that its sync is deferred, then stay
+ * idle past the interval: the write must be synced without any other call. The policy of the test is restored after.
+ *
+ * Return value: int: 0 if the deferred write is synced in time, -1 otherwise
+ */
+static int gpTest_SyncDeadline(void)
+{
+    UInt8 writeData = 0x5D;
+    UInt8 readData[MAX_LENGTH];
+    UInt8 length = 0;
+    gpNvm_CacheStats before, deferred, after;
+
+    //A value different from the stored one, so that the set writes
+    if((gpNvm_GetAttribute(ATTRIBUTE_ID_SYNC, &length, readData) == GPNVM_OK) && (readData[0] == 0x5D))
+    {
+        writeData = 0xD5;
+    }
+
+    if((gpNvm_SetSyncPolicy(GPNVM_SYNC_PERIODIC, SYNC_INTERVAL_MS) != GPNVM_OK) || (gpNvm_Sync() != GPNVM_OK) ||
+       (gpNvm_GetCacheStats(&before) != GPNVM_OK) || (gpNvm_SetAttribute(ATTRIBUTE_ID_SYNC, sizeof(writeData), &writeData) != GPNVM_OK) ||
+       (gpNvm_GetCacheStats(&deferred) != GPNVM_OK))
+    {
+        printf("Cannot set the attribute synced periodically!\n");
+        return -1;
+    }
+    usleep(3*SYNC_INTERVAL_MS*1000);
+    gpNvm_GetCacheStats(&after);
+
+    if(gpNvm_SetSyncPolicy(GPNVM_SYNC_PERIODIC, 1000) != GPNVM_OK)
+    {
+        return -1;
+    }
+
+    if((deferred.syncs != before.syncs) || (after.syncs != before.syncs + 1))
+    {
+        printf("Error! The last write is not synced when the interval expires (%u syncs)!\n", after.syncs - before.syncs);
+        return -1;
+    }
+    printf("The last write is synced when the interval of %u ms expires!\n", SYNC_INTERVAL_MS);
+    return 0;
+}
+
+/*
+ * Name: gpTest_IncrementCounter
+ *
+ * Description: Thread incrementing the counter attribute CAS_INCREMENTS times with an optimistic
+ * read-modify-write: read, increment, then compare-and-set, retried when another thread was faster.
+ *
+ * Return value: void*: NULL if all increments succeeded, not NULL otherwise
+ */
+static void* gpTest_IncrementCounter(void* pArg)
+{
+    UInt32 counter, newCounter;
+    UInt8 length;
+    gpNvm_Result result;
+
+    (void)pArg;
+
+    for(UInt32 cpt = 0; cpt < CAS_INCREMENTS; cpt++)
+    {
+        do
+        {
+            if(gpNvm_GetAttribute(ATTRIBUTE_ID_COUNTER, &length, (UInt8*)&counter) != GPNVM_OK)
+            {
+                return (void*)1;
+            }
+            newCounter = counter + 1;
+            result = gpNvm_CompareAndSetAttribute(ATTRIBUTE_ID_COUNTER, sizeof(counter), (UInt8*)&counter, sizeof(newCounter), (UInt8*)&newCounter);
+        } while(result == GPNVM_ERROR_COMPARE_FAILED);
+
+        if(result != GPNVM_OK)
+        {
+            return (void*)1;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Name: gpTest_CompareAndSet
+ *
+ * Description: Run CAS_THREADS threads incrementing the same counter attribute with compare-and-set and check
+ * that no increment is lost. Then check that a version token is rejected once the attribute changed.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_CompareAndSet(void)
+{
+    pthread_t threads[CAS_THREADS];
+    void* pThreadResult;
+    UInt32 start = 0, counter = 0;
+#if GPNVM_VERSION_TOKENS
+    UInt32 version, newVersion;
+#endif
+    UInt8 length;
+    int failed = 0;
+
+    //Create the counter if it is not stored yet, it keeps its value from previous runs otherwise
+    if((gpNvm_CompareAndSetAttribute(ATTRIBUTE_ID_COUNTER, 0, NULL, sizeof(start), (UInt8*)&start) == GPNVM_ERROR_COMPARE_FAILED) &&
+       (gpNvm_GetAttribute(ATTRIBUTE_ID_COUNTER, &length, (UInt8*)&start) != GPNVM_OK))
+    {
+        printf("Cannot read the counter attribute!\n");
+        return -1;
+    }
+
+    for(UInt8 cpt = 0; cpt < CAS_THREADS; cpt++)
+    {
+        pthread_create(&threads[cpt], NULL, gpTest_IncrementCounter, NULL);
+    }
+
+    for(UInt8 cpt = 0; cpt < CAS_THREADS; cpt++)
+    {
+        pthread_join(threads[cpt], &pThreadResult);
+        failed |= (pThreadResult != NULL);
+    }
+
+    if(failed || (gpNvm_GetAttribute(ATTRIBUTE_ID_COUNTER, &length, (UInt8*)&counter) != GPNVM_OK) ||
+       (counter != start + CAS_THREADS*CAS_INCREMENTS))
+    {
+        printf("Error! Counter is %u instead of %u!\n", counter, start + CAS_THREADS*CAS_INCREMENTS);
+        return -1;
+    }
+    printf("Counter incremented %d times by %d threads with compare-and-set!\n", CAS_THREADS*CAS_INCREMENTS, CAS_THREADS);
+#if GPNVM_VERSION_TOKENS
+    if(gpNvm_GetAttributeWithVersion(ATTRIBUTE_ID_COUNTER, &length, (UInt8*)&counter, &version) != GPNVM_OK)
+    {
+        printf("Cannot read the counter attribute version!\n");
+        return -1;
+    }
+    //Another update makes the version token read above stale
+    counter++;
+
+    if((gpNvm_SetAttribute(ATTRIBUTE_ID_COUNTER, sizeof(counter), (UInt8*)&counter) != GPNVM_OK) ||
+       (gpNvm_CompareVersionAndSetAttribute(ATTRIBUTE_ID_COUNTER, version, sizeof(counter), (UInt8*)&counter, &newVersion) != GPNVM_ERROR_COMPARE_FAILED) ||
+       (gpNvm_CompareVersionAndSetAttribute(ATTRIBUTE_ID_COUNTER, newVersion, sizeof(counter), (UInt8*)&counter, NULL) != GPNVM_OK))
+    {
+        printf("Error! Stale version token is not rejected!\n");
+        return -1;
+    }
+    printf("Stale version token is rejected!\n");
+#endif
+    return 0;
+}
+
+/*
+ * Name: gpTest_ChangeDetection
+ *
+ * Description: Check that setting the counter attribute to its stored value keeps the store and attribute
+ * versions, and that a real change increments them.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_ChangeDetection(void)
+{
+    UInt32 value = 0, storeVersion = 0, newStoreVersion = 0;
+#if GPNVM_VERSION_TOKENS
+    UInt32 version = 0, newVersion = 0;
+#endif
+    UInt8 length;
+
+    if((gpNvm_GetAttribute(ATTRIBUTE_ID_COUNTER, &length, (UInt8*)&value) != GPNVM_OK) || (gpNvm_GetStoreVersion(&storeVersion) != GPNVM_OK) ||
+       (gpNvm_SetAttribute(ATTRIBUTE_ID_COUNTER, sizeof(value), (UInt8*)&value) != GPNVM_OK) || (gpNvm_GetStoreVersion(&newStoreVersion) != GPNVM_OK) ||
+       (newStoreVersion != storeVersion))
+    {
+        printf("Error! Store version changed without a value change!\n");
+        return -1;
+    }
+#if GPNVM_VERSION_TOKENS
+    gpNvm_GetAttributeVersion(ATTRIBUTE_ID_COUNTER, &version);
+#endif
+    value++;
+
+    if((gpNvm_SetAttribute(ATTRIBUTE_ID_COUNTER, sizeof(value), (UInt8*)&value) != GPNVM_OK) || (gpNvm_GetStoreVersion(&newStoreVersion) != GPNVM_OK) ||
+       (newStoreVersion != storeVersion + 1))
+    {
+        printf("Error! Store version is %u instead of %u!\n", newStoreVersion, storeVersion + 1);
+        return -1;
+    }
+#if GPNVM_VERSION_TOKENS
+    if((gpNvm_GetAttributeVersion(ATTRIBUTE_ID_COUNTER, &newVersion) != GPNVM_OK) || (newVersion != version + 1))
+    {
+        printf("Error! Attribute version is %u instead of %u!\n", newVersion, version + 1);
+        return -1;
+    }
+#endif
+    printf("Store version %u only changes with the values!\n", newStoreVersion);
+    return 0;
+}
+
+#if GPNVM_MAX_SUBSCRIBERS > 0
+/*
+ * Name: gpTest_CountChange
+ *
+ * Description: Subscription callback counting the changes of the counter attribute.
+ *
+ * Return value: None
+ */
+static void gpTest_CountChange(gpNvm_AttrId attrId, void* pContext)
+{
+    if(attrId == ATTRIBUTE_ID_COUNTER)
+    {
+        (*(int*)pContext)++;
+    }
+}
+
+/*
+ * Name: gpTest_Subscribe
+ *
+ * Description: Subscribe to the counter attribute with a callback and an eventfd, then check that setting an
+ * identical value notifies nothing and that a real change calls the callback once and wakes up the eventfd.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_Subscribe(void)
+{
+    int changes = 0;
+    int eventFd = eventfd(0, EFD_NONBLOCK);
+    uint64_t wakeups = 0;
+    UInt32 value = 0;
+    UInt8 length, handle;
+    int failed;
+
+    if((eventFd < 0) || (gpNvm_GetAttribute(ATTRIBUTE_ID_COUNTER, &length, (UInt8*)&value) != GPNVM_OK) ||
+       (gpNvm_Subscribe(ATTRIBUTE_ID_COUNTER, ATTRIBUTE_ID_COUNTER, gpTest_CountChange, &changes, eventFd, &handle) != GPNVM_OK))
+    {
+        printf("Cannot subscribe to the counter attribute!\n");
+        return -1;
+    }
+    gpNvm_SetAttribute(ATTRIBUTE_ID_COUNTER, sizeof(value), (UInt8*)&value);
+    failed = (changes != 0) || (read(eventFd, &wakeups, sizeof(wakeups)) == sizeof(wakeups));
+    value++;
+    gpNvm_SetAttribute(ATTRIBUTE_ID_COUNTER, sizeof(value), (UInt8*)&value);
+    failed |= (changes != 1) || (read(eventFd, &wakeups, sizeof(wakeups)) != sizeof(wakeups)) || (wakeups != 1);
+    gpNvm_Unsubscribe(handle);
+    close(eventFd);
+
+    if(failed)
+    {
+        printf("Error! %d change notifications and %u wakeups instead of 1!\n", changes, (UInt32)wakeups);
+        return -1;
+    }
+    printf("Change of the counter attribute is notified once!\n");
+    return 0;
+}
+#endif
+
+#if GPNVM_MAX_SNAPSHOTS > 0
+/*
+ * Name: gpTest_Snapshot
+ *
+ * Description: Open a snapshot, then change the counter attribute and increment the boot counter. Check that the
+ * snapshot still reads their old values while gpNvm_GetAttribute reads the new ones.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_Snapshot(void)
+{
+    UInt32 value = 0, bootCounter = 0, snapshotValue = 0, snapshotBootCounter = 0, newValue = 0;
+    UInt8 length, handle;
+
+    if((gpNvm_GetAttribute(ATTRIBUTE_ID_COUNTER, &length, (UInt8*)&value) != GPNVM_OK) ||
+       (gpNvm_CounterRead(ATTRIBUTE_ID_BOOT_COUNTER, &bootCounter) != GPNVM_OK) || (gpNvm_SnapshotOpen(&handle) != GPNVM_OK))
+    {
+        printf("Cannot open a snapshot!\n");
+        return -1;
+    }
+    newValue = value + 1;
+
+    if((gpNvm_SetAttribute(ATTRIBUTE_ID_COUNTER, sizeof(newValue), (UInt8*)&newValue) != GPNVM_OK) ||
+       (gpNvm_CounterIncrement(ATTRIBUTE_ID_BOOT_COUNTER, NULL) != GPNVM_OK) ||
+       (gpNvm_SnapshotGet(handle, ATTRIBUTE_ID_COUNTER, &length, (UInt8*)&snapshotValue) != GPNVM_OK) ||
+       (gpNvm_SnapshotGet(handle, ATTRIBUTE_ID_BOOT_COUNTER, &length, (UInt8*)&snapshotBootCounter) != GPNVM_OK) ||
+       (snapshotValue != value) || (snapshotBootCounter != bootCounter) ||
+       (gpNvm_GetAttribute(ATTRIBUTE_ID_COUNTER, &length, (UInt8*)&value) != GPNVM_OK) || (value != newValue))
+    {
+        printf("Error! Snapshot reads %u and %u instead of %u and %u!\n", snapshotValue, snapshotBootCounter, newValue - 1, bootCounter);
+        gpNvm_SnapshotClose(handle);
+        return -1;
+    }
+    gpNvm_SnapshotClose(handle);
+    printf("Snapshot keeps the values of changed attributes!\n");
+    return 0;
+}
+#endif
+
+#if GPNVM_MULTI_PROCESS
+/*
+ * Name: gpTest_MultiProcess
+ *
+ * Description: Fork a process that sets the counter attribute through its own cache, then check that this process
+ * reads the new value and sees the change in its store version.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_MultiProcess(void)
+{
+    UInt32 value = 0, storeVersion = 0, newStoreVersion = 0;
+    UInt8 length;
+    int status = -1;
+    pid_t child;
+
+    if((gpNvm_GetAttribute(ATTRIBUTE_ID_COUNTER, &length, (UInt8*)&value) != GPNVM_OK) || (gpNvm_GetStoreVersion(&storeVersion) != GPNVM_OK))
+    {
+        printf("Cannot read the counter attribute!\n");
+        return -1;
+    }
+    child = fork();
+
+    if(child == 0)
+    {
+        value++;
+        _exit(((gpNvm_SetAttribute(ATTRIBUTE_ID_COUNTER, sizeof(value), (UInt8*)&value) == GPNVM_OK) && (gpNvm_Uninit() == GPNVM_OK)) ? 0 : 1);
+    }
+    waitpid(child, &status, 0);
+
+    if((status != 0) || (gpNvm_GetAttribute(ATTRIBUTE_ID_COUNTER, &length, (UInt8*)&newStoreVersion) != GPNVM_OK) || (newStoreVersion != value + 1) ||
+       (gpNvm_GetStoreVersion(&newStoreVersion) != GPNVM_OK) || (newStoreVersion != storeVersion + 1))
+    {
+        printf("Error! Change of another process is not seen!\n");
+        return -1;
+    }
+    printf("Change of another process is seen!\n");
+    return 0;
+}
+
+/*
+ * Name: gpTest_SharedState
+ *
+ * Description: Leave a shared memory object too small for the shared state under the name of the closed non-volatile
+ * memory file: gpNvm_Init must reject it instead of mapping it. Once it is removed, gpNvm_Init creates the shared state
+ * and the last gpNvm_Uninit removes it.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_SharedState(void)
+{
+    struct stat status;
+    char name[64];
+    int result = 0;
+    int fd = -1;
+
+    if(stat(GPNVM_FILE_NAME, &status) == 0)
+    {
+        snprintf(name, sizeof(name), "%s.%lx.%lx", GPNVM_SHM_NAME, (unsigned long)status.st_dev, (unsigned long)status.st_ino);
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    }
+
+    if((fd < 0) || (ftruncate(fd, sizeof(UInt32)) != 0) || (close(fd) != 0))
+    {
+        printf("Cannot leave a shared memory object for the non-volatile memory file!\n");
+        return -1;
+    }
+
+    if(gpNvm_Init() != GPNVM_ERROR_OPENING_FILE)
+    {
+        printf("Error! A shared memory object too small is mapped!\n");
+        gpNvm_Uninit();
+        result = -1;
+    }
+
+    if((shm_unlink(name) != 0) || (gpNvm_Init() != GPNVM_OK) || (gpNvm_Uninit() != GPNVM_OK))
+    {
+        printf("Cannot open non-volatile memory with a new shared state!\n");
+        return -1;
+    }
+
+    if(shm_unlink(name) == 0)
+    {
+        printf("Error! The shared state is not removed by the last process!\n");
+        result = -1;
+    }
+
+    if(result == 0)
+    {
+        printf("Shared state of another build is rejected, the last process removes it!\n");
+    }
+    return result;
+}
+#endif
+
+/*
+ * Name: gpTest_Counter
+ *
+ * Description: Increment a counter attribute COUNTER_INCREMENTS times, more than the bits of its bitmap so that
+ * it is erased at least once, and check its value. Then check that it cannot be set as a plain attribute.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_Counter(void)
+{
+    UInt32 start = 0, counter = 0;
+
+    //The counter keeps its value from previous runs
+    if((gpNvm_CounterRead(ATTRIBUTE_ID_BOOT_COUNTER, &start) != GPNVM_OK) &&
+       (gpNvm_CounterRead(ATTRIBUTE_ID_BOOT_COUNTER, &start) != GPNVM_ERROR_INVALID_ATTRIBUTE_ID))
+    {
+        printf("Cannot read the boot counter!\n");
+        return -1;
+    }
+
+    for(UInt32 cpt = 0; cpt < COUNTER_INCREMENTS; cpt++)
+    {
+        if((gpNvm_CounterIncrement(ATTRIBUTE_ID_BOOT_COUNTER, &counter) != GPNVM_OK) || (counter != start + cpt + 1))
+        {
+            printf("Error! Boot counter is %u instead of %u!\n", counter, start + cpt + 1);
+            return -1;
+        }
+    }
+
+    if((gpNvm_CounterRead(ATTRIBUTE_ID_BOOT_COUNTER, &counter) != GPNVM_OK) || (counter != start + COUNTER_INCREMENTS) ||
+       (gpNvm_SetAttribute(ATTRIBUTE_ID_BOOT_COUNTER, sizeof(counter), (UInt8*)&counter) != GPNVM_ERROR_INVALID_PARAMETERS))
+    {
+        printf("Error! Boot counter is %u instead of %u, or is set as a plain attribute!\n", counter, start + COUNTER_INCREMENTS);
+        return -1;
+    }
+    printf("Boot counter incremented %d times up to %u!\n", COUNTER_INCREMENTS, counter);
+    return 0;
+}
+
+#if GPNVM_CHANGE_FEED_SIZE > 0
+/*
+ * Name: gpTest_ChangeFeed
+ *
+ * Description: Set, set again to the same value and delete an attribute, and check that the change feed holds its set
+ * and its delete only. Then make FEED_CHANGES changes, more than the feed keeps, and check that the consumer gets a gap
+ * and can read the changes kept, and that a cursor moved off its change gets a gap. The space of the deleted attribute
+ * is reclaimed at the end.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_ChangeFeed(void)
+{
+    gpNvm_FeedCursor cursor, stale;
+    gpNvm_Change change;
+    UInt32 value = 0x12345678;
+    UInt32 read = 0;
+    gpNvm_Result result;
+
+    if((gpNvm_ChangeFeedStart(&cursor) != GPNVM_OK) ||
+       (gpNvm_SetAttribute(ATTRIBUTE_ID_FEED, sizeof(value), (UInt8*)&value) != GPNVM_OK) ||
+       (gpNvm_SetAttribute(ATTRIBUTE_ID_FEED, sizeof(value), (UInt8*)&value) != GPNVM_OK) ||
+       (gpNvm_DeleteAttribute(ATTRIBUTE_ID_FEED) != GPNVM_OK))
+    {
+        printf("Cannot change attribute %d!\n", ATTRIBUTE_ID_FEED);
+        return -1;
+    }
+
+    if((gpNvm_ChangeFeedRead(&cursor, &change) != GPNVM_OK) || (change.type != GPNVM_DELTA_SET) ||
+       (change.attrId != ATTRIBUTE_ID_FEED) || (change.length != sizeof(value)) || (memcmp(change.value, &value, sizeof(value)) != 0) ||
+       (gpNvm_ChangeFeedRead(&cursor, &change) != GPNVM_OK) || (change.type != GPNVM_DELTA_DELETE) ||
+       (gpNvm_ChangeFeedRead(&cursor, &change) != GPNVM_ERROR_NO_CHANGE))
+    {
+        printf("Error! The change feed does not hold the set then the delete of attribute %d!\n", ATTRIBUTE_ID_FEED);
+        return -1;
+    }
+    stale = cursor;
+
+    for(UInt32 cpt = 0; cpt < FEED_CHANGES; cpt++)
+    {
+        if(gpNvm_SetAttribute(ATTRIBUTE_ID_FEED, sizeof(cpt), (UInt8*)&cpt) != GPNVM_OK)
+        {
+            printf("Cannot set attribute %d!\n", ATTRIBUTE_ID_FEED);
+            return -1;
+        }
+    }
+
+    if(gpNvm_ChangeFeedRead(&stale, &change) != GPNVM_ERROR_FEED_GAP)
+    {
+        printf("Error! The change feed reports no gap to a consumer behind it!\n");
+        return -1;
+    }
+
+    //The last change kept is the last value set
+    while((result = gpNvm_ChangeFeedRead(&stale, &change)) == GPNVM_OK)
+    {
+        memcpy(&read, change.value, sizeof(read));
+    }
+
+    if((result != GPNVM_ERROR_NO_CHANGE) || (read != FEED_CHANGES - 1) || (gpNvm_DeleteAttribute(ATTRIBUTE_ID_FEED) != GPNVM_OK) ||
+       (gpNvm_Compact() != GPNVM_OK))
+    {
+        printf("Error! The change feed does not end with the last value set!\n");
+        return -1;
+    }
+    //A cursor whose sequence number is not the one at its position in the ring is not trusted
+    stale.sequence--;
+
+    if((gpNvm_ChangeFeedRead(&stale, &change) != GPNVM_ERROR_FEED_GAP) || (gpNvm_ChangeFeedRead(&stale, &change) != GPNVM_OK))
+    {
+        printf("Error! The change feed reads a cursor off its change!\n");
+        return -1;
+    }
+    printf("Change feed reports a gap after %d changes!\n", FEED_CHANGES);
+    return 0;
+}
+#endif
+
+/*
+ * Name: gpTest_DeleteCompact
+ *
+ * Description: Set DELETE_ATTRIBUTES attributes from ATTRIBUTE_ID_FIRST_DELETE, delete all but the last one and check the
+ * hole they leave, compact and check that the last one is still readable, then delete it and compact again so the
+ * space is left as it was.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_DeleteCompact(void)
+{
+    UInt8 value[MAX_LENGTH], readValue[MAX_LENGTH];
+    UInt8 length = 0;
+    gpNvm_SpaceStats before, holed, compacted;
+    gpNvm_AttrId last = ATTRIBUTE_ID_FIRST_DELETE + DELETE_ATTRIBUTES - 1;
+
+    if(gpNvm_GetSpaceStats(&before) != GPNVM_OK)
+    {
+        printf("Cannot get the space usage!\n");
+        return -1;
+    }
+
+    for(gpNvm_AttrId attrId = ATTRIBUTE_ID_FIRST_DELETE; attrId <= last; attrId++)
+    {
+        //Distinct bytes, so that the values take their length even compressed
+        for(UInt8 cpt = 0; cpt < sizeof(value); cpt++)
+        {
+            value[cpt] = (UInt8)(attrId + cpt);
+        }
+
+        if(gpNvm_SetAttribute(attrId, sizeof(value), value) != GPNVM_OK)
+        {
+            printf("Cannot set attribute %d!\n", attrId);
+            return -1;
+        }
+    }
+
+    for(gpNvm_AttrId attrId = ATTRIBUTE_ID_FIRST_DELETE; attrId < last; attrId++)
+    {
+        if(gpNvm_DeleteAttribute(attrId) != GPNVM_OK)
+        {
+            printf("Cannot delete attribute %d!\n", attrId);
+            return -1;
+        }
+    }
+
+    if((gpNvm_GetAttribute(ATTRIBUTE_ID_FIRST_DELETE, &length, readValue) != GPNVM_ERROR_INVALID_ATTRIBUTE_ID) ||
+       (gpNvm_DeleteAttribute(ATTRIBUTE_ID_FIRST_DELETE) != GPNVM_ERROR_INVALID_ATTRIBUTE_ID) ||
+       (gpNvm_GetSpaceStats(&holed) != GPNVM_OK) || (holed.holeBytes != before.holeBytes + (DELETE_ATTRIBUTES - 1)*(1 + MAX_LENGTH)) ||
+       (gpNvm_Compact() != GPNVM_OK) || (gpNvm_GetSpaceStats(&compacted) != GPNVM_OK) || (compacted.holeBytes != 0))
+    {
+        printf("Error! Deleted attributes are still stored or their space is not reclaimed!\n");
+        return -1;
+    }
+
+    if((gpNvm_GetAttribute(last, &length, readValue) != GPNVM_OK) || (length != sizeof(value)) || (memcmp(value, readValue, length) != 0))
+    {
+        printf("Error! Mismatch between written/read data after compaction!\n");
+        return -1;
+    }
+
+    if((gpNvm_DeleteAttribute(last) != GPNVM_OK) || (gpNvm_Compact() != GPNVM_OK) ||
+       (gpNvm_GetSpaceStats(&compacted) != GPNVM_OK) || (compacted.userMemoryEnd != before.userMemoryEnd - before.holeBytes))
+    {
+        printf("Error! Space of the deleted attributes is not reclaimed!\n");
+        return -1;
+    }
+    printf("Deleted attributes are reclaimed by compaction (%u bytes)!\n", holed.holeBytes);
+    return 0;
+}
+
+/*
+ * Name: gpTest_ReadOnly
+ *
+ * Description: Open the non-volatile memory read-only, as a reader process would, read attribute 4 and the boot
+ * counter from the mapping and check that writes are rejected.
+ *
+ * Parameters:
+ *            UInt32 expected: value of attribute 4
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_ReadOnly(UInt32 expected)
+{
+    UInt32 value = 0, counter = 0;
+    UInt8 length;
+    int result = 0;
+
+    if((gpNvm_SetStorageOptions(GPNVM_STORAGE_READ_ONLY) != GPNVM_OK) || (gpNvm_Init() != GPNVM_OK))
+    {
+        printf("Cannot open non-volatile memory read-only!\n");
+        return -1;
+    }
+
+    if((gpNvm_GetAttribute(ATTRIBUTE_ID_4, &length, (UInt8*)&value) != GPNVM_OK) || (value != expected) ||
+       (gpNvm_CounterRead(ATTRIBUTE_ID_BOOT_COUNTER, &counter) != GPNVM_OK) || (counter < COUNTER_INCREMENTS))
+    {
+        printf("Error! Mismatch between written/read data of the read-only mapping!\n");
+        result = -1;
+    }
+    else if(gpNvm_SetAttribute(ATTRIBUTE_ID_4, sizeof(value), (UInt8*)&value) != GPNVM_ERROR_WRITING_FILE)
+    {
+        printf("Error! Read-only mapping accepted a write!\n");
+        result = -1;
+    }
+
+    if((gpNvm_Uninit() != GPNVM_OK) || (gpNvm_SetStorageOptions(0) != GPNVM_OK))
+    {
+        printf("Cannot close the read-only mapping!\n");
+        return -1;
+    }
+
+    if(result == 0)
+    {
+        printf("Attributes are read from the read-only mapping!\n");
+    }
+    return result;
+}
+
+/*
+ * Name: gpTest_CalculateChecksum
+ *
+ * Description: CRC8 of gpNvm, used to seal a crafted migration journal.
+ *
+ * Parameters:
+ *            const UInt8* ptr: data
+ *            UInt8 length: length of data
+ *
+ * Return value: UInt8: calculated CRC
+ */
+static UInt8 gpTest_CalculateChecksum(const UInt8* ptr, UInt8 length)
+{
+    UInt8 crc = 0xFF;
+
+    for(UInt8 i = 0; i < length; i++)
+    {
+        crc ^= ptr[i];
+
+        for(UInt8 j = 0; j < 8; j++)
+        {
+            crc = ((crc & 0x80) != 0) ? (UInt8)((crc << 1) ^ 0x31) : (UInt8)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/*
+ * Name: gpTest_Upgrade
+ *
+ * Description: Turn the closed non-volatile memory file into a format version 0 image, the areas without the header,
+ * caught in the middle of its upgrade: its last bytes already moved to their offset in the new layout and a journal
+ * recording them in the sector after the image, as left by a crash. gpNvm_Init must resume the migration, drop the
+ * journal, and find attribute 4 and the attributes of gpTest_ManyAttributes intact.
+ *
+ * Parameters:
+ *            UInt32 expected: value of attribute 4
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_Upgrade(UInt32 expected)
+{
+    gpTest_Journal journal;
+    UInt8 sector[GPNVM_SECTOR_SIZE];
+    UInt32 value = 0;
+    UInt32 imageSize, moved;
+    UInt8* pImage = NULL;
+    UInt8 length;
+    struct stat status;
+    int result = 0;
+    int fd = open(GPNVM_FILE_NAME, O_RDWR);
+
+    if((fd < 0) || (fstat(fd, &status) != 0) || ((pImage = malloc(status.st_size)) == NULL) ||
+       (pread(fd, pImage, status.st_size, 0) != status.st_size))
+    {
+        printf("Cannot read the non-volatile memory file!\n");
+        result = -1;
+    }
+    else
+    {
+        //Version 0 has the areas at offset 0, the migration moves them by UPGRADE_HEADER_SIZE starting from the end
+        imageSize = (UInt32)status.st_size;
+        moved = (imageSize >= 3*UPGRADE_HEADER_SIZE) ? 2*UPGRADE_HEADER_SIZE : UPGRADE_HEADER_SIZE;
+        memset(&journal, 0, sizeof(journal));
+        journal.magic = UPGRADE_JOURNAL_MAGIC;
+        journal.version = 0;
+        journal.done = moved;
+        journal.fileSize = imageSize - UPGRADE_HEADER_SIZE;
+        journal.crc = gpTest_CalculateChecksum((UInt8*)&journal, offsetof(gpTest_Journal, crc));
+        memset(sector, 0xFF, sizeof(sector));
+        memcpy(sector, &journal, sizeof(journal));
+
+        //Not moved yet: the old image. Moved: the bytes at their new offset, as in the upgraded image
+        if((pwrite(fd, &pImage[UPGRADE_HEADER_SIZE], imageSize - moved, 0) != (ssize_t)(imageSize - moved)) ||
+           (pwrite(fd, &pImage[imageSize - moved], moved, imageSize - moved) != (ssize_t)moved) ||
+           (pwrite(fd, sector, sizeof(sector), imageSize) != sizeof(sector)))
+        {
+            printf("Cannot write the interrupted migration of the non-volatile memory file!\n");
+            result = -1;
+        }
+    }
+    free(pImage);
+
+    if((fd >= 0) && (close(fd) != 0))
+    {
+        result = -1;
+    }
+
+    if((result != 0) || (gpNvm_Init() != GPNVM_OK))
+    {
+        printf("Cannot resume the interrupted migration of the non-volatile memory file!\n");
+        return -1;
+    }
+
+    if((gpNvm_GetAttribute(ATTRIBUTE_ID_4, &length, (UInt8*)&value) != GPNVM_OK) || (value != expected) || (gpTest_CheckBulk(0) != 0))
+    {
+        printf("Error! Mismatch between written/read data after the migration!\n");
+        result = -1;
+    }
+
+    if((gpNvm_Uninit() != GPNVM_OK) || (stat(GPNVM_FILE_NAME, &status) != 0) || (status.st_size != imageSize))
+    {
+        printf("Error! The migration journal is not dropped!\n");
+        return -1;
+    }
+
+    if(result == 0)
+    {
+        printf("Interrupted upgrade from format version 0 is resumed!\n");
+    }
+    return result;
+}
+
+/*
+ * Name: gpTest_Header
+ *
+ * Description: Change the format version in the header of the closed non-volatile memory file and check that
+ * gpNvm_Init rejects it without touching the file, then restore it and check that attribute 4 is still there.
+ *
+ * Parameters:
+ *            UInt32 expected: value of attribute 4
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_Header(UInt32 expected)
+{
+    UInt32 value = 0;
+    UInt8 length, version;
+    UInt8 newer = 0xFF;
+    int result = 0;
+    int fd = open(GPNVM_FILE_NAME, O_RDWR);
+
+    //The version follows the 4 bytes magic
+    if((fd < 0) || (pread(fd, &version, 1, 4) != 1) || (pwrite(fd, &newer, 1, 4) != 1))
+    {
+        printf("Cannot change the header of the non-volatile memory file!\n");
+        return -1;
+    }
+
+    if(gpNvm_Init() != GPNVM_ERROR_READING_FILE)
+    {
+        printf("Error! A file with an invalid header is accepted!\n");
+        gpNvm_Uninit();
+        result = -1;
+    }
+
+    if((pwrite(fd, &version, 1, 4) != 1) || (close(fd) != 0) || (gpNvm_Init() != GPNVM_OK))
+    {
+        printf("Cannot open non-volatile memory with its header restored!\n");
+        return -1;
+    }
+
+    if((gpNvm_GetAttribute(ATTRIBUTE_ID_4, &length, (UInt8*)&value) != GPNVM_OK) || (value != expected))
+    {
+        printf("Error! Mismatch between written/read data after the header was rejected!\n");
+        result = -1;
+    }
+
+    if(gpNvm_Uninit() != GPNVM_OK)
+    {
+        printf("Cannot uninitialize non-volatile memory!\n");
+        return -1;
+    }
+
+    if(result == 0)
+    {
+        printf("Invalid header is rejected!\n");
+    }
+    return result;
+}
+
+/*
+ * Name: gpTest_FindValue
+ *
+ * Description: Look for a value in a closed file, as the test knows nothing of the layout, and optionally corrupt it
+ * with its length byte, stored just before it.
+ *
+ * Parameters:
+ *            const char* pFileName: path of the file
+ *            const UInt8* pValue: value to look for, unique in the file
+ *            UInt8 length: length of the value
+ *            const UInt8* pMask: length + 1 bytes XORed into the length byte and the value found, NULL to only look
+ *
+ * Return value: int: 0 if the value is found, -1 otherwise
+ */
+static int gpTest_FindValue(const char* pFileName, const UInt8* pValue, UInt8 length, const UInt8* pMask)
+{
+    static UInt8 image[1 << 16];
+    int fd = open(pFileName, O_RDWR);
+    ssize_t size = (fd < 0) ? -1 : pread(fd, image, sizeof(image), 0);
+    int result = -1;
+
+    for(ssize_t offset = 1; (result != 0) && (offset + length <= size); offset++)
+    {
+        if(memcmp(&image[offset], pValue, length) != 0)
+        {
+            continue;
+        }
+        result = 0;
+
+        for(UInt16 cpt = 0; (pMask != NULL) && (cpt <= length); cpt++)
+        {
+            image[offset - 1 + cpt] ^= pMask[cpt];
+        }
+
+        if((pMask != NULL) && (pwrite(fd, &image[offset - 1], length + 1, offset - 1) != length + 1))
+        {
+            result = -1;
+        }
+    }
+
+    if(fd >= 0)
+    {
+        close(fd);
+    }
+    return result;
+}
+
+/*
+ * Name: gpTest_RunTool
+ *
+ * Description: Run gpnvm-tool on the image TOOL_IMAGE_NAME and check its exit status and output.
+ *
+ * Parameters:
+ *            const char* pArguments: command and arguments after the image
+ *            int expectedStatus: exit status expected
+ *            const char* pExpected: text expected in the output, NULL to not check it
+ *
+ * Return value: int: 0 if the tool exits with the expected status and output, -1 otherwise
+ */
+static int gpTest_RunTool(const char* pArguments, int expectedStatus, const char* pExpected)
+{
+    char command[256];
+    char output[TOOL_OUTPUT_SIZE];
+    size_t length = 0;
+    size_t read = 0;
+    int status;
+    FILE* pipe;
+
+    //The messages of the component go to stderr, only the output of the tool is checked
+    snprintf(command, sizeof(command), "%s %s %s 2>/dev/null", TOOL_PATH, TOOL_IMAGE_NAME, pArguments);
+    pipe = popen(command, "r");
+
+    if(pipe == NULL)
+    {
+        printf("Cannot run %s!\n", command);
+        return -1;
+    }
+
+    while((length < sizeof(output) - 1) && ((read = fread(&output[length], 1, sizeof(output) - 1 - length, pipe)) > 0))
+    {
+        length += read;
+    }
+    output[length] = '\0';
+    status = pclose(pipe);
+
+    if(!WIFEXITED(status) || (WEXITSTATUS(status) != expectedStatus) || ((pExpected != NULL) && (strstr(output, pExpected) == NULL)))
+    {
+        printf("Error! gpnvm-tool %s exited with %d, %d expected, and printed:\n%s", pArguments,
+               WIFEXITED(status) ? WEXITSTATUS(status) : -1, expectedStatus, output);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Name: gpTest_Tool
+ *
+ * Description: Run the commands of gpnvm-tool on an image TOOL_IMAGE_NAME holding TOOL_ATTRIBUTES attributes from
+ * ATTRIBUTE_ID_FIRST_TOOL, the middle one deleted: dump, verify and stats, then upgrade after the image is turned into
+ * a format version 0 one, then compact, which must drop its backup. Last the first attribute is corrupted everywhere,
+ * verify must report it and compact must keep the backup. Skipped when the tool is not built next to the test.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_Tool(void)
+{
+    UInt8 value[MAX_LENGTH];
+    UInt8 beyondEcc[MAX_LENGTH + 1] = {0};
+    UInt8* pImage = NULL;
+    struct stat status;
+    char name[64];
+    int result = 0;
+    int fd;
+
+    if(access(TOOL_PATH, X_OK) != 0)
+    {
+        printf("gpnvm-tool is not built, its test is skipped!\n");
+        return 0;
+    }
+    unlink(TOOL_IMAGE_NAME);
+
+    if((gpNvm_SetFileName(TOOL_IMAGE_NAME) != GPNVM_OK) || (gpNvm_Init() != GPNVM_OK))
+    {
+        printf("Cannot create the image of gpnvm-tool!\n");
+        return -1;
+    }
+
+    for(gpNvm_AttrId attrId = ATTRIBUTE_ID_FIRST_TOOL; (result == 0) && (attrId < ATTRIBUTE_ID_FIRST_TOOL + TOOL_ATTRIBUTES); attrId++)
+    {
+        for(UInt8 cpt = 0; cpt < sizeof(value); cpt++)
+        {
+            value[cpt] = (UInt8)(attrId + cpt);
+        }
+
+        if(gpNvm_SetAttribute(attrId, sizeof(value), value) != GPNVM_OK)
+        {
+            result = -1;
+        }
+    }
+
+    if((result != 0) || (gpNvm_DeleteAttribute(ATTRIBUTE_ID_FIRST_TOOL + 1) != GPNVM_OK) || (gpNvm_Uninit() != GPNVM_OK) ||
+       (gpNvm_SetFileName(GPNVM_FILE_NAME) != GPNVM_OK))
+    {
+        printf("Cannot set the attributes of the image of gpnvm-tool!\n");
+        return -1;
+    }
+
+    if((gpTest_RunTool("dump", 0, "0x7b [ 20] 7b 7c") != 0) || (gpTest_RunTool("dump --json", 0, "{\"id\": 125, \"length\": 20") != 0) ||
+       (gpTest_RunTool("verify", 0, "2 attributes valid, 0 corrupted") != 0) || (gpTest_RunTool("stats", 0, "holes:          1, 21 bytes") != 0))
+    {
+        result = -1;
+    }
+
+    //Format version 0 has the areas without the header, it cannot be mapped read-only before it is upgraded
+    fd = open(TOOL_IMAGE_NAME, O_RDWR);
+
+    if((fd < 0) || (fstat(fd, &status) != 0) || ((pImage = malloc(status.st_size)) == NULL) ||
+       (pread(fd, pImage, status.st_size, 0) != status.st_size) ||
+       (pwrite(fd, &pImage[UPGRADE_HEADER_SIZE], status.st_size - UPGRADE_HEADER_SIZE, 0) != status.st_size - UPGRADE_HEADER_SIZE) ||
+       (ftruncate(fd, status.st_size - UPGRADE_HEADER_SIZE) != 0))
+    {
+        printf("Cannot turn the image of gpnvm-tool into format version 0!\n");
+        result = -1;
+    }
+    free(pImage);
+
+    if(fd >= 0)
+    {
+        close(fd);
+    }
+
+    if((result != 0) || (gpTest_RunTool("dump", 2, NULL) != 0) || (gpTest_RunTool("upgrade", 0, "is in the current format") != 0) ||
+       (gpTest_RunTool("verify", 0, "2 attributes valid, 0 corrupted") != 0))
+    {
+        result = -1;
+    }
+
+    if((result != 0) || (gpTest_RunTool("compact", 0, "21 bytes reclaimed from 1 holes") != 0) ||
+       (access(TOOL_IMAGE_NAME ".bak", F_OK) == 0) || (gpTest_RunTool("stats", 0, "holes:          0, 0 bytes") != 0) ||
+       (gpTest_RunTool("dump", 0, "0x7d [ 20] 7d 7e") != 0))
+    {
+        printf("Error! The image is not compacted by gpnvm-tool or its backup is not dropped!\n");
+        result = -1;
+    }
+
+    //Corrupted everywhere, beyond what the ECC corrects, the length byte kept
+    for(UInt8 cpt = 0; cpt < sizeof(value); cpt++)
+    {
+        value[cpt] = (UInt8)(ATTRIBUTE_ID_FIRST_TOOL + cpt);
+    }
+    beyondEcc[1] = 0x01;
+    beyondEcc[1 + GPNVM_ECC_INTERLEAVE] |= 0x02;
+    result |= gpTest_FindValue(TOOL_IMAGE_NAME, value, sizeof(value), beyondEcc);
+
+    for(UInt8 copy = 1; copy <= GPNVM_MIRROR_COPIES; copy++)
+    {
+        snprintf(name, sizeof(name), "%s.%u", TOOL_IMAGE_NAME, copy);
+        result |= gpTest_FindValue(name, value, sizeof(value), beyondEcc);
+    }
+
+    if((result != 0) || (gpTest_RunTool("verify", 1, "0x7b corrupted") != 0) || (gpTest_RunTool("compact", 2, NULL) != 0) ||
+       (access(TOOL_IMAGE_NAME ".bak", F_OK) != 0))
+    {
+        printf("Error! The corrupted image is not reported by gpnvm-tool or its backup is dropped!\n");
+        result = -1;
+    }
+    unlink(TOOL_IMAGE_NAME);
+    unlink(TOOL_IMAGE_NAME ".bak");
+
+    for(UInt8 copy = 1; copy <= GPNVM_MIRROR_COPIES; copy++)
+    {
+        snprintf(name, sizeof(name), "%s.%u", TOOL_IMAGE_NAME, copy);
+        unlink(name);
+    }
+
+    if(result == 0)
+    {
+        printf("gpnvm-tool dumps, verifies, upgrades and compacts the image!\n");
+    }
+    return result;
+}
+
+#if GPNVM_MIRROR_COPIES > 0
+/*
+ * Name: gpTest_Copies
+ *
+ * Description: Corrupt an attribute in the closed non-volatile memory file and check that it is still read, from a copy
+ * of the file, and repaired in the file once it is closed. Then corrupt it in the copies too, so that it is reported
+ * corrupted, and set it again.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_Copies(void)
+{
+    UInt8 value[MAX_LENGTH];
+    UInt8 readData[255];
+    UInt8 bit[MAX_LENGTH + 1] = {0};
+    UInt8 beyondEcc[MAX_LENGTH + 1] = {0};
+    UInt8 length = 0;
+    char name[64];
+    int result = 0;
+
+    for(UInt8 cpt = 0; cpt < sizeof(value); cpt++)
+    {
+        value[cpt] = (UInt8)(0xA0 + cpt);
+    }
+    bit[1] = 0x01;
+    //Two bytes of the same codeword are more than the ECC corrects
+    beyondEcc[1] = 0x01;
+    beyondEcc[1 + GPNVM_ECC_INTERLEAVE] |= 0x02;
+
+    if((gpNvm_Init() != GPNVM_OK) || (gpNvm_SetAttribute(ATTRIBUTE_ID_HEAL, sizeof(value), value) != GPNVM_OK) ||
+       (gpNvm_Uninit() != GPNVM_OK) || (gpTest_FindValue(GPNVM_FILE_NAME, value, sizeof(value), bit) != 0))
+    {
+        printf("Cannot corrupt the non-volatile memory file!\n");
+        return -1;
+    }
+
+    if((gpNvm_Init() != GPNVM_OK) || (gpNvm_GetAttribute(ATTRIBUTE_ID_HEAL, &length, readData) != GPNVM_OK) ||
+       (length != sizeof(value)) || (memcmp(readData, value, sizeof(value)) != 0) || (gpNvm_Uninit() != GPNVM_OK) ||
+       (gpTest_FindValue(GPNVM_FILE_NAME, value, sizeof(value), NULL) != 0))
+    {
+        printf("Error! The corrupted attribute is not read from a copy and repaired!\n");
+        result = -1;
+    }
+    //Corrupted everywhere
+    result |= gpTest_FindValue(GPNVM_FILE_NAME, value, sizeof(value), beyondEcc);
+
+    for(UInt8 copy = 1; copy <= GPNVM_MIRROR_COPIES; copy++)
+    {
+        snprintf(name, sizeof(name), "%s.%u", GPNVM_FILE_NAME, copy);
+        result |= gpTest_FindValue(name, value, sizeof(value), beyondEcc);
+    }
+
+    if((gpNvm_Init() != GPNVM_OK) || (gpNvm_GetAttribute(ATTRIBUTE_ID_HEAL, &length, readData) != GPNVM_ERROR_CORRUPTED_ATTRIBUTE))
+    {
+        printf("Error! An attribute corrupted in every copy is read!\n");
+        result = -1;
+    }
+
+    if((gpNvm_SetAttribute(ATTRIBUTE_ID_HEAL, sizeof(value), value) != GPNVM_OK) || (gpNvm_Uninit() != GPNVM_OK))
+    {
+        printf("Cannot set the corrupted attribute again!\n");
+        return -1;
+    }
+
+    if(result == 0)
+    {
+        printf("Corrupted attribute is read from a copy and repaired!\n");
+    }
+    return result;
+}
+
+/*
+ * Name: gpTest_CopiesNeighbour
+ *
+ * Description: Set an attribute then a neighbour stored right after it, in the same sector, and corrupt the first one
+ * in the closed non-volatile memory file only. Writing the neighbour writes their sector into the copies too, the
+ * corrupted attribute must be repaired first: it must then be sane in the file and in every copy. Both are deleted and
+ * their space reclaimed at the end.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_CopiesNeighbour(void)
+{
+    UInt8 value[MAX_LENGTH];
+    UInt8 readData[255];
+    UInt8 beyondEcc[MAX_LENGTH + 1] = {0};
+    UInt32 neighbour = 0x4E4E4E4E;
+    UInt8 length = 0;
+    char name[64];
+    int result = 0;
+
+    for(UInt8 cpt = 0; cpt < sizeof(value); cpt++)
+    {
+        value[cpt] = (UInt8)(0xC0 + cpt);
+    }
+    beyondEcc[1] = 0x01;
+    beyondEcc[1 + GPNVM_ECC_INTERLEAVE] |= 0x02;
+
+    if((gpNvm_Init() != GPNVM_OK) || (gpNvm_SetAttribute(ATTRIBUTE_ID_SPREAD, sizeof(value), value) != GPNVM_OK) ||
+       (gpNvm_SetAttribute(ATTRIBUTE_ID_NEIGHBOUR, sizeof(neighbour), (UInt8*)&neighbour) != GPNVM_OK) ||
+       (gpNvm_Uninit() != GPNVM_OK) || (gpTest_FindValue(GPNVM_FILE_NAME, value, sizeof(value), beyondEcc) != 0))
+    {
+        printf("Cannot corrupt the non-volatile memory file!\n");
+        return -1;
+    }
+    neighbour = ~neighbour;
+
+    if((gpNvm_Init() != GPNVM_OK) || (gpNvm_SetAttribute(ATTRIBUTE_ID_NEIGHBOUR, sizeof(neighbour), (UInt8*)&neighbour) != GPNVM_OK) ||
+       (gpNvm_Uninit() != GPNVM_OK))
+    {
+        printf("Cannot set the neighbour of the corrupted attribute!\n");
+        return -1;
+    }
+    result |= gpTest_FindValue(GPNVM_FILE_NAME, value, sizeof(value), NULL);
+
+    for(UInt8 copy = 1; copy <= GPNVM_MIRROR_COPIES; copy++)
+    {
+        snprintf(name, sizeof(name), "%s.%u", GPNVM_FILE_NAME, copy);
+        result |= gpTest_FindValue(name, value, sizeof(value), NULL);
+    }
+
+    if(gpNvm_Init() != GPNVM_OK)
+    {
+        printf("Cannot initialize non-volatile memory!\n");
+        return -1;
+    }
+
+    if((result != 0) || (gpNvm_GetAttribute(ATTRIBUTE_ID_SPREAD, &length, readData) != GPNVM_OK) ||
+       (length != sizeof(value)) || (memcmp(readData, value, sizeof(value)) != 0))
+    {
+        printf("Error! The corrupted attribute reached the copies with the write of its neighbour!\n");
+        result = -1;
+    }
+
+    //The space is left as it was for the next run
+    if((gpNvm_DeleteAttribute(ATTRIBUTE_ID_SPREAD) != GPNVM_OK) || (gpNvm_DeleteAttribute(ATTRIBUTE_ID_NEIGHBOUR) != GPNVM_OK) ||
+       (gpNvm_Compact() != GPNVM_OK) || (gpNvm_Uninit() != GPNVM_OK))
+    {
+        printf("Cannot remove the corrupted attribute and its neighbour!\n");
+        return -1;
+    }
+
+    if(result == 0)
+    {
+        printf("Corrupted attribute is repaired before the write of its neighbour!\n");
+    }
+    return result;
+}
+
+/*
+ * Name: gpTest_CopiesMissing
+ *
+ * Description: Create a new non-volatile memory file while its first copy cannot be created, a directory having its
+ * name. gpNvm_Init must fail instead of writing the new image without it.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_CopiesMissing(void)
+{
+    char name[64];
+    int result = 0;
+
+    snprintf(name, sizeof(name), "%s.1", MIRROR_FILE_NAME);
+    unlink(MIRROR_FILE_NAME);
+    unlink(name);
+
+    if((mkdir(name, 0700) != 0) || (gpNvm_SetFileName(MIRROR_FILE_NAME) != GPNVM_OK))
+    {
+        printf("Cannot block the first copy of the file!\n");
+        return -1;
+    }
+
+    if(gpNvm_Init() != GPNVM_ERROR_OPENING_FILE)
+    {
+        printf("Error! A new file is created without its copy!\n");
+        gpNvm_Uninit();
+        result = -1;
+    }
+
+    if((gpNvm_SetFileName(GPNVM_FILE_NAME) != GPNVM_OK) || (rmdir(name) != 0) || (unlink(MIRROR_FILE_NAME) != 0))
+    {
+        printf("Cannot remove the file and the directory blocking its copy!\n");
+        return -1;
+    }
+
+    for(UInt8 copy = 2; copy <= GPNVM_MIRROR_COPIES; copy++)
+    {
+        snprintf(name, sizeof(name), "%s.%u", MIRROR_FILE_NAME, copy);
+        unlink(name);
+    }
+
+    if(result == 0)
+    {
+        printf("File is not created when its copy cannot be!\n");
+    }
+    return result;
+}
+#endif
+
+#if GPNVM_ECC_INTERLEAVE > 0
+/*
+ * Name: gpTest_TimeGets
+ *
+ * Description: Get the ECC test attribute several times and check its value.
+ *
+ * Parameters:
+ *            const UInt8* pValue: expected value, ECC_LENGTH bytes
+ *
+ * Return value: long: time taken by the ECC_OPERATIONS gets in ns, -1 if a get fails or mismatches
+ */
+static long gpTest_TimeGets(const UInt8* pValue)
+{
+    UInt8 readData[255];
+    UInt8 length = 0;
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for(UInt32 cpt = 0; cpt < ECC_OPERATIONS; cpt++)
+    {
+        if((gpNvm_GetAttribute(ATTRIBUTE_ID_ECC, &length, readData) != GPNVM_OK) || (length != ECC_LENGTH) ||
+           (memcmp(readData, pValue, ECC_LENGTH) != 0))
+        {
+            return -1;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec)*1000000000L + (end.tv_nsec - start.tv_nsec);
+}
+
+/*
+ * Name: gpTest_Ecc
+ *
+ * Description: Corrupt an attribute in the closed non-volatile memory file by a flip of its length byte, a burst of
+ * GPNVM_ECC_INTERLEAVE bytes and a bit flip, and check that each time it is corrected on read and repaired in the file
+ * once it is closed. Two bytes corrupted in one codeword must be reported corrupted, unless a copy of the file serves
+ * them. Also measures the cost per byte of the ECC encoding (with the rest of an in-place set, unsynced) and decoding
+ * (corrected get minus clean get).
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_Ecc(void)
+{
+    UInt8 value[ECC_LENGTH];
+    UInt8 readData[255];
+    UInt8 mask[ECC_LENGTH + 1];
+    UInt8 length = 0;
+    struct timespec start, end;
+    long setNs = 0, cleanNs = 0, correctedNs = 0;
+    int result = 0;
+
+    for(UInt8 cpt = 0; cpt < ECC_LENGTH; cpt++)
+    {
+        value[cpt] = (UInt8)(0x13 + 7*cpt);
+    }
+
+    if((gpNvm_Init() != GPNVM_OK) || (gpNvm_SetAttribute(ATTRIBUTE_ID_ECC, ECC_LENGTH, value) != GPNVM_OK) ||
+       (gpNvm_SetSyncPolicy(GPNVM_SYNC_NONE, 0) != GPNVM_OK))
+    {
+        printf("Cannot set the ECC attribute!\n");
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for(UInt32 cpt = 0; (result == 0) && (cpt < ECC_OPERATIONS); cpt++)
+    {
+        value[0] = (UInt8)cpt;
+        result = (gpNvm_SetAttribute(ATTRIBUTE_ID_ECC, ECC_LENGTH, value) == GPNVM_OK) ? 0 : -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    setNs = (end.tv_sec - start.tv_sec)*1000000000L + (end.tv_nsec - start.tv_nsec);
+    cleanNs = gpTest_TimeGets(value);
+
+    if((result != 0) || (cleanNs < 0) || (gpNvm_SetSyncPolicy(GPNVM_SYNC_ALWAYS, 0) != GPNVM_OK) || (gpNvm_Uninit() != GPNVM_OK))
+    {
+        printf("Error! Mismatch between written/read data of the ECC attribute!\n");
+        return -1;
+    }
+
+    for(UInt8 error = 0; error < 3; error++)
+    {
+        memset(mask, 0, sizeof(mask));
+
+        switch(error)
+        {
+            case 0:
+                mask[0] = 0x01;
+                break;
+            case 1:
+                memset(&mask[1 + ECC_LENGTH/4], 0xFF, GPNVM_ECC_INTERLEAVE);
+                break;
+            default:
+                //Last, so that the decoding cost is measured for the most common error
+                mask[1 + ECC_LENGTH/2] = 0x10;
+                break;
+        }
+
+        if(gpTest_FindValue(GPNVM_FILE_NAME, value, ECC_LENGTH, mask) != 0)
+        {
+            printf("Cannot corrupt the non-volatile memory file!\n");
+            return -1;
+        }
+        correctedNs = (gpNvm_Init() == GPNVM_OK) ? gpTest_TimeGets(value) : -1;
+
+        if((correctedNs < 0) || (gpNvm_Uninit() != GPNVM_OK) || (gpTest_FindValue(GPNVM_FILE_NAME, value, ECC_LENGTH, NULL) != 0))
+        {
+            printf("Error! Corrupted attribute is not corrected (error %u)!\n", error);
+            result = -1;
+        }
+    }
+    //Beyond what a codeword corrects
+    memset(mask, 0, sizeof(mask));
+    mask[1] = 0x01;
+    mask[1 + GPNVM_ECC_INTERLEAVE] = 0x01;
+
+    if((gpTest_FindValue(GPNVM_FILE_NAME, value, ECC_LENGTH, mask) != 0) || (gpNvm_Init() != GPNVM_OK) ||
+       (gpNvm_GetAttribute(ATTRIBUTE_ID_ECC, &length, readData) != ((GPNVM_MIRROR_COPIES > 0) ? GPNVM_OK : GPNVM_ERROR_CORRUPTED_ATTRIBUTE)))
+    {
+        printf("Error! An attribute with two corrupted bytes in a codeword is read!\n");
+        result = -1;
+    }
+
+    if((gpNvm_SetAttribute(ATTRIBUTE_ID_ECC, ECC_LENGTH, value) != GPNVM_OK) || (gpNvm_Uninit() != GPNVM_OK))
+    {
+        printf("Cannot set the corrupted attribute again!\n");
+        return -1;
+    }
+
+    if(result == 0)
+    {
+        printf("Corrupted attribute bytes are corrected! (%.2f ns per byte to set, %.2f ns per byte to correct)\n",
+               (double)setNs/ECC_OPERATIONS/ECC_LENGTH, (double)(correctedNs - cleanNs)/ECC_OPERATIONS/ECC_LENGTH);
+    }
+    return result;
+}
+#endif
+
+#if GPNVM_COMPRESSION > 0
+/*
+ * Name: gpTest_Compression
+ *
+ * Description: Set a sparse value, a structure of zeros with a few fields set, and a value without runs, and check
+ * that only the first one is stored compressed. Then fill half of the sparse value so that its compressed form grows
+ * and the attribute moves, set it sparse again so that it is updated in place, and read it after the file is reopened.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_Compression(void)
+{
+    UInt8 sparse[SPARSE_LENGTH], dense[SPARSE_LENGTH], plain[MAX_LENGTH];
+    UInt8 readData[255];
+    UInt8 length = 0;
+    gpNvm_SpaceStats before, stored, moved;
+    int result = 0;
+
+    memset(sparse, 0, sizeof(sparse));
+    sparse[0] = 0x01;
+    sparse[17] = 0x42;
+    memset(&sparse[64], 0xFF, 8);
+    sparse[SPARSE_LENGTH - 1] = 0x7E;
+    memcpy(dense, sparse, sizeof(dense));
+
+    for(UInt8 cpt = 0; cpt < SPARSE_LENGTH/2; cpt++)
+    {
+        dense[cpt] = (UInt8)(0x31 + 3*cpt);
+    }
+
+    for(UInt8 cpt = 0; cpt < sizeof(plain); cpt++)
+    {
+        plain[cpt] = (UInt8)(0xC0 + cpt);
+    }
+
+    if((gpNvm_Init() != GPNVM_OK) || (gpNvm_GetSpaceStats(&before) != GPNVM_OK) ||
+       (gpNvm_SetAttribute(ATTRIBUTE_ID_SPARSE, sizeof(sparse), sparse) != GPNVM_OK) ||
+       (gpNvm_SetAttribute(ATTRIBUTE_ID_PLAIN, sizeof(plain), plain) != GPNVM_OK) || (gpNvm_GetSpaceStats(&stored) != GPNVM_OK))
+    {
+        printf("Cannot set the sparse attribute!\n");
+        return -1;
+    }
+
+    if((stored.compressed != before.compressed + 1) || (stored.savedBytes - before.savedBytes < SPARSE_LENGTH/2) ||
+       (gpNvm_GetAttribute(ATTRIBUTE_ID_SPARSE, &length, readData) != GPNVM_OK) || (length != sizeof(sparse)) ||
+       (memcmp(readData, sparse, sizeof(sparse)) != 0))
+    {
+        printf("Error! The sparse attribute is not stored compressed!\n");
+        result = -1;
+    }
+
+    if((gpNvm_SetAttribute(ATTRIBUTE_ID_SPARSE, sizeof(dense), dense) != GPNVM_OK) || (gpNvm_GetSpaceStats(&moved) != GPNVM_OK) ||
+       (moved.holes <= stored.holes) || (gpNvm_GetAttribute(ATTRIBUTE_ID_SPARSE, &length, readData) != GPNVM_OK) ||
+       (length != sizeof(dense)) || (memcmp(readData, dense, sizeof(dense)) != 0))
+    {
+        printf("Error! The attribute whose compressed value grows is not moved!\n");
+        result = -1;
+    }
+
+    if((gpNvm_SetAttribute(ATTRIBUTE_ID_SPARSE, sizeof(sparse), sparse) != GPNVM_OK) || (gpNvm_GetSpaceStats(&stored) != GPNVM_OK) ||
+       (stored.holes != moved.holes) || (stored.userMemoryEnd > moved.userMemoryEnd) ||
+       (gpNvm_Uninit() != GPNVM_OK) || (gpNvm_Init() != GPNVM_OK) ||
+       (gpNvm_GetAttribute(ATTRIBUTE_ID_SPARSE, &length, readData) != GPNVM_OK) || (length != sizeof(sparse)) ||
+       (memcmp(readData, sparse, sizeof(sparse)) != 0))
+    {
+        printf("Error! The attribute whose compressed value shrinks is not updated in place!\n");
+        result = -1;
+    }
+
+    if((gpNvm_DeleteAttribute(ATTRIBUTE_ID_SPARSE) != GPNVM_OK) || (gpNvm_DeleteAttribute(ATTRIBUTE_ID_PLAIN) != GPNVM_OK) ||
+       (gpNvm_Compact() != GPNVM_OK) || (gpNvm_Uninit() != GPNVM_OK))
+    {
+        printf("Cannot delete the sparse attribute!\n");
+        return -1;
+    }
+
+    if(result == 0)
+    {
+        printf("Sparse attribute of %u bytes is stored compressed in %u bytes!\n", SPARSE_LENGTH,
+               SPARSE_LENGTH - (stored.savedBytes - before.savedBytes));
+    }
+    return result;
+}
+#endif
+
+#if (GPNVM_MAX_SNAPSHOTS > 0) && ((GPNVM_COMPRESSION > 0) || (GPNVM_DEDUP > 0))
+/*
+ * Name: gpTest_SnapshotFull
+ *
+ * Description: Set SNAPSHOT_ATTRIBUTES attributes from ATTRIBUTE_ID_FIRST_SNAPSHOT to a value of SNAPSHOT_LENGTH zero bytes,
+ * stored in a few bytes each (GPNVM_COMPRESSION) or once (GPNVM_DEDUP), open a snapshot and change them all. Their old
+ * values take more room saved decoded and once per attribute in the snapshot than in the user area, more than its arena:
+ * the snapshot must report GPNVM_ERROR_MEMORY_FULL instead of overflowing, and a new snapshot must read the new values.
+ * The attributes are deleted at the end.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_SnapshotFull(void)
+{
+    UInt8 value[SNAPSHOT_LENGTH], newValue[SNAPSHOT_LENGTH], readData[255];
+    UInt8 length = 0, handle;
+    gpNvm_SpaceStats stats;
+    gpNvm_Result expected;
+    int result = 0;
+
+    memset(value, 0, sizeof(value));
+    memset(newValue, 0x5A, sizeof(newValue));
+
+    if((gpNvm_Init() != GPNVM_OK) || (gpNvm_GetSpaceStats(&stats) != GPNVM_OK))
+    {
+        printf("Cannot initialize non-volatile memory!\n");
+        return -1;
+    }
+    //The arena holds the user area and a header per attribute
+    expected = (SNAPSHOT_ATTRIBUTES*(2 + sizeof(value)) > stats.userMemorySize + 256) ? GPNVM_ERROR_MEMORY_FULL : GPNVM_OK;
+
+    for(gpNvm_AttrId attrId = ATTRIBUTE_ID_FIRST_SNAPSHOT; (result == 0) && (attrId < ATTRIBUTE_ID_FIRST_SNAPSHOT + SNAPSHOT_ATTRIBUTES); attrId++)
+    {
+        if(gpNvm_SetAttribute(attrId, sizeof(value), value) != GPNVM_OK)
+        {
+            printf("Cannot set attribute %d!\n", attrId);
+            result = -1;
+        }
+    }
+
+    if((result == 0) && (gpNvm_SnapshotOpen(&handle) != GPNVM_OK))
+    {
+        printf("Cannot open a snapshot!\n");
+        result = -1;
+    }
+
+    for(gpNvm_AttrId attrId = ATTRIBUTE_ID_FIRST_SNAPSHOT; (result == 0) && (attrId < ATTRIBUTE_ID_FIRST_SNAPSHOT + SNAPSHOT_ATTRIBUTES); attrId++)
+    {
+        if(gpNvm_SetAttribute(attrId, sizeof(newValue), newValue) != GPNVM_OK)
+        {
+            printf("Cannot set attribute %d!\n", attrId);
+            result = -1;
+        }
+    }
+
+    for(gpNvm_AttrId attrId = ATTRIBUTE_ID_FIRST_SNAPSHOT; (result == 0) && (attrId < ATTRIBUTE_ID_FIRST_SNAPSHOT + SNAPSHOT_ATTRIBUTES); attrId++)
+    {
+        if((gpNvm_SnapshotGet(handle, attrId, &length, readData) != expected) ||
+           ((expected == GPNVM_OK) && ((length != sizeof(value)) || (memcmp(readData, value, sizeof(value)) != 0))))
+        {
+            printf("Error! The snapshot reads attribute %d although its arena is full!\n", attrId);
+            result = -1;
+        }
+    }
+
+    if((result == 0) && ((gpNvm_SnapshotClose(handle) != GPNVM_OK) || (gpNvm_SnapshotOpen(&handle) != GPNVM_OK) ||
+       (gpNvm_SnapshotGet(handle, ATTRIBUTE_ID_FIRST_SNAPSHOT, &length, readData) != GPNVM_OK) || (length != sizeof(newValue)) ||
+       (memcmp(readData, newValue, sizeof(newValue)) != 0) || (gpNvm_SnapshotClose(handle) != GPNVM_OK)))
+    {
+        printf("Error! A new snapshot does not read the new values!\n");
+        result = -1;
+    }
+
+    for(gpNvm_AttrId attrId = ATTRIBUTE_ID_FIRST_SNAPSHOT; attrId < ATTRIBUTE_ID_FIRST_SNAPSHOT + SNAPSHOT_ATTRIBUTES; attrId++)
+    {
+        gpNvm_DeleteAttribute(attrId);
+    }
+
+    if((gpNvm_Compact() != GPNVM_OK) || (gpNvm_Uninit() != GPNVM_OK))
+    {
+        printf("Cannot delete the attributes of the snapshot!\n");
+        return -1;
+    }
+
+    if(result == 0)
+    {
+        printf("Snapshot reports its full arena instead of overflowing it!\n");
+    }
+    return result;
+}
+#endif
+
+#if GPNVM_DEDUP > 0
+/*
+ * Name: gpTest_CheckShared
+ *
+ * Description: Check that attributes from ATTRIBUTE_ID_FIRST_DEDUP hold a value, skipping the ones set otherwise.
+ *
+ * Parameters:
+ *            gpNvm_AttrId first: first attribute to check
+ *            gpNvm_AttrId skipped: attribute not to check
+ *            const UInt8* pValue: expected value, DEDUP_LENGTH bytes
+ *
+ * Return value: int: 0 if every attribute holds the value, -1 otherwise
+ */
+static int gpTest_CheckShared(gpNvm_AttrId first, gpNvm_AttrId skipped, const UInt8* pValue)
+{
+    UInt8 readData[255];
+    UInt8 length = 0;
+
+    for(gpNvm_AttrId attrId = first; attrId < ATTRIBUTE_ID_FIRST_DEDUP + DEDUP_ATTRIBUTES; attrId++)
+    {
+        if((attrId != skipped) && ((gpNvm_GetAttribute(attrId, &length, readData) != GPNVM_OK) || (length != DEDUP_LENGTH) ||
+           (memcmp(readData, pValue, DEDUP_LENGTH) != 0)))
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Name: gpTest_Dedup
+ *
+ * Description: Provision DEDUP_ATTRIBUTES attributes from ATTRIBUTE_ID_FIRST_DEDUP with the same default value and check
+ * that it is stored once. Then update one of them, which gets its own copy, delete the first one, which stored the value,
+ * and compact: the other ones keep sharing the default value, after the file is reopened too.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_Dedup(void)
+{
+    UInt8 defaultValue[DEDUP_LENGTH], updated[DEDUP_LENGTH];
+    UInt8 readData[255];
+    UInt8 length = 0;
+    gpNvm_AttrId updatedId = ATTRIBUTE_ID_FIRST_DEDUP + 1;
+    gpNvm_SpaceStats before, provisioned, after;
+    int result = 0;
+
+    for(UInt8 cpt = 0; cpt < DEDUP_LENGTH; cpt++)
+    {
+        defaultValue[cpt] = (UInt8)(0x90 ^ (7*cpt));
+        updated[cpt] = (UInt8)(0x0F ^ (5*cpt));
+    }
+
+    if((gpNvm_Init() != GPNVM_OK) || (gpNvm_GetSpaceStats(&before) != GPNVM_OK))
+    {
+        printf("Cannot initialize the shared attributes!\n");
+        return -1;
+    }
+
+    for(gpNvm_AttrId attrId = ATTRIBUTE_ID_FIRST_DEDUP; attrId < ATTRIBUTE_ID_FIRST_DEDUP + DEDUP_ATTRIBUTES; attrId++)
+    {
+        if(gpNvm_SetAttribute(attrId, sizeof(defaultValue), defaultValue) != GPNVM_OK)
+        {
+            printf("Cannot set the shared attributes!\n");
+            return -1;
+        }
+    }
+
+    if((gpNvm_GetSpaceStats(&provisioned) != GPNVM_OK) || (provisioned.shared != before.shared + DEDUP_ATTRIBUTES - 1) ||
+       (provisioned.usedBytes != before.usedBytes + 1 + DEDUP_LENGTH) || (gpTest_CheckShared(ATTRIBUTE_ID_FIRST_DEDUP, 0, defaultValue) != 0))
+    {
+        printf("Error! The default value is not stored once!\n");
+        result = -1;
+    }
+
+    if((gpNvm_SetAttribute(updatedId, sizeof(updated), updated) != GPNVM_OK) || (gpNvm_GetSpaceStats(&after) != GPNVM_OK) ||
+       (after.shared != provisioned.shared - 1) || (after.userMemoryEnd != provisioned.userMemoryEnd + 1 + DEDUP_LENGTH) ||
+       (gpNvm_GetAttribute(updatedId, &length, readData) != GPNVM_OK) || (memcmp(readData, updated, sizeof(updated)) != 0) ||
+       (gpTest_CheckShared(ATTRIBUTE_ID_FIRST_DEDUP, updatedId, defaultValue) != 0))
+    {
+        printf("Error! Updating a shared attribute changes the other ones!\n");
+        result = -1;
+    }
+
+    if((gpNvm_DeleteAttribute(ATTRIBUTE_ID_FIRST_DEDUP) != GPNVM_OK) || (gpNvm_Compact() != GPNVM_OK) ||
+       (gpNvm_GetSpaceStats(&after) != GPNVM_OK) || (after.shared != provisioned.shared - 2) || (after.holes != 0) ||
+       (gpNvm_Uninit() != GPNVM_OK) || (gpNvm_Init() != GPNVM_OK) ||
+       (gpTest_CheckShared(ATTRIBUTE_ID_FIRST_DEDUP + 1, updatedId, defaultValue) != 0) ||
+       (gpNvm_GetAttribute(updatedId, &length, readData) != GPNVM_OK) || (memcmp(readData, updated, sizeof(updated)) != 0))
+    {
+        printf("Error! Deleting the attribute storing a shared value changes the other ones!\n");
+        result = -1;
+    }
+
+    for(gpNvm_AttrId attrId = ATTRIBUTE_ID_FIRST_DEDUP + 1; attrId < ATTRIBUTE_ID_FIRST_DEDUP + DEDUP_ATTRIBUTES; attrId++)
+    {
+        if(gpNvm_DeleteAttribute(attrId) != GPNVM_OK)
+        {
+            printf("Cannot delete the shared attributes!\n");
+            return -1;
+        }
+    }
+
+    if((gpNvm_Compact() != GPNVM_OK) || (gpNvm_Uninit() != GPNVM_OK))
+    {
+        printf("Cannot compact the shared attributes!\n");
+        return -1;
+    }
+
+    if(result == 0)
+    {
+        printf("%u attributes set to the same value of %u bytes store it once!\n", DEDUP_ATTRIBUTES, DEDUP_LENGTH);
+    }
+    return result;
+}
+
+/*
+ * Name: gpTest_RemoveDedupImage
+ *
+ * Description: Remove DEDUP_FILE_NAME and its copies, left by an interrupted run or by gpTest_DedupDelta.
+ *
+ * Return value: None
+ */
+static void gpTest_RemoveDedupImage(void)
+{
+    char name[64];
+
+    unlink(DEDUP_FILE_NAME);
+
+    for(UInt8 copy = 1; copy <= GPNVM_MIRROR_COPIES; copy++)
+    {
+        snprintf(name, sizeof(name), "%s.%u", DEDUP_FILE_NAME, copy);
+        unlink(name);
+    }
+}
+
+/*
+ * Name: gpTest_DedupDelta
+ *
+ * Description: In a store of its own, set attribute 0 to a value of its own and attributes 1 and 2 to a shared one, then
+ * fill the store with other values of the same length. A delta setting attributes 0 and 1 does not fit, since the shared
+ * value is never written in place: it must be rejected with GPNVM_ERROR_MEMORY_FULL before attribute 0 is changed, after
+ * the file is reopened too. The delta is built by hand, see GPNVM_DELTA_MAGIC for its format.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_DedupDelta(void)
+{
+    UInt8 own[DEDUP_LENGTH], shared[DEDUP_LENGTH], filler[DEDUP_LENGTH];
+    UInt8 delta[GPNVM_DELTA_HEADER_SIZE + 2*(3 + DEDUP_LENGTH) + sizeof(UInt32)];
+    UInt8 readData[255];
+    UInt8 length = 0;
+    UInt32 magic = GPNVM_DELTA_MAGIC, digest = 2166136261u;
+    UInt32 offset = GPNVM_DELTA_HEADER_SIZE;
+    UInt16 count = 2;
+    gpNvm_Result fill = GPNVM_OK;
+    int result = 0;
+
+    for(UInt8 cpt = 0; cpt < DEDUP_LENGTH; cpt++)
+    {
+        own[cpt] = (UInt8)(0xA0 + cpt);
+        shared[cpt] = (UInt8)(0xC0 + cpt);
+    }
+    gpTest_RemoveDedupImage();
+
+    if((gpNvm_SetFileName(DEDUP_FILE_NAME) != GPNVM_OK) || (gpNvm_Init() != GPNVM_OK) ||
+       (gpNvm_SetAttribute(0, sizeof(own), own) != GPNVM_OK) || (gpNvm_SetAttribute(1, sizeof(shared), shared) != GPNVM_OK) ||
+       (gpNvm_SetAttribute(2, sizeof(shared), shared) != GPNVM_OK))
+    {
+        printf("Cannot set the attributes of the full store!\n");
+        gpNvm_Uninit();
+        gpNvm_SetFileName(GPNVM_FILE_NAME);
+        return -1;
+    }
+
+    //Values differing by their first bytes, so none is shared nor compressed
+    for(UInt16 attrId = 3; (fill == GPNVM_OK) && (attrId < 256); attrId++)
+    {
+        for(UInt8 cpt = 0; cpt < DEDUP_LENGTH; cpt++)
+        {
+            filler[cpt] = (UInt8)(attrId + cpt);
+        }
+        filler[1] = 0x5A;
+        fill = gpNvm_SetAttribute((gpNvm_AttrId)attrId, sizeof(filler), filler);
+    }
+
+    if(fill != GPNVM_ERROR_MEMORY_FULL)
+    {
+        printf("Cannot fill the store!\n");
+        result = -1;
+    }
+
+    //[magic][count] then [type][attrId][length][value] per record and the FNV-1a digest
+    memcpy(delta, &magic, sizeof(magic));
+    memcpy(&delta[sizeof(magic)], &count, sizeof(count));
+
+    for(UInt8 attrId = 0; attrId < 2; attrId++)
+    {
+        delta[offset] = GPNVM_DELTA_SET;
+        delta[offset + 1] = attrId;
+        delta[offset + 2] = DEDUP_LENGTH;
+
+        for(UInt8 cpt = 0; cpt < DEDUP_LENGTH; cpt++)
+        {
+            delta[offset + 3 + cpt] = (UInt8)(0x10 + 0x80*attrId + cpt);
+        }
+        offset += 3 + DEDUP_LENGTH;
+    }
+
+    for(UInt32 cpt = 0; cpt < offset; cpt++)
+    {
+        digest = (digest ^ delta[cpt])*16777619u;
+    }
+    memcpy(&delta[offset], &digest, sizeof(digest));
+
+    if((result == 0) && (gpNvm_DeltaApply(delta, sizeof(delta)) != GPNVM_ERROR_MEMORY_FULL))
+    {
+        printf("Error! A delta replacing a shared value is applied to a full store!\n");
+        result = -1;
+    }
+
+    if((gpNvm_Uninit() != GPNVM_OK) || (gpNvm_Init() != GPNVM_OK))
+    {
+        printf("Cannot reopen the full store!\n");
+        result = -1;
+    }
+    else if((gpNvm_GetAttribute(0, &length, readData) != GPNVM_OK) || (length != sizeof(own)) ||
+            (memcmp(readData, own, sizeof(own)) != 0) || (gpNvm_GetAttribute(1, &length, readData) != GPNVM_OK) ||
+            (memcmp(readData, shared, sizeof(shared)) != 0))
+    {
+        printf("Error! A rejected delta changes the attributes!\n");
+        result = -1;
+    }
+    gpNvm_Uninit();
+
+    if(gpNvm_SetFileName(GPNVM_FILE_NAME) != GPNVM_OK)
+    {
+        printf("Cannot close the full store!\n");
+        return -1;
+    }
+    gpTest_RemoveDedupImage();
+
+    if(result == 0)
+    {
+        printf("Delta replacing a shared value is rejected by a full store!\n");
+    }
+    return result;
+}
+
+/*
+ * Name: gpTest_DedupHeader
+ *
+ * Description: Record in the header of the closed non-volatile memory file the encoding of a build without
+ * GPNVM_DEDUP. gpNvm_Init must open it and rewrite the header with the encoding of this build, and attribute 4 must
+ * still be there.
+ *
+ * Parameters:
+ *            UInt32 expected: value of attribute 4
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_DedupHeader(UInt32 expected)
+{
+    UInt8 header[DEDUP_ENCODING_OFFSET + 2];
+    UInt32 value = 0;
+    UInt8 length, encoding;
+    int result = 0;
+    int fd = open(GPNVM_FILE_NAME, O_RDWR);
+
+    if((fd < 0) || (pread(fd, header, sizeof(header), 0) != sizeof(header)))
+    {
+        printf("Cannot read the header of the non-volatile memory file!\n");
+        return -1;
+    }
+    //Shared values are in the high nibble, without compression the byte was 0xFF
+    encoding = header[DEDUP_ENCODING_OFFSET];
+    header[DEDUP_ENCODING_OFFSET] = (encoding == 0x10) ? 0xFF : (UInt8)(encoding & 0x0F);
+    header[DEDUP_ENCODING_OFFSET + 1] = gpTest_CalculateChecksum(header, DEDUP_ENCODING_OFFSET + 1);
+
+    if((pwrite(fd, header, sizeof(header), 0) != sizeof(header)) || (gpNvm_Init() != GPNVM_OK))
+    {
+        printf("Error! A file without shared values is rejected!\n");
+        close(fd);
+        return -1;
+    }
+
+    if((gpNvm_GetAttribute(ATTRIBUTE_ID_4, &length, (UInt8*)&value) != GPNVM_OK) || (value != expected))
+    {
+        printf("Error! Mismatch between written/read data in a file without shared values!\n");
+        result = -1;
+    }
+
+    if((gpNvm_Uninit() != GPNVM_OK) || (pread(fd, header, sizeof(header), 0) != sizeof(header)) || (close(fd) != 0))
+    {
+        printf("Cannot uninitialize non-volatile memory!\n");
+        return -1;
+    }
+
+    if(header[DEDUP_ENCODING_OFFSET] != encoding)
+    {
+        printf("Error! The header of a file without shared values is not rewritten!\n");
+        result = -1;
+    }
+
+    if(result == 0)
+    {
+        printf("File without shared values is opened and its header rewritten!\n");
+    }
+    return result;
+}
+#endif
+
+/*
+ * Name: gpTest_Mirror
+ *
+ * Description: Synchronize a mirror file holding an attribute of its own with the closed non-volatile memory file: the
+ * delta built against the signature of the mirror is applied to it, then the mirror must have the same signature and a
+ * new delta must be empty.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_Mirror(void)
+{
+    static UInt8 delta[GPNVM_DELTA_MAX_SIZE];
+    gpNvm_Signature mirror, source;
+    UInt8 value[MAX_LENGTH];
+    UInt32 length = 0, emptyLength = 0;
+    char name[64];
+    int result = 0;
+
+    memset(value, ATTRIBUTE_ID_MIRROR_ONLY, sizeof(value));
+    unlink(MIRROR_FILE_NAME);
+
+    //Copies left by an interrupted run would be taken for the copies of the new mirror
+    for(UInt8 copy = 1; copy <= GPNVM_MIRROR_COPIES; copy++)
+    {
+        snprintf(name, sizeof(name), "%s.%u", MIRROR_FILE_NAME, copy);
+        unlink(name);
+    }
+
+    if((gpNvm_SetFileName(MIRROR_FILE_NAME) != GPNVM_OK) || (gpNvm_Init() != GPNVM_OK) ||
+       (gpNvm_SetAttribute(ATTRIBUTE_ID_MIRROR_ONLY, sizeof(value), value) != GPNVM_OK) ||
+       (gpNvm_GetSignature(&mirror) != GPNVM_OK) || (gpNvm_Uninit() != GPNVM_OK))
+    {
+        printf("Cannot get the signature of the mirror!\n");
+        return -1;
+    }
+
+    if((gpNvm_SetFileName(GPNVM_FILE_NAME) != GPNVM_OK) || (gpNvm_Init() != GPNVM_OK) ||
+       (gpNvm_DiffCreate(&mirror, delta, sizeof(delta), &length) != GPNVM_OK) ||
+       (gpNvm_GetSignature(&source) != GPNVM_OK) || (gpNvm_Uninit() != GPNVM_OK))
+    {
+        printf("Cannot build the delta of the non-volatile memory!\n");
+        return -1;
+    }
+
+    if((gpNvm_SetFileName(MIRROR_FILE_NAME) != GPNVM_OK) || (gpNvm_Init() != GPNVM_OK))
+    {
+        printf("Cannot open the mirror!\n");
+        return -1;
+    }
+    //A corrupted delta is rejected before anything changes
+    delta[GPNVM_DELTA_HEADER_SIZE] ^= 0xFF;
+
+    if(gpNvm_DeltaApply(delta, length) != GPNVM_ERROR_INVALID_PARAMETERS)
+    {
+        printf("Error! A corrupted delta is applied!\n");
+        result = -1;
+    }
+    delta[GPNVM_DELTA_HEADER_SIZE] ^= 0xFF;
+
+    if((gpNvm_DeltaApply(delta, length) != GPNVM_OK) || (gpNvm_GetSignature(&mirror) != GPNVM_OK) ||
+       (memcmp(&mirror, &source, sizeof(mirror)) != 0) || (gpNvm_DiffCreate(&source, NULL, 0, &emptyLength) != GPNVM_OK) ||
+       (emptyLength != GPNVM_DELTA_HEADER_SIZE + sizeof(UInt32)))
+    {
+        printf("Error! Mismatch between the mirror and the non-volatile memory!\n");
+        result = -1;
+    }
+
+    if((gpNvm_Uninit() != GPNVM_OK) || (gpNvm_SetFileName(GPNVM_FILE_NAME) != GPNVM_OK) || (unlink(MIRROR_FILE_NAME) != 0))
+    {
+        printf("Cannot close the mirror!\n");
+        return -1;
+    }
+
+    for(UInt8 copy = 1; copy <= GPNVM_MIRROR_COPIES; copy++)
+    {
+        snprintf(name, sizeof(name), "%s.%u", MIRROR_FILE_NAME, copy);
+
+        if(unlink(name) != 0)
+        {
+            printf("Cannot remove copy %u of the mirror!\n", copy);
+            return -1;
+        }
+    }
+
+    if(result == 0)
+    {
+        printf("Mirror is synchronized by a delta of %u bytes!\n", length);
+    }
+    return result;
+}
+
+/*
+ * Name: gpTest_CheckRecords
+ *
+ * Description: Read back the records set by gpTest_RecordStore: each one filled with its key, except the deleted
+ * record STORE_RECORDS/2.
+ *
+ * Return value: int: 0 if all records match, -1 otherwise
+ */
+static int gpTest_CheckRecords(void)
+{
+    UInt8 writeData[MAX_LENGTH];
+    UInt8 readData[255];
+    UInt8 length;
+
+    for(gpNvmStore_Key key = 0; key < STORE_RECORDS; key++)
+    {
+        memset(writeData, (UInt8)key, sizeof(writeData));
+
+        if(key == STORE_RECORDS/2)
+        {
+            if(gpNvmStore_GetRecord(key, &length, readData) != GPNVM_ERROR_INVALID_ATTRIBUTE_ID)
+            {
+                printf("Error! Record %u is not deleted!\n", key);
+                return -1;
+            }
+        }
+        else if((gpNvmStore_GetRecord(key, &length, readData) != GPNVM_OK) || (length != 1 + key%MAX_LENGTH) || (memcmp(writeData, readData, length) != 0))
+        {
+            printf("Error! Mismatch between written/read data of record %u!\n", key);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Name: gpTest_RecordStore
+ *
+ * Description: Set STORE_RECORDS records in the record store, each one filled with its key and with a length
+ * depending on its key, so that buckets are split and the directory is doubled. Then delete one record, reopen
+ * the store and read them all back.
+ *
+ * Return value: int: 0 if all records match, -1 otherwise
+ */
+static int gpTest_RecordStore(void)
+{
+    UInt8 writeData[MAX_LENGTH];
+    gpNvmStore_Stats stats;
+
+    if(gpNvmStore_Init() != GPNVM_OK)
+    {
+        printf("Cannot initialize the record store!\n");
+        return -1;
+    }
+
+    for(gpNvmStore_Key key = 0; key < STORE_RECORDS; key++)
+    {
+        memset(writeData, (UInt8)key, sizeof(writeData));
+
+        if(gpNvmStore_SetRecord(key, (UInt8)(1 + key%MAX_LENGTH), writeData) != GPNVM_OK)
+        {
+            printf("Cannot set record %u into the record store!\n", key);
+            return -1;
+        }
+    }
+
+    if((gpNvmStore_DeleteRecord(STORE_RECORDS/2) != GPNVM_OK) || (gpNvmStore_Uninit() != GPNVM_OK) || (gpNvmStore_Init() != GPNVM_OK))
+    {
+        printf("Cannot delete a record and reopen the record store!\n");
+        return -1;
+    }
+
+    if(gpTest_CheckRecords() != 0)
+    {
+        return -1;
+    }
+    gpNvmStore_GetStats(&stats);
+    printf("Written/read data of %u records match! (pages=%u depth=%u cache hits=%u misses=%u)\n",
+           stats.records, stats.pages, stats.globalDepth, stats.cache.hits, stats.cache.misses);
+    return (gpNvmStore_Uninit() == GPNVM_OK) ? 0 : -1;
+}
+
+/*
+ * Name: gpTest_RecordStoreCrash
+ *
+ * Description: A child process opens the record store left by gpTest_RecordStore, adds STORE_CRASH_RECORDS records
+ * and updates existing ones, so that committed buckets are split and pages are evicted, then exits without syncing
+ * as if it crashed. The store opened again must hold the records of the last sync, and none of the lost ones.
+ *
+ * Return value: int: 0 if the store is rolled back to its last sync, -1 otherwise
+ */
+static int gpTest_RecordStoreCrash(void)
+{
+    UInt8 writeData[MAX_LENGTH];
+    UInt8 readData[255];
+    UInt8 length;
+    gpNvmStore_Stats stats;
+    int status = -1;
+    pid_t pid;
+
+    pid = fork();
+
+    if(pid == 0)
+    {
+        if(gpNvmStore_Init() != GPNVM_OK)
+        {
+            _exit(1);
+        }
+
+        for(gpNvmStore_Key key = 0; key < STORE_RECORDS + STORE_CRASH_RECORDS; key += (key < STORE_RECORDS) ? 7 : 1)
+        {
+            memset(writeData, (UInt8)~key, sizeof(writeData));
+
+            if(gpNvmStore_SetRecord(key, sizeof(writeData), writeData) != GPNVM_OK)
+            {
+                _exit(1);
+            }
+        }
+        //Crash: the dirty pages and the header are not written
+        _exit(0);
+    }
+
+    if((pid < 0) || (waitpid(pid, &status, 0) != pid) || (status != 0) || (gpNvmStore_Init() != GPNVM_OK))
+    {
+        printf("Cannot update the record store from a crashing process and reopen it!\n");
+        return -1;
+    }
+
+    if(gpTest_CheckRecords() != 0)
+    {
+        return -1;
+    }
+
+    for(gpNvmStore_Key key = STORE_RECORDS; key < STORE_RECORDS + STORE_CRASH_RECORDS; key++)
+    {
+        if(gpNvmStore_GetRecord(key, &length, readData) != GPNVM_ERROR_INVALID_ATTRIBUTE_ID)
+        {
+            printf("Error! Record %u set after the last sync is found after a crash!\n", key);
+            return -1;
+        }
+    }
+    gpNvmStore_GetStats(&stats);
+    printf("Record store is rolled back to its last sync after a crash! (records=%u pages=%u)\n", stats.records, stats.pages);
+    return (gpNvmStore_Uninit() == GPNVM_OK) ? 0 : -1;
+}
+
+/*
+ * Name: gpTest_DaemonReader
+ *
+ * Description: Thread reading the attributes set by gpTest_Daemon through the shared connection of the process,
+ * DAEMON_RING_GETS/CAS_THREADS times.
+ *
+ * Parameters:
+ *            void* pArg: expected values, DAEMON_ATTRIBUTES UInt32
+ *
+ * Return value: void*: NULL if all values match, not NULL otherwise
+ */
+static void* gpTest_DaemonReader(void* pArg)
+{
+    const UInt32* pValues = (const UInt32*)pArg;
+    UInt32 value = 0;
+    UInt8 length;
+
+    for(UInt32 cpt = 0; cpt < DAEMON_RING_GETS/CAS_THREADS; cpt++)
+    {
+        if((gpNvmClient_GetAttribute(ATTRIBUTE_ID_FIRST_DAEMON + cpt%DAEMON_ATTRIBUTES, &length, (UInt8*)&value) != GPNVM_OK) ||
+           (value != pValues[cpt%DAEMON_ATTRIBUTES]))
+        {
+            return (void*)1;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Name: gpTest_Daemon
+ *
+ * Description: Fork a process running the daemon, set DAEMON_ATTRIBUTES attributes through the client library with
+ * pipelined requests, more than one pipeline window, then read them back through the daemon. Then do the same through
+ * the shared memory ring and time DAEMON_RING_GETS gets, then read them from CAS_THREADS threads sharing the ring.
+ *
+ * Return value: int: 0 if the test passes, -1 otherwise
+ */
+static int gpTest_Daemon(void)
+{
+    gpNvm_BulkEntry entries[DAEMON_ATTRIBUTES];
+    UInt32 values[DAEMON_ATTRIBUTES];
+    pthread_t threads[CAS_THREADS];
+    void* pThreadResult;
+    UInt8 readers = 0;
+    struct timespec start, end;
+    UInt32 value = 0;
+    UInt8 length;
+    int status = -1;
+    int result = 0;
+    pid_t child;
+
+    child = fork();
+
+    if(child == 0)
+    {
+        _exit((gpNvmDaemon_Run(GPNVM_DAEMON_SOCKET) == GPNVM_OK) ? 0 : 1);
+    }
+
+    //Wait for the daemon to listen
+    for(UInt8 retry = 0; (retry < 100) && (gpNvmClient_Connect(GPNVM_DAEMON_SOCKET) != GPNVM_OK); retry++)
+    {
+        usleep(10000);
+    }
+
+    for(UInt8 cpt = 0; cpt < DAEMON_ATTRIBUTES; cpt++)
+    {
+        values[cpt] = 0xDA000000 | (ATTRIBUTE_ID_FIRST_DAEMON + cpt);
+        entries[cpt].attrId = ATTRIBUTE_ID_FIRST_DAEMON + cpt;
+        entries[cpt].length = sizeof(values[cpt]);
+        entries[cpt].pValue = (UInt8*)&values[cpt];
+    }
+
+    if(gpNvmClient_SetAttributes(entries, DAEMON_ATTRIBUTES) != GPNVM_OK)
+    {
+        printf("Cannot set attributes through the daemon!\n");
+        result = -1;
+    }
+
+    for(UInt8 cpt = 0; (result == 0) && (cpt < DAEMON_ATTRIBUTES); cpt++)
+    {
+        if((gpNvmClient_GetAttribute(ATTRIBUTE_ID_FIRST_DAEMON + cpt, &length, (UInt8*)&value) != GPNVM_OK) || (value != values[cpt]))
+        {
+            printf("Error! Mismatch between written/read data of attribute %u through the daemon!\n", ATTRIBUTE_ID_FIRST_DAEMON + cpt);
+            result = -1;
+        }
+    }
+
+    //Same through the shared memory ring, then time the gets
+    if((result == 0) && (gpNvmClient_AttachRing() != GPNVM_OK))
+    {
+        printf("Cannot attach the ring of the daemon!\n");
+        result = -1;
+    }
+
+    for(UInt8 cpt = 0; (result == 0) && (cpt < DAEMON_ATTRIBUTES); cpt++)
+    {
+        values[cpt] = ~values[cpt];
+    }
+
+    if((result == 0) && (gpNvmClient_SetAttributes(entries, DAEMON_ATTRIBUTES) != GPNVM_OK))
+    {
+        printf("Cannot set attributes through the ring!\n");
+        result = -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for(UInt32 cpt = 0; (result == 0) && (cpt < DAEMON_RING_GETS); cpt++)
+    {
+        if((gpNvmClient_GetAttribute(ATTRIBUTE_ID_FIRST_DAEMON + cpt%DAEMON_ATTRIBUTES, &length, (UInt8*)&value) != GPNVM_OK) ||
+           (value != values[cpt%DAEMON_ATTRIBUTES]))
+        {
+            printf("Error! Mismatch between written/read data of attribute %u through the ring!\n", ATTRIBUTE_ID_FIRST_DAEMON + cpt%DAEMON_ATTRIBUTES);
+            result = -1;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    for(readers = 0; (result == 0) && (readers < CAS_THREADS); readers++)
+    {
+        pthread_create(&threads[readers], NULL, gpTest_DaemonReader, values);
+    }
+
+    for(UInt8 cpt = 0; cpt < readers; cpt++)
+    {
+        pthread_join(threads[cpt], &pThreadResult);
+
+        if(pThreadResult != NULL)
+        {
+            printf("Error! Mismatch between written/read data of threads sharing the ring!\n");
+            result = -1;
+        }
+    }
+    gpNvmClient_Disconnect();
+    kill(child, SIGTERM);
+    waitpid(child, &status, 0);
+
+    if((result != 0) || (status != 0))
+    {
+        printf("Error! The daemon did not serve the client!\n");
+        return -1;
+    }
+    printf("Written/read data through the daemon match! (%ld ns per get on the ring)\n",
+           ((end.tv_sec - start.tv_sec)*1000000000L + (end.tv_nsec - start.tv_nsec))/DAEMON_RING_GETS);
+    return 0;
+}
+
 int main(int argc, char* argv[])
 {
     UInt8 attr1[MAX_LENGTH];
@@ -79,6 +2524,7 @@ int main(int argc, char* argv[])
         printf("Cannot initialize non-volatile memory!\n");
         return -1;
     }
+    printf("Non-volatile memory RAM footprint: %u bytes\n", gpNvm_GetRamFootprint());
     /* Set/Get attribute 1 data */
     //Write attribute 1 data
 
@@ -281,5 +2727,130 @@ int main(int argc, char* argv[])
         printf("Cannot uninitialize non-volatile memory!\n");
         return -1;
     }
-    return 0;
+    /* Check attributes persist across Uninit/Init with a batching sync policy and O_DIRECT storage */
+    result = gpNvm_SetSyncPolicy(GPNVM_SYNC_PERIODIC, 1000);
+
+    if(result == GPNVM_OK)
+    {
+        result = gpNvm_SetStorageOptions(GPNVM_STORAGE_DIRECT);
+    }
+
+    if(result != GPNVM_OK)
+    {
+        printf("Cannot set sync policy and storage options!\n");
+        return -1;
+    }
+    result = gpNvm_Init();
+
+    if(result != GPNVM_OK)
+    {
+        printf("Cannot re-initialize non-volatile memory!\n");
+        return -1;
+    }
+    memset(readData,0, sizeof(readData));
+    result = gpNvm_GetAttribute(ATTRIBUTE_ID_4, &length,readData);
+    memcpy(&outVar,readData, sizeof(attr4));
+
+    if((result != GPNVM_OK) || (length != sizeof(attr4)) || (outVar != attr4))
+    {
+        printf("Error! Attribute 4 is not persistent!\n");
+        return -1;
+    }
+    printf("Attribute 4 is persistent!\n");
+
+    if((gpTest_SyncDeadline() != 0) || (gpTest_ManyAttributes() != 0) || (gpTest_BulkLoad() != 0) || (gpTest_CompareAndSet() != 0) ||
+       (gpTest_ChangeDetection() != 0) || (gpTest_Counter() != 0))
+    {
+        return -1;
+    }
+#if GPNVM_CHANGE_FEED_SIZE > 0
+    if(gpTest_ChangeFeed() != 0)
+    {
+        return -1;
+    }
+#endif
+    if(gpTest_DeleteCompact() != 0)
+    {
+        return -1;
+    }
+#if GPNVM_MAX_SUBSCRIBERS > 0
+    if(gpTest_Subscribe() != 0)
+    {
+        return -1;
+    }
+#endif
+#if GPNVM_MAX_SNAPSHOTS > 0
+    if(gpTest_Snapshot() != 0)
+    {
+        return -1;
+    }
+#endif
+#if GPNVM_MULTI_PROCESS
+    if(gpTest_MultiProcess() != 0)
+    {
+        return -1;
+    }
+#endif
+    //Update attribute 4 then force a durability point
+    attr4 = 0xdddddddd;
+    memcpy(writeData, &attr4,sizeof(attr4));
+
+    if((gpNvm_SetAttribute(ATTRIBUTE_ID_4, sizeof(attr4),writeData) != GPNVM_OK) || (gpNvm_Sync() != GPNVM_OK))
+    {
+        printf("Cannot update and sync attribute 4!\n");
+        return -1;
+    }
+    result = gpNvm_Uninit();
+
+    if(result != GPNVM_OK)
+    {
+        printf("Cannot uninitialize non-volatile memory!\n");
+        return -1;
+    }
+
+    if((gpTest_ReadOnly(attr4) != 0) || (gpTest_Header(attr4) != 0) || (gpTest_Upgrade(attr4) != 0) || (gpTest_Tool() != 0))
+    {
+        return -1;
+    }
+#if GPNVM_MULTI_PROCESS
+    if(gpTest_SharedState() != 0)
+    {
+        return -1;
+    }
+#endif
+#if GPNVM_MIRROR_COPIES > 0
+    if((gpTest_Copies() != 0) || (gpTest_CopiesNeighbour() != 0) || (gpTest_CopiesMissing() != 0))
+    {
+        return -1;
+    }
+#endif
+#if GPNVM_ECC_INTERLEAVE > 0
+    if(gpTest_Ecc() != 0)
+    {
+        return -1;
+    }
+#endif
+#if GPNVM_COMPRESSION > 0
+    if(gpTest_Compression() != 0)
+    {
+        return -1;
+    }
+#endif
+#if (GPNVM_MAX_SNAPSHOTS > 0) && ((GPNVM_COMPRESSION > 0) || (GPNVM_DEDUP > 0))
+    if(gpTest_SnapshotFull() != 0)
+    {
+        return -1;
+    }
+#endif
+#if GPNVM_DEDUP > 0
+    if((gpTest_Dedup() != 0) || (gpTest_DedupDelta() != 0) || (gpTest_DedupHeader(attr4) != 0))
+    {
+        return -1;
+    }
+#endif
+    if((gpTest_Mirror() != 0) || (gpTest_RecordStore() != 0) || (gpTest_RecordStoreCrash() != 0))
+    {
+        return -1;
+    }
+    return gpTest_Daemon();
 }